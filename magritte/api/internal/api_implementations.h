@@ -21,6 +21,8 @@
 // defined in graph_runners.h.
 
 #include <cstdint>
+#include <memory>
+#include <utility>
 
 #include "mediapipe/framework/calculator.pb.h"
 #include "mediapipe/framework/calculator_framework.h"
@@ -31,6 +33,7 @@
 #include "absl/strings/string_view.h"
 #include "magritte/api/internal/graph_runners.h"
 #include "magritte/api/magritte_api.h"
+#include "magritte/calculators/channel_order_service.h"
 #include "mediapipe/framework/formats/detection.pb.h"
 
 namespace magritte {
@@ -38,26 +41,42 @@ namespace internal {
 
 constexpr absl::string_view kImageInputStreamTag = "input_video";
 constexpr absl::string_view kImageOutputStreamTag = "output_video";
+// Optional input stream of the rotation hints, see magritte_api.h.
+constexpr absl::string_view kRotationInputStreamTag = "rotation_degrees";
+
+// Checks that a rotation hint is a multiple of 90 degrees.
+inline absl::Status CheckRotationHint(int rotation_degrees) {
+  if (rotation_degrees % 90 != 0) {
+    return absl::InvalidArgumentError(
+        "rotation hint must be a multiple of 90 degrees");
+  }
+  return absl::OkStatus();
+}
 
 // An implementation of DeidentifierSync<T>.
 template <typename T>
 class DeidentifierSyncImpl final : public DeidentifierSync<T>,
                                    public GraphRunnerSync {
  public:
-  DeidentifierSyncImpl(const mediapipe::CalculatorGraphConfig& graph_config)
-      : GraphRunnerSync(graph_config) {}
+  DeidentifierSyncImpl(const mediapipe::CalculatorGraphConfig& graph_config,
+                       ChannelOrder channel_order = ChannelOrder::kRgb)
+      : GraphRunnerSync(graph_config, channel_order) {}
 
   // Deidentifies a given frame using the methods defined by GraphRunnerSync.
   absl::StatusOr<std::unique_ptr<T>> Deidentify(std::unique_ptr<T> image,
                                                 int64_t timestamp_us) override {
-    timestamp_mutex_.Lock();
-    MP_RETURN_IF_ERROR(
-        AddToInputStream(kImageInputStreamTag, std::move(image), timestamp_us));
-    Flush(timestamp_us);
-    timestamp_mutex_.Unlock();
-    absl::StatusOr<std::unique_ptr<T>> output =
-        PollOutput<T>(kImageOutputStreamTag);
-    return output;
+    return DeidentifyWithRotationHint(std::move(image), timestamp_us,
+                                      /*rotation_degrees=*/nullptr);
+  }
+
+  // Deidentifies a given frame with a rotation hint using the methods defined
+  // by GraphRunnerSync.
+  absl::StatusOr<std::unique_ptr<T>> Deidentify(
+      std::unique_ptr<T> image, int64_t timestamp_us,
+      int rotation_degrees) override {
+    MP_RETURN_IF_ERROR(CheckRotationHint(rotation_degrees));
+    return DeidentifyWithRotationHint(std::move(image), timestamp_us,
+                                      std::make_unique<int>(rotation_degrees));
   }
 
   // Deidentifies a given frame using the methods defined by GraphRunnerSync.
@@ -67,6 +86,27 @@ class DeidentifierSyncImpl final : public DeidentifierSync<T>,
   }
 
   absl::Status Close() override { return GraphRunnerBase::Close(); }
+
+ private:
+  // Adds the frame and its rotation hint, if any, at the given timestamp and
+  // waits for the deidentified frame.
+  absl::StatusOr<std::unique_ptr<T>> DeidentifyWithRotationHint(
+      std::unique_ptr<T> image, int64_t timestamp_us,
+      std::unique_ptr<int> rotation_degrees) {
+    timestamp_mutex_.Lock();
+    absl::Status status = AddToOptionalInputStream(
+        kRotationInputStreamTag, std::move(rotation_degrees), timestamp_us);
+    if (status.ok()) {
+      status = AddToInputStream(kImageInputStreamTag, std::move(image),
+                                timestamp_us);
+    }
+    Flush(timestamp_us);
+    timestamp_mutex_.Unlock();
+    MP_RETURN_IF_ERROR(status);
+    absl::StatusOr<std::unique_ptr<T>> output =
+        PollOutput<T>(kImageOutputStreamTag);
+    return output;
+  }
 };
 
 // An implementation of DeidentifierAsync<T>.
@@ -75,8 +115,9 @@ class DeidentifierAsyncImpl final : public DeidentifierAsync<T>,
                                     public GraphRunnerAsync {
  public:
   DeidentifierAsyncImpl(const mediapipe::CalculatorGraphConfig& graph_config,
-                        const std::function<absl::Status(const T&)>& callback)
-      : GraphRunnerAsync(graph_config,
+                        const std::function<absl::Status(const T&)>& callback,
+                        ChannelOrder channel_order = ChannelOrder::kRgb)
+      : GraphRunnerAsync(graph_config, channel_order,
                          {{kImageOutputStreamTag,
                            [&callback](const mediapipe::Packet& packet) {
                              return callback(packet.Get<T>());
@@ -85,12 +126,17 @@ class DeidentifierAsyncImpl final : public DeidentifierAsync<T>,
   // Deidentifies a given frame using the methods defined by GraphRunnerAsync.
   absl::Status Deidentify(std::unique_ptr<T> image,
                           int64_t timestamp_us) override {
-    timestamp_mutex_.Lock();
-    absl::Status status = AddToInputStream(std::string(kImageInputStreamTag),
-                                           std::move(image), timestamp_us);
-    Flush(timestamp_us);
-    timestamp_mutex_.Unlock();
-    return status;
+    return DeidentifyWithRotationHint(std::move(image), timestamp_us,
+                                      /*rotation_degrees=*/nullptr);
+  }
+
+  // Deidentifies a given frame with a rotation hint using the methods defined
+  // by GraphRunnerAsync.
+  absl::Status Deidentify(std::unique_ptr<T> image, int64_t timestamp_us,
+                          int rotation_degrees) override {
+    MP_RETURN_IF_ERROR(CheckRotationHint(rotation_degrees));
+    return DeidentifyWithRotationHint(std::move(image), timestamp_us,
+                                      std::make_unique<int>(rotation_degrees));
   }
 
   // Deidentifies a given frame using the methods defined by GraphRunnerAsync.
@@ -99,6 +145,23 @@ class DeidentifierAsyncImpl final : public DeidentifierAsync<T>,
   }
 
   absl::Status Close() override { return GraphRunnerBase::Close(); }
+
+ private:
+  // Adds the frame and its rotation hint, if any, at the given timestamp.
+  absl::Status DeidentifyWithRotationHint(
+      std::unique_ptr<T> image, int64_t timestamp_us,
+      std::unique_ptr<int> rotation_degrees) {
+    timestamp_mutex_.Lock();
+    absl::Status status = AddToOptionalInputStream(
+        kRotationInputStreamTag, std::move(rotation_degrees), timestamp_us);
+    if (status.ok()) {
+      status = AddToInputStream(std::string(kImageInputStreamTag),
+                                std::move(image), timestamp_us);
+    }
+    Flush(timestamp_us);
+    timestamp_mutex_.Unlock();
+    return status;
+  }
 };
 
 // TODO: Implement classes for detection only and redaction only.
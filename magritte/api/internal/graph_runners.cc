@@ -16,7 +16,12 @@
 #include "magritte/api/internal/graph_runners.h"
 
 #include <cstdint>
+#include <memory>
+#include <string>
 
+#include "magritte/calculators/channel_order_service.h"
+#include "magritte/calculators/image_frame_pool.h"
+#include "magritte/calculators/image_frame_pool_service.h"
 #include "mediapipe/framework/port/status.h"
 
 namespace magritte {
@@ -25,11 +30,17 @@ namespace internal {
 // GraphRunnerBase definitions
 
 GraphRunnerBase::GraphRunnerBase(
-    const mediapipe::CalculatorGraphConfig& graph_config)
-    : graph_config_(graph_config) {}
+    const mediapipe::CalculatorGraphConfig& graph_config,
+    ChannelOrder channel_order)
+    : graph_config_(graph_config), channel_order_(channel_order) {}
 
 absl::Status GraphRunnerBase::InitializeGraph() {
-  return graph_.Initialize(graph_config_);
+  MP_RETURN_IF_ERROR(graph_.Initialize(graph_config_));
+  MP_RETURN_IF_ERROR(graph_.SetServiceObject(
+      kChannelOrderService, std::make_shared<ChannelOrder>(channel_order_)));
+  // All the CPU calculators of the graph recycle their frames in one pool.
+  return graph_.SetServiceObject(kImageFramePoolService,
+                                 ImageFramePool::Create());
 }
 
 absl::Status GraphRunnerBase::Close() {
@@ -38,6 +49,15 @@ absl::Status GraphRunnerBase::Close() {
   return graph_.WaitUntilDone();
 }
 
+bool GraphRunnerBase::HasInputStream(absl::string_view input_stream) const {
+  for (const std::string& name : graph_config_.input_stream()) {
+    if (name == input_stream) {
+      return true;
+    }
+  }
+  return false;
+}
+
 // Time in microseconds by how much the timestamp counter will be increased from
 // the previously used timestamp in case no new timestamp is given. The value
 // corresponds to 50fps.
@@ -52,8 +72,9 @@ int64_t GraphRunnerBase::NextTimestamp() { return next_timestamp_; }
 // GraphRunnerSync definitions
 
 GraphRunnerSync::GraphRunnerSync(
-    const mediapipe::CalculatorGraphConfig& graph_config)
-    : GraphRunnerBase(graph_config) {}
+    const mediapipe::CalculatorGraphConfig& graph_config,
+    ChannelOrder channel_order)
+    : GraphRunnerBase(graph_config, channel_order) {}
 
 absl::Status GraphRunnerSync::Preheat() {
   MP_RETURN_IF_ERROR(InitializeGraph());
@@ -70,10 +91,12 @@ absl::Status GraphRunnerSync::Preheat() {
 
 GraphRunnerAsync::GraphRunnerAsync(
     const mediapipe::CalculatorGraphConfig& graph_config,
+    ChannelOrder channel_order,
     absl::flat_hash_map<absl::string_view,
                         std::function<absl::Status(const mediapipe::Packet&)>>
         packet_callbacks)
-    : GraphRunnerBase(graph_config), packet_callbacks_(packet_callbacks) {}
+    : GraphRunnerBase(graph_config, channel_order),
+      packet_callbacks_(packet_callbacks) {}
 
 absl::Status GraphRunnerAsync::Preheat() {
   MP_RETURN_IF_ERROR(InitializeGraph());
@@ -24,6 +24,8 @@
 #include <cstdint>
 #include <functional>
 #include <memory>
+#include <string>
+#include <utility>
 
 #include "mediapipe/framework/calculator.pb.h"
 #include "mediapipe/framework/calculator_framework.h"
@@ -34,6 +36,7 @@
 #include "absl/status/statusor.h"
 #include "absl/strings/string_view.h"
 #include "absl/synchronization/mutex.h"
+#include "magritte/calculators/channel_order_service.h"
 #include "mediapipe/framework/formats/detection.pb.h"
 #include "mediapipe/framework/output_stream_poller.h"
 
@@ -45,11 +48,13 @@ namespace internal {
 // that can be shared between these classes.
 class GraphRunnerBase {
  protected:
-  // Constructor that takes a graph config. Doesn't perform any initialization.
-  GraphRunnerBase(const mediapipe::CalculatorGraphConfig& graph_config);
+  // Constructor that takes a graph config, and the channel order of its frames.
+  // Doesn't perform any initialization.
+  GraphRunnerBase(const mediapipe::CalculatorGraphConfig& graph_config,
+                  ChannelOrder channel_order);
 
-  // Initializes the graph_ field with the graph_config_. Does not yet start
-  // running the graph.
+  // Initializes the graph_ field with the graph_config_, and provides the
+  // channel_order_ to it. Does not yet start running the graph.
   absl::Status InitializeGraph();
 
   // Closes the graphs's input streams and waits for it to be done.
@@ -79,6 +84,32 @@ class GraphRunnerBase {
                                        .At(mediapipe::Timestamp(timestamp_us)));
   }
 
+  // Adds data to an input stream that the graph may not have, at the given
+  // timestamp. Without data, i.e. for a null input, this only tells the input
+  // stream that it has no packet at that timestamp, so that the graph doesn't
+  // wait for one. Does nothing if the graph doesn't have the input stream. Like
+  // AddToInputStream(), this method returns immediately.
+  template <typename T>
+  absl::Status AddToOptionalInputStream(absl::string_view input_stream,
+                                        std::unique_ptr<T> input,
+                                        int64_t timestamp_us) {
+    if (!HasInputStream(input_stream)) {
+      return absl::OkStatus();
+    }
+    if (input != nullptr) {
+      return AddToInputStream(input_stream, std::move(input), timestamp_us);
+    }
+    if (closed_) {
+      return absl::FailedPreconditionError("graph runner has been closed");
+    }
+    return graph_.SetInputStreamTimestampBound(
+        std::string(input_stream),
+        mediapipe::Timestamp(timestamp_us).NextAllowedInStream());
+  }
+
+  // Returns whether the graph has an input stream with the given name.
+  bool HasInputStream(absl::string_view input_stream) const;
+
   // Graph config for the graph to be run. It needs to be stored in a field to
   // be able to query input and output streams.
   mediapipe::CalculatorGraphConfig graph_config_;
@@ -89,6 +120,9 @@ class GraphRunnerBase {
   // Whether the graph has been closed.
   bool closed_ = false;
 
+  // The order of the color channels of the frames given to the graph.
+  ChannelOrder channel_order_;
+
   // A mutex to guard the internal timestamp.
   absl::Mutex timestamp_mutex_;
 
@@ -108,7 +142,8 @@ class GraphRunnerSync : public GraphRunnerBase {
   absl::Status Preheat();
 
  protected:
-  GraphRunnerSync(const mediapipe::CalculatorGraphConfig& graph_config);
+  GraphRunnerSync(const mediapipe::CalculatorGraphConfig& graph_config,
+                  ChannelOrder channel_order);
 
   // Polls output from the given output stream. This method blocks until the
   // output is available.
@@ -145,6 +180,7 @@ class GraphRunnerAsync : public GraphRunnerBase {
  protected:
   GraphRunnerAsync(
       const mediapipe::CalculatorGraphConfig& graph_config,
+      ChannelOrder channel_order,
       absl::flat_hash_map<absl::string_view,
                           std::function<absl::Status(const mediapipe::Packet&)>>
           packet_callbacks);
@@ -22,6 +22,8 @@
 // magritte_api_factory.h.
 
 #include <cstdint>
+#include <memory>
+#include <utility>
 
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
@@ -31,7 +33,7 @@ namespace magritte {
 // A class to deidentify frames synchronously with Magritte. Deidentifying means
 // detecting and redacting sensitive content. The template T can refer to either
 // mediapipe::GpuBuffer or mediapipe::ImageFrame, depending on whether or not a GPU
-// is used.
+// is used, or to mediapipe::YUVImage for YUV frames processed on CPU.
 // At time of creation of an instance of this class, processing threads will be
 // started so that it is immediately ready to consume input.
 template <typename T>
@@ -52,6 +54,19 @@ class DeidentifierSync {
   virtual absl::StatusOr<std::unique_ptr<T>> Deidentify(
       std::unique_ptr<T> image, int64_t timestamp) = 0;
 
+  // Same as above, with a rotation hint: the clockwise rotation in degrees of
+  // the content of the image relative to upright, e.g. from the device
+  // orientation or the EXIF data of the image. It must be a multiple of 90,
+  // otherwise an invalid argument error is returned. Graphs with a
+  // "rotation_degrees" input stream then only detect faces in the hinted
+  // orientation, which saves detection time in 360° graphs. Other graphs ignore
+  // the hint, as does this default implementation, which is only overridden by
+  // the Deidentifiers of the factory methods.
+  virtual absl::StatusOr<std::unique_ptr<T>> Deidentify(
+      std::unique_ptr<T> image, int64_t timestamp, int rotation_degrees) {
+    return Deidentify(std::move(image), timestamp);
+  }
+
   // Deidentifies a given frame, i.e. detects and redacts sensitive content in
   // it and returns the resulting redacted frame. The method blocks until the
   // processing is complete.
@@ -76,7 +91,7 @@ class DeidentifierSync {
 // A class to deidentify frames asynchronously with Magritte. Deidentifying
 // means detecting and redacting sensitive content. The template T can refer to
 // either mediapipe::GpuBuffer or mediapipe::ImageFrame, depending on whether or not
-// a GPU is used.
+// a GPU is used, or to mediapipe::YUVImage for YUV frames processed on CPU.
 // At time of creation of an instance of this class, processing threads will be
 // started so that it is immediately ready to consume input.
 template <typename T>
@@ -99,6 +114,19 @@ class DeidentifierAsync {
   virtual absl::Status Deidentify(std::unique_ptr<T> image,
                                   int64_t timestamp) = 0;
 
+  // Same as above, with a rotation hint: the clockwise rotation in degrees of
+  // the content of the image relative to upright, e.g. from the device
+  // orientation or the EXIF data of the image. It must be a multiple of 90,
+  // otherwise an invalid argument error is returned. Graphs with a
+  // "rotation_degrees" input stream then only detect faces in the hinted
+  // orientation, which saves detection time in 360° graphs. Other graphs ignore
+  // the hint, as does this default implementation, which is only overridden by
+  // the Deidentifiers of the factory methods.
+  virtual absl::Status Deidentify(std::unique_ptr<T> image, int64_t timestamp,
+                                  int rotation_degrees) {
+    return Deidentify(std::move(image), timestamp);
+  }
+
   // Deidentifies a given frame, i.e. detects and redacts sensitive content in
   // it and returns the resulting redacted frame. The method will return
   // immediately. Once the result is ready, a callback will be called.
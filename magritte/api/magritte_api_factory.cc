@@ -31,9 +31,11 @@ namespace {
 // Checks whether the given graph can be used as a deidentifaction graph.
 absl::Status CheckValidDeidentificationGraph(
     const mediapipe::CalculatorGraphConfig& graph_config) {
-  if (graph_config.input_stream_size() != 1) {
+  if (graph_config.input_stream_size() < 1 ||
+      graph_config.input_stream_size() > 2) {
     return absl::InvalidArgumentError(
-        "graph must have exactly one input stream");
+        "graph must have one image input stream and optionally one rotation "
+        "hint input stream");
   }
   if (graph_config.output_stream_size() != 1) {
     return absl::InvalidArgumentError(
@@ -47,6 +49,12 @@ absl::Status CheckValidDeidentificationGraph(
     return absl::InvalidArgumentError(absl::StrCat(
         "input stream must be tagged ", internal::kImageInputStreamTag));
   }
+  if (graph_config.input_stream_size() == 2 &&
+      graph_config.input_stream(1) != internal::kRotationInputStreamTag) {
+    return absl::InvalidArgumentError(
+        absl::StrCat("second input stream must be tagged ",
+                     internal::kRotationInputStreamTag));
+  }
   if (graph_config.output_stream(0) != internal::kImageOutputStreamTag) {
     return absl::InvalidArgumentError(absl::StrCat(
         "output stream must be tagged ", internal::kImageOutputStreamTag));
@@ -58,11 +66,12 @@ constexpr char kMagritteGraphNamespace[] = "magritte";
 }  // namespace
 
 absl::StatusOr<std::unique_ptr<DeidentifierSync<mediapipe::ImageFrame>>>
-CreateCpuDeidentifierSync(const mediapipe::CalculatorGraphConfig& graph_config) {
+CreateCpuDeidentifierSync(const mediapipe::CalculatorGraphConfig& graph_config,
+                          ChannelOrder channel_order) {
   MP_RETURN_IF_ERROR(CheckValidDeidentificationGraph(graph_config));
   auto Deidentifier =
       std::make_unique<internal::DeidentifierSyncImpl<mediapipe::ImageFrame>>(
-          graph_config);
+          graph_config, channel_order);
   MP_RETURN_IF_ERROR(Deidentifier->Preheat());
   return Deidentifier;
 }
@@ -70,10 +79,34 @@ CreateCpuDeidentifierSync(const mediapipe::CalculatorGraphConfig& graph_config)
 absl::StatusOr<std::unique_ptr<DeidentifierAsync<mediapipe::ImageFrame>>>
 CreateCpuDeidentifierAsync(
     const mediapipe::CalculatorGraphConfig& graph_config,
-    std::function<absl::Status(const mediapipe::ImageFrame&)> callback) {
+    std::function<absl::Status(const mediapipe::ImageFrame&)> callback,
+    ChannelOrder channel_order) {
   MP_RETURN_IF_ERROR(CheckValidDeidentificationGraph(graph_config));
   auto Deidentifier =
       std::make_unique<internal::DeidentifierAsyncImpl<mediapipe::ImageFrame>>(
+          graph_config, callback, channel_order);
+  MP_RETURN_IF_ERROR(Deidentifier->Preheat());
+  return Deidentifier;
+}
+
+absl::StatusOr<std::unique_ptr<DeidentifierSync<mediapipe::YUVImage>>>
+CreateYuvDeidentifierSync(
+    const mediapipe::CalculatorGraphConfig& graph_config) {
+  MP_RETURN_IF_ERROR(CheckValidDeidentificationGraph(graph_config));
+  auto Deidentifier =
+      std::make_unique<internal::DeidentifierSyncImpl<mediapipe::YUVImage>>(
+          graph_config);
+  MP_RETURN_IF_ERROR(Deidentifier->Preheat());
+  return Deidentifier;
+}
+
+absl::StatusOr<std::unique_ptr<DeidentifierAsync<mediapipe::YUVImage>>>
+CreateYuvDeidentifierAsync(
+    const mediapipe::CalculatorGraphConfig& graph_config,
+    std::function<absl::Status(const mediapipe::YUVImage&)> callback) {
+  MP_RETURN_IF_ERROR(CheckValidDeidentificationGraph(graph_config));
+  auto Deidentifier =
+      std::make_unique<internal::DeidentifierAsyncImpl<mediapipe::YUVImage>>(
           graph_config, callback);
   MP_RETURN_IF_ERROR(Deidentifier->Preheat());
   return Deidentifier;
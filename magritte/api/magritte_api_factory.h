@@ -30,8 +30,10 @@
 #include "absl/status/statusor.h"
 #include "absl/strings/string_view.h"
 #include "magritte/api/magritte_api.h"
+#include "magritte/calculators/channel_order_service.h"
 #include "mediapipe/framework/formats/detection.pb.h"
 #include "mediapipe/framework/formats/image_frame.h"
+#include "mediapipe/framework/formats/yuv_image.h"
 #include "mediapipe/gpu/gpu_buffer.h"
 #include "mediapipe/framework/port/status.h"
 
@@ -39,18 +41,45 @@ namespace magritte {
 
 // Given a graph, creates a synchronous Deidentifier operating on ImageFrames
 // (for CPU processing).
+// The frames may be SRGB, SRGBA or SBGRA. With ChannelOrder::kBgr, SRGB and
+// SRGBA frames are taken to hold BGR and BGRA data instead, as in OpenCV
+// buffers, so that these can be passed without conversion. Deidentified frames
+// keep the channel order of the input. kBgr is only supported by graphs whose
+// detection models get their frames through ImagePyramidCalculator, and that
+// draw no annotations; other graphs need RGB frames.
 // Returns an error if the given graph is not a top-level graph.
 absl::StatusOr<std::unique_ptr<DeidentifierSync<mediapipe::ImageFrame>>>
-CreateCpuDeidentifierSync(const mediapipe::CalculatorGraphConfig& graph_config);
+CreateCpuDeidentifierSync(const mediapipe::CalculatorGraphConfig& graph_config,
+                          ChannelOrder channel_order = ChannelOrder::kRgb);
 
 // Given a graph, creates an asynchronous Deidentifier operating on ImageFrames
 // (for CPU processing). The Deidentifier will call the callback on each
 // completed frame.
+// The channel_order is as in CreateCpuDeidentifierSync.
 // Returns an error if the given graph is not a top-level graph.
 absl::StatusOr<std::unique_ptr<DeidentifierAsync<mediapipe::ImageFrame>>>
 CreateCpuDeidentifierAsync(
     const mediapipe::CalculatorGraphConfig& graph_config,
-    std::function<absl::Status(const mediapipe::ImageFrame&)> callback);
+    std::function<absl::Status(const mediapipe::ImageFrame&)> callback,
+    ChannelOrder channel_order = ChannelOrder::kRgb);
+
+// Given a graph, creates a synchronous Deidentifier operating on YUVImages (for
+// CPU processing), e.g. the frames of a video decoder, which are deidentified
+// without being converted to RGB. The frames must be 8-bit I420 or NV12 images
+// with an even width and height, and the graph must process YUVImages, e.g.
+// FacePixelizationOfflineYuvCpu.
+// Returns an error if the given graph is not a top-level graph.
+absl::StatusOr<std::unique_ptr<DeidentifierSync<mediapipe::YUVImage>>>
+CreateYuvDeidentifierSync(const mediapipe::CalculatorGraphConfig& graph_config);
+
+// Given a graph, creates an asynchronous Deidentifier operating on YUVImages
+// (for CPU processing), as in CreateYuvDeidentifierSync. The Deidentifier will
+// call the callback on each completed frame.
+// Returns an error if the given graph is not a top-level graph.
+absl::StatusOr<std::unique_ptr<DeidentifierAsync<mediapipe::YUVImage>>>
+CreateYuvDeidentifierAsync(
+    const mediapipe::CalculatorGraphConfig& graph_config,
+    std::function<absl::Status(const mediapipe::YUVImage&)> callback);
 
 #if !defined(MEDIAPIPE_DISABLE_GPU)
 
@@ -0,0 +1,305 @@
+//
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "magritte/calculators/adaptive_sampler_calculator.pb.h"
+#include "magritte/calculators/image_frame_util.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/formats/detection.pb.h"
+#include "mediapipe/framework/formats/image_frame.h"
+#include "mediapipe/framework/formats/location_data.pb.h"
+#include "mediapipe/framework/mediapipe_options.pb.h"
+#include "mediapipe/framework/port/ret_check.h"
+#include "mediapipe/framework/port/status.h"
+#include "mediapipe/framework/stream_handler/sync_set_input_stream_handler.pb.h"
+#include  <opencv2/core.hpp>
+#include  <opencv2/imgproc.hpp>
+
+namespace magritte {
+namespace {
+using ::mediapipe::CalculatorBase;
+using ::mediapipe::CalculatorContext;
+using ::mediapipe::CalculatorContract;
+using ::mediapipe::Detection;
+using ::mediapipe::ImageFrame;
+using ::mediapipe::Timestamp;
+using Detections = std::vector<Detection>;
+
+constexpr char kImageTag[] = "IMAGE";
+constexpr char kTrackedDetectionsTag[] = "TRACKED_DETECTIONS";
+constexpr char kSceneCutTag[] = "SCENE_CUT";
+constexpr char kSampledImageTag[] = "SAMPLED_IMAGE";
+
+// Counters, after the node name: the number of input and sampled frames, whose
+// ratio is the detection rate, the sum of the tracker drifts at the sampled
+// frames in percent of the face sizes, and the number of lost tracks.
+constexpr char kFramesCounterSuffix[] = "/Frames";
+constexpr char kSampledFramesCounterSuffix[] = "/SampledFrames";
+constexpr char kDriftPercentCounterSuffix[] = "/DriftPercent";
+constexpr char kLostTracksCounterSuffix[] = "/LostTracks";
+
+// The size of the thumbnails whose differences measure the frame motion.
+constexpr int kThumbnailSize = 32;
+
+// The center and size of a detection's relative bounding box.
+struct Box {
+  float x_center;
+  float y_center;
+  float size;
+};
+
+Box BoxOf(const Detection& detection) {
+  const auto& box = detection.location_data().relative_bounding_box();
+  return {box.xmin() + box.width() / 2, box.ymin() + box.height() / 2,
+          std::max(box.width(), box.height())};
+}
+}  // namespace
+
+// A calculator that samples a video stream for detection at a rate adapted to
+// the scene, between a minimum rate for static scenes and a maximum rate for
+// fast changes, instead of the fixed rate of a PacketResamplerCalculator.
+//
+// The rate is raised by any of:
+// - the frame motion, measured as the mean absolute difference between small
+//   grayscale thumbnails of consecutive frames;
+// - the tracker drift, measured as the largest displacement of a tracked face
+//   since the last sample, relative to its size, i.e. how far the tracker
+//   carried the face on its own, with growing risk of losing it;
+// - the number of tracks lost since the last sample.
+// A frame is sampled once the time since the last sampled frame reaches the
+// period of the current rate. The first frame is always sampled, and so are
+// scene cuts, after which the tracks of the previous shot are forgotten.
+//
+// The tracked detections are typically looped back from a tracker downstream,
+// which is fed with detections on the sampled frames. They are processed as
+// soon as they arrive, without waiting for them on each frame, so they update
+// the rate of the next frames. Tracked detections from before the last scene
+// cut are ignored.
+//
+// Inputs:
+// - IMAGE: The ImageFrame stream to sample, in SRGB, SRGBA or GRAY8.
+// - TRACKED_DETECTIONS (optional): The tracked detections, as
+//   std::vector<Detection> with relative bounding boxes and track IDs in
+//   detection_id. It should be declared as a back edge when looped back.
+// - SCENE_CUT (optional): A packet of any type for the frames that start a new
+//   scene, e.g. from a SceneCutCalculator.
+//
+// Outputs:
+// - SAMPLED_IMAGE: The sampled frames, as the same packets as the input.
+//
+// Options:
+// - min_frame_rate, max_frame_rate: The range of the sampling rate, in frames
+//   per second. Default is 2 to 10.
+// - motion_threshold: The frame motion at which the maximum rate is used.
+//   Default is 0.05.
+// - drift_threshold: The tracker drift at which the maximum rate is used.
+//   Default is 0.5.
+// - lost_track_weight: The increase of the rate for each lost track, relative
+//   to the range of rates. Default is 0.5.
+//
+// Example config:
+// node {
+//   calculator: "AdaptiveSamplerCalculator"
+//   input_stream: "IMAGE:input_video"
+//   input_stream: "TRACKED_DETECTIONS:tracked_detections"
+//   input_stream_info: {
+//     tag_index: "TRACKED_DETECTIONS"
+//     back_edge: true
+//   }
+//   output_stream: "SAMPLED_IMAGE:sampled_input_video"
+//   options: {
+//     [magritte.AdaptiveSamplerCalculatorOptions.ext] {
+//       min_frame_rate: 2
+//       max_frame_rate: 10
+//     }
+//   }
+// }
+class AdaptiveSamplerCalculator : public CalculatorBase {
+ public:
+  AdaptiveSamplerCalculator() = default;
+  ~AdaptiveSamplerCalculator() override = default;
+
+  static absl::Status GetContract(CalculatorContract* cc) {
+    RET_CHECK(cc->Inputs().HasTag(kImageTag))
+        << "Missing input " << kImageTag << " tag.";
+    cc->Inputs().Tag(kImageTag).Set<ImageFrame>();
+    if (cc->Inputs().HasTag(kTrackedDetectionsTag)) {
+      cc->Inputs().Tag(kTrackedDetectionsTag).Set<Detections>();
+    }
+    if (cc->Inputs().HasTag(kSceneCutTag)) {
+      cc->Inputs().Tag(kSceneCutTag).SetAny();
+    }
+
+    RET_CHECK(cc->Outputs().HasTag(kSampledImageTag))
+        << "Missing output " << kSampledImageTag << " tag.";
+    cc->Outputs().Tag(kSampledImageTag).SetSameAs(&cc->Inputs().Tag(kImageTag));
+
+    // Frames must not wait for the tracked detections of their own timestamp,
+    // which depend on the sampling when looped back, but must be processed
+    // with their scene cuts.
+    mediapipe::MediaPipeOptions handler_options;
+    auto* sync_sets = handler_options.MutableExtension(
+        mediapipe::SyncSetInputStreamHandlerOptions::ext);
+    auto* frame_sync_set = sync_sets->add_sync_set();
+    frame_sync_set->add_tag_index(kImageTag);
+    if (cc->Inputs().HasTag(kSceneCutTag)) {
+      frame_sync_set->add_tag_index(kSceneCutTag);
+    }
+    if (cc->Inputs().HasTag(kTrackedDetectionsTag)) {
+      sync_sets->add_sync_set()->add_tag_index(kTrackedDetectionsTag);
+    }
+    cc->SetInputStreamHandler("SyncSetInputStreamHandler");
+    cc->SetInputStreamHandlerOptions(handler_options);
+    // No input side packets.
+    return absl::OkStatus();
+  }
+
+  absl::Status Open(CalculatorContext* cc) override {
+    options_ = cc->Options<AdaptiveSamplerCalculatorOptions>();
+    RET_CHECK_GT(options_.min_frame_rate(), 0.0f)
+        << "min_frame_rate must be positive.";
+    RET_CHECK_GE(options_.max_frame_rate(), options_.min_frame_rate())
+        << "max_frame_rate must be at least min_frame_rate.";
+    RET_CHECK_GT(options_.motion_threshold(), 0.0f)
+        << "motion_threshold must be positive.";
+    RET_CHECK_GT(options_.drift_threshold(), 0.0f)
+        << "drift_threshold must be positive.";
+    return absl::OkStatus();
+  }
+
+  absl::Status Process(CalculatorContext* cc) override {
+    if (cc->Inputs().HasTag(kTrackedDetectionsTag) &&
+        !cc->Inputs().Tag(kTrackedDetectionsTag).IsEmpty() &&
+        cc->InputTimestamp() >= last_scene_cut_) {
+      UpdateTracks(cc,
+                   cc->Inputs().Tag(kTrackedDetectionsTag).Get<Detections>());
+    }
+    if (cc->Inputs().Tag(kImageTag).IsEmpty()) {
+      return absl::OkStatus();
+    }
+
+    cc->GetCounter(absl::StrCat(cc->NodeName(), kFramesCounterSuffix))
+        ->Increment();
+    ASSIGN_OR_RETURN(
+        cv::Mat thumbnail,
+        GrayThumbnail(cc->Inputs().Tag(kImageTag).Get<ImageFrame>(),
+                      kThumbnailSize, cv::INTER_AREA));
+    float motion = 0.0f;
+    if (!previous_thumbnail_.empty()) {
+      motion = cv::norm(thumbnail, previous_thumbnail_, cv::NORM_L1) /
+               (255.0f * thumbnail.total());
+    }
+    previous_thumbnail_ = thumbnail;
+
+    const Timestamp timestamp = cc->InputTimestamp();
+    const bool scene_cut = cc->Inputs().HasTag(kSceneCutTag) &&
+                           !cc->Inputs().Tag(kSceneCutTag).IsEmpty();
+    if (scene_cut) {
+      last_scene_cut_ = timestamp;
+      tracks_.clear();
+    }
+    if (!scene_cut && last_sample_ != Timestamp::Unset() &&
+        (timestamp - last_sample_).Seconds() < 1.0 / FrameRate(motion)) {
+      cc->Outputs()
+          .Tag(kSampledImageTag)
+          .SetNextTimestampBound(timestamp.NextAllowedInStream());
+      return absl::OkStatus();
+    }
+
+    cc->Outputs()
+        .Tag(kSampledImageTag)
+        .AddPacket(cc->Inputs().Tag(kImageTag).Value());
+    cc->GetCounter(absl::StrCat(cc->NodeName(), kSampledFramesCounterSuffix))
+        ->Increment();
+    cc->GetCounter(absl::StrCat(cc->NodeName(), kDriftPercentCounterSuffix))
+        ->IncrementBy(std::lround(drift_ * 100.0f));
+    last_sample_ = timestamp;
+    anchors_.clear();
+    drift_ = 0.0f;
+    lost_tracks_ = 0;
+    return absl::OkStatus();
+  }
+
+ private:
+  // Updates the drift and the lost tracks since the last sample with the
+  // currently tracked detections.
+  void UpdateTracks(CalculatorContext* cc, const Detections& tracked) {
+    absl::flat_hash_map<int64_t, Box> current;
+    for (const Detection& detection : tracked) {
+      current[detection.detection_id()] = BoxOf(detection);
+    }
+    int lost = 0;
+    for (const auto& id_and_box : tracks_) {
+      if (!current.contains(id_and_box.first)) ++lost;
+    }
+    if (lost > 0) {
+      lost_tracks_ += lost;
+      cc->GetCounter(absl::StrCat(cc->NodeName(), kLostTracksCounterSuffix))
+          ->IncrementBy(lost);
+    }
+    for (const auto& id_and_box : current) {
+      // Tracks are anchored where they are first seen after the last sample.
+      const Box& anchor =
+          anchors_.try_emplace(id_and_box.first, id_and_box.second)
+              .first->second;
+      if (anchor.size > 0.0f) {
+        drift_ = std::max(
+            drift_, std::hypot(id_and_box.second.x_center - anchor.x_center,
+                               id_and_box.second.y_center - anchor.y_center) /
+                        anchor.size);
+      }
+    }
+    tracks_ = std::move(current);
+  }
+
+  // Returns the sampling rate for the given frame motion and the current
+  // tracks.
+  float FrameRate(float motion) const {
+    const float urgency = std::min(
+        1.0f, std::max({motion / options_.motion_threshold(),
+                        drift_ / options_.drift_threshold(),
+                        lost_tracks_ * options_.lost_track_weight()}));
+    return options_.min_frame_rate() +
+           urgency * (options_.max_frame_rate() - options_.min_frame_rate());
+  }
+
+  AdaptiveSamplerCalculatorOptions options_;
+  // The thumbnail of the previous frame.
+  cv::Mat previous_thumbnail_;
+  // The timestamp of the last sampled frame.
+  Timestamp last_sample_ = Timestamp::Unset();
+  // The timestamp of the last scene cut.
+  Timestamp last_scene_cut_ = Timestamp::Min();
+  // The boxes of the currently tracked detections, by track ID.
+  absl::flat_hash_map<int64_t, Box> tracks_;
+  // The boxes of the tracks where they were first seen since the last sample.
+  absl::flat_hash_map<int64_t, Box> anchors_;
+  // The largest drift of a track since the last sample.
+  float drift_ = 0.0f;
+  // The number of tracks lost since the last sample.
+  int lost_tracks_ = 0;
+};
+
+REGISTER_CALCULATOR(AdaptiveSamplerCalculator);
+
+}  // namespace magritte
@@ -0,0 +1,144 @@
+//
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include  <opencv2/core.hpp>
+#include "magritte/calculators/adaptive_sampler_calculator.pb.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/calculator_runner.h"
+#include "mediapipe/framework/formats/image_frame.h"
+#include "mediapipe/framework/formats/image_frame_opencv.h"
+#include "mediapipe/framework/port/gmock.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/parse_text_proto.h"
+#include "mediapipe/framework/port/status_matchers.h"
+
+namespace magritte {
+namespace {
+
+using ::mediapipe::CalculatorRunner;
+using ::mediapipe::ImageFormat;
+using ::mediapipe::ImageFrame;
+using ::mediapipe::Packet;
+using ::mediapipe::Timestamp;
+using ::mediapipe::formats::MatView;
+
+constexpr char kNodeConfig[] = R"pb(
+  calculator: "AdaptiveSamplerCalculator"
+  input_stream: "IMAGE:input_video"
+  output_stream: "SAMPLED_IMAGE:sampled_video"
+  options {
+    [magritte.AdaptiveSamplerCalculatorOptions.ext] {
+      min_frame_rate: 2
+      max_frame_rate: 10
+    }
+  }
+)pb";
+
+// The input frame period, for 20 fps.
+constexpr int64_t kFramePeriodUs = 50000;
+
+// Returns a frame filled with the given gray level, at the given frame index.
+Packet MakeFrame(int level, int index) {
+  auto frame = std::make_unique<ImageFrame>(
+      ImageFormat::SRGB, 64, 48, ImageFrame::kDefaultAlignmentBoundary);
+  MatView(frame.get()).setTo(cv::Scalar(level, level, level));
+  return mediapipe::Adopt(frame.release())
+      .At(Timestamp(index * kFramePeriodUs));
+}
+
+std::vector<int64_t> SampledIndices(const CalculatorRunner& runner) {
+  std::vector<int64_t> indices;
+  for (const auto& packet : runner.Outputs().Tag("SAMPLED_IMAGE").packets) {
+    indices.push_back(packet.Timestamp().Value() / kFramePeriodUs);
+  }
+  return indices;
+}
+
+TEST(AdaptiveSamplerCalculatorTest, SamplesStaticSceneAtMinimumRate) {
+  CalculatorRunner runner(
+      mediapipe::ParseTextProtoOrDie<mediapipe::CalculatorGraphConfig::Node>(
+          kNodeConfig));
+  for (int i = 0; i < 40; ++i) {
+    runner.MutableInputs()->Tag("IMAGE").packets.push_back(MakeFrame(128, i));
+  }
+
+  MP_ASSERT_OK(runner.Run());
+  EXPECT_THAT(SampledIndices(runner), testing::ElementsAre(0, 10, 20, 30));
+  EXPECT_EQ(runner.GetCounter("AdaptiveSamplerCalculator/Frames")->Get(), 40);
+  EXPECT_EQ(runner.GetCounter("AdaptiveSamplerCalculator/SampledFrames")->Get(),
+            4);
+}
+
+TEST(AdaptiveSamplerCalculatorTest, SamplesMovingSceneAtMaximumRate) {
+  CalculatorRunner runner(
+      mediapipe::ParseTextProtoOrDie<mediapipe::CalculatorGraphConfig::Node>(
+          kNodeConfig));
+  for (int i = 0; i < 8; ++i) {
+    runner.MutableInputs()->Tag("IMAGE").packets.push_back(
+        MakeFrame(i % 2 == 0 ? 0 : 255, i));
+  }
+
+  MP_ASSERT_OK(runner.Run());
+  EXPECT_THAT(SampledIndices(runner), testing::ElementsAre(0, 2, 4, 6));
+}
+
+TEST(AdaptiveSamplerCalculatorTest, SamplesSceneCuts) {
+  auto node =
+      mediapipe::ParseTextProtoOrDie<mediapipe::CalculatorGraphConfig::Node>(
+          kNodeConfig);
+  node.add_input_stream("SCENE_CUT:scene_cut");
+  CalculatorRunner runner(node);
+  for (int i = 0; i < 12; ++i) {
+    runner.MutableInputs()->Tag("IMAGE").packets.push_back(MakeFrame(128, i));
+  }
+  runner.MutableInputs()->Tag("SCENE_CUT").packets.push_back(
+      mediapipe::MakePacket<bool>(true).At(Timestamp(3 * kFramePeriodUs)));
+
+  MP_ASSERT_OK(runner.Run());
+  EXPECT_THAT(SampledIndices(runner), testing::ElementsAre(0, 3));
+}
+
+TEST(AdaptiveSamplerCalculatorTest, ForwardsSampledPackets) {
+  CalculatorRunner runner(
+      mediapipe::ParseTextProtoOrDie<mediapipe::CalculatorGraphConfig::Node>(
+          kNodeConfig));
+  const Packet frame = MakeFrame(128, 0);
+  runner.MutableInputs()->Tag("IMAGE").packets.push_back(frame);
+
+  MP_ASSERT_OK(runner.Run());
+  const auto& sampled = runner.Outputs().Tag("SAMPLED_IMAGE").packets;
+  ASSERT_EQ(sampled.size(), 1);
+  EXPECT_EQ(&sampled[0].Get<ImageFrame>(), &frame.Get<ImageFrame>());
+}
+
+TEST(AdaptiveSamplerCalculatorTest, FailsWithInvalidRates) {
+  auto node =
+      mediapipe::ParseTextProtoOrDie<mediapipe::CalculatorGraphConfig::Node>(
+          kNodeConfig);
+  node.mutable_options()
+      ->MutableExtension(AdaptiveSamplerCalculatorOptions::ext)
+      ->set_max_frame_rate(1);
+  CalculatorRunner runner(node);
+  runner.MutableInputs()->Tag("IMAGE").packets.push_back(MakeFrame(128, 0));
+
+  EXPECT_FALSE(runner.Run().ok());
+}
+
+}  // namespace
+}  // namespace magritte
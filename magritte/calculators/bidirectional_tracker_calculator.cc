@@ -0,0 +1,415 @@
+//
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "magritte/calculators/bidirectional_tracker_calculator.pb.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/formats/detection.pb.h"
+#include "mediapipe/framework/formats/image_frame.h"
+#include "mediapipe/framework/formats/image_frame_opencv.h"
+#include "mediapipe/framework/formats/location_data.pb.h"
+#include "mediapipe/framework/port/ret_check.h"
+#include "mediapipe/framework/port/status.h"
+#include  <opencv2/core.hpp>
+#include  <opencv2/imgproc.hpp>
+
+namespace magritte {
+namespace {
+using ::mediapipe::CalculatorBase;
+using ::mediapipe::CalculatorContext;
+using ::mediapipe::CalculatorContract;
+using ::mediapipe::Detection;
+using ::mediapipe::ImageFormat;
+using ::mediapipe::ImageFrame;
+using ::mediapipe::LocationData;
+using ::mediapipe::Packet;
+using ::mediapipe::formats::MatView;
+using Detections = std::vector<Detection>;
+
+constexpr char kImageTag[] = "IMAGE";
+constexpr char kDetectionsTag[] = "DETECTIONS";
+
+// Boxes smaller than this, in pixels of the tracked frames, are not searched
+// for, and stay in place.
+constexpr int kMinTemplateSize = 4;
+
+const LocationData::RelativeBoundingBox& Box(const Detection& detection) {
+  return detection.location_data().relative_bounding_box();
+}
+
+float IntersectionOverUnion(const Detection& a, const Detection& b) {
+  const auto& box_a = Box(a);
+  const auto& box_b = Box(b);
+  const float width =
+      std::min(box_a.xmin() + box_a.width(), box_b.xmin() + box_b.width()) -
+      std::max(box_a.xmin(), box_b.xmin());
+  const float height =
+      std::min(box_a.ymin() + box_a.height(), box_b.ymin() + box_b.height()) -
+      std::max(box_a.ymin(), box_b.ymin());
+  if (width <= 0 || height <= 0) return 0.0f;
+  const float intersection = width * height;
+  return intersection / (box_a.width() * box_a.height() +
+                         box_b.width() * box_b.height() - intersection);
+}
+
+// Returns the pairs of indices of a and b matched greedily by decreasing
+// intersection over union, from min_iou up.
+std::vector<std::pair<int, int>> MatchDetections(const Detections& a,
+                                                 const Detections& b,
+                                                 float min_iou) {
+  std::vector<std::tuple<float, int, int>> candidates;
+  const int num_a = static_cast<int>(a.size());
+  const int num_b = static_cast<int>(b.size());
+  for (int i = 0; i < num_a; ++i) {
+    for (int j = 0; j < num_b; ++j) {
+      const float iou = IntersectionOverUnion(a[i], b[j]);
+      if (iou >= min_iou) candidates.emplace_back(iou, i, j);
+    }
+  }
+  std::sort(candidates.begin(), candidates.end(),
+            [](const auto& x, const auto& y) {
+              return std::get<0>(x) > std::get<0>(y);
+            });
+  std::vector<bool> a_matched(a.size(), false);
+  std::vector<bool> b_matched(b.size(), false);
+  std::vector<std::pair<int, int>> matches;
+  for (const auto& [iou, i, j] : candidates) {
+    if (a_matched[i] || b_matched[j]) continue;
+    a_matched[i] = true;
+    b_matched[j] = true;
+    matches.emplace_back(i, j);
+  }
+  return matches;
+}
+
+// Moves the box and keypoints of a detection by (dx, dy), in normalized
+// coordinates.
+void MoveDetection(float dx, float dy, Detection* detection) {
+  LocationData* location_data = detection->mutable_location_data();
+  auto* box = location_data->mutable_relative_bounding_box();
+  box->set_xmin(box->xmin() + dx);
+  box->set_ymin(box->ymin() + dy);
+  for (auto& keypoint : *location_data->mutable_relative_keypoints()) {
+    keypoint.set_x(keypoint.x() + dx);
+    keypoint.set_y(keypoint.y() + dy);
+  }
+}
+}  // namespace
+
+// A calculator that tracks faces detected on sparse keyframes both forward and
+// backward in time, for offline graphs to detect faces on 1 in N frames only.
+//
+// A tracker that only goes forward misses the faces before their first
+// detection, so offline graphs run the detection on every frame. Instead, this
+// calculator buffers the frames between two keyframes, then tracks the faces of
+// the first keyframe forward and those of the second keyframe backward through
+// them, and merges both: the forward and backward boxes of the same face, with
+// enough overlap, are interpolated by the distance to each keyframe, so that
+// the size of the faces changes smoothly, while the faces only tracked one way,
+// e.g. faces appearing or leaving between keyframes, are kept as is. The frames
+// before the first keyframe are only tracked backward, and those after the last
+// keyframe only forward.
+//
+// Faces are tracked by template matching, with their normalized correlation in
+// a search window around their previous position, and a track ends when the
+// best match is below min_score. Tracking runs on small grayscale frames, e.g.
+// the GRAY8 proxy of ImagePyramidCalculator, which is all that is buffered.
+//
+// The faces are given a track ID in detection_id: the faces of a keyframe take
+// the ID of the forward tracks that reach them, and new IDs otherwise.
+//
+// The output is delayed until the next keyframe, so this calculator is meant
+// for offline graphs.
+//
+// Inputs:
+// - IMAGE: The GRAY8 ImageFrame stream in which the faces are tracked, with a
+//   packet for every frame.
+// - DETECTIONS: The faces detected on the keyframes, as std::vector<Detection>
+//   with relative bounding boxes. The frames with a packet, even empty, are the
+//   keyframes.
+//
+// Outputs:
+// - DETECTIONS: The tracked faces of every frame, as std::vector<Detection>.
+//
+// Options:
+// - search_margin: The margin around a box, as a fraction of its size on each
+//   side, in which it is searched for in the next frame. Default is 0.5.
+// - min_score: The minimum normalized correlation of a box with its best match
+//   for the track to continue. Default is 0.5.
+// - min_iou: The minimum intersection over union for two boxes to be the same
+//   face. Default is 0.3.
+//
+// Example config:
+// node {
+//   calculator: "BidirectionalTrackerCalculator"
+//   input_stream: "IMAGE:tracking_proxy"
+//   input_stream: "DETECTIONS:keyframe_detections"
+//   output_stream: "DETECTIONS:tracked_detections"
+//   options: {
+//     [magritte.BidirectionalTrackerCalculatorOptions.ext] {
+//       search_margin: 0.5
+//       min_score: 0.5
+//     }
+//   }
+// }
+class BidirectionalTrackerCalculator : public CalculatorBase {
+ public:
+  BidirectionalTrackerCalculator() = default;
+  ~BidirectionalTrackerCalculator() override = default;
+
+  static absl::Status GetContract(CalculatorContract* cc) {
+    RET_CHECK(cc->Inputs().HasTag(kImageTag))
+        << "Missing input " << kImageTag << " tag.";
+    cc->Inputs().Tag(kImageTag).Set<ImageFrame>();
+    RET_CHECK(cc->Inputs().HasTag(kDetectionsTag))
+        << "Missing input " << kDetectionsTag << " tag.";
+    cc->Inputs().Tag(kDetectionsTag).Set<Detections>();
+    RET_CHECK(cc->Outputs().HasTag(kDetectionsTag))
+        << "Missing output " << kDetectionsTag << " tag.";
+    cc->Outputs().Tag(kDetectionsTag).Set<Detections>();
+    // No input side packets.
+    return absl::OkStatus();
+  }
+
+  absl::Status Open(CalculatorContext* cc) override {
+    options_ = cc->Options<BidirectionalTrackerCalculatorOptions>();
+    RET_CHECK_GE(options_.search_margin(), 0.0f)
+        << "search_margin must not be negative.";
+    return absl::OkStatus();
+  }
+
+  absl::Status Process(CalculatorContext* cc) override {
+    if (cc->Inputs().Tag(kImageTag).IsEmpty()) {
+      RET_CHECK(cc->Inputs().Tag(kDetectionsTag).IsEmpty())
+          << "Keyframe detections without an image at "
+          << cc->InputTimestamp();
+      return absl::OkStatus();
+    }
+    const Packet& image = cc->Inputs().Tag(kImageTag).Value();
+    RET_CHECK_EQ(image.Get<ImageFrame>().Format(), ImageFormat::GRAY8)
+        << "Only GRAY8 images are supported.";
+    if (cc->Inputs().Tag(kDetectionsTag).IsEmpty()) {
+      pending_images_.push_back(image);
+      return absl::OkStatus();
+    }
+
+    Detections detections;
+    for (const Detection& detection :
+         cc->Inputs().Tag(kDetectionsTag).Get<Detections>()) {
+      if (detection.location_data().has_relative_bounding_box()) {
+        detections.push_back(detection);
+      }
+    }
+
+    // The tracks from the previous keyframe, through the pending frames and up
+    // to this keyframe.
+    std::vector<Detections> forward;
+    if (!previous_image_.IsEmpty()) {
+      std::vector<Packet> images = {previous_image_};
+      images.insert(images.end(), pending_images_.begin(),
+                    pending_images_.end());
+      images.push_back(image);
+      forward = Track(previous_detections_, images);
+    }
+    AssignIds(forward.empty() ? Detections() : forward.back(), &detections);
+
+    // The tracks from this keyframe, back through the pending frames.
+    std::vector<Packet> images = {image};
+    images.insert(images.end(), pending_images_.rbegin(),
+                  pending_images_.rend());
+    std::vector<Detections> backward = Track(detections, images);
+    std::reverse(backward.begin(), backward.end());
+
+    const int num_pending = pending_images_.size();
+    for (int i = 0; i < num_pending; ++i) {
+      // The weight of the backward tracks grows with the proximity of this
+      // keyframe.
+      const float weight = (i + 1.0f) / (num_pending + 1.0f);
+      auto output = std::make_unique<Detections>(
+          forward.empty() ? backward[i]
+                          : Merge(forward[i], backward[i], weight));
+      cc->Outputs()
+          .Tag(kDetectionsTag)
+          .Add(output.release(), pending_images_[i].Timestamp());
+    }
+    cc->Outputs()
+        .Tag(kDetectionsTag)
+        .Add(new Detections(detections), cc->InputTimestamp());
+
+    previous_image_ = image;
+    previous_detections_ = std::move(detections);
+    pending_images_.clear();
+    return absl::OkStatus();
+  }
+
+  absl::Status Close(CalculatorContext* cc) override {
+    // The frames after the last keyframe are only tracked forward.
+    std::vector<Detections> forward(pending_images_.size());
+    if (!previous_image_.IsEmpty()) {
+      std::vector<Packet> images = {previous_image_};
+      images.insert(images.end(), pending_images_.begin(),
+                    pending_images_.end());
+      forward = Track(previous_detections_, images);
+    }
+    for (size_t i = 0; i < pending_images_.size(); ++i) {
+      cc->Outputs()
+          .Tag(kDetectionsTag)
+          .Add(new Detections(std::move(forward[i])),
+               pending_images_[i].Timestamp());
+    }
+    pending_images_.clear();
+    return absl::OkStatus();
+  }
+
+ private:
+  // Tracks the detections of the first image through the next ones, and
+  // returns the tracked detections of each next image.
+  std::vector<Detections> Track(const Detections& detections,
+                                const std::vector<Packet>& images) const {
+    std::vector<Detections> tracked;
+    tracked.reserve(images.size() - 1);
+    const Detections* previous = &detections;
+    for (size_t i = 1; i < images.size(); ++i) {
+      const cv::Mat from = MatView(&images[i - 1].Get<ImageFrame>());
+      const cv::Mat to = MatView(&images[i].Get<ImageFrame>());
+      Detections& current = tracked.emplace_back();
+      for (const Detection& detection : *previous) {
+        Detection moved = detection;
+        if (TrackDetection(from, to, &moved)) {
+          current.push_back(std::move(moved));
+        }
+      }
+      previous = &current;
+    }
+    return tracked;
+  }
+
+  // Moves the detection to the best match of its box in the next frame.
+  // Returns false when the match is too poor, i.e. the track is lost.
+  bool TrackDetection(const cv::Mat& from, const cv::Mat& to,
+                      Detection* detection) const {
+    const auto& box = Box(*detection);
+    const cv::Rect image_rect(0, 0, from.cols, from.rows);
+    const cv::Rect box_rect =
+        cv::Rect(cvRound(box.xmin() * from.cols),
+                 cvRound(box.ymin() * from.rows),
+                 cvRound(box.width() * from.cols),
+                 cvRound(box.height() * from.rows)) &
+        image_rect;
+    if (box_rect.width < kMinTemplateSize ||
+        box_rect.height < kMinTemplateSize) {
+      return box_rect.area() > 0;
+    }
+    const int margin_x = cvCeil(options_.search_margin() * box_rect.width);
+    const int margin_y = cvCeil(options_.search_margin() * box_rect.height);
+    const cv::Rect search_rect =
+        cv::Rect(box_rect.x - margin_x, box_rect.y - margin_y,
+                 box_rect.width + 2 * margin_x,
+                 box_rect.height + 2 * margin_y) &
+        image_rect;
+
+    cv::Mat scores;
+    cv::matchTemplate(to(search_rect), from(box_rect), scores,
+                      cv::TM_CCOEFF_NORMED);
+    double max_score;
+    cv::Point max_location;
+    cv::minMaxLoc(scores, nullptr, &max_score, nullptr, &max_location);
+    if (max_score < options_.min_score()) return false;
+    MoveDetection(
+        static_cast<float>(search_rect.x + max_location.x - box_rect.x) /
+            from.cols,
+        static_cast<float>(search_rect.y + max_location.y - box_rect.y) /
+            from.rows,
+        detection);
+    return true;
+  }
+
+  // Gives the detections of a keyframe the IDs of the forward tracks that
+  // reach them, and new IDs otherwise.
+  void AssignIds(const Detections& forward, Detections* detections) {
+    std::vector<bool> assigned(detections->size(), false);
+    for (const auto& [i, j] :
+         MatchDetections(forward, *detections, options_.min_iou())) {
+      (*detections)[j].set_detection_id(forward[i].detection_id());
+      assigned[j] = true;
+    }
+    for (size_t j = 0; j < detections->size(); ++j) {
+      if (!assigned[j]) (*detections)[j].set_detection_id(next_id_++);
+    }
+  }
+
+  // Merges the forward and backward tracked detections of a frame, by
+  // interpolating the boxes of the same face with the given backward weight.
+  Detections Merge(const Detections& forward, const Detections& backward,
+                   float weight) const {
+    Detections merged;
+    std::vector<bool> forward_matched(forward.size(), false);
+    std::vector<bool> backward_matched(backward.size(), false);
+    for (const auto& [i, j] :
+         MatchDetections(forward, backward, options_.min_iou())) {
+      forward_matched[i] = true;
+      backward_matched[j] = true;
+      const auto& forward_box = Box(forward[i]);
+      const auto& backward_box = Box(backward[j]);
+      const auto interpolate = [weight](float from_forward,
+                                        float from_backward) {
+        return (1 - weight) * from_forward + weight * from_backward;
+      };
+      Detection& detection = merged.emplace_back(backward[j]);
+      auto* box =
+          detection.mutable_location_data()->mutable_relative_bounding_box();
+      box->set_xmin(interpolate(forward_box.xmin(), backward_box.xmin()));
+      box->set_ymin(interpolate(forward_box.ymin(), backward_box.ymin()));
+      box->set_width(interpolate(forward_box.width(), backward_box.width()));
+      box->set_height(
+          interpolate(forward_box.height(), backward_box.height()));
+      // The keypoints move with the center of the box.
+      const float dx = box->xmin() + box->width() / 2 - backward_box.xmin() -
+                       backward_box.width() / 2;
+      const float dy = box->ymin() + box->height() / 2 - backward_box.ymin() -
+                       backward_box.height() / 2;
+      for (auto& keypoint :
+           *detection.mutable_location_data()->mutable_relative_keypoints()) {
+        keypoint.set_x(keypoint.x() + dx);
+        keypoint.set_y(keypoint.y() + dy);
+      }
+    }
+    for (size_t i = 0; i < forward.size(); ++i) {
+      if (!forward_matched[i]) merged.push_back(forward[i]);
+    }
+    for (size_t j = 0; j < backward.size(); ++j) {
+      if (!backward_matched[j]) merged.push_back(backward[j]);
+    }
+    return merged;
+  }
+
+  BidirectionalTrackerCalculatorOptions options_;
+  // The image and detections of the previous keyframe.
+  Packet previous_image_;
+  Detections previous_detections_;
+  // The images since the previous keyframe, or since the start.
+  std::vector<Packet> pending_images_;
+  int64_t next_id_ = 0;
+};
+
+REGISTER_CALCULATOR(BidirectionalTrackerCalculator);
+
+}  // namespace magritte
@@ -0,0 +1,164 @@
+//
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include  <opencv2/core.hpp>
+#include "magritte/calculators/bidirectional_tracker_calculator.pb.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/calculator_runner.h"
+#include "mediapipe/framework/formats/detection.pb.h"
+#include "mediapipe/framework/formats/image_frame.h"
+#include "mediapipe/framework/formats/image_frame_opencv.h"
+#include "mediapipe/framework/formats/location_data.pb.h"
+#include "mediapipe/framework/port/gmock.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/parse_text_proto.h"
+#include "mediapipe/framework/port/status_matchers.h"
+
+namespace magritte {
+namespace {
+
+using ::mediapipe::CalculatorRunner;
+using ::mediapipe::Detection;
+using ::mediapipe::ImageFormat;
+using ::mediapipe::ImageFrame;
+using ::mediapipe::MakePacket;
+using ::mediapipe::Packet;
+using ::mediapipe::Timestamp;
+using ::mediapipe::formats::MatView;
+using Detections = std::vector<Detection>;
+
+constexpr int kWidth = 160;
+constexpr int kHeight = 120;
+
+constexpr char kNodeConfig[] = R"pb(
+  calculator: "BidirectionalTrackerCalculator"
+  input_stream: "IMAGE:tracking_proxy"
+  input_stream: "DETECTIONS:keyframe_detections"
+  output_stream: "DETECTIONS:tracked_detections"
+  options {
+    [magritte.BidirectionalTrackerCalculatorOptions.ext] {
+      search_margin: 0.5
+      min_score: 0.5
+    }
+  }
+)pb";
+
+// A scene with two textured faces on a flat background: the first one moves
+// right by 4 pixels per frame, and the second one appears in frame 2.
+class Scene {
+ public:
+  Scene() : first_face_(20, 20, CV_8UC1), second_face_(16, 16, CV_8UC1) {
+    cv::RNG rng(1);
+    rng.fill(first_face_, cv::RNG::UNIFORM, 0, 256);
+    rng.fill(second_face_, cv::RNG::UNIFORM, 0, 256);
+  }
+
+  Packet Frame(int index) const {
+    auto frame = std::make_unique<ImageFrame>(
+        ImageFormat::GRAY8, kWidth, kHeight,
+        ImageFrame::kDefaultAlignmentBoundary);
+    cv::Mat mat = MatView(frame.get());
+    mat.setTo(128);
+    first_face_.copyTo(mat(FirstFaceRect(index)));
+    if (index >= 2) second_face_.copyTo(mat(SecondFaceRect()));
+    return mediapipe::Adopt(frame.release()).At(Timestamp(index));
+  }
+
+  static cv::Rect FirstFaceRect(int index) {
+    return cv::Rect(20 + 4 * index, 50, 20, 20);
+  }
+  static cv::Rect SecondFaceRect() { return cv::Rect(100, 20, 16, 16); }
+
+ private:
+  cv::Mat first_face_;
+  cv::Mat second_face_;
+};
+
+Detection MakeDetection(const cv::Rect& rect) {
+  Detection detection;
+  auto* box =
+      detection.mutable_location_data()->mutable_relative_bounding_box();
+  box->set_xmin(static_cast<float>(rect.x) / kWidth);
+  box->set_ymin(static_cast<float>(rect.y) / kHeight);
+  box->set_width(static_cast<float>(rect.width) / kWidth);
+  box->set_height(static_cast<float>(rect.height) / kHeight);
+  return detection;
+}
+
+// Returns the xmin of the box of the detection with the given track ID, in
+// pixels, or -1 if there is none.
+int TrackX(const Detections& detections, int64_t id) {
+  for (const Detection& detection : detections) {
+    if (detection.detection_id() == id) {
+      return std::round(
+          detection.location_data().relative_bounding_box().xmin() * kWidth);
+    }
+  }
+  return -1;
+}
+
+TEST(BidirectionalTrackerCalculatorTest, TracksForwardAndBackward) {
+  CalculatorRunner runner(
+      mediapipe::ParseTextProtoOrDie<mediapipe::CalculatorGraphConfig::Node>(
+          kNodeConfig));
+  const Scene scene;
+  for (int i = 0; i < 6; ++i) {
+    runner.MutableInputs()->Tag("IMAGE").packets.push_back(scene.Frame(i));
+  }
+  // Frames 0 and 4 are the keyframes.
+  runner.MutableInputs()->Tag("DETECTIONS").packets.push_back(
+      MakePacket<Detections>(
+          Detections{MakeDetection(Scene::FirstFaceRect(0))})
+          .At(Timestamp(0)));
+  runner.MutableInputs()->Tag("DETECTIONS").packets.push_back(
+      MakePacket<Detections>(
+          Detections{MakeDetection(Scene::FirstFaceRect(4)),
+                     MakeDetection(Scene::SecondFaceRect())})
+          .At(Timestamp(4)));
+
+  MP_ASSERT_OK(runner.Run());
+  const auto& packets = runner.Outputs().Tag("DETECTIONS").packets;
+  ASSERT_EQ(packets.size(), 6);
+  for (int i = 0; i < 6; ++i) {
+    EXPECT_EQ(packets[i].Timestamp(), Timestamp(i));
+    const Detections& detections = packets[i].Get<Detections>();
+    // The first face keeps its track ID, and is found in every frame.
+    EXPECT_EQ(TrackX(detections, 0), Scene::FirstFaceRect(i).x)
+        << "frame " << i;
+    // The second face is tracked back to its appearance, and after the last
+    // keyframe.
+    EXPECT_EQ(TrackX(detections, 1), i >= 2 ? Scene::SecondFaceRect().x : -1)
+        << "frame " << i;
+    EXPECT_EQ(detections.size(), i >= 2 ? 2 : 1) << "frame " << i;
+  }
+}
+
+TEST(BidirectionalTrackerCalculatorTest, FailsWithoutGrayscaleImages) {
+  CalculatorRunner runner(
+      mediapipe::ParseTextProtoOrDie<mediapipe::CalculatorGraphConfig::Node>(
+          kNodeConfig));
+  runner.MutableInputs()->Tag("IMAGE").packets.push_back(
+      mediapipe::Adopt(new ImageFrame(ImageFormat::SRGB, kWidth, kHeight))
+          .At(Timestamp(0)));
+  EXPECT_FALSE(runner.Run().ok());
+}
+
+}  // namespace
+}  // namespace magritte
@@ -22,7 +22,12 @@
 #include "mediapipe/framework/calculator_framework.h"
 #include "mediapipe/framework/formats/image_frame.h"
 #include "mediapipe/framework/formats/image_frame_opencv.h"
+#include "mediapipe/framework/formats/yuv_image.h"
 #include "absl/status/status.h"
+#include "magritte/calculators/image_frame_pool_service.h"
+#include "magritte/calculators/image_frame_util.h"
+#include "magritte/calculators/yuv_image_util.h"
+#include "mediapipe/framework/port/status.h"
 #include  <opencv2/core.hpp>
 #include  <opencv2/imgproc.hpp>
 
@@ -30,54 +35,93 @@ namespace magritte {
 using ::mediapipe::CalculatorContext;
 using ::mediapipe::CalculatorContract;
 using ::mediapipe::ImageFrame;
+using ::mediapipe::YUVImage;
 using ::mediapipe::formats::MatView;
 namespace {
 constexpr char kForegroundFrameTag[] = "FRAMES_FG";
 constexpr char kBackgroundFrameTag[] = "FRAMES_BG";
 constexpr char kMaskTag[] = "MASK";
 constexpr char kOutputFrameTag[] = "FRAMES";
+constexpr char kYuvForegroundFrameTag[] = "YUV_FRAMES_FG";
+constexpr char kYuvBackgroundFrameTag[] = "YUV_FRAMES_BG";
+constexpr char kYuvOutputFrameTag[] = "YUV_FRAMES";
 }  // namespace
 
 absl::Status BlendCalculator::GetContract(CalculatorContract* cc) {
-  cc->Inputs().Tag(kForegroundFrameTag).Set<ImageFrame>();
-  cc->Inputs().Tag(kBackgroundFrameTag).Set<ImageFrame>();
+  RET_CHECK(cc->Inputs().HasTag(kBackgroundFrameTag) ^
+            cc->Inputs().HasTag(kYuvBackgroundFrameTag))
+      << "Exactly one of " << kBackgroundFrameTag << " or "
+      << kYuvBackgroundFrameTag << " input tags must be set.";
+  if (cc->Inputs().HasTag(kBackgroundFrameTag)) {
+    cc->Inputs().Tag(kForegroundFrameTag).Set<ImageFrame>();
+    cc->Inputs().Tag(kBackgroundFrameTag).Set<ImageFrame>();
+    cc->Outputs().Tag(kOutputFrameTag).Set<ImageFrame>();
+  } else {
+    cc->Inputs().Tag(kYuvForegroundFrameTag).Set<YUVImage>();
+    cc->Inputs().Tag(kYuvBackgroundFrameTag).Set<YUVImage>();
+    cc->Outputs().Tag(kYuvOutputFrameTag).Set<YUVImage>();
+  }
   cc->Inputs().Tag(kMaskTag).Set<ImageFrame>();
-  cc->Outputs().Tag(kOutputFrameTag).Set<ImageFrame>();
+  UseImageFramePoolService(cc);
 
   // No input side packets.
   return absl::OkStatus();
 }
 
 absl::Status BlendCalculator::Open(CalculatorContext* cc) {
+  pool_ = GetImageFramePool(cc);
   return absl::OkStatus();
 }
 
 absl::Status BlendCalculator::Process(CalculatorContext* cc) {
-  if (cc->Inputs().Tag(kBackgroundFrameTag).Value().IsEmpty()) {
+  const bool yuv = cc->Inputs().HasTag(kYuvBackgroundFrameTag);
+  const char* background_tag =
+      yuv ? kYuvBackgroundFrameTag : kBackgroundFrameTag;
+  const char* foreground_tag =
+      yuv ? kYuvForegroundFrameTag : kForegroundFrameTag;
+  const char* output_tag = yuv ? kYuvOutputFrameTag : kOutputFrameTag;
+  if (cc->Inputs().Tag(background_tag).Value().IsEmpty()) {
     LOG(WARNING) << "No background image frame at " << cc->InputTimestamp();
     return absl::OkStatus();
   }
-  if (cc->Inputs().Tag(kForegroundFrameTag).Value().IsEmpty()) {
+  if (cc->Inputs().Tag(foreground_tag).Value().IsEmpty()) {
     LOG(WARNING) << "No foreground image frame at " << cc->InputTimestamp();
     return absl::OkStatus();
   }
   if (cc->Inputs().Tag(kMaskTag).Value().IsEmpty()) {
     LOG(INFO) << "No mask frame at " << cc->InputTimestamp();
     cc->Outputs()
-        .Tag(kOutputFrameTag)
-        .AddPacket(cc->Inputs().Tag(kForegroundFrameTag).Value());
+        .Tag(output_tag)
+        .AddPacket(cc->Inputs().Tag(foreground_tag).Value());
+    return absl::OkStatus();
+  }
+
+  if (yuv) {
+    const auto& image_fg = cc->Inputs().Tag(foreground_tag).Get<YUVImage>();
+    const auto& mask = cc->Inputs().Tag(kMaskTag).Get<ImageFrame>();
+    ASSIGN_OR_RETURN(
+        std::unique_ptr<YUVImage> output_image,
+        ConsumeOrCopyYuvImage(cc, cc->Inputs().Tag(background_tag)));
+    RET_CHECK_EQ(output_image->fourcc(), image_fg.fourcc());
+    ASSIGN_OR_RETURN(const YuvPlanes planes_bg, GetYuvPlanes(*output_image));
+    ASSIGN_OR_RETURN(const YuvPlanes planes_fg, GetYuvPlanes(image_fg));
+    MP_RETURN_IF_ERROR(blendPlanes(planes_bg, planes_fg, MatView(&mask)));
+    cc->Outputs()
+        .Tag(output_tag)
+        .Add(output_image.release(), cc->InputTimestamp());
     return absl::OkStatus();
   }
 
-  const auto& frame_bg =
-      cc->Inputs().Tag(kBackgroundFrameTag).Get<ImageFrame>();
   const auto& frame_fg =
       cc->Inputs().Tag(kForegroundFrameTag).Get<ImageFrame>();
   const auto& mask = cc->Inputs().Tag(kMaskTag).Get<ImageFrame>();
 
-  std::unique_ptr<ImageFrame> output_frame(
-      new ImageFrame(frame_bg.Format(), frame_bg.Width(), frame_bg.Height()));
-  output_frame->CopyFrom(frame_bg, ImageFrame::kDefaultAlignmentBoundary);
+  // The foreground is blended into the background in place. The background is
+  // only copied if other calculators might want to access it still.
+  ASSIGN_OR_RETURN(
+      std::unique_ptr<ImageFrame> output_frame,
+      ConsumeOrCopyImageFrame(cc, cc->Inputs().Tag(kBackgroundFrameTag),
+                              pool_.get()));
   RET_CHECK_OK(
       blend(MatView(output_frame.get()), MatView(&frame_fg), MatView(&mask)));
   cc->Outputs()
@@ -107,5 +151,34 @@ absl::Status BlendCalculator::blend(cv::Mat bg, cv::Mat fg, cv::Mat mask) {
   return absl::OkStatus();
 }
 
+absl::Status BlendCalculator::blendPlanes(const YuvPlanes& bg,
+                                          const YuvPlanes& fg,
+                                          const cv::Mat& mask) {
+  RET_CHECK_EQ(bg.size(), fg.size());
+  // As for ImageFrames, only the first channel of the mask is used.
+  cv::Mat mask_channel;
+  cv::extractChannel(mask, mask_channel, 0);
+  if (mask_channel.depth() == CV_32F) {
+    mask_channel.convertTo(mask_channel, CV_8U, 255);
+  }
+  for (size_t i = 0; i < bg.size(); ++i) {
+    RET_CHECK(bg[i].size() == fg[i].size() && bg[i].type() == fg[i].type());
+    cv::Mat plane_mask;
+    cv::resize(mask_channel, plane_mask, bg[i].size(), 0, 0,
+               cv::INTER_NEAREST);
+    if (bg[i].channels() == 2) {
+      cv::merge(std::vector<cv::Mat>{plane_mask, plane_mask}, plane_mask);
+    }
+    cv::Mat bg_result;
+    cv::Mat fg_result;
+    multiply(plane_mask, fg[i], fg_result, 1.0 / 255);
+    multiply(cv::Scalar::all(255) - plane_mask, bg[i], bg_result, 1.0 / 255);
+    // Add the masked foreground and background into the background plane.
+    cv::Mat plane = bg[i];
+    add(fg_result, bg_result, plane);
+  }
+  return absl::OkStatus();
+}
+
 REGISTER_CALCULATOR(BlendCalculator);
 }  // namespace magritte
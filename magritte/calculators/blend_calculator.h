@@ -22,11 +22,16 @@
 
 #include "mediapipe/framework/calculator_framework.h"
 #include "absl/status/status.h"
+#include "magritte/calculators/image_frame_pool.h"
+#include "magritte/calculators/yuv_image_util.h"
 #include  <opencv2/core.hpp>
 
 namespace magritte {
-// A calculator that takes two ImageFrame input streams and blends them
-// according to a mask.
+// A calculator that takes two ImageFrame or YUVImage input streams and blends
+// them according to a mask.
+//
+// YUVImages are blended plane by plane, the mask being resized to the size of
+// each plane.
 //
 // Inputs:
 // - FRAMES_BG: An ImageFrame stream, containing a background image. The
@@ -38,10 +43,13 @@ namespace magritte {
 //   blended: 0 means using the background value, 255 means using the forground
 //   value, and intermediate value will result in the weigted average between
 //   the two.
+// - YUV_FRAMES_BG and YUV_FRAMES_FG: YUVImage streams, instead of FRAMES_BG and
+//   FRAMES_FG. Both must have the same size and layout. The MASK stays an
+//   ImageFrame stream.
 //
 // Outputs:
-// - FRAMES: An ImageFrame stream containing the result of the blending as
-//   described above.
+// - FRAMES or YUV_FRAMES: An ImageFrame or YUVImage stream, matching the
+//   inputs, containing the result of the blending as described above.
 //
 // Example config:
 // node {
@@ -62,6 +70,11 @@ class BlendCalculator : public ::mediapipe::CalculatorBase {
 
  private:
   static absl::Status blend(cv::Mat bg, cv::Mat fg, cv::Mat mask);
+  static absl::Status blendPlanes(const YuvPlanes& bg, const YuvPlanes& fg,
+                                  const cv::Mat& mask);
+
+  // Provides the buffers of copied background frames.
+  std::shared_ptr<ImageFramePool> pool_;
 };
 }  // namespace magritte
 
@@ -16,6 +16,7 @@
 
 #include "magritte/calculators/blend_calculator.h"
 
+#include <cstdint>
 #include <memory>
 #include <string>
 
@@ -25,15 +26,19 @@
 #include "mediapipe/framework/calculator_framework.h"
 #include "mediapipe/framework/calculator_runner.h"
 #include "mediapipe/framework/formats/image_frame.h"
+#include "mediapipe/framework/formats/yuv_image.h"
 #include "mediapipe/framework/packet.h"
 #include "mediapipe/framework/port/gtest.h"
 #include "mediapipe/framework/port/parse_text_proto.h"
 #include "mediapipe/framework/port/status_matchers.h"
 #include "mediapipe/framework/tool/test_util.h"
+#include "magritte/calculators/yuv_image_util.h"
+#include "libyuv/video_common.h"
 
 namespace magritte {
 namespace {
 using ::mediapipe::ImageFrame;
+using ::mediapipe::YUVImage;
 
 struct BlendTestCase {
   const std::string test_name;
@@ -215,5 +220,77 @@ INSTANTIATE_TEST_SUITE_P(
       return info.param.test_name;
     });
 
+// Returns a YUVImage of the given layout and size, with uniform planes.
+std::unique_ptr<YUVImage> MakeUniformYuvImage(uint32_t fourcc, int width,
+                                              int height, int y, int u, int v) {
+  std::unique_ptr<YUVImage> image = MakeYuvImage(fourcc, width, height).value();
+  YuvPlanes planes = GetYuvPlanes(*image).value();
+  planes[0].setTo(y);
+  if (planes.size() == 3) {
+    planes[1].setTo(u);
+    planes[2].setTo(v);
+  } else {
+    planes[1].setTo(cv::Scalar(u, v));
+  }
+  return image;
+}
+
+class BlendCalculatorYuvTest : public testing::TestWithParam<uint32_t> {};
+
+TEST_P(BlendCalculatorYuvTest, BlendsPlanes) {
+  std::unique_ptr<YUVImage> background =
+      MakeUniformYuvImage(GetParam(), 4, 4, 100, 50, 60);
+  std::unique_ptr<YUVImage> foreground =
+      MakeUniformYuvImage(GetParam(), 4, 4, 200, 150, 160);
+  // The left half of the mask selects the foreground, the right half the
+  // background.
+  auto mask = std::make_unique<ImageFrame>(mediapipe::ImageFormat::SRGB, 2, 2);
+  cv::Mat mask_mat = mediapipe::formats::MatView(mask.get());
+  mask_mat.setTo(cv::Scalar::all(0));
+  mask_mat.col(0).setTo(cv::Scalar::all(255));
+
+  mediapipe::CalculatorRunner runner(
+      mediapipe::ParseTextProtoOrDie<mediapipe::CalculatorGraphConfig::Node>(R"pb(
+        calculator: "BlendCalculator"
+        input_stream: "YUV_FRAMES_BG:frames_bg"
+        input_stream: "YUV_FRAMES_FG:frames_fg"
+        input_stream: "MASK:mask"
+        output_stream: "YUV_FRAMES:output_video"
+      )pb"));
+  runner.MutableInputs()
+      ->Tag("YUV_FRAMES_BG")
+      .packets.push_back(mediapipe::PointToForeign(background.get())
+                             .At(mediapipe::Timestamp(0)));
+  runner.MutableInputs()
+      ->Tag("YUV_FRAMES_FG")
+      .packets.push_back(mediapipe::PointToForeign(foreground.get())
+                             .At(mediapipe::Timestamp(0)));
+  runner.MutableInputs()->Tag("MASK").packets.push_back(
+      mediapipe::Adopt(mask.release()).At(mediapipe::Timestamp(0)));
+
+  MP_ASSERT_OK(runner.Run());
+
+  const std::vector<mediapipe::Packet>& output =
+      runner.Outputs().Tag("YUV_FRAMES").packets;
+  ASSERT_EQ(output.size(), 1);
+  ASSERT_OK_AND_ASSIGN(const YuvPlanes planes,
+                       GetYuvPlanes(output[0].Get<YUVImage>()));
+  ASSERT_OK_AND_ASSIGN(const YuvPlanes background_planes,
+                       GetYuvPlanes(*background));
+  ASSERT_OK_AND_ASSIGN(const YuvPlanes foreground_planes,
+                       GetYuvPlanes(*foreground));
+  ASSERT_EQ(planes.size(), background_planes.size());
+  for (size_t i = 0; i < planes.size(); ++i) {
+    const int half = planes[i].cols / 2;
+    cv::Mat expected = background_planes[i].clone();
+    foreground_planes[i].colRange(0, half).copyTo(expected.colRange(0, half));
+    EXPECT_EQ(cv::norm(planes[i], expected, cv::NORM_INF), 0) << "plane " << i;
+  }
+}
+
+INSTANTIATE_TEST_SUITE_P(BlendCalculatorYuvTests, BlendCalculatorYuvTest,
+                         testing::Values(libyuv::FOURCC_I420,
+                                         libyuv::FOURCC_NV12));
+
 }  // namespace
 }  // namespace magritte
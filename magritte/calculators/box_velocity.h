@@ -0,0 +1,39 @@
+//
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+#ifndef MAGRITTE_CALCULATORS_BOX_VELOCITY_H_
+#define MAGRITTE_CALCULATORS_BOX_VELOCITY_H_
+
+#include <cstdint>
+#include <vector>
+
+namespace magritte {
+
+// The velocity of the relative bounding box of a tracked detection, in
+// normalized units per second, e.g. as estimated by the filters of a tracker.
+struct BoxVelocity {
+  // The detection_id of the tracked detection.
+  int64_t detection_id = 0;
+  float xmin = 0.0f;
+  float ymin = 0.0f;
+  float width = 0.0f;
+  float height = 0.0f;
+};
+
+typedef std::vector<BoxVelocity> BoxVelocities;
+
+}  // namespace magritte
+
+#endif  // MAGRITTE_CALCULATORS_BOX_VELOCITY_H_
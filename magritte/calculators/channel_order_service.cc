@@ -0,0 +1,52 @@
+//
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+#include "magritte/calculators/channel_order_service.h"
+
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/formats/image_format.pb.h"
+#include "mediapipe/framework/graph_service.h"
+
+namespace magritte {
+
+const mediapipe::GraphService<ChannelOrder> kChannelOrderService(
+    "magritte::kChannelOrderService");
+
+void UseChannelOrderService(mediapipe::CalculatorContract* cc) {
+  cc->UseService(kChannelOrderService).Optional();
+}
+
+ChannelOrder GetChannelOrder(mediapipe::CalculatorContext* cc) {
+  auto service = cc->Service(kChannelOrderService);
+  if (service.IsAvailable()) {
+    return service.GetObject();
+  }
+  return ChannelOrder::kRgb;
+}
+
+bool IsBgr(mediapipe::CalculatorContext* cc,
+           mediapipe::ImageFormat::Format format) {
+  switch (format) {
+    case mediapipe::ImageFormat::SBGRA:
+      return true;
+    case mediapipe::ImageFormat::SRGB:
+    case mediapipe::ImageFormat::SRGBA:
+      return GetChannelOrder(cc) == ChannelOrder::kBgr;
+    default:
+      return false;
+  }
+}
+
+}  // namespace magritte
@@ -0,0 +1,57 @@
+//
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+#ifndef MAGRITTE_CALCULATORS_CHANNEL_ORDER_SERVICE_H_
+#define MAGRITTE_CALCULATORS_CHANNEL_ORDER_SERVICE_H_
+
+#include "absl/base/attributes.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/formats/image_format.pb.h"
+#include "mediapipe/framework/graph_service.h"
+
+namespace magritte {
+
+// The order of the color channels of the SRGB and SRGBA frames of a graph.
+// MediaPipe has no 3-channel BGR format, so BGR frames, e.g. as decoded by
+// OpenCV, are given as SRGB frames in a graph that provides kBgr. SBGRA frames
+// are always BGR. Only ImagePyramidCalculator swaps the channels for the
+// detection models, so kBgr is only supported by the graphs that detect
+// through it and draw no annotations.
+enum class ChannelOrder { kRgb, kBgr };
+
+// Graph service providing the ChannelOrder of the frames of a graph.
+// Applications provide it with
+//   graph.SetServiceObject(kChannelOrderService,
+//                          std::make_shared<ChannelOrder>(ChannelOrder::kBgr));
+// before starting the graph. Without it, frames are RGB.
+ABSL_CONST_INIT extern const mediapipe::GraphService<ChannelOrder>
+    kChannelOrderService;
+
+// Declares that the calculator uses kChannelOrderService if the graph provides
+// it. To be called from GetContract.
+void UseChannelOrderService(mediapipe::CalculatorContract* cc);
+
+// Returns the channel order provided to the graph, or kRgb if there is none.
+ChannelOrder GetChannelOrder(mediapipe::CalculatorContext* cc);
+
+// Returns whether the color channels of frames with the given format are in
+// BGR order: always for SBGRA, and for SRGB and SRGBA if the graph provides
+// kBgr.
+bool IsBgr(mediapipe::CalculatorContext* cc,
+           mediapipe::ImageFormat::Format format);
+
+}  // namespace magritte
+
+#endif  // MAGRITTE_CALCULATORS_CHANNEL_ORDER_SERVICE_H_
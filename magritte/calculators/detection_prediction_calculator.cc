@@ -0,0 +1,281 @@
+//
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "magritte/calculators/box_velocity.h"
+#include "magritte/calculators/detection_prediction_calculator.pb.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/formats/detection.pb.h"
+#include "mediapipe/framework/formats/location_data.pb.h"
+#include "mediapipe/framework/port/ret_check.h"
+
+namespace magritte {
+namespace {
+using ::mediapipe::CalculatorBase;
+using ::mediapipe::CalculatorContext;
+using ::mediapipe::CalculatorContract;
+using ::mediapipe::Detection;
+using ::mediapipe::LocationData;
+using ::mediapipe::Timestamp;
+using Detections = std::vector<Detection>;
+
+constexpr char kImageTag[] = "IMAGE";
+constexpr char kDetectionsTag[] = "DETECTIONS";
+constexpr char kVelocitiesTag[] = "VELOCITIES";
+
+// A relative bounding box, or its velocity in normalized units per second.
+struct Box {
+  float xmin = 0.0f;
+  float ymin = 0.0f;
+  float width = 0.0f;
+  float height = 0.0f;
+};
+
+Box DetectionBox(const Detection& detection) {
+  const auto& box = detection.location_data().relative_bounding_box();
+  return {box.xmin(), box.ymin(), box.width(), box.height()};
+}
+}  // namespace
+
+// A calculator that predicts the newest tracked detections forward to the
+// timestamp of each frame, so that frames can be redacted as soon as they
+// arrive, without waiting for the detection of their own timestamp.
+//
+// In live graphs, redacting a frame with its own detections adds the model
+// inference to the latency of every frame. Instead, detection can run
+// asynchronously on the frames it has time for, and this calculator gives each
+// frame the last detections that finished, moved forward at the velocity of
+// their tracks, and widened by a safety margin that grows with the time
+// elapsed since the detected frame, to cover the error of the prediction. The
+// latency of the frames is then bounded by the redaction cost alone.
+//
+// The velocities of the tracks are those of the VELOCITIES input if it is
+// connected, e.g. as estimated by the filters of IouKalmanTrackerCalculator.
+// Otherwise, the velocity of a track is measured between the last two detection
+// packets where it appears, by detection_id. Detections without a velocity only
+// grow by the margin.
+//
+// The calculator uses the ImmediateInputStreamHandler: frames are processed as
+// soon as they arrive, and the detections, at older timestamps, whenever they
+// finish.
+//
+// Inputs:
+// - IMAGE: A stream of any type, e.g. the ImageFrame stream, that gives the
+//   timestamps of the output. Its packets are not read.
+// - DETECTIONS: The tracked detections, as std::vector<Detection>, with
+//   relative bounding boxes and track IDs in detection_id.
+// - VELOCITIES (optional): The velocities of the boxes of the tracked
+//   detections, as BoxVelocities, by detection_id.
+//
+// Outputs:
+// - DETECTIONS: The last detections, predicted to the timestamp of each frame
+//   and widened by the safety margin, as std::vector<Detection>. It's empty
+//   until the first detections arrive.
+//
+// Options:
+// - margin_rate: The safety margin on each side of the boxes, as a fraction of
+//   their size per second elapsed. Default is 1.
+// - max_margin: The maximum safety margin on each side of the boxes, as a
+//   fraction of their size. Default is 0.5.
+// - max_prediction_duration: The maximum time, in seconds, the boxes are moved
+//   forward at their velocity. Default is 0.5.
+//
+// Example config:
+// node {
+//   calculator: "DetectionPredictionCalculator"
+//   input_stream: "IMAGE:input_video"
+//   input_stream: "DETECTIONS:async_tracked_detections"
+//   input_stream: "VELOCITIES:async_track_velocities"
+//   output_stream: "DETECTIONS:predicted_detections"
+//   options: {
+//     [magritte.DetectionPredictionCalculatorOptions.ext] {
+//       margin_rate: 1.0
+//       max_margin: 0.5
+//       max_prediction_duration: 0.5
+//     }
+//   }
+// }
+class DetectionPredictionCalculator : public CalculatorBase {
+ public:
+  DetectionPredictionCalculator() = default;
+  ~DetectionPredictionCalculator() override = default;
+
+  static absl::Status GetContract(CalculatorContract* cc) {
+    RET_CHECK(cc->Inputs().HasTag(kImageTag))
+        << "Missing input " << kImageTag << " tag.";
+    cc->Inputs().Tag(kImageTag).SetAny();
+    RET_CHECK(cc->Inputs().HasTag(kDetectionsTag))
+        << "Missing input " << kDetectionsTag << " tag.";
+    cc->Inputs().Tag(kDetectionsTag).Set<Detections>();
+    if (cc->Inputs().HasTag(kVelocitiesTag)) {
+      cc->Inputs().Tag(kVelocitiesTag).Set<BoxVelocities>();
+    }
+    RET_CHECK(cc->Outputs().HasTag(kDetectionsTag))
+        << "Missing output " << kDetectionsTag << " tag.";
+    cc->Outputs().Tag(kDetectionsTag).Set<Detections>();
+    // Frames must not wait for the detections of their own timestamp.
+    cc->SetInputStreamHandler("ImmediateInputStreamHandler");
+    // No input side packets.
+    return absl::OkStatus();
+  }
+
+  absl::Status Open(CalculatorContext* cc) override {
+    options_ = cc->Options<DetectionPredictionCalculatorOptions>();
+    RET_CHECK_GE(options_.margin_rate(), 0.0f)
+        << "margin_rate must not be negative.";
+    RET_CHECK_GE(options_.max_margin(), 0.0f)
+        << "max_margin must not be negative.";
+    RET_CHECK_GE(options_.max_prediction_duration(), 0.0f)
+        << "max_prediction_duration must not be negative.";
+    return absl::OkStatus();
+  }
+
+  absl::Status Process(CalculatorContext* cc) override {
+    if (cc->Inputs().HasTag(kVelocitiesTag) &&
+        !cc->Inputs().Tag(kVelocitiesTag).IsEmpty()) {
+      // The velocities may arrive before or after the detections of the same
+      // timestamp, and are looked up by track ID either way.
+      velocities_.clear();
+      for (const BoxVelocity& velocity :
+           cc->Inputs().Tag(kVelocitiesTag).Get<BoxVelocities>()) {
+        velocities_[velocity.detection_id] = {velocity.xmin, velocity.ymin,
+                                              velocity.width, velocity.height};
+      }
+    }
+    if (!cc->Inputs().Tag(kDetectionsTag).IsEmpty()) {
+      const mediapipe::Packet& packet =
+          cc->Inputs().Tag(kDetectionsTag).Value();
+      const bool measure_velocities = !cc->Inputs().HasTag(kVelocitiesTag);
+      UpdateDetections(packet.Get<Detections>(), packet.Timestamp(),
+                       measure_velocities);
+    }
+    if (cc->Inputs().Tag(kImageTag).IsEmpty()) {
+      return absl::OkStatus();
+    }
+
+    const Timestamp timestamp =
+        cc->Inputs().Tag(kImageTag).Value().Timestamp();
+    auto output = std::make_unique<Detections>();
+    if (detections_timestamp_ != Timestamp::Unset()) {
+      const float elapsed =
+          std::max(0.0, (timestamp - detections_timestamp_).Seconds());
+      const float prediction_duration =
+          std::min(elapsed, options_.max_prediction_duration());
+      const float margin =
+          std::min(options_.margin_rate() * elapsed, options_.max_margin());
+      output->reserve(detections_.size());
+      for (const Detection& detection : detections_) {
+        output->push_back(
+            PredictedDetection(detection, prediction_duration, margin));
+      }
+    }
+    cc->Outputs().Tag(kDetectionsTag).Add(output.release(), timestamp);
+    return absl::OkStatus();
+  }
+
+ private:
+  // Keeps the new detections, and measures the velocities of their tracks if
+  // requested.
+  void UpdateDetections(const Detections& detections, Timestamp timestamp,
+                        bool measure_velocities) {
+    if (!measure_velocities) {
+      detections_ = detections;
+      detections_timestamp_ = timestamp;
+      return;
+    }
+    absl::flat_hash_map<int64_t, Box> velocities;
+    if (detections_timestamp_ != Timestamp::Unset() &&
+        timestamp > detections_timestamp_) {
+      const float dt = (timestamp - detections_timestamp_).Seconds();
+      absl::flat_hash_map<int64_t, Box> previous_boxes;
+      for (const Detection& detection : detections_) {
+        if (detection.has_detection_id()) {
+          previous_boxes[detection.detection_id()] = DetectionBox(detection);
+        }
+      }
+      for (const Detection& detection : detections) {
+        if (!detection.has_detection_id()) continue;
+        const auto it = previous_boxes.find(detection.detection_id());
+        if (it == previous_boxes.end()) continue;
+        const Box box = DetectionBox(detection);
+        velocities[detection.detection_id()] = {
+            (box.xmin - it->second.xmin) / dt,
+            (box.ymin - it->second.ymin) / dt,
+            (box.width - it->second.width) / dt,
+            (box.height - it->second.height) / dt};
+      }
+    }
+    detections_ = detections;
+    detections_timestamp_ = timestamp;
+    velocities_ = std::move(velocities);
+  }
+
+  // Returns the detection moved forward at its velocity for the given duration,
+  // and widened by the given margin on each side, as a fraction of its size.
+  Detection PredictedDetection(const Detection& detection,
+                               float prediction_duration, float margin) const {
+    Box box = DetectionBox(detection);
+    float dx = 0.0f;
+    float dy = 0.0f;
+    if (detection.has_detection_id()) {
+      const auto it = velocities_.find(detection.detection_id());
+      if (it != velocities_.end()) {
+        const Box& velocity = it->second;
+        const float width = std::max(
+            0.0f, box.width + velocity.width * prediction_duration);
+        const float height = std::max(
+            0.0f, box.height + velocity.height * prediction_duration);
+        // The keypoints move with the center of the box.
+        dx = velocity.xmin * prediction_duration + (width - box.width) / 2;
+        dy = velocity.ymin * prediction_duration + (height - box.height) / 2;
+        box.xmin += velocity.xmin * prediction_duration;
+        box.ymin += velocity.ymin * prediction_duration;
+        box.width = width;
+        box.height = height;
+      }
+    }
+
+    Detection predicted = detection;
+    LocationData* location_data = predicted.mutable_location_data();
+    auto* output_box = location_data->mutable_relative_bounding_box();
+    output_box->set_xmin(box.xmin - margin * box.width);
+    output_box->set_ymin(box.ymin - margin * box.height);
+    output_box->set_width(box.width * (1 + 2 * margin));
+    output_box->set_height(box.height * (1 + 2 * margin));
+    for (auto& keypoint : *location_data->mutable_relative_keypoints()) {
+      keypoint.set_x(keypoint.x() + dx);
+      keypoint.set_y(keypoint.y() + dy);
+    }
+    return predicted;
+  }
+
+  DetectionPredictionCalculatorOptions options_;
+  // The last detections, and their timestamp.
+  Detections detections_;
+  Timestamp detections_timestamp_ = Timestamp::Unset();
+  // The velocities of the boxes of the last detections, by track ID, measured
+  // or from the VELOCITIES input.
+  absl::flat_hash_map<int64_t, Box> velocities_;
+};
+
+REGISTER_CALCULATOR(DetectionPredictionCalculator);
+
+}  // namespace magritte
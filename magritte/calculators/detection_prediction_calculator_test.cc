@@ -0,0 +1,181 @@
+//
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+#include <cstdint>
+#include <vector>
+
+#include "magritte/calculators/box_velocity.h"
+#include "magritte/calculators/detection_prediction_calculator.pb.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/calculator_runner.h"
+#include "mediapipe/framework/formats/detection.pb.h"
+#include "mediapipe/framework/formats/location_data.pb.h"
+#include "mediapipe/framework/port/gmock.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/parse_text_proto.h"
+#include "mediapipe/framework/port/status_matchers.h"
+
+namespace magritte {
+namespace {
+
+using ::mediapipe::CalculatorRunner;
+using ::mediapipe::Detection;
+using ::mediapipe::MakePacket;
+using ::mediapipe::Timestamp;
+using Detections = std::vector<Detection>;
+
+constexpr char kNodeConfig[] = R"pb(
+  calculator: "DetectionPredictionCalculator"
+  input_stream: "IMAGE:input_video"
+  input_stream: "DETECTIONS:async_tracked_detections"
+  output_stream: "DETECTIONS:predicted_detections"
+  options {
+    [magritte.DetectionPredictionCalculatorOptions.ext] {
+      margin_rate: 1.0
+      max_margin: 0.25
+      max_prediction_duration: 0.2
+    }
+  }
+)pb";
+
+// Returns a tracked face detection, with a keypoint at the center of its box.
+Detection MakeFace(int64_t id, float xmin, float ymin, float size) {
+  Detection detection;
+  detection.set_detection_id(id);
+  auto* location_data = detection.mutable_location_data();
+  auto* box = location_data->mutable_relative_bounding_box();
+  box->set_xmin(xmin);
+  box->set_ymin(ymin);
+  box->set_width(size);
+  box->set_height(size);
+  auto* keypoint = location_data->add_relative_keypoints();
+  keypoint->set_x(xmin + size / 2);
+  keypoint->set_y(ymin + size / 2);
+  return detection;
+}
+
+void AddFrame(int64_t timestamp, CalculatorRunner* runner) {
+  runner->MutableInputs()->Tag("IMAGE").packets.push_back(
+      MakePacket<int>(0).At(Timestamp(timestamp)));
+}
+
+void AddDetections(int64_t timestamp, const Detections& detections,
+                   CalculatorRunner* runner) {
+  runner->MutableInputs()->Tag("DETECTIONS").packets.push_back(
+      MakePacket<Detections>(detections).At(Timestamp(timestamp)));
+}
+
+TEST(DetectionPredictionCalculatorTest, PredictsAndWidensBoxes) {
+  CalculatorRunner runner(
+      mediapipe::ParseTextProtoOrDie<mediapipe::CalculatorGraphConfig::Node>(
+          kNodeConfig));
+  // The face moves right by 0.05 every 100 ms.
+  AddDetections(0, {MakeFace(1, 0.2f, 0.4f, 0.2f)}, &runner);
+  AddDetections(100000, {MakeFace(1, 0.25f, 0.4f, 0.2f)}, &runner);
+  // 100 ms after the last detections.
+  AddFrame(200000, &runner);
+  // 1 s after the last detections, beyond the maximum prediction and margin.
+  AddFrame(1100000, &runner);
+
+  MP_ASSERT_OK(runner.Run());
+  const auto& packets = runner.Outputs().Tag("DETECTIONS").packets;
+  ASSERT_EQ(packets.size(), 2);
+  EXPECT_EQ(packets[0].Timestamp(), Timestamp(200000));
+  EXPECT_EQ(packets[1].Timestamp(), Timestamp(1100000));
+
+  ASSERT_EQ(packets[0].Get<Detections>().size(), 1);
+  const Detection& predicted = packets[0].Get<Detections>()[0];
+  EXPECT_EQ(predicted.detection_id(), 1);
+  const auto& box = predicted.location_data().relative_bounding_box();
+  // Moved to 0.3 and widened by 10% on each side.
+  EXPECT_NEAR(box.xmin(), 0.28f, 1e-5f);
+  EXPECT_NEAR(box.ymin(), 0.38f, 1e-5f);
+  EXPECT_NEAR(box.width(), 0.24f, 1e-5f);
+  EXPECT_NEAR(box.height(), 0.24f, 1e-5f);
+  const auto& keypoint = predicted.location_data().relative_keypoints(0);
+  EXPECT_NEAR(keypoint.x(), 0.4f, 1e-5f);
+  EXPECT_NEAR(keypoint.y(), 0.5f, 1e-5f);
+
+  ASSERT_EQ(packets[1].Get<Detections>().size(), 1);
+  const auto& late_box = packets[1]
+                             .Get<Detections>()[0]
+                             .location_data()
+                             .relative_bounding_box();
+  // Moved to 0.35 for 200 ms, and widened by 25% on each side.
+  EXPECT_NEAR(late_box.xmin(), 0.3f, 1e-5f);
+  EXPECT_NEAR(late_box.ymin(), 0.35f, 1e-5f);
+  EXPECT_NEAR(late_box.width(), 0.3f, 1e-5f);
+  EXPECT_NEAR(late_box.height(), 0.3f, 1e-5f);
+}
+
+TEST(DetectionPredictionCalculatorTest, UsesInputVelocities) {
+  CalculatorRunner runner(
+      mediapipe::ParseTextProtoOrDie<mediapipe::CalculatorGraphConfig::Node>(
+          R"pb(
+            calculator: "DetectionPredictionCalculator"
+            input_stream: "IMAGE:input_video"
+            input_stream: "DETECTIONS:async_tracked_detections"
+            input_stream: "VELOCITIES:async_track_velocities"
+            output_stream: "DETECTIONS:predicted_detections"
+            options {
+              [magritte.DetectionPredictionCalculatorOptions.ext] {
+                margin_rate: 0.0
+              }
+            }
+          )pb"));
+  // A single detection, with the velocity of its track: 0.5 per second down.
+  AddDetections(0, {MakeFace(1, 0.2f, 0.4f, 0.2f)}, &runner);
+  runner.MutableInputs()
+      ->Tag("VELOCITIES")
+      .packets.push_back(MakePacket<BoxVelocities>(BoxVelocities{
+                             {/*detection_id=*/1, /*xmin=*/0.0f,
+                              /*ymin=*/0.5f, /*width=*/0.0f,
+                              /*height=*/0.0f}})
+                             .At(Timestamp(0)));
+  AddFrame(100000, &runner);
+
+  MP_ASSERT_OK(runner.Run());
+  const auto& packets = runner.Outputs().Tag("DETECTIONS").packets;
+  ASSERT_EQ(packets.size(), 1);
+  ASSERT_EQ(packets[0].Get<Detections>().size(), 1);
+  const auto& box =
+      packets[0].Get<Detections>()[0].location_data().relative_bounding_box();
+  EXPECT_NEAR(box.xmin(), 0.2f, 1e-5f);
+  EXPECT_NEAR(box.ymin(), 0.45f, 1e-5f);
+  EXPECT_NEAR(box.width(), 0.2f, 1e-5f);
+}
+
+TEST(DetectionPredictionCalculatorTest, OutputsEmptyDetectionsUntilDetected) {
+  CalculatorRunner runner(
+      mediapipe::ParseTextProtoOrDie<mediapipe::CalculatorGraphConfig::Node>(
+          kNodeConfig));
+  AddFrame(0, &runner);
+  AddDetections(1, {MakeFace(1, 0.2f, 0.4f, 0.2f)}, &runner);
+  AddFrame(2, &runner);
+
+  MP_ASSERT_OK(runner.Run());
+  const auto& packets = runner.Outputs().Tag("DETECTIONS").packets;
+  ASSERT_EQ(packets.size(), 2);
+  EXPECT_TRUE(packets[0].Get<Detections>().empty());
+  ASSERT_EQ(packets[1].Get<Detections>().size(), 1);
+  // Without a velocity, the box stays in place.
+  const auto& box =
+      packets[1].Get<Detections>()[0].location_data().relative_bounding_box();
+  EXPECT_NEAR(box.xmin(), 0.2f, 1e-5f);
+  EXPECT_NEAR(box.width(), 0.2f, 1e-5f);
+}
+
+}  // namespace
+}  // namespace magritte
@@ -0,0 +1,157 @@
+//
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "magritte/calculators/detection_schedule_calculator.pb.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/formats/detection.pb.h"
+#include "mediapipe/framework/formats/location_data.pb.h"
+#include "mediapipe/framework/formats/rect.pb.h"
+#include "mediapipe/framework/port/ret_check.h"
+
+namespace magritte {
+namespace {
+using ::mediapipe::CalculatorBase;
+using ::mediapipe::CalculatorContext;
+using ::mediapipe::CalculatorContract;
+using ::mediapipe::Detection;
+using ::mediapipe::NormalizedRect;
+using Detections = std::vector<Detection>;
+
+constexpr char kTickTag[] = "TICK";
+constexpr char kDetectionsTag[] = "DETECTIONS";
+constexpr char kRegionOfInterestTag[] = "ROI";
+
+// Suffix of the counter of frames in which the secondary detector runs, after
+// the node name.
+constexpr char kSecondaryRunsCounterSuffix[] = "/SecondaryRuns";
+}  // namespace
+
+// A calculator that schedules a costly secondary face detector, e.g. the
+// full-range model, based on the results of a cheaper primary detector run in
+// every frame, e.g. the short-range model.
+//
+// The secondary detector runs periodically, and when the primary detections
+// suggest small or distant faces: when a primary detection is small, or when
+// the primary detector finds no face. In the other frames, the faces only found
+// by the secondary detector are expected to be carried forward by a tracker
+// downstream.
+//
+// Inputs:
+// - TICK: A packet of any type for every frame, e.g. the input image.
+// - DETECTIONS: The faces found by the primary detector, as
+//   std::vector<Detection>. A missing packet means that none were found.
+//
+// Outputs:
+// - ROI: A NormalizedRect covering the whole image, only output for the frames
+//   in which the secondary detector must run. It is meant to drive a detection
+//   subgraph by ROI, which skips the frames without ROI.
+//
+// Options:
+// - interval: The secondary detector runs at least once every interval frames.
+//   Default is 5.
+// - min_face_size: The secondary detector runs when a primary detection has a
+//   relative width or height below it. Default is 0.1.
+// - run_without_detections: Whether the secondary detector runs when the
+//   primary detector finds no face. Default is true.
+//
+// Example config:
+// node {
+//   calculator: "DetectionScheduleCalculator"
+//   input_stream: "TICK:input_video"
+//   input_stream: "DETECTIONS:short_range_detections"
+//   output_stream: "ROI:full_range_roi"
+//   options: {
+//     [magritte.DetectionScheduleCalculatorOptions.ext] {
+//       interval: 5
+//       min_face_size: 0.1
+//     }
+//   }
+// }
+class DetectionScheduleCalculator : public CalculatorBase {
+ public:
+  DetectionScheduleCalculator() = default;
+  ~DetectionScheduleCalculator() override = default;
+
+  static absl::Status GetContract(CalculatorContract* cc) {
+    RET_CHECK(cc->Inputs().HasTag(kTickTag))
+        << "Missing input " << kTickTag << " tag.";
+    cc->Inputs().Tag(kTickTag).SetAny();
+    RET_CHECK(cc->Inputs().HasTag(kDetectionsTag))
+        << "Missing input " << kDetectionsTag << " tag.";
+    cc->Inputs().Tag(kDetectionsTag).Set<Detections>();
+
+    RET_CHECK(cc->Outputs().HasTag(kRegionOfInterestTag))
+        << "Missing output " << kRegionOfInterestTag << " tag.";
+    cc->Outputs().Tag(kRegionOfInterestTag).Set<NormalizedRect>();
+
+    // No input side packets.
+    return absl::OkStatus();
+  }
+
+  absl::Status Open(CalculatorContext* cc) override {
+    cc->SetOffset(mediapipe::TimestampDiff(0));
+    options_ = cc->Options<DetectionScheduleCalculatorOptions>();
+    RET_CHECK_GE(options_.interval(), 1) << "interval must be positive.";
+    // The first frame runs the secondary detector.
+    frames_since_run_ = options_.interval() - 1;
+    return absl::OkStatus();
+  }
+
+  absl::Status Process(CalculatorContext* cc) override {
+    ++frames_since_run_;
+    if (!MustRunSecondary(cc->Inputs().Tag(kDetectionsTag))) {
+      return absl::OkStatus();
+    }
+    frames_since_run_ = 0;
+
+    NormalizedRect* roi = new NormalizedRect();
+    roi->set_x_center(0.5f);
+    roi->set_y_center(0.5f);
+    roi->set_width(1.0f);
+    roi->set_height(1.0f);
+    cc->Outputs().Tag(kRegionOfInterestTag).Add(roi, cc->InputTimestamp());
+    cc->GetCounter(absl::StrCat(cc->NodeName(), kSecondaryRunsCounterSuffix))
+        ->Increment();
+    return absl::OkStatus();
+  }
+
+ private:
+  // Whether the secondary detector must run given the primary detections.
+  bool MustRunSecondary(const mediapipe::InputStream& detections) const {
+    if (frames_since_run_ >= options_.interval()) return true;
+    if (detections.IsEmpty() || detections.Get<Detections>().empty()) {
+      return options_.run_without_detections();
+    }
+    for (const Detection& detection : detections.Get<Detections>()) {
+      const auto& box = detection.location_data().relative_bounding_box();
+      if (box.width() < options_.min_face_size() ||
+          box.height() < options_.min_face_size()) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  DetectionScheduleCalculatorOptions options_;
+  // Number of frames since the secondary detector last ran.
+  int frames_since_run_ = 0;
+};
+
+REGISTER_CALCULATOR(DetectionScheduleCalculator);
+
+}  // namespace magritte
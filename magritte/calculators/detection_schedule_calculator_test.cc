@@ -0,0 +1,134 @@
+//
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+#include <cstdint>
+#include <vector>
+
+#include "magritte/calculators/detection_schedule_calculator.pb.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/calculator_runner.h"
+#include "mediapipe/framework/formats/detection.pb.h"
+#include "mediapipe/framework/formats/location_data.pb.h"
+#include "mediapipe/framework/formats/rect.pb.h"
+#include "mediapipe/framework/port/gmock.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/parse_text_proto.h"
+#include "mediapipe/framework/port/status_matchers.h"
+
+namespace magritte {
+namespace {
+
+using ::mediapipe::CalculatorRunner;
+using ::mediapipe::Detection;
+using ::mediapipe::MakePacket;
+using ::mediapipe::NormalizedRect;
+using ::mediapipe::Timestamp;
+using Detections = std::vector<Detection>;
+
+constexpr char kNodeConfig[] = R"pb(
+  calculator: "DetectionScheduleCalculator"
+  input_stream: "TICK:tick"
+  input_stream: "DETECTIONS:detections"
+  output_stream: "ROI:roi"
+  options {
+    [magritte.DetectionScheduleCalculatorOptions.ext] {
+      interval: 3
+      min_face_size: 0.1
+    }
+  }
+)pb";
+
+// Adds a frame with one primary detection of the given relative size, or
+// without detections packet for a size of 0.
+void AddFrame(int timestamp, float face_size, CalculatorRunner* runner) {
+  runner->MutableInputs()->Tag("TICK").packets.push_back(
+      MakePacket<int>(0).At(Timestamp(timestamp)));
+  if (face_size > 0) {
+    Detection detection;
+    auto* box =
+        detection.mutable_location_data()->mutable_relative_bounding_box();
+    box->set_width(face_size);
+    box->set_height(face_size);
+    runner->MutableInputs()->Tag("DETECTIONS").packets.push_back(
+        MakePacket<Detections>(Detections{detection})
+            .At(Timestamp(timestamp)));
+  }
+}
+
+std::vector<int64_t> OutputTimestamps(const CalculatorRunner& runner) {
+  std::vector<int64_t> timestamps;
+  for (const auto& packet : runner.Outputs().Tag("ROI").packets) {
+    timestamps.push_back(packet.Timestamp().Value());
+  }
+  return timestamps;
+}
+
+TEST(DetectionScheduleCalculatorTest, RunsPeriodicallyWithLargeFaces) {
+  CalculatorRunner runner(
+      mediapipe::ParseTextProtoOrDie<mediapipe::CalculatorGraphConfig::Node>(
+          kNodeConfig));
+  for (int t = 0; t < 7; ++t) {
+    AddFrame(t, 0.3f, &runner);
+  }
+
+  MP_ASSERT_OK(runner.Run());
+  EXPECT_THAT(OutputTimestamps(runner), testing::ElementsAre(0, 3, 6));
+  EXPECT_EQ(
+      runner.GetCounter("DetectionScheduleCalculator/SecondaryRuns")->Get(), 3);
+  const NormalizedRect& roi =
+      runner.Outputs().Tag("ROI").packets[0].Get<NormalizedRect>();
+  EXPECT_FLOAT_EQ(roi.x_center(), 0.5f);
+  EXPECT_FLOAT_EQ(roi.y_center(), 0.5f);
+  EXPECT_FLOAT_EQ(roi.width(), 1.0f);
+  EXPECT_FLOAT_EQ(roi.height(), 1.0f);
+  EXPECT_FLOAT_EQ(roi.rotation(), 0.0f);
+}
+
+TEST(DetectionScheduleCalculatorTest, RunsForSmallOrMissingFaces) {
+  CalculatorRunner runner(
+      mediapipe::ParseTextProtoOrDie<mediapipe::CalculatorGraphConfig::Node>(
+          kNodeConfig));
+  // Frame 0 always runs, frame 2 has a small face, frame 3 has no face, and
+  // frame 6 is periodic.
+  AddFrame(0, 0.3f, &runner);
+  AddFrame(1, 0.3f, &runner);
+  AddFrame(2, 0.05f, &runner);
+  AddFrame(3, 0.0f, &runner);
+  AddFrame(4, 0.3f, &runner);
+  AddFrame(5, 0.3f, &runner);
+  AddFrame(6, 0.3f, &runner);
+
+  MP_ASSERT_OK(runner.Run());
+  EXPECT_THAT(OutputTimestamps(runner), testing::ElementsAre(0, 2, 3, 6));
+}
+
+TEST(DetectionScheduleCalculatorTest, CanSkipFramesWithoutFaces) {
+  auto node =
+      mediapipe::ParseTextProtoOrDie<mediapipe::CalculatorGraphConfig::Node>(
+          kNodeConfig);
+  node.mutable_options()
+      ->MutableExtension(DetectionScheduleCalculatorOptions::ext)
+      ->set_run_without_detections(false);
+  CalculatorRunner runner(node);
+  for (int t = 0; t < 4; ++t) {
+    AddFrame(t, 0.0f, &runner);
+  }
+
+  MP_ASSERT_OK(runner.Run());
+  EXPECT_THAT(OutputTimestamps(runner), testing::ElementsAre(0, 3));
+}
+
+}  // namespace
+}  // namespace magritte
@@ -0,0 +1,238 @@
+//
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+#include "magritte/calculators/disjoint_tiles.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <numeric>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include  <opencv2/core.hpp>
+
+namespace magritte {
+namespace {
+
+// Union-find over region indices.
+class DisjointSets {
+ public:
+  explicit DisjointSets(int size) : parent_(size) {
+    std::iota(parent_.begin(), parent_.end(), 0);
+  }
+
+  int Find(int i) {
+    while (parent_[i] != i) {
+      parent_[i] = parent_[parent_[i]];
+      i = parent_[i];
+    }
+    return i;
+  }
+
+  void Union(int i, int j) { parent_[Find(i)] = Find(j); }
+
+ private:
+  std::vector<int> parent_;
+};
+
+// Rounds towards negative infinity, so that cells are well defined for regions
+// that are partially outside of the image.
+int FloorDiv(int a, int b) {
+  return a / b - (a % b != 0 && (a < 0) != (b < 0));
+}
+
+// Returns the indices of the non-empty regions grouped by transitive overlap,
+// each group and the groups themselves ordered by their first region.
+std::vector<std::vector<int>> GroupOverlappingRegions(
+    const std::vector<cv::Rect>& regions, int grid_cell_size) {
+  const int num_regions = static_cast<int>(regions.size());
+  absl::flat_hash_map<std::pair<int, int>, std::vector<int>> regions_by_cell;
+  for (int i = 0; i < num_regions; ++i) {
+    const cv::Rect& region = regions[i];
+    if (region.empty()) {
+      continue;
+    }
+    for (int cy = FloorDiv(region.y, grid_cell_size);
+         cy <= FloorDiv(region.br().y - 1, grid_cell_size); ++cy) {
+      for (int cx = FloorDiv(region.x, grid_cell_size);
+           cx <= FloorDiv(region.br().x - 1, grid_cell_size); ++cx) {
+        regions_by_cell[{cx, cy}].push_back(i);
+      }
+    }
+  }
+
+  // Regions can only overlap if they share a cell.
+  DisjointSets sets(regions.size());
+  for (const auto& [cell, indices] : regions_by_cell) {
+    for (size_t a = 0; a < indices.size(); ++a) {
+      for (size_t b = a + 1; b < indices.size(); ++b) {
+        if ((regions[indices[a]] & regions[indices[b]]).area() > 0) {
+          sets.Union(indices[a], indices[b]);
+        }
+      }
+    }
+  }
+
+  std::vector<std::vector<int>> groups;
+  std::vector<int> group_of_root(regions.size(), -1);
+  for (int i = 0; i < num_regions; ++i) {
+    if (regions[i].empty()) {
+      continue;
+    }
+    const int root = sets.Find(i);
+    if (group_of_root[root] < 0) {
+      group_of_root[root] = groups.size();
+      groups.emplace_back();
+    }
+    groups[group_of_root[root]].push_back(i);
+  }
+  return groups;
+}
+
+// Appends the disjoint tiles covering the union of a group of regions.
+void DecomposeGroup(const std::vector<cv::Rect>& regions,
+                    const std::vector<int>& values,
+                    const std::vector<int>& group, int group_index,
+                    std::vector<DisjointTile>* tiles) {
+  std::vector<int> band_edges;
+  for (const int i : group) {
+    band_edges.push_back(regions[i].y);
+    band_edges.push_back(regions[i].br().y);
+  }
+  std::sort(band_edges.begin(), band_edges.end());
+  band_edges.erase(std::unique(band_edges.begin(), band_edges.end()),
+                   band_edges.end());
+
+  // Tiles ending at the top of the current band, which are extended downwards
+  // if the band has a tile with the same horizontal extent and value.
+  std::vector<DisjointTile> open_tiles;
+  for (size_t b = 0; b + 1 < band_edges.size(); ++b) {
+    const int top = band_edges[b];
+    const int bottom = band_edges[b + 1];
+
+    // Sweep over the left and right edges of the regions spanning the band,
+    // keeping track of the values of the regions covering the sweep position.
+    std::vector<std::pair<int, int>> events;  // (x, +/- (index + 1))
+    for (const int i : group) {
+      if (regions[i].y <= top && regions[i].br().y >= bottom) {
+        events.emplace_back(regions[i].x, i + 1);
+        events.emplace_back(regions[i].br().x, -(i + 1));
+      }
+    }
+    std::sort(events.begin(), events.end());
+
+    std::vector<DisjointTile> band_tiles;
+    std::map<int, int> covering_values;  // value -> number of regions
+    for (size_t e = 0; e < events.size(); ++e) {
+      const auto [x, signed_index] = events[e];
+      const int value = values[std::abs(signed_index) - 1];
+      if (signed_index > 0) {
+        ++covering_values[value];
+      } else if (--covering_values[value] == 0) {
+        covering_values.erase(value);
+      }
+      if (e + 1 == events.size() || events[e + 1].first == x ||
+          covering_values.empty()) {
+        continue;
+      }
+      const int next_x = events[e + 1].first;
+      const int max_value = covering_values.rbegin()->first;
+      if (!band_tiles.empty() && band_tiles.back().rect.br().x == x &&
+          band_tiles.back().value == max_value) {
+        band_tiles.back().rect.width += next_x - x;
+      } else {
+        band_tiles.push_back({cv::Rect(x, top, next_x - x, bottom - top),
+                              max_value, group_index});
+      }
+    }
+
+    for (DisjointTile& tile : band_tiles) {
+      auto open_tile = std::find_if(
+          open_tiles.begin(), open_tiles.end(), [&tile](const DisjointTile& t) {
+            return t.rect.br().y == tile.rect.y && t.rect.x == tile.rect.x &&
+                   t.rect.width == tile.rect.width && t.value == tile.value;
+          });
+      if (open_tile != open_tiles.end()) {
+        tile.rect.y = open_tile->rect.y;
+        tile.rect.height += open_tile->rect.height;
+        open_tiles.erase(open_tile);
+      }
+    }
+    tiles->insert(tiles->end(), open_tiles.begin(), open_tiles.end());
+    open_tiles = std::move(band_tiles);
+  }
+  tiles->insert(tiles->end(), open_tiles.begin(), open_tiles.end());
+}
+
+}  // namespace
+
+std::vector<DisjointTile> DecomposeIntoDisjointTiles(
+    const std::vector<cv::Rect>& regions, const std::vector<int>& values,
+    int grid_cell_size) {
+  std::vector<DisjointTile> tiles;
+  const std::vector<std::vector<int>> groups =
+      GroupOverlappingRegions(regions, grid_cell_size);
+  const int num_groups = static_cast<int>(groups.size());
+  for (int g = 0; g < num_groups; ++g) {
+    DecomposeGroup(regions, values, groups[g], g, &tiles);
+  }
+  return tiles;
+}
+
+std::vector<DisjointTileBatch> BatchDisjointTiles(
+    const std::vector<DisjointTile>& tiles) {
+  std::vector<DisjointTileBatch> candidates;
+  std::vector<int64_t> separate_areas;
+  absl::flat_hash_map<std::pair<int, int>, int> candidate_of_group_and_value;
+  const int num_tiles = static_cast<int>(tiles.size());
+  for (int i = 0; i < num_tiles; ++i) {
+    const DisjointTile& tile = tiles[i];
+    const auto [it, inserted] = candidate_of_group_and_value.try_emplace(
+        std::make_pair(tile.group, tile.value), candidates.size());
+    if (inserted) {
+      candidates.push_back({tile.rect, tile.value, {}});
+      separate_areas.push_back(0);
+    }
+    DisjointTileBatch& candidate = candidates[it->second];
+    candidate.bounds |= tile.rect;
+    candidate.tiles.push_back(i);
+    separate_areas[it->second] += PaddedTileArea(tile.rect, tile.value);
+  }
+
+  std::vector<DisjointTileBatch> batches;
+  for (size_t c = 0; c < candidates.size(); ++c) {
+    DisjointTileBatch& candidate = candidates[c];
+    const int64_t batched_area =
+        PaddedTileArea(candidate.bounds, candidate.value);
+    if (batched_area <= separate_areas[c]) {
+      batches.push_back(std::move(candidate));
+      continue;
+    }
+    for (const int i : candidate.tiles) {
+      batches.push_back({tiles[i].rect, tiles[i].value, {i}});
+    }
+  }
+  return batches;
+}
+
+int64_t PaddedTileArea(const cv::Rect& rect, int value) {
+  const int margin = value / 2;
+  return static_cast<int64_t>(rect.width + 2 * margin) *
+         (rect.height + 2 * margin);
+}
+
+}  // namespace magritte
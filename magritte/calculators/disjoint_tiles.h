@@ -0,0 +1,74 @@
+//
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+#ifndef MAGRITTE_CALCULATORS_DISJOINT_TILES_H_
+#define MAGRITTE_CALCULATORS_DISJOINT_TILES_H_
+
+#include <cstdint>
+#include <vector>
+
+#include  <opencv2/core.hpp>
+
+namespace magritte {
+
+// A rectangle of a disjoint tiling, with the largest value of the regions that
+// cover it.
+struct DisjointTile {
+  cv::Rect rect;
+  int value = 0;
+  // Index of the group of transitively overlapping regions the tile belongs to.
+  int group = 0;
+};
+
+// Tiles with the same value that are filtered together, from their bounds.
+struct DisjointTileBatch {
+  cv::Rect bounds;
+  int value = 0;
+  // Indices of the tiles of the batch.
+  std::vector<int> tiles;
+};
+
+// Decomposes the union of the given regions into disjoint rectangular tiles,
+// so that each pixel covered by at least one region is in exactly one tile.
+// Each tile gets the largest of `values` of the regions covering it; `values`
+// must have one entry per region. Empty regions are ignored.
+//
+// Overlapping regions are found by binning the regions into a grid with cells
+// of grid_cell_size x grid_cell_size pixels, so the cost grows with the total
+// area of the regions rather than quadratically with their number. Each group
+// of overlapping regions is then split into horizontal bands at the top and
+// bottom edges of its regions, and vertically adjacent tiles with the same
+// extent and value are merged.
+std::vector<DisjointTile> DecomposeIntoDisjointTiles(
+    const std::vector<cv::Rect>& regions, const std::vector<int>& values,
+    int grid_cell_size);
+
+// Batches the given tiles for filters that read `value / 2` pixels around each
+// tile, e.g. blurs with a kernel of size `value`. Where regions overlap, the
+// tiling has many thin tiles, and filtering each of them separately pays for a
+// margin on every side of every tile. Instead, the tiles of a group with the
+// same value are filtered once, over their bounds and margin, unless that
+// covers more pixels than filtering them separately. The total filtered area
+// therefore never exceeds that of the tiles one by one, and within a group it
+// is bounded by the area of the group times its number of distinct values.
+std::vector<DisjointTileBatch> BatchDisjointTiles(
+    const std::vector<DisjointTile>& tiles);
+
+// Returns the area of the given rect extended by `value / 2` on each side.
+int64_t PaddedTileArea(const cv::Rect& rect, int value);
+
+}  // namespace magritte
+
+#endif  // MAGRITTE_CALCULATORS_DISJOINT_TILES_H_
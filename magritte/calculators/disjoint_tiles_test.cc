@@ -0,0 +1,181 @@
+//
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+#include "magritte/calculators/disjoint_tiles.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "mediapipe/framework/port/gmock.h"
+#include "mediapipe/framework/port/gtest.h"
+#include  <opencv2/core.hpp>
+
+namespace magritte {
+namespace {
+
+using ::testing::IsEmpty;
+using ::testing::UnorderedElementsAre;
+
+constexpr int kGridCellSize = 16;
+
+MATCHER_P2(IsTile, rect, value, "") {
+  return arg.rect == rect && arg.value == value;
+}
+
+TEST(DecomposeIntoDisjointTilesTest, NoRegions) {
+  EXPECT_THAT(DecomposeIntoDisjointTiles({}, {}, kGridCellSize), IsEmpty());
+}
+
+TEST(DecomposeIntoDisjointTilesTest, IgnoresEmptyRegions) {
+  EXPECT_THAT(DecomposeIntoDisjointTiles({cv::Rect(), cv::Rect(5, 5, 0, 10)},
+                                         {1, 2}, kGridCellSize),
+              IsEmpty());
+}
+
+TEST(DecomposeIntoDisjointTilesTest, KeepsDisjointRegions) {
+  EXPECT_THAT(
+      DecomposeIntoDisjointTiles({cv::Rect(0, 0, 10, 10),
+                                  cv::Rect(10, 0, 10, 10)},
+                                 {1, 2}, kGridCellSize),
+      UnorderedElementsAre(IsTile(cv::Rect(0, 0, 10, 10), 1),
+                           IsTile(cv::Rect(10, 0, 10, 10), 2)));
+}
+
+TEST(DecomposeIntoDisjointTilesTest, MergesContainedRegions) {
+  EXPECT_THAT(
+      DecomposeIntoDisjointTiles({cv::Rect(0, 0, 100, 100),
+                                  cv::Rect(20, 20, 10, 10)},
+                                 {5, 1}, kGridCellSize),
+      UnorderedElementsAre(IsTile(cv::Rect(0, 0, 100, 100), 5)));
+}
+
+TEST(DecomposeIntoDisjointTilesTest, SplitsOverlappingRegions) {
+  // Two overlapping squares with different values; the overlap gets the
+  // larger value.
+  EXPECT_THAT(
+      DecomposeIntoDisjointTiles({cv::Rect(0, 0, 20, 20),
+                                  cv::Rect(10, 10, 20, 20)},
+                                 {1, 2}, kGridCellSize),
+      UnorderedElementsAre(IsTile(cv::Rect(0, 0, 20, 10), 1),
+                           IsTile(cv::Rect(0, 10, 10, 10), 1),
+                           IsTile(cv::Rect(10, 10, 20, 20), 2)));
+}
+
+// Compares the tiles to the regions pixel by pixel for random crowds of
+// overlapping regions, partially outside of the image.
+TEST(DecomposeIntoDisjointTilesTest, CoversEachPixelOnceWithLargestValue) {
+  std::mt19937 random(/*seed=*/1);
+  for (int iteration = 0; iteration < 100; ++iteration) {
+    std::vector<cv::Rect> regions;
+    std::vector<int> values;
+    for (int i = 0; i < 40; ++i) {
+      regions.emplace_back(random() % 120 - 10, random() % 120 - 10,
+                           random() % 40, random() % 40);
+      values.push_back(random() % 5);
+    }
+    const std::vector<DisjointTile> tiles =
+        DecomposeIntoDisjointTiles(regions, values, kGridCellSize);
+
+    for (int y = -10; y < 150; ++y) {
+      for (int x = -10; x < 150; ++x) {
+        int expected_value = -1;
+        for (size_t i = 0; i < regions.size(); ++i) {
+          if (regions[i].contains(cv::Point(x, y))) {
+            expected_value = std::max(expected_value, values[i]);
+          }
+        }
+        int num_tiles = 0;
+        int value = -1;
+        for (const DisjointTile& tile : tiles) {
+          if (tile.rect.contains(cv::Point(x, y))) {
+            ++num_tiles;
+            value = tile.value;
+          }
+        }
+        ASSERT_EQ(num_tiles, expected_value < 0 ? 0 : 1)
+            << "at (" << x << ", " << y << ")";
+        ASSERT_EQ(value, expected_value) << "at (" << x << ", " << y << ")";
+      }
+    }
+  }
+}
+
+TEST(BatchDisjointTilesTest, BatchesEachTileOnceWithItsValue) {
+  std::mt19937 random(/*seed=*/2);
+  for (int iteration = 0; iteration < 100; ++iteration) {
+    std::vector<cv::Rect> regions;
+    std::vector<int> values;
+    for (int i = 0; i < 40; ++i) {
+      regions.emplace_back(random() % 200, random() % 200, random() % 60,
+                           random() % 60);
+      values.push_back(2 * (random() % 4) + 9);
+    }
+    const std::vector<DisjointTile> tiles =
+        DecomposeIntoDisjointTiles(regions, values, kGridCellSize);
+
+    const std::vector<DisjointTileBatch> batches = BatchDisjointTiles(tiles);
+
+    std::vector<int> num_batches_of_tile(tiles.size(), 0);
+    int64_t batched_area = 0;
+    for (const DisjointTileBatch& batch : batches) {
+      for (const int i : batch.tiles) {
+        ++num_batches_of_tile[i];
+        EXPECT_EQ(tiles[i].value, batch.value);
+        EXPECT_EQ(tiles[i].rect & batch.bounds, tiles[i].rect);
+      }
+      batched_area += PaddedTileArea(batch.bounds, batch.value);
+    }
+    int64_t separate_area = 0;
+    for (size_t i = 0; i < tiles.size(); ++i) {
+      EXPECT_EQ(num_batches_of_tile[i], 1);
+      separate_area += PaddedTileArea(tiles[i].rect, tiles[i].value);
+    }
+    EXPECT_LE(batched_area, separate_area);
+  }
+}
+
+// Many faces of the same size overlapping in a 200x200 area split into thin
+// tiles, which are still filtered once over the area of the crowd.
+TEST(BatchDisjointTilesTest, WorkStaysBoundedInCrowds) {
+  constexpr int kBlurSize = 13;
+  std::mt19937 random(/*seed=*/3);
+  std::vector<cv::Rect> regions;
+  for (int i = 0; i < 200; ++i) {
+    regions.emplace_back(random() % 160, random() % 160, 40, 40);
+  }
+  const std::vector<DisjointTile> tiles = DecomposeIntoDisjointTiles(
+      regions, std::vector<int>(regions.size(), kBlurSize), kGridCellSize);
+  int64_t separate_area = 0;
+  for (const DisjointTile& tile : tiles) {
+    separate_area += PaddedTileArea(tile.rect, tile.value);
+  }
+
+  const std::vector<DisjointTileBatch> batches = BatchDisjointTiles(tiles);
+
+  int64_t batched_area = 0;
+  for (const DisjointTileBatch& batch : batches) {
+    batched_area += PaddedTileArea(batch.bounds, batch.value);
+  }
+  const int64_t crowd_area = PaddedTileArea(cv::Rect(0, 0, 200, 200),
+                                            kBlurSize);
+  EXPECT_GT(tiles.size(), 1);
+  EXPECT_LE(batched_area, crowd_area);
+  EXPECT_LT(batched_area, separate_area);
+}
+
+}  // namespace
+}  // namespace magritte
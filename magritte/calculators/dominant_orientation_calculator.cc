@@ -0,0 +1,143 @@
+//
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+#include <memory>
+#include <vector>
+
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/formats/detection.pb.h"
+#include "mediapipe/framework/port/ret_check.h"
+
+namespace magritte {
+namespace {
+using ::mediapipe::CalculatorBase;
+using ::mediapipe::CalculatorContext;
+using ::mediapipe::CalculatorContract;
+using ::mediapipe::Detection;
+using Detections = std::vector<Detection>;
+
+constexpr char kTickTag[] = "TICK";
+constexpr char kDetectionsTag[] = "DETECTIONS";
+constexpr char kRotationDegreesTag[] = "ROTATION_DEGREES";
+
+// Number of orientations searched in a full sweep.
+constexpr int kNumOrientations = 4;
+
+// Returns the sum of the scores of the detections in the given stream, or 0 if
+// there is no packet.
+float TotalScore(const mediapipe::InputStream& stream) {
+  if (stream.IsEmpty()) return 0.0f;
+  float total = 0.0f;
+  for (const Detection& detection : stream.Get<Detections>()) {
+    total += detection.score_size() > 0 ? detection.score(0) : 1.0f;
+  }
+  return total;
+}
+}  // namespace
+
+// A calculator that tracks the dominant orientation of the faces of a stream,
+// for the OrientationCascadeCalculator.
+//
+// The dominant orientation only changes on the frames in which all four
+// orientations were searched: it becomes the orientation whose detections have
+// the highest total score, if that is strictly higher than the score of the
+// current dominant orientation. The output is meant to be looped back to the
+// next frame with a PreviousLoopbackCalculator, to select the primary
+// orientation.
+//
+// Inputs:
+// - TICK: A packet of any type for every frame, e.g. the input image.
+// - ROTATION_DEGREES (optional): The current dominant orientation, i.e. the
+//   clockwise rotation of the primary ROI in degrees, as an int multiple of 90.
+//   Defaults to 0.
+// - DETECTIONS:0: The faces found in the primary orientation, as
+//   std::vector<Detection>.
+// - DETECTIONS:1, DETECTIONS:2, DETECTIONS:3: The faces found in the ROIs
+//   rotated by 90°, 180° and 270° more than the primary ROI, if they were
+//   searched.
+//
+// Outputs:
+// - ROTATION_DEGREES: The dominant orientation after this frame, in degrees in
+//   [0, 360).
+//
+// Example config:
+// node {
+//   calculator: "DominantOrientationCalculator"
+//   input_stream: "TICK:input_video"
+//   input_stream: "ROTATION_DEGREES:primary_rotation"
+//   input_stream: "DETECTIONS:0:primary_detections"
+//   input_stream: "DETECTIONS:1:detections1"
+//   input_stream: "DETECTIONS:2:detections2"
+//   input_stream: "DETECTIONS:3:detections3"
+//   output_stream: "ROTATION_DEGREES:dominant_rotation"
+// }
+class DominantOrientationCalculator : public CalculatorBase {
+ public:
+  DominantOrientationCalculator() = default;
+  ~DominantOrientationCalculator() override = default;
+
+  static absl::Status GetContract(CalculatorContract* cc) {
+    RET_CHECK(cc->Inputs().HasTag(kTickTag))
+        << "Missing input " << kTickTag << " tag.";
+    cc->Inputs().Tag(kTickTag).SetAny();
+    if (cc->Inputs().HasTag(kRotationDegreesTag)) {
+      cc->Inputs().Tag(kRotationDegreesTag).Set<int>();
+    }
+    RET_CHECK_EQ(cc->Inputs().NumEntries(kDetectionsTag), kNumOrientations)
+        << "Calculator must have " << kNumOrientations << " DETECTIONS inputs.";
+    for (int i = 0; i < kNumOrientations; ++i) {
+      cc->Inputs().Get(kDetectionsTag, i).Set<Detections>();
+    }
+    RET_CHECK(cc->Outputs().HasTag(kRotationDegreesTag))
+        << "Missing output " << kRotationDegreesTag << " tag.";
+    cc->Outputs().Tag(kRotationDegreesTag).Set<int>();
+
+    // No input side packets.
+    return absl::OkStatus();
+  }
+
+  absl::Status Open(CalculatorContext* cc) override {
+    cc->SetOffset(mediapipe::TimestampDiff(0));
+    return absl::OkStatus();
+  }
+
+  absl::Status Process(CalculatorContext* cc) override {
+    int primary_rotation = 0;
+    if (cc->Inputs().HasTag(kRotationDegreesTag) &&
+        !cc->Inputs().Tag(kRotationDegreesTag).IsEmpty()) {
+      primary_rotation = cc->Inputs().Tag(kRotationDegreesTag).Get<int>();
+    }
+
+    int dominant = 0;
+    float dominant_score = TotalScore(cc->Inputs().Get(kDetectionsTag, 0));
+    for (int i = 1; i < kNumOrientations; ++i) {
+      const float score = TotalScore(cc->Inputs().Get(kDetectionsTag, i));
+      if (score > dominant_score) {
+        dominant = i;
+        dominant_score = score;
+      }
+    }
+
+    const int rotation = ((primary_rotation + 90 * dominant) % 360 + 360) % 360;
+    cc->Outputs()
+        .Tag(kRotationDegreesTag)
+        .Add(new int(rotation), cc->InputTimestamp());
+    return absl::OkStatus();
+  }
+};
+
+REGISTER_CALCULATOR(DominantOrientationCalculator);
+
+}  // namespace magritte
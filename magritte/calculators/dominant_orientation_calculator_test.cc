@@ -0,0 +1,123 @@
+//
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+#include <vector>
+
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/calculator_runner.h"
+#include "mediapipe/framework/formats/detection.pb.h"
+#include "mediapipe/framework/port/gmock.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/parse_text_proto.h"
+#include "mediapipe/framework/port/status_matchers.h"
+
+namespace magritte {
+namespace {
+
+using ::mediapipe::CalculatorRunner;
+using ::mediapipe::Detection;
+using ::mediapipe::MakePacket;
+using ::mediapipe::Timestamp;
+using Detections = std::vector<Detection>;
+
+constexpr char kNodeConfig[] = R"pb(
+  calculator: "DominantOrientationCalculator"
+  input_stream: "TICK:tick"
+  input_stream: "ROTATION_DEGREES:primary_rotation"
+  input_stream: "DETECTIONS:0:detections0"
+  input_stream: "DETECTIONS:1:detections1"
+  input_stream: "DETECTIONS:2:detections2"
+  input_stream: "DETECTIONS:3:detections3"
+  output_stream: "ROTATION_DEGREES:dominant_rotation"
+)pb";
+
+Detections MakeDetections(const std::vector<float>& scores) {
+  Detections detections;
+  for (float score : scores) {
+    detections.emplace_back().add_score(score);
+  }
+  return detections;
+}
+
+class DominantOrientationCalculatorTest : public testing::Test {
+ protected:
+  DominantOrientationCalculatorTest()
+      : runner_(mediapipe::ParseTextProtoOrDie<
+                mediapipe::CalculatorGraphConfig::Node>(kNodeConfig)) {}
+
+  void AddTick(int timestamp) {
+    runner_.MutableInputs()->Tag("TICK").packets.push_back(
+        MakePacket<int>(0).At(Timestamp(timestamp)));
+  }
+
+  void AddPrimaryRotation(int timestamp, int rotation) {
+    runner_.MutableInputs()->Tag("ROTATION_DEGREES").packets.push_back(
+        MakePacket<int>(rotation).At(Timestamp(timestamp)));
+  }
+
+  void AddDetections(int timestamp, int index,
+                     const std::vector<float>& scores) {
+    runner_.MutableInputs()->Get("DETECTIONS", index).packets.push_back(
+        MakePacket<Detections>(MakeDetections(scores))
+            .At(Timestamp(timestamp)));
+  }
+
+  std::vector<int> OutputRotations() {
+    std::vector<int> rotations;
+    for (const auto& packet :
+         runner_.Outputs().Tag("ROTATION_DEGREES").packets) {
+      rotations.push_back(packet.Get<int>());
+    }
+    return rotations;
+  }
+
+  CalculatorRunner runner_;
+};
+
+TEST_F(DominantOrientationCalculatorTest, DefaultsToUpright) {
+  AddTick(0);
+
+  MP_ASSERT_OK(runner_.Run());
+  EXPECT_THAT(OutputRotations(), testing::ElementsAre(0));
+}
+
+TEST_F(DominantOrientationCalculatorTest, KeepsPrimaryWithoutFullSweep) {
+  AddTick(0);
+  AddPrimaryRotation(0, 90);
+  AddDetections(0, 0, {0.8});
+
+  MP_ASSERT_OK(runner_.Run());
+  EXPECT_THAT(OutputRotations(), testing::ElementsAre(90));
+}
+
+TEST_F(DominantOrientationCalculatorTest, SwitchesToBestScoringOrientation) {
+  // The faces of the stream are upside down, relative to a primary rotation of
+  // 270°.
+  AddTick(0);
+  AddPrimaryRotation(0, 270);
+  AddDetections(0, 1, {0.6});
+  AddDetections(0, 2, {0.9, 0.7});
+  // With a tie, the primary orientation is kept.
+  AddTick(1);
+  AddPrimaryRotation(1, 90);
+  AddDetections(1, 0, {0.9});
+  AddDetections(1, 3, {0.9});
+
+  MP_ASSERT_OK(runner_.Run());
+  EXPECT_THAT(OutputRotations(), testing::ElementsAre(90, 90));
+}
+
+}  // namespace
+}  // namespace magritte
@@ -0,0 +1,139 @@
+//
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+#include "magritte/calculators/fast_blur.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+#include  <opencv2/core.hpp>
+#include  <opencv2/imgproc.hpp>
+
+namespace magritte {
+namespace {
+
+// Number of stacked box filters approximating a Gaussian. Three passes are
+// within a few intensity levels of the real Gaussian.
+constexpr int kNumBoxPasses = 3;
+
+// Standard deviation of the Gaussian applied at the downsampled level of the
+// pyramid blur. The smaller, the more the image is downsampled; below about
+// three pixels the upsampling artifacts become visible.
+constexpr double kPyramidSigma = 3.0;
+
+// Returns the sizes of kNumBoxPasses stacked box filters whose combined
+// variance approximates the variance of a Gaussian with the given standard
+// deviation (see W. Jarosz, "Fast Image Convolutions", 2001). A size of one
+// leaves the image unchanged.
+std::array<int, kNumBoxPasses> BoxSizesForGaussian(double sigma) {
+  const double variance = sigma * sigma;
+  const double ideal_size =
+      std::sqrt(12.0 * variance / kNumBoxPasses + 1.0);
+  int lower_size = static_cast<int>(std::floor(ideal_size));
+  if (lower_size % 2 == 0) {
+    lower_size--;
+  }
+  lower_size = std::max(lower_size, 1);
+  const int upper_size = lower_size + 2;
+  // Number of passes using the lower size, so that the total variance
+  // sum((size^2 - 1) / 12) is as close as possible to the Gaussian variance.
+  const int num_lower = static_cast<int>(std::round(
+      (12.0 * variance - kNumBoxPasses * lower_size * lower_size -
+       4.0 * kNumBoxPasses * lower_size - 3.0 * kNumBoxPasses) /
+      (-4.0 * lower_size - 4.0)));
+
+  std::array<int, kNumBoxPasses> sizes;
+  for (int i = 0; i < kNumBoxPasses; ++i) {
+    sizes[i] = i < num_lower ? lower_size : upper_size;
+  }
+  return sizes;
+}
+
+// Blurs a downsampled copy of `mat` with `blur_small` and upsamples the result
+// back into `mat`. `blur_small` receives the downsampled copy and the actual
+// downsampling factor. Returns false without modifying `mat` if the kernel is
+// too small to be worth downsampling.
+template <typename BlurFn>
+bool BlurDownsampled(int kernel_size, cv::Mat* mat, BlurFn blur_small) {
+  const int factor = static_cast<int>(GaussianSigmaForKernelSize(kernel_size) /
+                                      kPyramidSigma);
+  if (factor <= 1) {
+    return false;
+  }
+
+  const cv::Size small_size(std::max(1, (mat->cols + factor / 2) / factor),
+                            std::max(1, (mat->rows + factor / 2) / factor));
+  cv::Mat small;
+  cv::resize(*mat, small, small_size, 0, 0, cv::INTER_AREA);
+  blur_small(static_cast<double>(mat->cols) / small_size.width, &small);
+  // The destination already has the right size and type, so resize writes into
+  // the region of the original image.
+  cv::resize(small, *mat, mat->size(), 0, 0, cv::INTER_LINEAR);
+  return true;
+}
+
+}  // namespace
+
+double GaussianSigmaForKernelSize(int kernel_size) {
+  return 0.3 * ((kernel_size - 1) * 0.5 - 1) + 0.8;
+}
+
+void RunningSumBoxBlur(int kernel_size, cv::Mat* mat) {
+  if (kernel_size <= 1) {
+    return;
+  }
+  cv::blur(*mat, *mat, cv::Size(kernel_size, kernel_size));
+}
+
+void RunningSumGaussianBlur(int kernel_size, cv::Mat* mat) {
+  for (const int box_size :
+       BoxSizesForGaussian(GaussianSigmaForKernelSize(kernel_size))) {
+    RunningSumBoxBlur(box_size, mat);
+  }
+}
+
+void PyramidBoxBlur(int kernel_size, cv::Mat* mat) {
+  const bool blurred = BlurDownsampled(
+      kernel_size, mat, [kernel_size](double factor, cv::Mat* small) {
+        int small_kernel_size =
+            std::max(1, static_cast<int>(std::round(kernel_size / factor)));
+        if (small_kernel_size % 2 == 0) {
+          small_kernel_size++;
+        }
+        RunningSumBoxBlur(small_kernel_size, small);
+      });
+  if (!blurred) {
+    RunningSumBoxBlur(kernel_size, mat);
+  }
+}
+
+void PyramidGaussianBlur(int kernel_size, cv::Mat* mat) {
+  const double sigma = GaussianSigmaForKernelSize(kernel_size);
+  const bool blurred = BlurDownsampled(
+      kernel_size, mat, [sigma](double factor, cv::Mat* small) {
+        // Area downsampling already averages over factor x factor pixels,
+        // which is a box filter with variance (factor^2 - 1) / 12.
+        const double remaining_variance =
+            std::max(0.0, sigma * sigma - (factor * factor - 1.0) / 12.0);
+        cv::GaussianBlur(*small, *small, cv::Size(0, 0),
+                         std::sqrt(remaining_variance) / factor);
+      });
+  if (!blurred) {
+    cv::GaussianBlur(*mat, *mat, cv::Size(kernel_size, kernel_size), 0, 0);
+  }
+}
+
+}  // namespace magritte
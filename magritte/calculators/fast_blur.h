@@ -0,0 +1,56 @@
+//
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+#ifndef MAGRITTE_CALCULATORS_FAST_BLUR_H_
+#define MAGRITTE_CALCULATORS_FAST_BLUR_H_
+
+#include  <opencv2/core.hpp>
+
+namespace magritte {
+
+// Blur implementations whose cost per pixel does not depend on the kernel
+// size. All of them blur the given matrix in place. If it is a region of a
+// larger image, the running-sum variants use the pixels outside of the region
+// as border, like OpenCV filters do. The pyramid variants do too when the
+// kernel is too small to downsample, but otherwise only read the region
+// itself, as cv::resize does, and reflect its edges instead.
+//
+// The kernel size must be a positive odd number. The Gaussian variants
+// approximate cv::GaussianBlur(mat, mat, {kernel_size, kernel_size}, 0, 0),
+// i.e. with the standard deviation that OpenCV derives from the kernel size.
+
+// Returns the standard deviation cv::GaussianBlur uses for the given kernel
+// size when none is specified.
+double GaussianSigmaForKernelSize(int kernel_size);
+
+// Blurs with a normalized box filter. OpenCV computes box filters with running
+// sums over rows and columns, so this is equivalent to cv::blur.
+void RunningSumBoxBlur(int kernel_size, cv::Mat* mat);
+
+// Approximates a Gaussian blur by three stacked running-sum box filters whose
+// sizes are chosen to match the variance of the Gaussian.
+void RunningSumGaussianBlur(int kernel_size, cv::Mat* mat);
+
+// Blurs a downsampled copy of the matrix with a small box filter and upsamples
+// the result back into the matrix.
+void PyramidBoxBlur(int kernel_size, cv::Mat* mat);
+
+// Blurs a downsampled copy of the matrix with a small Gaussian kernel and
+// upsamples the result back into the matrix.
+void PyramidGaussianBlur(int kernel_size, cv::Mat* mat);
+
+}  // namespace magritte
+
+#endif  // MAGRITTE_CALCULATORS_FAST_BLUR_H_
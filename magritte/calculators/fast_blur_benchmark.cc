@@ -0,0 +1,107 @@
+//
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Benchmarks the blur algorithms of SimpleBlurCalculatorCpu for a single face
+// of increasing size in a 4K frame.
+//
+// Usage:
+//   bazel run -c opt //magritte/calculators:fast_blur_benchmark
+#include <cmath>
+
+#include "benchmark/benchmark.h"
+#include  <opencv2/core.hpp>
+#include  <opencv2/imgproc.hpp>
+#include "magritte/calculators/fast_blur.h"
+
+namespace magritte {
+namespace {
+
+constexpr int kFrameWidth = 3840;
+constexpr int kFrameHeight = 2160;
+
+// Same ratio between face size and kernel size as SimpleBlurCalculatorCpu.
+constexpr float kMaskToDetectionRatio = 0.3f;
+
+// Blurs a centered square face of size state.range(0) in a 4K frame with the
+// kernel size SimpleBlurCalculatorCpu would use.
+template <typename BlurFn>
+void BlurFace(benchmark::State& state, BlurFn blur) {
+  const int face_size = state.range(0);
+  int kernel_size =
+      static_cast<int>(std::round(face_size * kMaskToDetectionRatio));
+  if (kernel_size % 2 == 0) {
+    kernel_size++;
+  }
+
+  cv::Mat frame(kFrameHeight, kFrameWidth, CV_8UC3);
+  cv::randu(frame, cv::Scalar::all(0), cv::Scalar::all(255));
+  const cv::Rect face((kFrameWidth - face_size) / 2,
+                      (kFrameHeight - face_size) / 2, face_size, face_size);
+
+  for (auto _ : state) {
+    cv::Mat submatrix = frame(face);
+    blur(kernel_size, &submatrix);
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * face_size * face_size);
+  state.counters["kernel_size"] = kernel_size;
+}
+
+void BM_DirectBoxBlur(benchmark::State& state) {
+  BlurFace(state, [](int kernel_size, cv::Mat* mat) {
+    cv::blur(*mat, *mat, cv::Size(kernel_size, kernel_size));
+  });
+}
+
+void BM_DirectGaussianBlur(benchmark::State& state) {
+  BlurFace(state, [](int kernel_size, cv::Mat* mat) {
+    cv::GaussianBlur(*mat, *mat, cv::Size(kernel_size, kernel_size), 0, 0);
+  });
+}
+
+void BM_RunningSumBoxBlur(benchmark::State& state) {
+  BlurFace(state, RunningSumBoxBlur);
+}
+
+void BM_RunningSumGaussianBlur(benchmark::State& state) {
+  BlurFace(state, RunningSumGaussianBlur);
+}
+
+void BM_PyramidBoxBlur(benchmark::State& state) {
+  BlurFace(state, PyramidBoxBlur);
+}
+
+void BM_PyramidGaussianBlur(benchmark::State& state) {
+  BlurFace(state, PyramidGaussianBlur);
+}
+
+// Face sizes in pixels, from a distant face in 720p to a close-up in 4K.
+void FaceSizes(benchmark::internal::Benchmark* benchmark) {
+  for (const int face_size : {32, 64, 128, 256, 600, 1200}) {
+    benchmark->Arg(face_size);
+  }
+}
+
+BENCHMARK(BM_DirectBoxBlur)->Apply(FaceSizes);
+BENCHMARK(BM_DirectGaussianBlur)->Apply(FaceSizes);
+BENCHMARK(BM_RunningSumBoxBlur)->Apply(FaceSizes);
+BENCHMARK(BM_RunningSumGaussianBlur)->Apply(FaceSizes);
+BENCHMARK(BM_PyramidBoxBlur)->Apply(FaceSizes);
+BENCHMARK(BM_PyramidGaussianBlur)->Apply(FaceSizes);
+
+}  // namespace
+}  // namespace magritte
+
+BENCHMARK_MAIN();
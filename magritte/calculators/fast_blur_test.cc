@@ -0,0 +1,133 @@
+//
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+#include "magritte/calculators/fast_blur.h"
+
+#include  <opencv2/core.hpp>
+#include  <opencv2/imgproc.hpp>
+#include "mediapipe/framework/port/gtest.h"
+
+namespace magritte {
+namespace {
+
+// Maximum and average difference to the exact filter, in intensity levels.
+constexpr double kMaxDifference = 24.0;
+constexpr double kMaxAverageDifference = 3.0;
+
+// Returns an RGB checkerboard with 40 pixel squares, with a size that is not a
+// multiple of the downsampling factors.
+cv::Mat MakeCheckerboard() {
+  cv::Mat mat(/*rows=*/233, /*cols=*/237, CV_8UC3, cv::Scalar::all(0));
+  for (int y = 0; y < mat.rows; ++y) {
+    for (int x = 0; x < mat.cols; ++x) {
+      if ((x / 40 + y / 40) % 2 == 1) {
+        mat.at<cv::Vec3b>(y, x) = cv::Vec3b(255, 255, 255);
+      }
+    }
+  }
+  return mat;
+}
+
+void ExpectClose(const cv::Mat& actual, const cv::Mat& expected,
+                 int kernel_size) {
+  cv::Mat difference;
+  cv::absdiff(actual, expected, difference);
+  EXPECT_LE(cv::norm(difference, cv::NORM_INF), kMaxDifference)
+      << "kernel size " << kernel_size;
+  const cv::Scalar mean = cv::mean(difference);
+  for (int c = 0; c < 3; ++c) {
+    EXPECT_LE(mean[c], kMaxAverageDifference) << "kernel size " << kernel_size;
+  }
+}
+
+class FastBlurTest : public testing::TestWithParam<int> {};
+
+TEST_P(FastBlurTest, RunningSumBoxBlurMatchesBoxFilter) {
+  const int kernel_size = GetParam();
+  cv::Mat expected = MakeCheckerboard();
+  cv::blur(expected, expected, cv::Size(kernel_size, kernel_size));
+
+  cv::Mat actual = MakeCheckerboard();
+  RunningSumBoxBlur(kernel_size, &actual);
+
+  EXPECT_EQ(cv::norm(actual, expected, cv::NORM_INF), 0.0);
+}
+
+TEST_P(FastBlurTest, RunningSumGaussianBlurApproximatesGaussian) {
+  const int kernel_size = GetParam();
+  cv::Mat expected = MakeCheckerboard();
+  cv::GaussianBlur(expected, expected, cv::Size(kernel_size, kernel_size), 0,
+                   0);
+
+  cv::Mat actual = MakeCheckerboard();
+  RunningSumGaussianBlur(kernel_size, &actual);
+
+  ExpectClose(actual, expected, kernel_size);
+}
+
+TEST_P(FastBlurTest, PyramidBoxBlurApproximatesBoxFilter) {
+  const int kernel_size = GetParam();
+  cv::Mat expected = MakeCheckerboard();
+  cv::blur(expected, expected, cv::Size(kernel_size, kernel_size));
+
+  cv::Mat actual = MakeCheckerboard();
+  PyramidBoxBlur(kernel_size, &actual);
+
+  ExpectClose(actual, expected, kernel_size);
+}
+
+TEST_P(FastBlurTest, PyramidGaussianBlurApproximatesGaussian) {
+  const int kernel_size = GetParam();
+  cv::Mat expected = MakeCheckerboard();
+  cv::GaussianBlur(expected, expected, cv::Size(kernel_size, kernel_size), 0,
+                   0);
+
+  cv::Mat actual = MakeCheckerboard();
+  PyramidGaussianBlur(kernel_size, &actual);
+
+  ExpectClose(actual, expected, kernel_size);
+}
+
+TEST_P(FastBlurTest, BlursOnlyTheRegion) {
+  const int kernel_size = GetParam();
+  const cv::Mat original = MakeCheckerboard();
+  const cv::Rect region(60, 50, 120, 100);
+
+  cv::Mat actual = original.clone();
+  cv::Mat submatrix = actual(region);
+  PyramidGaussianBlur(kernel_size, &submatrix);
+  RunningSumGaussianBlur(kernel_size, &submatrix);
+
+  cv::Mat outside_mask(original.size(), CV_8UC1, cv::Scalar(255));
+  outside_mask(region).setTo(0);
+  EXPECT_EQ(cv::norm(actual, original, cv::NORM_INF, outside_mask), 0.0);
+}
+
+TEST(FastBlurConstantTest, KeepsConstantImageUnchanged) {
+  const cv::Mat original(/*rows=*/100, /*cols=*/90, CV_8UC4,
+                         cv::Scalar(77, 12, 200, 255));
+  for (auto blur : {RunningSumBoxBlur, RunningSumGaussianBlur, PyramidBoxBlur,
+                    PyramidGaussianBlur}) {
+    cv::Mat mat = original.clone();
+    blur(/*kernel_size=*/61, &mat);
+    EXPECT_EQ(cv::norm(mat, original, cv::NORM_INF), 0.0);
+  }
+}
+
+INSTANTIATE_TEST_SUITE_P(KernelSizes, FastBlurTest,
+                         testing::Values(3, 15, 31, 61, 121, 181));
+
+}  // namespace
+}  // namespace magritte
@@ -0,0 +1,152 @@
+//
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+#include "absl/strings/str_cat.h"
+#include "magritte/calculators/frame_change_gate_calculator.pb.h"
+#include "magritte/calculators/image_frame_util.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/formats/image_frame.h"
+#include "mediapipe/framework/port/ret_check.h"
+#include "mediapipe/framework/port/status.h"
+#include  <opencv2/core.hpp>
+#include  <opencv2/imgproc.hpp>
+
+namespace magritte {
+namespace {
+using ::mediapipe::CalculatorBase;
+using ::mediapipe::CalculatorContext;
+using ::mediapipe::CalculatorContract;
+using ::mediapipe::ImageFrame;
+
+constexpr char kImageTag[] = "IMAGE";
+constexpr char kChangedImageTag[] = "CHANGED_IMAGE";
+
+// Suffix of the counter of skipped frames, after the node name.
+constexpr char kSkippedFramesCounterSuffix[] = "/SkippedFrames";
+
+// The size of the thumbnails that are compared. They average all the pixels of
+// the frame, which filters out sensor noise and compression artifacts.
+constexpr int kThumbnailSize = 64;
+}  // namespace
+
+// A calculator that drops the frames that did not change, e.g. in screen
+// recordings or fixed camera feeds, so that the detection and redaction nodes
+// downstream only run on the frames that did.
+//
+// A frame is unchanged when its 64x64 grayscale thumbnail differs from the one
+// of the last forwarded frame by at most the threshold on every pixel.
+// Comparing with the last forwarded frame rather than the previous one ensures
+// that slow changes, e.g. a fade, are eventually forwarded. The resize and the
+// difference are vectorized by OpenCV, and their cost is small compared to a
+// single detection.
+//
+// The frames that are skipped only advance the timestamp bound of the output,
+// so the results of the last forwarded frame can be reused downstream with a
+// PacketClonerCalculator ticked by the input stream: either its detections, to
+// redact the current frame, or its redacted frame, to also skip the redaction.
+//
+// Inputs:
+// - IMAGE: The ImageFrame stream, in SRGB, SRGBA or GRAY8.
+//
+// Outputs:
+// - CHANGED_IMAGE: The frames that changed. The first frame is always
+//   forwarded.
+//
+// Options:
+// - threshold: The largest difference of a thumbnail pixel, as a fraction of
+//   the 0-255 range, for the frame to be skipped. Default is 0.05.
+// - max_skipped_frames: The maximum number of consecutive skipped frames, after
+//   which a frame is forwarded anyway, or 0 for no limit. This bounds the
+//   staleness of the reused results, and the number of frames buffered by the
+//   nodes that wait for them. Default is 30.
+//
+// Example config:
+// node {
+//   calculator: "FrameChangeGateCalculator"
+//   input_stream: "IMAGE:input_video"
+//   output_stream: "CHANGED_IMAGE:changed_video"
+//   options: {
+//     [magritte.FrameChangeGateCalculatorOptions.ext] {
+//       threshold: 0.05
+//       max_skipped_frames: 30
+//     }
+//   }
+// }
+class FrameChangeGateCalculator : public CalculatorBase {
+ public:
+  FrameChangeGateCalculator() = default;
+  ~FrameChangeGateCalculator() override = default;
+
+  static absl::Status GetContract(CalculatorContract* cc) {
+    RET_CHECK(cc->Inputs().HasTag(kImageTag))
+        << "Missing input " << kImageTag << " tag.";
+    cc->Inputs().Tag(kImageTag).Set<ImageFrame>();
+    RET_CHECK(cc->Outputs().HasTag(kChangedImageTag))
+        << "Missing output " << kChangedImageTag << " tag.";
+    cc->Outputs().Tag(kChangedImageTag).SetSameAs(&cc->Inputs().Tag(kImageTag));
+    // No input side packets.
+    return absl::OkStatus();
+  }
+
+  absl::Status Open(CalculatorContext* cc) override {
+    cc->SetOffset(mediapipe::TimestampDiff(0));
+    const auto& options = cc->Options<FrameChangeGateCalculatorOptions>();
+    RET_CHECK(options.threshold() >= 0.0f && options.threshold() < 1.0f)
+        << "threshold must be in [0, 1).";
+    RET_CHECK_GE(options.max_skipped_frames(), 0)
+        << "max_skipped_frames must be non-negative.";
+    threshold_ = options.threshold() * 255.0f;
+    max_skipped_frames_ = options.max_skipped_frames();
+    return absl::OkStatus();
+  }
+
+  absl::Status Process(CalculatorContext* cc) override {
+    ASSIGN_OR_RETURN(
+        cv::Mat thumbnail,
+        GrayThumbnail(cc->Inputs().Tag(kImageTag).Get<ImageFrame>(),
+                      kThumbnailSize, cv::INTER_AREA));
+    if (!last_thumbnail_.empty() &&
+        (max_skipped_frames_ == 0 || skipped_frames_ < max_skipped_frames_) &&
+        cv::norm(thumbnail, last_thumbnail_, cv::NORM_INF) <= threshold_) {
+      cc->Outputs()
+          .Tag(kChangedImageTag)
+          .SetNextTimestampBound(cc->InputTimestamp().NextAllowedInStream());
+      cc->GetCounter(absl::StrCat(cc->NodeName(), kSkippedFramesCounterSuffix))
+          ->Increment();
+      ++skipped_frames_;
+      return absl::OkStatus();
+    }
+
+    cc->Outputs()
+        .Tag(kChangedImageTag)
+        .AddPacket(cc->Inputs().Tag(kImageTag).Value());
+    last_thumbnail_ = thumbnail;
+    skipped_frames_ = 0;
+    return absl::OkStatus();
+  }
+
+ private:
+  // The largest pixel difference of an unchanged frame, from 0 to 255.
+  float threshold_ = 0.0f;
+  int max_skipped_frames_ = 0;
+  // The thumbnail of the last forwarded frame, if any.
+  cv::Mat last_thumbnail_;
+  // The number of frames skipped since the last forwarded frame.
+  int skipped_frames_ = 0;
+};
+
+REGISTER_CALCULATOR(FrameChangeGateCalculator);
+
+}  // namespace magritte
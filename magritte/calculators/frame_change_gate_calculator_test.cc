@@ -0,0 +1,129 @@
+//
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include  <opencv2/core.hpp>
+#include "magritte/calculators/frame_change_gate_calculator.pb.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/calculator_runner.h"
+#include "mediapipe/framework/formats/image_frame.h"
+#include "mediapipe/framework/formats/image_frame_opencv.h"
+#include "mediapipe/framework/port/gmock.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/parse_text_proto.h"
+#include "mediapipe/framework/port/status_matchers.h"
+
+namespace magritte {
+namespace {
+
+using ::mediapipe::CalculatorRunner;
+using ::mediapipe::ImageFormat;
+using ::mediapipe::ImageFrame;
+using ::mediapipe::Packet;
+using ::mediapipe::Timestamp;
+using ::mediapipe::formats::MatView;
+
+constexpr char kNodeConfig[] = R"pb(
+  calculator: "FrameChangeGateCalculator"
+  input_stream: "IMAGE:input_video"
+  output_stream: "CHANGED_IMAGE:changed_video"
+  options {
+    [magritte.FrameChangeGateCalculatorOptions.ext] {
+      threshold: 0.05
+      max_skipped_frames: 0
+    }
+  }
+)pb";
+
+// Returns a frame with the given gray level, and optionally a small white
+// square in its top left corner.
+Packet MakeFrame(int level, bool with_square, int timestamp) {
+  auto frame = std::make_unique<ImageFrame>(
+      ImageFormat::SRGB, 320, 240, ImageFrame::kDefaultAlignmentBoundary);
+  cv::Mat mat = MatView(frame.get());
+  mat.setTo(cv::Scalar(level, level, level));
+  if (with_square) {
+    mat(cv::Rect(20, 20, 32, 32)).setTo(cv::Scalar(255, 255, 255));
+  }
+  return mediapipe::Adopt(frame.release()).At(Timestamp(timestamp));
+}
+
+std::vector<int64_t> ChangedTimestamps(const CalculatorRunner& runner) {
+  std::vector<int64_t> timestamps;
+  for (const auto& packet : runner.Outputs().Tag("CHANGED_IMAGE").packets) {
+    timestamps.push_back(packet.Timestamp().Value());
+  }
+  return timestamps;
+}
+
+TEST(FrameChangeGateCalculatorTest, ForwardsChangedFrames) {
+  CalculatorRunner runner(
+      mediapipe::ParseTextProtoOrDie<mediapipe::CalculatorGraphConfig::Node>(
+          kNodeConfig));
+  auto& packets = runner.MutableInputs()->Tag("IMAGE").packets;
+  packets.push_back(MakeFrame(100, false, 0));
+  packets.push_back(MakeFrame(100, false, 1));
+  // A difference of 10 levels is below the threshold of 12.75.
+  packets.push_back(MakeFrame(110, false, 2));
+  // The difference with the last forwarded frame is above the threshold.
+  packets.push_back(MakeFrame(120, false, 3));
+  // A small part of the frame changes.
+  packets.push_back(MakeFrame(120, true, 4));
+  packets.push_back(MakeFrame(120, true, 5));
+
+  MP_ASSERT_OK(runner.Run());
+  EXPECT_THAT(ChangedTimestamps(runner), testing::ElementsAre(0, 3, 4));
+  EXPECT_EQ(
+      runner.GetCounter("FrameChangeGateCalculator/SkippedFrames")->Get(), 3);
+}
+
+TEST(FrameChangeGateCalculatorTest, ForwardsAfterMaxSkippedFrames) {
+  auto node =
+      mediapipe::ParseTextProtoOrDie<mediapipe::CalculatorGraphConfig::Node>(
+          kNodeConfig);
+  node.mutable_options()
+      ->MutableExtension(FrameChangeGateCalculatorOptions::ext)
+      ->set_max_skipped_frames(2);
+  CalculatorRunner runner(node);
+  for (int i = 0; i < 6; ++i) {
+    runner.MutableInputs()->Tag("IMAGE").packets.push_back(
+        MakeFrame(100, false, i));
+  }
+
+  MP_ASSERT_OK(runner.Run());
+  EXPECT_THAT(ChangedTimestamps(runner), testing::ElementsAre(0, 3));
+  EXPECT_EQ(
+      runner.GetCounter("FrameChangeGateCalculator/SkippedFrames")->Get(), 4);
+}
+
+TEST(FrameChangeGateCalculatorTest, FailsWithInvalidThreshold) {
+  auto node =
+      mediapipe::ParseTextProtoOrDie<mediapipe::CalculatorGraphConfig::Node>(
+          kNodeConfig);
+  node.mutable_options()
+      ->MutableExtension(FrameChangeGateCalculatorOptions::ext)
+      ->set_threshold(1.0f);
+  CalculatorRunner runner(node);
+  runner.MutableInputs()->Tag("IMAGE").packets.push_back(
+      MakeFrame(100, false, 0));
+
+  EXPECT_FALSE(runner.Run().ok());
+}
+
+}  // namespace
+}  // namespace magritte
@@ -0,0 +1,192 @@
+//
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+#include "magritte/calculators/image_frame_pool.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "absl/synchronization/mutex.h"
+#include "mediapipe/framework/formats/image_format.pb.h"
+#include "mediapipe/framework/formats/image_frame.h"
+#include "mediapipe/framework/port/aligned_malloc_and_free.h"
+#include "mediapipe/framework/port/logging.h"
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif  // __linux__
+
+namespace magritte {
+namespace {
+
+using ::mediapipe::ImageFormat;
+using ::mediapipe::ImageFrame;
+
+// Size of the transparent huge pages of x86-64 and arm64 Linux.
+constexpr size_t kHugePageSize = 2 << 20;
+
+// Allocates a buffer of the given size in bytes, either with aligned_malloc or
+// backed by transparent huge pages.
+uint8_t* AllocateBuffer(size_t size, uint32_t alignment_boundary,
+                        bool huge_pages) {
+#if defined(__linux__)
+  if (huge_pages) {
+    const size_t mapped_size =
+        (size + kHugePageSize - 1) / kHugePageSize * kHugePageSize;
+    void* pixel_data = mmap(nullptr, mapped_size, PROT_READ | PROT_WRITE,
+                            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    CHECK(pixel_data != MAP_FAILED) << "Could not map " << mapped_size
+                                    << " bytes for an ImageFrame.";
+#if defined(MADV_HUGEPAGE)
+    // This is only advice: without transparent huge pages, the buffer is still
+    // usable, with regular pages.
+    madvise(pixel_data, mapped_size, MADV_HUGEPAGE);
+#endif  // MADV_HUGEPAGE
+    return static_cast<uint8_t*>(pixel_data);
+  }
+#endif  // __linux__
+  // aligned_malloc needs at least pointer alignment.
+  void* pixel_data = aligned_malloc(
+      size, std::max<int>(alignment_boundary,
+                          ImageFrame::kDefaultAlignmentBoundary));
+  CHECK(pixel_data != nullptr)
+      << "Could not allocate " << size << " bytes for an ImageFrame.";
+  return static_cast<uint8_t*>(pixel_data);
+}
+
+// Returns the number of bytes per row of a frame, padded the same way
+// ImageFrame pads the frames it allocates.
+int WidthStep(ImageFormat::Format format, int width,
+              uint32_t alignment_boundary) {
+  const int row_bytes = width * ImageFrame::NumberOfChannelsForFormat(format) *
+                        ImageFrame::ByteDepthForFormat(format);
+  return (row_bytes + alignment_boundary - 1) / alignment_boundary *
+         alignment_boundary;
+}
+
+// Frees a buffer allocated by AllocateBuffer with the same size and kind.
+void FreeBuffer(uint8_t* pixel_data, size_t size, bool huge_pages) {
+#if defined(__linux__)
+  if (huge_pages) {
+    munmap(pixel_data,
+           (size + kHugePageSize - 1) / kHugePageSize * kHugePageSize);
+    return;
+  }
+#endif  // __linux__
+  aligned_free(pixel_data);
+}
+
+}  // namespace
+
+// static
+std::shared_ptr<ImageFramePool> ImageFramePool::Create() {
+  return Create(Options());
+}
+
+// static
+std::shared_ptr<ImageFramePool> ImageFramePool::Create(const Options& options) {
+  return std::shared_ptr<ImageFramePool>(new ImageFramePool(options));
+}
+
+ImageFramePool::ImageFramePool(const Options& options) : options_(options) {}
+
+ImageFramePool::~ImageFramePool() {
+  absl::MutexLock lock(&mutex_);
+  for (auto& [spec, buffers] : free_buffers_) {
+    const size_t size =
+        static_cast<size_t>(
+            WidthStep(spec.format, spec.width, spec.alignment_boundary)) *
+        spec.height;
+    const bool huge_pages =
+        options_.use_huge_pages && size >= kHugePageSize;
+    for (uint8_t* pixel_data : buffers) {
+      FreeBuffer(pixel_data, size, huge_pages);
+    }
+  }
+}
+
+std::unique_ptr<ImageFrame> ImageFramePool::GetFrame(
+    ImageFormat::Format format, int width, int height,
+    uint32_t alignment_boundary) {
+  const BufferSpec spec = {format, width, height, alignment_boundary};
+  const int width_step = WidthStep(format, width, alignment_boundary);
+  const size_t size = static_cast<size_t>(width_step) * height;
+  const bool huge_pages = options_.use_huge_pages && size >= kHugePageSize;
+
+  uint8_t* pixel_data = nullptr;
+  {
+    absl::MutexLock lock(&mutex_);
+    auto it = free_buffers_.find(spec);
+    if (it != free_buffers_.end() && !it->second.empty()) {
+      pixel_data = it->second.back();
+      it->second.pop_back();
+      ++stats_.hits;
+    } else {
+      ++stats_.misses;
+      stats_.allocated_bytes += size;
+      stats_.peak_allocated_bytes =
+          std::max(stats_.peak_allocated_bytes, stats_.allocated_bytes);
+    }
+  }
+  if (pixel_data == nullptr) {
+    pixel_data = AllocateBuffer(size, alignment_boundary, huge_pages);
+  }
+
+  // The frame only holds a weak reference, so that it can outlive the pool.
+  std::weak_ptr<ImageFramePool> weak_pool = weak_from_this();
+  return std::make_unique<ImageFrame>(
+      format, width, height, width_step, pixel_data,
+      [weak_pool, spec, size, huge_pages](uint8_t* pixel_data) {
+        if (std::shared_ptr<ImageFramePool> pool = weak_pool.lock()) {
+          pool->Recycle(spec, size, huge_pages, pixel_data);
+        } else {
+          FreeBuffer(pixel_data, size, huge_pages);
+        }
+      });
+}
+
+void ImageFramePool::Recycle(const BufferSpec& spec, size_t size,
+                             bool huge_pages, uint8_t* pixel_data) {
+  {
+    absl::MutexLock lock(&mutex_);
+    std::vector<uint8_t*>& buffers = free_buffers_[spec];
+    if (static_cast<int>(buffers.size()) < options_.max_free_buffers) {
+      buffers.push_back(pixel_data);
+      return;
+    }
+    stats_.allocated_bytes -= size;
+  }
+  FreeBuffer(pixel_data, size, huge_pages);
+}
+
+int ImageFramePool::NumFreeBuffers() const {
+  absl::MutexLock lock(&mutex_);
+  int num_free_buffers = 0;
+  for (const auto& [spec, buffers] : free_buffers_) {
+    num_free_buffers += buffers.size();
+  }
+  return num_free_buffers;
+}
+
+ImageFramePool::Stats ImageFramePool::GetStats() const {
+  absl::MutexLock lock(&mutex_);
+  return stats_;
+}
+
+}  // namespace magritte
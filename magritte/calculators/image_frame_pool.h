@@ -0,0 +1,125 @@
+//
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+#ifndef MAGRITTE_CALCULATORS_IMAGE_FRAME_POOL_H_
+#define MAGRITTE_CALCULATORS_IMAGE_FRAME_POOL_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/synchronization/mutex.h"
+#include "mediapipe/framework/formats/image_format.pb.h"
+#include "mediapipe/framework/formats/image_frame.h"
+
+namespace magritte {
+
+// A pool of ImageFrame buffers, so that calculators that output a new frame for
+// every input don't allocate one every time. At 4K, every allocation is tens of
+// MB, which the allocator typically maps and unmaps, faulting in every page
+// again. See image_frame_pool_service.h to share a pool in a graph.
+//
+// Frames obtained from the pool own a recycled buffer, which goes back to the
+// pool when the frame is destroyed, typically when the last packet holding it
+// is released downstream. Buffers are recycled by format, size and alignment.
+// The pool is thread-safe, and frames may outlive it.
+class ImageFramePool : public std::enable_shared_from_this<ImageFramePool> {
+ public:
+  struct Options {
+    // Maximum number of unused buffers kept for each format, size and
+    // alignment. Buffers returned beyond that are freed.
+    int max_free_buffers = 4;
+    // Whether to back buffers of at least one huge page with transparent huge
+    // pages, on Linux. This saves page faults and TLB misses on large frames,
+    // at the cost of rounding their size up to a multiple of the huge page
+    // size.
+    bool use_huge_pages = false;
+  };
+
+  struct Stats {
+    // Number of frames with a recycled buffer, and with a new buffer.
+    int64_t hits = 0;
+    int64_t misses = 0;
+    // Bytes allocated by the pool, for frames in use and free buffers, and the
+    // peak of that number.
+    int64_t allocated_bytes = 0;
+    int64_t peak_allocated_bytes = 0;
+
+    // Returns the fraction of frames with a recycled buffer, or 0 if no frame
+    // was requested.
+    double HitRate() const {
+      return hits + misses > 0 ? static_cast<double>(hits) / (hits + misses)
+                               : 0.0;
+    }
+  };
+
+  static std::shared_ptr<ImageFramePool> Create();
+  static std::shared_ptr<ImageFramePool> Create(const Options& options);
+
+  ~ImageFramePool();
+
+  // Returns a frame with the given format, size and row alignment, as would be
+  // allocated by the corresponding ImageFrame constructor. Its contents are
+  // unspecified.
+  std::unique_ptr<mediapipe::ImageFrame> GetFrame(
+      mediapipe::ImageFormat::Format format, int width, int height,
+      uint32_t alignment_boundary =
+          mediapipe::ImageFrame::kDefaultAlignmentBoundary);
+
+  // Returns the number of unused buffers in the pool, of any format and size.
+  int NumFreeBuffers() const;
+
+  // Returns usage statistics since the pool was created.
+  Stats GetStats() const;
+
+ private:
+  struct BufferSpec {
+    mediapipe::ImageFormat::Format format;
+    int width;
+    int height;
+    uint32_t alignment_boundary;
+
+    bool operator==(const BufferSpec& other) const {
+      return format == other.format && width == other.width &&
+             height == other.height &&
+             alignment_boundary == other.alignment_boundary;
+    }
+
+    template <typename H>
+    friend H AbslHashValue(H h, const BufferSpec& spec) {
+      return H::combine(std::move(h), spec.format, spec.width, spec.height,
+                        spec.alignment_boundary);
+    }
+  };
+
+  explicit ImageFramePool(const Options& options);
+
+  // Takes back the buffer of a destroyed frame, of the given size in bytes.
+  void Recycle(const BufferSpec& spec, size_t size, bool huge_pages,
+               uint8_t* pixel_data);
+
+  const Options options_;
+  mutable absl::Mutex mutex_;
+  absl::flat_hash_map<BufferSpec, std::vector<uint8_t*>> free_buffers_
+      ABSL_GUARDED_BY(mutex_);
+  Stats stats_ ABSL_GUARDED_BY(mutex_);
+};
+
+}  // namespace magritte
+
+#endif  // MAGRITTE_CALCULATORS_IMAGE_FRAME_POOL_H_
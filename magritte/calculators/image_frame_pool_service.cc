@@ -0,0 +1,42 @@
+//
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+#include "magritte/calculators/image_frame_pool_service.h"
+
+#include <memory>
+
+#include "magritte/calculators/image_frame_pool.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/graph_service.h"
+
+namespace magritte {
+
+const mediapipe::GraphService<ImageFramePool> kImageFramePoolService(
+    "magritte::kImageFramePoolService");
+
+void UseImageFramePoolService(mediapipe::CalculatorContract* cc) {
+  cc->UseService(kImageFramePoolService).Optional();
+}
+
+std::shared_ptr<ImageFramePool> GetImageFramePool(
+    mediapipe::CalculatorContext* cc) {
+  auto service = cc->Service(kImageFramePoolService);
+  if (service.IsAvailable()) {
+    return service.GetObject().shared_from_this();
+  }
+  return ImageFramePool::Create();
+}
+
+}  // namespace magritte
@@ -0,0 +1,48 @@
+//
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+#ifndef MAGRITTE_CALCULATORS_IMAGE_FRAME_POOL_SERVICE_H_
+#define MAGRITTE_CALCULATORS_IMAGE_FRAME_POOL_SERVICE_H_
+
+#include <memory>
+
+#include "absl/base/attributes.h"
+#include "magritte/calculators/image_frame_pool.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/graph_service.h"
+
+namespace magritte {
+
+// Graph service providing an ImageFramePool shared by all the CPU calculators
+// of a graph, so that buffers released by one calculator can be reused by
+// another. Applications provide it with
+//   graph.SetServiceObject(kImageFramePoolService, ImageFramePool::Create());
+// before starting the graph. Without it, each calculator uses its own pool.
+ABSL_CONST_INIT extern const mediapipe::GraphService<ImageFramePool>
+    kImageFramePoolService;
+
+// Declares that the calculator uses kImageFramePoolService if the graph
+// provides it. To be called from GetContract.
+void UseImageFramePoolService(mediapipe::CalculatorContract* cc);
+
+// Returns the pool provided to the graph, or if there is none, a new pool for
+// the calculator alone. To be called from Open; the calculator should keep the
+// pool until it is destroyed.
+std::shared_ptr<ImageFramePool> GetImageFramePool(
+    mediapipe::CalculatorContext* cc);
+
+}  // namespace magritte
+
+#endif  // MAGRITTE_CALCULATORS_IMAGE_FRAME_POOL_SERVICE_H_
@@ -0,0 +1,135 @@
+//
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+#include "magritte/calculators/image_frame_pool.h"
+
+#include <memory>
+#include <vector>
+
+#include "mediapipe/framework/formats/image_format.pb.h"
+#include "mediapipe/framework/formats/image_frame.h"
+#include "mediapipe/framework/port/gtest.h"
+
+namespace magritte {
+namespace {
+
+using ::mediapipe::ImageFormat;
+using ::mediapipe::ImageFrame;
+
+TEST(ImageFramePoolTest, RecyclesBufferOfDestroyedFrame) {
+  std::shared_ptr<ImageFramePool> pool = ImageFramePool::Create();
+  std::unique_ptr<ImageFrame> frame = pool->GetFrame(ImageFormat::SRGB, 10, 8);
+  const uint8_t* pixel_data = frame->PixelData();
+  EXPECT_EQ(pool->NumFreeBuffers(), 0);
+
+  frame.reset();
+  EXPECT_EQ(pool->NumFreeBuffers(), 1);
+
+  frame = pool->GetFrame(ImageFormat::SRGB, 10, 8);
+  EXPECT_EQ(frame->PixelData(), pixel_data);
+  EXPECT_EQ(pool->NumFreeBuffers(), 0);
+}
+
+TEST(ImageFramePoolTest, ReturnsFramesWithRequestedFormatAndDefaultAlignment) {
+  std::shared_ptr<ImageFramePool> pool = ImageFramePool::Create();
+  std::unique_ptr<ImageFrame> frame = pool->GetFrame(ImageFormat::SRGBA, 13, 7);
+  const ImageFrame reference(ImageFormat::SRGBA, 13, 7);
+
+  EXPECT_EQ(frame->Format(), ImageFormat::SRGBA);
+  EXPECT_EQ(frame->Width(), 13);
+  EXPECT_EQ(frame->Height(), 7);
+  EXPECT_EQ(frame->WidthStep(), reference.WidthStep());
+  EXPECT_TRUE(frame->IsAligned(ImageFrame::kDefaultAlignmentBoundary));
+}
+
+TEST(ImageFramePoolTest, DoesNotShareBuffersBetweenFormatsOrSizes) {
+  std::shared_ptr<ImageFramePool> pool = ImageFramePool::Create();
+  pool->GetFrame(ImageFormat::SRGB, 10, 8).reset();
+  ASSERT_EQ(pool->NumFreeBuffers(), 1);
+
+  std::unique_ptr<ImageFrame> other_size =
+      pool->GetFrame(ImageFormat::SRGB, 8, 10);
+  std::unique_ptr<ImageFrame> other_format =
+      pool->GetFrame(ImageFormat::SRGBA, 10, 8);
+  EXPECT_EQ(pool->NumFreeBuffers(), 1);
+}
+
+TEST(ImageFramePoolTest, KeepsAtMostMaxFreeBuffers) {
+  ImageFramePool::Options options;
+  options.max_free_buffers = 2;
+  std::shared_ptr<ImageFramePool> pool = ImageFramePool::Create(options);
+  std::vector<std::unique_ptr<ImageFrame>> frames;
+  for (int i = 0; i < 3; ++i) {
+    frames.push_back(pool->GetFrame(ImageFormat::GRAY8, 4, 4));
+  }
+
+  frames.clear();
+  EXPECT_EQ(pool->NumFreeBuffers(), 2);
+}
+
+TEST(ImageFramePoolTest, DoesNotShareBuffersBetweenAlignments) {
+  std::shared_ptr<ImageFramePool> pool = ImageFramePool::Create();
+  pool->GetFrame(ImageFormat::SRGB, 10, 8, /*alignment_boundary=*/4).reset();
+
+  std::unique_ptr<ImageFrame> frame =
+      pool->GetFrame(ImageFormat::SRGB, 10, 8, /*alignment_boundary=*/32);
+  EXPECT_EQ(frame->WidthStep(), 32);
+  EXPECT_TRUE(frame->IsAligned(32));
+  EXPECT_EQ(pool->NumFreeBuffers(), 1);
+}
+
+TEST(ImageFramePoolTest, ReportsHitRateAndPeakMemory) {
+  std::shared_ptr<ImageFramePool> pool = ImageFramePool::Create();
+  // 16 * 8 bytes.
+  std::unique_ptr<ImageFrame> first = pool->GetFrame(ImageFormat::SRGB, 5, 8);
+  std::unique_ptr<ImageFrame> second = pool->GetFrame(ImageFormat::SRGB, 5, 8);
+  first.reset();
+  second.reset();
+  std::unique_ptr<ImageFrame> third = pool->GetFrame(ImageFormat::SRGB, 5, 8);
+
+  const ImageFramePool::Stats stats = pool->GetStats();
+  EXPECT_EQ(stats.hits, 1);
+  EXPECT_EQ(stats.misses, 2);
+  EXPECT_DOUBLE_EQ(stats.HitRate(), 1.0 / 3.0);
+  EXPECT_EQ(stats.allocated_bytes, 2 * 16 * 8);
+  EXPECT_EQ(stats.peak_allocated_bytes, 2 * 16 * 8);
+}
+
+TEST(ImageFramePoolTest, SupportsHugePages) {
+  ImageFramePool::Options options;
+  options.use_huge_pages = true;
+  std::shared_ptr<ImageFramePool> pool = ImageFramePool::Create(options);
+  std::unique_ptr<ImageFrame> frame =
+      pool->GetFrame(ImageFormat::SRGBA, 3840, 2160);
+  const uint8_t* pixel_data = frame->PixelData();
+  EXPECT_TRUE(frame->IsAligned(ImageFrame::kDefaultAlignmentBoundary));
+  frame->SetToZero();
+
+  frame.reset();
+  frame = pool->GetFrame(ImageFormat::SRGBA, 3840, 2160);
+  EXPECT_EQ(frame->PixelData(), pixel_data);
+}
+
+TEST(ImageFramePoolTest, FramesCanOutlivePool) {
+  std::shared_ptr<ImageFramePool> pool = ImageFramePool::Create();
+  std::unique_ptr<ImageFrame> frame = pool->GetFrame(ImageFormat::SRGB, 10, 8);
+
+  pool.reset();
+  frame->SetToZero();
+  frame.reset();
+}
+
+}  // namespace
+}  // namespace magritte
@@ -0,0 +1,98 @@
+//
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+#include "magritte/calculators/image_frame_util.h"
+
+#include <cstring>
+#include <memory>
+#include <utility>
+
+#include "magritte/calculators/image_frame_pool.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/formats/image_frame.h"
+#include "mediapipe/framework/port/ret_check.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "mediapipe/framework/formats/image_frame_opencv.h"
+#include  <opencv2/core.hpp>
+#include  <opencv2/imgproc.hpp>
+
+namespace magritte {
+
+using ::mediapipe::CalculatorContext;
+using ::mediapipe::ImageFrame;
+
+absl::StatusOr<std::unique_ptr<ImageFrame>> ConsumeOrCopyImageFrame(
+    CalculatorContext* cc, mediapipe::InputStream& input,
+    ImageFramePool* pool) {
+  RET_CHECK(cc != nullptr) << "CalculatorContext is nullptr";
+  RET_CHECK(!input.IsEmpty()) << "No image frame at " << cc->InputTimestamp();
+
+  // Consume() only succeeds if the packet holds the last reference to the
+  // frame, and leaves the packet untouched otherwise.
+  mediapipe::Packet& packet = input.Value();
+  absl::StatusOr<std::unique_ptr<ImageFrame>> consumed =
+      packet.Consume<ImageFrame>();
+  if (consumed.ok()) {
+    cc->GetCounter(absl::StrCat(cc->NodeName(), kFramesConsumedCounterSuffix))
+        ->Increment();
+    return std::move(consumed).value();
+  }
+
+  const ImageFrame& frame = packet.Get<ImageFrame>();
+  std::unique_ptr<ImageFrame> copy =
+      pool != nullptr
+          ? pool->GetFrame(frame.Format(), frame.Width(), frame.Height())
+          : std::make_unique<ImageFrame>(
+                frame.Format(), frame.Width(), frame.Height(),
+                ImageFrame::kDefaultAlignmentBoundary);
+  // ImageFrame::CopyFrom() would allocate a new buffer, so the rows are copied
+  // into the existing one instead.
+  const int row_bytes =
+      frame.Width() * frame.NumberOfChannels() * frame.ByteDepth();
+  for (int y = 0; y < frame.Height(); ++y) {
+    std::memcpy(copy->MutablePixelData() + y * copy->WidthStep(),
+                frame.PixelData() + y * frame.WidthStep(), row_bytes);
+  }
+  cc->GetCounter(absl::StrCat(cc->NodeName(), kFramesCopiedCounterSuffix))
+      ->Increment();
+  return copy;
+}
+
+absl::StatusOr<cv::Mat> GrayThumbnail(const ImageFrame& frame, int size,
+                                      int interpolation) {
+  cv::Mat thumbnail;
+  cv::resize(mediapipe::formats::MatView(&frame), thumbnail,
+             cv::Size(size, size), 0, 0, interpolation);
+  switch (thumbnail.channels()) {
+    case 1:
+      return thumbnail;
+    case 3: {
+      cv::Mat gray;
+      cv::cvtColor(thumbnail, gray, cv::COLOR_RGB2GRAY);
+      return gray;
+    }
+    case 4: {
+      cv::Mat gray;
+      cv::cvtColor(thumbnail, gray, cv::COLOR_RGBA2GRAY);
+      return gray;
+    }
+    default:
+      return absl::InvalidArgumentError(absl::StrCat(
+          "Unsupported number of channels: ", thumbnail.channels()));
+  }
+}
+
+}  // namespace magritte
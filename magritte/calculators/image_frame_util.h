@@ -0,0 +1,60 @@
+//
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+#ifndef MAGRITTE_CALCULATORS_IMAGE_FRAME_UTIL_H_
+#define MAGRITTE_CALCULATORS_IMAGE_FRAME_UTIL_H_
+
+#include <memory>
+
+#include "magritte/calculators/image_frame_pool.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/formats/image_frame.h"
+#include "absl/status/statusor.h"
+#include  <opencv2/core.hpp>
+
+namespace magritte {
+
+// Suffixes of the counters maintained by ConsumeOrCopyImageFrame. The full
+// counter name is the node name followed by the suffix, e.g.
+// "SimpleBlurCalculatorCpu/FramesCopied".
+constexpr char kFramesConsumedCounterSuffix[] = "/FramesConsumed";
+constexpr char kFramesCopiedCounterSuffix[] = "/FramesCopied";
+
+// Returns a writable ImageFrame holding the contents of the current packet of
+// the given input stream, for calculators that modify their input in place.
+//
+// If the packet is the only reference to its ImageFrame, the frame is taken
+// over without copying and the packet is left empty. Otherwise, the frame is
+// still shared with other calculators (or with the caller of the graph), so it
+// is copied exactly once, into a frame taken from the given pool if it is not
+// nullptr. In both cases, the returned frame can be modified and
+// sent downstream, where it can in turn be consumed by the next calculator.
+//
+// Increments the "<node name>/FramesConsumed" or "<node name>/FramesCopied"
+// counter of the calculator accordingly.
+absl::StatusOr<std::unique_ptr<mediapipe::ImageFrame>> ConsumeOrCopyImageFrame(
+    mediapipe::CalculatorContext* cc, mediapipe::InputStream& input,
+    ImageFramePool* pool = nullptr);
+
+// Returns a size x size grayscale thumbnail of an SRGB, SRGBA or GRAY8 frame,
+// to cheaply compare frames with each other. The frame is resized with the
+// given OpenCV interpolation: cv::INTER_AREA averages all of its pixels, while
+// cv::INTER_NEAREST only reads size x size of them.
+absl::StatusOr<cv::Mat> GrayThumbnail(const mediapipe::ImageFrame& frame,
+                                      int size, int interpolation);
+
+}  // namespace magritte
+
+#endif  // MAGRITTE_CALCULATORS_IMAGE_FRAME_UTIL_H_
@@ -0,0 +1,299 @@
+//
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+#include <algorithm>
+#include <memory>
+
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "magritte/calculators/channel_order_service.h"
+#include "magritte/calculators/image_frame_pool.h"
+#include "magritte/calculators/image_frame_pool_service.h"
+#include "magritte/calculators/image_pyramid_calculator.pb.h"
+#include "magritte/calculators/yuv_image_util.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/formats/image_frame.h"
+#include "mediapipe/framework/formats/image_frame_opencv.h"
+#include "mediapipe/framework/formats/yuv_image.h"
+#include "mediapipe/framework/port/ret_check.h"
+#include "mediapipe/framework/port/status.h"
+#include  <opencv2/core.hpp>
+#include  <opencv2/imgproc.hpp>
+
+namespace magritte {
+namespace {
+using ::mediapipe::CalculatorBase;
+using ::mediapipe::CalculatorContext;
+using ::mediapipe::CalculatorContract;
+using ::mediapipe::ImageFormat;
+using ::mediapipe::ImageFrame;
+using ::mediapipe::Packet;
+using ::mediapipe::YUVImage;
+using ::mediapipe::formats::MatView;
+
+constexpr char kImageTag[] = "IMAGE";
+constexpr char kYuvImageTag[] = "YUV_IMAGE";
+constexpr char kLevelTag[] = "LEVEL";
+
+// Returns the RGB format with the same channels as the given BGR format.
+ImageFormat::Format RgbFormat(ImageFormat::Format format) {
+  return format == ImageFormat::SRGB ? ImageFormat::SRGB : ImageFormat::SRGBA;
+}
+
+// Returns the OpenCV code converting the channels of a BGR frame to RGB.
+int BgrToRgbCode(const ImageFrame& frame) {
+  return frame.NumberOfChannels() == 3 ? cv::COLOR_BGR2RGB
+                                       : cv::COLOR_BGRA2RGBA;
+}
+
+// Returns the size of an image downscaled by the given factor, rounded to the
+// nearest pixel.
+cv::Size DownscaledSize(int width, int height, int factor) {
+  return cv::Size(std::max(1, (width + factor / 2) / factor),
+                  std::max(1, (height + factor / 2) / factor));
+}
+
+cv::Size DownscaledSize(const ImageFrame& frame, int factor) {
+  return DownscaledSize(frame.Width(), frame.Height(), factor);
+}
+}  // namespace
+
+// A calculator that builds a pyramid of downscaled copies of an image once per
+// frame, to be shared by the face detection models of a graph.
+//
+// Detection models only need their small input tensors, e.g. 128x128 or
+// 192x192, yet each model converts the whole input frame into its tensor, and
+// 360° subgraphs do so for each orientation. With 4K inputs, downscaling the
+// frame once and giving the same small frame to all models makes their
+// preprocessing independent of the input resolution, and better antialiased.
+// Since detections are in normalized coordinates, they apply to the input
+// frame as is.
+//
+// The first level is the input downscaled by the smallest power of two that
+// fits it in max_size, with area averaging, and each next level halves the
+// previous one. Inputs that already fit are forwarded without copy. The levels
+// are taken from the graph's ImageFramePool.
+//
+// With the grayscale option, the first level is converted to GRAY8 after it is
+// downscaled, e.g. for a tracking proxy frame: motion analysis only needs luma,
+// and the conversion then only costs as much as the small level.
+//
+// BGR frames, i.e. SBGRA frames or SRGB and SRGBA frames in a graph whose
+// kChannelOrderService is kBgr, are converted to RGB along with the first
+// level, since detection models expect RGB. The rest of the graph can then
+// redact the input frames in their own channel order, without converting them.
+//
+// YUVImage inputs, in I420 or NV12, are converted to RGB at the size of the
+// first level only: the planes are downscaled first, and the first level is
+// rounded down to an even size for the subsampled chroma. With the grayscale
+// option, the first level is the downscaled luma plane, without conversion.
+//
+// Inputs:
+// - IMAGE or YUV_IMAGE: An ImageFrame or YUVImage stream, containing the input
+//   images.
+//
+// Outputs:
+// - LEVEL:0, LEVEL:1, ...: The levels of the pyramid, as ImageFrame, from
+//   largest to smallest. They are RGB, or GRAY8 with the grayscale option.
+//
+// Options:
+// - max_size: The maximum width and height of the first level. Default is 640.
+// - grayscale: Whether the levels are converted to GRAY8. Default is false.
+//
+// Example config:
+// node {
+//   calculator: "ImagePyramidCalculator"
+//   input_stream: "IMAGE:input_video"
+//   output_stream: "LEVEL:0:detection_video"
+//   options: {
+//     [magritte.ImagePyramidCalculatorOptions.ext] {
+//       max_size: 640
+//     }
+//   }
+// }
+class ImagePyramidCalculator : public CalculatorBase {
+ public:
+  ImagePyramidCalculator() = default;
+  ~ImagePyramidCalculator() override = default;
+
+  static absl::Status GetContract(CalculatorContract* cc) {
+    RET_CHECK(cc->Inputs().HasTag(kImageTag) ^
+              cc->Inputs().HasTag(kYuvImageTag))
+        << "Exactly one of " << kImageTag << " or " << kYuvImageTag
+        << " input tags must be set.";
+    if (cc->Inputs().HasTag(kImageTag)) {
+      cc->Inputs().Tag(kImageTag).Set<ImageFrame>();
+    } else {
+      cc->Inputs().Tag(kYuvImageTag).Set<YUVImage>();
+    }
+    RET_CHECK_GE(cc->Outputs().NumEntries(kLevelTag), 1)
+        << "Missing output " << kLevelTag << " tag.";
+    for (int i = 0; i < cc->Outputs().NumEntries(kLevelTag); ++i) {
+      cc->Outputs().Get(kLevelTag, i).Set<ImageFrame>();
+    }
+    UseImageFramePoolService(cc);
+    UseChannelOrderService(cc);
+    // No input side packets.
+    return absl::OkStatus();
+  }
+
+  absl::Status Open(CalculatorContext* cc) override {
+    cc->SetOffset(mediapipe::TimestampDiff(0));
+    const auto& options = cc->Options<ImagePyramidCalculatorOptions>();
+    max_size_ = options.max_size();
+    RET_CHECK_GE(max_size_, 1) << "max_size must be positive.";
+    grayscale_ = options.grayscale();
+    pool_ = GetImageFramePool(cc);
+    return absl::OkStatus();
+  }
+
+  absl::Status Process(CalculatorContext* cc) override {
+    Packet level;
+    if (cc->Inputs().HasTag(kYuvImageTag)) {
+      ASSIGN_OR_RETURN(
+          std::unique_ptr<ImageFrame> yuv_level,
+          FirstYuvLevel(cc->Inputs().Tag(kYuvImageTag).Get<YUVImage>()));
+      level = mediapipe::Adopt(yuv_level.release()).At(cc->InputTimestamp());
+    } else {
+      ASSIGN_OR_RETURN(level, FirstLevel(cc));
+    }
+    const int num_levels = cc->Outputs().NumEntries(kLevelTag);
+    for (int i = 0; i < num_levels; ++i) {
+      cc->Outputs().Get(kLevelTag, i).AddPacket(level);
+      if (i + 1 < num_levels) {
+        level =
+            mediapipe::Adopt(Downscale(level.Get<ImageFrame>(), 2).release())
+                .At(cc->InputTimestamp());
+      }
+    }
+    return absl::OkStatus();
+  }
+
+ private:
+  // Returns the smallest power of two that fits an image of the given size in
+  // max_size_ once downscaled by it.
+  int DownscaleFactor(int width, int height) const {
+    int factor = 1;
+    while ((std::max(width, height) + factor - 1) / factor > max_size_) {
+      factor *= 2;
+    }
+    return factor;
+  }
+
+  // Returns the first level for the ImageFrame input.
+  absl::StatusOr<Packet> FirstLevel(CalculatorContext* cc) {
+    const Packet& input = cc->Inputs().Tag(kImageTag).Value();
+    const ImageFrame& frame = input.Get<ImageFrame>();
+    const int factor = DownscaleFactor(frame.Width(), frame.Height());
+    const bool bgr = IsBgr(cc, frame.Format());
+    Packet level = input;
+    if (bgr && !grayscale_) {
+      level = mediapipe::Adopt(DownscaleToRgb(frame, factor).release())
+                  .At(cc->InputTimestamp());
+    } else if (factor > 1) {
+      level = mediapipe::Adopt(Downscale(frame, factor).release())
+                  .At(cc->InputTimestamp());
+    }
+    if (grayscale_ && level.Get<ImageFrame>().Format() != ImageFormat::GRAY8) {
+      ASSIGN_OR_RETURN(std::unique_ptr<ImageFrame> gray,
+                       ToGrayscale(level.Get<ImageFrame>(), bgr));
+      level = mediapipe::Adopt(gray.release()).At(cc->InputTimestamp());
+    }
+    return level;
+  }
+
+  // Returns the first level for the YUVImage input, converting only its
+  // downscaled planes.
+  absl::StatusOr<std::unique_ptr<ImageFrame>> FirstYuvLevel(
+      const YUVImage& image) {
+    ASSIGN_OR_RETURN(const YuvPlanes planes, GetYuvPlanes(image));
+    cv::Size size = DownscaledSize(
+        image.width(), image.height(),
+        DownscaleFactor(image.width(), image.height()));
+    if (grayscale_) {
+      std::unique_ptr<ImageFrame> output =
+          pool_->GetFrame(ImageFormat::GRAY8, size.width, size.height);
+      cv::Mat output_mat = MatView(output.get());
+      cv::resize(planes[0], output_mat, size, 0, 0, cv::INTER_AREA);
+      return output;
+    }
+    size.width = std::max(2, size.width - size.width % 2);
+    size.height = std::max(2, size.height - size.height % 2);
+    std::unique_ptr<ImageFrame> output =
+        pool_->GetFrame(ImageFormat::SRGB, size.width, size.height);
+    YuvPlanesToRgb(planes, MatView(output.get()));
+    return output;
+  }
+
+  // Returns the frame downscaled by the given factor, with area averaging.
+  std::unique_ptr<ImageFrame> Downscale(const ImageFrame& frame, int factor) {
+    const cv::Size size = DownscaledSize(frame, factor);
+    std::unique_ptr<ImageFrame> output =
+        pool_->GetFrame(frame.Format(), size.width, size.height);
+    cv::Mat output_mat = MatView(output.get());
+    cv::resize(MatView(&frame), output_mat, size, 0, 0, cv::INTER_AREA);
+    return output;
+  }
+
+  // Returns the BGR frame downscaled by the given factor, if any, and
+  // converted to RGB. The channels are swapped on the downscaled frame.
+  std::unique_ptr<ImageFrame> DownscaleToRgb(const ImageFrame& frame,
+                                             int factor) {
+    const cv::Size size = DownscaledSize(frame, factor);
+    std::unique_ptr<ImageFrame> output =
+        pool_->GetFrame(RgbFormat(frame.Format()), size.width, size.height);
+    cv::Mat output_mat = MatView(output.get());
+    if (factor == 1) {
+      cv::cvtColor(MatView(&frame), output_mat, BgrToRgbCode(frame));
+    } else {
+      cv::resize(MatView(&frame), output_mat, size, 0, 0, cv::INTER_AREA);
+      cv::cvtColor(output_mat, output_mat, BgrToRgbCode(frame));
+    }
+    return output;
+  }
+
+  // Returns the SRGB, SRGBA or SBGRA frame converted to GRAY8, given whether
+  // its channels are in BGR order.
+  absl::StatusOr<std::unique_ptr<ImageFrame>> ToGrayscale(
+      const ImageFrame& frame, bool bgr) {
+    int code;
+    switch (frame.Format()) {
+      case ImageFormat::SRGB:
+        code = bgr ? cv::COLOR_BGR2GRAY : cv::COLOR_RGB2GRAY;
+        break;
+      case ImageFormat::SRGBA:
+      case ImageFormat::SBGRA:
+        code = bgr ? cv::COLOR_BGRA2GRAY : cv::COLOR_RGBA2GRAY;
+        break;
+      default:
+        return absl::InvalidArgumentError(absl::StrCat(
+            "Unsupported image format for grayscale: ",
+            ImageFormat::Format_Name(frame.Format())));
+    }
+    std::unique_ptr<ImageFrame> output =
+        pool_->GetFrame(ImageFormat::GRAY8, frame.Width(), frame.Height());
+    cv::Mat output_mat = MatView(output.get());
+    cv::cvtColor(MatView(&frame), output_mat, code);
+    return output;
+  }
+
+  int max_size_ = 1;
+  bool grayscale_ = false;
+  std::shared_ptr<ImageFramePool> pool_;
+};
+
+REGISTER_CALCULATOR(ImagePyramidCalculator);
+
+}  // namespace magritte
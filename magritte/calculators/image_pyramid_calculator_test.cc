@@ -0,0 +1,221 @@
+//
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+#include <memory>
+#include <vector>
+
+#include  <opencv2/core.hpp>
+#include "magritte/calculators/image_pyramid_calculator.pb.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/calculator_runner.h"
+#include "mediapipe/framework/formats/image_frame.h"
+#include "mediapipe/framework/formats/image_frame_opencv.h"
+#include "mediapipe/framework/formats/yuv_image.h"
+#include "mediapipe/framework/port/gmock.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/parse_text_proto.h"
+#include "mediapipe/framework/port/status_matchers.h"
+#include "magritte/calculators/yuv_image_util.h"
+#include "libyuv/video_common.h"
+
+namespace magritte {
+namespace {
+
+using ::mediapipe::CalculatorRunner;
+using ::mediapipe::ImageFormat;
+using ::mediapipe::ImageFrame;
+using ::mediapipe::Packet;
+using ::mediapipe::Timestamp;
+using ::mediapipe::YUVImage;
+using ::mediapipe::formats::MatView;
+
+constexpr char kNodeConfig[] = R"pb(
+  calculator: "ImagePyramidCalculator"
+  input_stream: "IMAGE:input_video"
+  output_stream: "LEVEL:0:level0"
+  output_stream: "LEVEL:1:level1"
+  options {
+    [magritte.ImagePyramidCalculatorOptions.ext] { max_size: 32 }
+  }
+)pb";
+
+// Returns a frame of the given size filled with a constant color.
+Packet MakeFrame(int width, int height) {
+  auto frame =
+      std::make_unique<ImageFrame>(ImageFormat::SRGB, width, height,
+                                   ImageFrame::kDefaultAlignmentBoundary);
+  MatView(frame.get()).setTo(cv::Scalar(10, 20, 30));
+  return mediapipe::Adopt(frame.release()).At(Timestamp(0));
+}
+
+void ExpectFrame(const Packet& packet, int width, int height) {
+  const auto& frame = packet.Get<ImageFrame>();
+  EXPECT_EQ(frame.Width(), width);
+  EXPECT_EQ(frame.Height(), height);
+  cv::Mat difference;
+  cv::absdiff(MatView(&frame), cv::Scalar(10, 20, 30), difference);
+  EXPECT_EQ(cv::countNonZero(difference.reshape(1)), 0);
+}
+
+TEST(ImagePyramidCalculatorTest, DownscalesByPowersOfTwo) {
+  CalculatorRunner runner(
+      mediapipe::ParseTextProtoOrDie<mediapipe::CalculatorGraphConfig::Node>(
+          kNodeConfig));
+  runner.MutableInputs()->Tag("IMAGE").packets.push_back(MakeFrame(100, 60));
+
+  MP_ASSERT_OK(runner.Run());
+  const auto& level0 = runner.Outputs().Get("LEVEL", 0).packets;
+  const auto& level1 = runner.Outputs().Get("LEVEL", 1).packets;
+  ASSERT_EQ(level0.size(), 1);
+  ASSERT_EQ(level1.size(), 1);
+  // 100 / 4 = 25 fits in 32, and 25 / 2 rounds to 13.
+  ExpectFrame(level0[0], 25, 15);
+  ExpectFrame(level1[0], 13, 8);
+}
+
+TEST(ImagePyramidCalculatorTest, ForwardsSmallInputsWithoutCopy) {
+  CalculatorRunner runner(
+      mediapipe::ParseTextProtoOrDie<mediapipe::CalculatorGraphConfig::Node>(
+          kNodeConfig));
+  const Packet input = MakeFrame(32, 20);
+  runner.MutableInputs()->Tag("IMAGE").packets.push_back(input);
+
+  MP_ASSERT_OK(runner.Run());
+  const auto& level0 = runner.Outputs().Get("LEVEL", 0).packets;
+  ASSERT_EQ(level0.size(), 1);
+  EXPECT_EQ(&level0[0].Get<ImageFrame>(), &input.Get<ImageFrame>());
+  ExpectFrame(runner.Outputs().Get("LEVEL", 1).packets[0], 16, 10);
+}
+
+TEST(ImagePyramidCalculatorTest, ConvertsToGrayscale) {
+  auto node =
+      mediapipe::ParseTextProtoOrDie<mediapipe::CalculatorGraphConfig::Node>(
+          kNodeConfig);
+  node.mutable_options()
+      ->MutableExtension(ImagePyramidCalculatorOptions::ext)
+      ->set_grayscale(true);
+  CalculatorRunner runner(node);
+  runner.MutableInputs()->Tag("IMAGE").packets.push_back(MakeFrame(100, 60));
+
+  MP_ASSERT_OK(runner.Run());
+  for (int i = 0; i < 2; ++i) {
+    const auto& frame =
+        runner.Outputs().Get("LEVEL", i).packets[0].Get<ImageFrame>();
+    EXPECT_EQ(frame.Format(), ImageFormat::GRAY8);
+    // The luma of (10, 20, 30).
+    EXPECT_EQ(cv::countNonZero(MatView(&frame) != 18), 0);
+  }
+}
+
+TEST(ImagePyramidCalculatorTest, ConvertsBgrToRgb) {
+  CalculatorRunner runner(
+      mediapipe::ParseTextProtoOrDie<mediapipe::CalculatorGraphConfig::Node>(
+          kNodeConfig));
+  // Both an input that is downscaled and one that already fits.
+  const std::vector<cv::Size> sizes = {cv::Size(100, 60), cv::Size(32, 20)};
+  const int num_sizes = static_cast<int>(sizes.size());
+  for (int i = 0; i < num_sizes; ++i) {
+    auto frame = std::make_unique<ImageFrame>(
+        ImageFormat::SBGRA, sizes[i].width, sizes[i].height,
+        ImageFrame::kDefaultAlignmentBoundary);
+    MatView(frame.get()).setTo(cv::Scalar(30, 20, 10, 255));
+    runner.MutableInputs()->Tag("IMAGE").packets.push_back(
+        mediapipe::Adopt(frame.release()).At(Timestamp(i)));
+  }
+
+  MP_ASSERT_OK(runner.Run());
+  for (int i = 0; i < 2; ++i) {
+    for (const Packet& packet : runner.Outputs().Get("LEVEL", i).packets) {
+      const auto& frame = packet.Get<ImageFrame>();
+      EXPECT_EQ(frame.Format(), ImageFormat::SRGBA);
+      cv::Mat difference;
+      cv::absdiff(MatView(&frame), cv::Scalar(10, 20, 30, 255), difference);
+      EXPECT_EQ(cv::countNonZero(difference.reshape(1)), 0);
+    }
+  }
+}
+
+TEST(ImagePyramidCalculatorTest, ConvertsYuvAtLevelSize) {
+  CalculatorRunner runner(
+      mediapipe::ParseTextProtoOrDie<mediapipe::CalculatorGraphConfig::Node>(
+          R"pb(
+            calculator: "ImagePyramidCalculator"
+            input_stream: "YUV_IMAGE:input_video"
+            output_stream: "LEVEL:0:level0"
+            options {
+              [magritte.ImagePyramidCalculatorOptions.ext] { max_size: 32 }
+            }
+          )pb"));
+  for (const uint32_t fourcc : {libyuv::FOURCC_I420, libyuv::FOURCC_NV12}) {
+    ASSERT_OK_AND_ASSIGN(std::unique_ptr<YUVImage> image,
+                         MakeYuvImage(fourcc, 100, 60));
+    ASSERT_OK_AND_ASSIGN(const YuvPlanes planes, GetYuvPlanes(*image));
+    RgbToYuvPlanes(cv::Mat(60, 100, CV_8UC3, cv::Scalar(10, 20, 30)), planes);
+    const Timestamp timestamp(
+        runner.MutableInputs()->Tag("YUV_IMAGE").packets.size());
+    runner.MutableInputs()->Tag("YUV_IMAGE").packets.push_back(
+        mediapipe::Adopt(image.release()).At(timestamp));
+  }
+
+  MP_ASSERT_OK(runner.Run());
+  const auto& level0 = runner.Outputs().Get("LEVEL", 0).packets;
+  ASSERT_EQ(level0.size(), 2);
+  for (const Packet& packet : level0) {
+    const auto& frame = packet.Get<ImageFrame>();
+    EXPECT_EQ(frame.Format(), ImageFormat::SRGB);
+    // 100 / 4 = 25, rounded down to an even width for the chroma.
+    EXPECT_EQ(frame.Width(), 24);
+    EXPECT_EQ(frame.Height(), 14);
+    cv::Mat difference;
+    cv::absdiff(MatView(&frame), cv::Scalar(10, 20, 30), difference);
+    EXPECT_LE(cv::norm(difference, cv::NORM_INF), 3.0);
+  }
+}
+
+TEST(ImagePyramidCalculatorTest, TakesYuvLumaForGrayscale) {
+  CalculatorRunner runner(
+      mediapipe::ParseTextProtoOrDie<mediapipe::CalculatorGraphConfig::Node>(
+          R"pb(
+            calculator: "ImagePyramidCalculator"
+            input_stream: "YUV_IMAGE:input_video"
+            output_stream: "LEVEL:0:level0"
+            options {
+              [magritte.ImagePyramidCalculatorOptions.ext] {
+                max_size: 32
+                grayscale: true
+              }
+            }
+          )pb"));
+  ASSERT_OK_AND_ASSIGN(std::unique_ptr<YUVImage> image,
+                       MakeYuvImage(libyuv::FOURCC_I420, 100, 60));
+  ASSERT_OK_AND_ASSIGN(YuvPlanes planes, GetYuvPlanes(*image));
+  planes[0].setTo(cv::Scalar(77));
+  runner.MutableInputs()->Tag("YUV_IMAGE").packets.push_back(
+      mediapipe::Adopt(image.release()).At(Timestamp(0)));
+
+  MP_ASSERT_OK(runner.Run());
+  const auto& level0 = runner.Outputs().Get("LEVEL", 0).packets;
+  ASSERT_EQ(level0.size(), 1);
+  const auto& frame = level0[0].Get<ImageFrame>();
+  EXPECT_EQ(frame.Format(), ImageFormat::GRAY8);
+  EXPECT_EQ(frame.Width(), 25);
+  EXPECT_EQ(frame.Height(), 15);
+  cv::Mat difference;
+  cv::absdiff(MatView(&frame), cv::Scalar(77), difference);
+  EXPECT_EQ(cv::countNonZero(difference), 0);
+}
+
+}  // namespace
+}  // namespace magritte
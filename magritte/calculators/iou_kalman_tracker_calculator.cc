@@ -0,0 +1,386 @@
+//
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "magritte/calculators/box_velocity.h"
+#include "magritte/calculators/iou_kalman_tracker_calculator.pb.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/formats/detection.pb.h"
+#include "mediapipe/framework/formats/location_data.pb.h"
+#include "mediapipe/framework/port/ret_check.h"
+
+namespace magritte {
+namespace {
+using ::mediapipe::CalculatorBase;
+using ::mediapipe::CalculatorContext;
+using ::mediapipe::CalculatorContract;
+using ::mediapipe::Detection;
+using ::mediapipe::LocationData;
+using ::mediapipe::Timestamp;
+using Detections = std::vector<Detection>;
+
+constexpr char kVideoTag[] = "VIDEO";
+constexpr char kDetectionsTag[] = "DETECTIONS";
+constexpr char kVelocitiesTag[] = "VELOCITIES";
+
+// The initial variance of the velocity of new tracks, in normalized units per
+// second, squared: a face may cross the frame in about a second.
+constexpr float kInitialVelocityVariance = 1.0f;
+
+// A box by its center and size, in normalized coordinates.
+struct Box {
+  float x_center;
+  float y_center;
+  float width;
+  float height;
+};
+
+Box DetectionBox(const Detection& detection) {
+  const auto& box = detection.location_data().relative_bounding_box();
+  return {box.xmin() + box.width() / 2, box.ymin() + box.height() / 2,
+          box.width(), box.height()};
+}
+
+float IntersectionOverUnion(const Box& a, const Box& b) {
+  const float width = std::min(a.x_center + a.width / 2,
+                               b.x_center + b.width / 2) -
+                      std::max(a.x_center - a.width / 2,
+                               b.x_center - b.width / 2);
+  const float height = std::min(a.y_center + a.height / 2,
+                                b.y_center + b.height / 2) -
+                       std::max(a.y_center - a.height / 2,
+                                b.y_center - b.height / 2);
+  if (width <= 0 || height <= 0) return 0.0f;
+  const float intersection = width * height;
+  return intersection /
+         (a.width * a.height + b.width * b.height - intersection);
+}
+
+// A constant-velocity Kalman filter of one box coordinate, whose state is the
+// position and the velocity of the coordinate.
+class CoordinateFilter {
+ public:
+  CoordinateFilter() = default;
+  CoordinateFilter(float position, float measurement_variance)
+      : position_(position),
+        position_variance_(measurement_variance),
+        velocity_variance_(kInitialVelocityVariance) {}
+
+  // Moves the state dt seconds forward, with a white noise acceleration of the
+  // given variance.
+  void Predict(float dt, float process_variance) {
+    position_ += velocity_ * dt;
+    position_variance_ += dt * (2 * covariance_ + dt * velocity_variance_) +
+                          process_variance * dt * dt * dt / 3;
+    covariance_ += dt * velocity_variance_ + process_variance * dt * dt / 2;
+    velocity_variance_ += process_variance * dt;
+  }
+
+  // Corrects the state with a measured position.
+  void Update(float position, float measurement_variance) {
+    const float innovation_variance = position_variance_ + measurement_variance;
+    const float position_gain = position_variance_ / innovation_variance;
+    const float velocity_gain = covariance_ / innovation_variance;
+    const float innovation = position - position_;
+    position_ += position_gain * innovation;
+    velocity_ += velocity_gain * innovation;
+    velocity_variance_ -= velocity_gain * covariance_;
+    position_variance_ *= 1 - position_gain;
+    covariance_ *= 1 - position_gain;
+  }
+
+  float position() const { return position_; }
+  float velocity() const { return velocity_; }
+
+ private:
+  float position_ = 0.0f;
+  float velocity_ = 0.0f;
+  float position_variance_ = 0.0f;
+  float covariance_ = 0.0f;
+  float velocity_variance_ = 0.0f;
+};
+}  // namespace
+
+// A calculator that tracks detections by linking them across frames by
+// intersection over union (IoU), and predicts their boxes with constant-
+// velocity Kalman filters, without reading any image pixels.
+//
+// It's a lightweight alternative to the MediaPipe object tracking subgraph,
+// whose motion analysis is more than needed for fixed cameras at high frame
+// rates, where boxes move little between frames. Each box coordinate (center
+// and size) has its own filter. When detections arrive, they are matched to
+// the predicted boxes of the tracks greedily by decreasing IoU, from min_iou
+// up; matched tracks are corrected, unmatched detections start new tracks, and
+// tracks unmatched for more than max_missed_detections detection packets are
+// dropped, as are tracks whose box leaves the image. The cost per frame is a
+// few arithmetic operations per track and per detection pair.
+//
+// As with the object tracking subgraph, the detections may come at a lower
+// rate than the video, e.g. from sampled frames, and a tracked detection is
+// output for each track at each video timestamp.
+//
+// Inputs:
+// - VIDEO: A stream of any type, e.g. the ImageFrame stream, that gives the
+//   timestamps of the output. Its packets are not read.
+// - DETECTIONS: The detections to be tracked, as std::vector<Detection>, with
+//   relative bounding boxes.
+//
+// Outputs:
+// - DETECTIONS: The tracked detections, as std::vector<Detection>, at the
+//   video timestamps. Each is a copy of the last detection of its track, with
+//   the predicted box, its keypoints moved along, and a unique track ID in
+//   detection_id.
+// - VELOCITIES (optional): The velocities of the boxes estimated by the
+//   filters, as BoxVelocities, at the same timestamps and in the same order as
+//   the tracked detections, e.g. for DetectionPredictionCalculator.
+//
+// Options:
+// - min_iou: The minimum IoU for a detection to continue a track. Default is
+//   0.3.
+// - max_missed_detections: The number of detection packets without a match
+//   after which a track is dropped. Default is 2.
+// - measurement_noise: The standard deviation of the detected box coordinates.
+//   Default is 0.01.
+// - process_noise: The standard deviation of the acceleration of the box
+//   coordinates, per second squared. Default is 1.
+//
+// Example config:
+// node {
+//   calculator: "IouKalmanTrackerCalculator"
+//   input_stream: "VIDEO:input_video"
+//   input_stream: "DETECTIONS:detections"
+//   output_stream: "DETECTIONS:tracked_detections"
+//   options: {
+//     [magritte.IouKalmanTrackerCalculatorOptions.ext] {
+//       min_iou: 0.3
+//       max_missed_detections: 2
+//     }
+//   }
+// }
+class IouKalmanTrackerCalculator : public CalculatorBase {
+ public:
+  IouKalmanTrackerCalculator() = default;
+  ~IouKalmanTrackerCalculator() override = default;
+
+  static absl::Status GetContract(CalculatorContract* cc) {
+    RET_CHECK(cc->Inputs().HasTag(kVideoTag))
+        << "Missing input " << kVideoTag << " tag.";
+    cc->Inputs().Tag(kVideoTag).SetAny();
+    RET_CHECK(cc->Inputs().HasTag(kDetectionsTag))
+        << "Missing input " << kDetectionsTag << " tag.";
+    cc->Inputs().Tag(kDetectionsTag).Set<Detections>();
+    RET_CHECK(cc->Outputs().HasTag(kDetectionsTag))
+        << "Missing output " << kDetectionsTag << " tag.";
+    cc->Outputs().Tag(kDetectionsTag).Set<Detections>();
+    if (cc->Outputs().HasTag(kVelocitiesTag)) {
+      cc->Outputs().Tag(kVelocitiesTag).Set<BoxVelocities>();
+    }
+    // No input side packets.
+    return absl::OkStatus();
+  }
+
+  absl::Status Open(CalculatorContext* cc) override {
+    cc->SetOffset(mediapipe::TimestampDiff(0));
+    options_ = cc->Options<IouKalmanTrackerCalculatorOptions>();
+    RET_CHECK_GT(options_.measurement_noise(), 0)
+        << "measurement_noise must be positive.";
+    RET_CHECK_GE(options_.process_noise(), 0)
+        << "process_noise must not be negative.";
+    measurement_variance_ =
+        options_.measurement_noise() * options_.measurement_noise();
+    process_variance_ = options_.process_noise() * options_.process_noise();
+    return absl::OkStatus();
+  }
+
+  absl::Status Process(CalculatorContext* cc) override {
+    if (last_timestamp_ != Timestamp::Unset()) {
+      const float dt = (cc->InputTimestamp() - last_timestamp_).Seconds();
+      for (Track& track : tracks_) {
+        for (CoordinateFilter& filter : track.filters) {
+          filter.Predict(dt, process_variance_);
+        }
+      }
+    }
+    last_timestamp_ = cc->InputTimestamp();
+
+    if (!cc->Inputs().Tag(kDetectionsTag).IsEmpty()) {
+      Associate(cc->Inputs().Tag(kDetectionsTag).Get<Detections>());
+    }
+    tracks_.erase(std::remove_if(tracks_.begin(), tracks_.end(),
+                                 [](const Track& track) {
+                                   return !IsInImage(TrackBox(track));
+                                 }),
+                  tracks_.end());
+
+    if (!cc->Inputs().Tag(kVideoTag).IsEmpty()) {
+      auto output = std::make_unique<Detections>();
+      output->reserve(tracks_.size());
+      for (const Track& track : tracks_) {
+        output->push_back(TrackedDetection(track));
+      }
+      cc->Outputs()
+          .Tag(kDetectionsTag)
+          .Add(output.release(), cc->InputTimestamp());
+      if (cc->Outputs().HasTag(kVelocitiesTag)) {
+        auto velocities = std::make_unique<BoxVelocities>();
+        velocities->reserve(tracks_.size());
+        for (const Track& track : tracks_) {
+          velocities->push_back(TrackVelocity(track));
+        }
+        cc->Outputs()
+            .Tag(kVelocitiesTag)
+            .Add(velocities.release(), cc->InputTimestamp());
+      }
+    }
+    return absl::OkStatus();
+  }
+
+ private:
+  struct Track {
+    int64_t id;
+    // The last detection of the track.
+    Detection detection;
+    // The filters of the x and y of the center, the width and the height.
+    std::array<CoordinateFilter, 4> filters;
+    int missed_detections = 0;
+  };
+
+  static Box TrackBox(const Track& track) {
+    return {track.filters[0].position(), track.filters[1].position(),
+            track.filters[2].position(), track.filters[3].position()};
+  }
+
+  static bool IsInImage(const Box& box) {
+    return box.width > 0 && box.height > 0 &&
+           box.x_center + box.width / 2 > 0 &&
+           box.x_center - box.width / 2 < 1 &&
+           box.y_center + box.height / 2 > 0 &&
+           box.y_center - box.height / 2 < 1;
+  }
+
+  // Returns the last detection of the track, moved to its predicted box.
+  static Detection TrackedDetection(const Track& track) {
+    Detection detection = track.detection;
+    detection.set_detection_id(track.id);
+    const Box detected = DetectionBox(track.detection);
+    const Box predicted = TrackBox(track);
+    LocationData* location_data = detection.mutable_location_data();
+    auto* box = location_data->mutable_relative_bounding_box();
+    box->set_xmin(predicted.x_center - predicted.width / 2);
+    box->set_ymin(predicted.y_center - predicted.height / 2);
+    box->set_width(predicted.width);
+    box->set_height(predicted.height);
+    for (auto& keypoint : *location_data->mutable_relative_keypoints()) {
+      keypoint.set_x(keypoint.x() + predicted.x_center - detected.x_center);
+      keypoint.set_y(keypoint.y() + predicted.y_center - detected.y_center);
+    }
+    return detection;
+  }
+
+  // Returns the velocity of the box of the track, from those of its center and
+  // size.
+  static BoxVelocity TrackVelocity(const Track& track) {
+    const float width = track.filters[2].velocity();
+    const float height = track.filters[3].velocity();
+    return {track.id, track.filters[0].velocity() - width / 2,
+            track.filters[1].velocity() - height / 2, width, height};
+  }
+
+  // Matches the detections to the tracks, corrects the matched tracks, drops
+  // the tracks unmatched for too long, and starts new tracks.
+  void Associate(const Detections& detections) {
+    std::vector<Box> boxes;
+    boxes.reserve(detections.size());
+    for (const Detection& detection : detections) {
+      boxes.push_back(DetectionBox(detection));
+    }
+
+    std::vector<std::tuple<float, int, int>> candidates;
+    const int num_tracks = static_cast<int>(tracks_.size());
+    const int num_boxes = static_cast<int>(boxes.size());
+    for (int i = 0; i < num_tracks; ++i) {
+      const Box track_box = TrackBox(tracks_[i]);
+      for (int j = 0; j < num_boxes; ++j) {
+        if (!detections[j].location_data().has_relative_bounding_box()) {
+          continue;
+        }
+        const float iou = IntersectionOverUnion(track_box, boxes[j]);
+        if (iou >= options_.min_iou()) candidates.emplace_back(iou, i, j);
+      }
+    }
+    std::sort(candidates.begin(), candidates.end(),
+              [](const auto& a, const auto& b) {
+                return std::get<0>(a) > std::get<0>(b);
+              });
+
+    std::vector<bool> track_matched(tracks_.size(), false);
+    std::vector<bool> detection_matched(detections.size(), false);
+    for (const auto& [iou, i, j] : candidates) {
+      if (track_matched[i] || detection_matched[j]) continue;
+      track_matched[i] = true;
+      detection_matched[j] = true;
+      Track& track = tracks_[i];
+      track.detection = detections[j];
+      track.missed_detections = 0;
+      track.filters[0].Update(boxes[j].x_center, measurement_variance_);
+      track.filters[1].Update(boxes[j].y_center, measurement_variance_);
+      track.filters[2].Update(boxes[j].width, measurement_variance_);
+      track.filters[3].Update(boxes[j].height, measurement_variance_);
+    }
+
+    std::vector<Track> tracks;
+    tracks.reserve(tracks_.size() + detections.size());
+    for (size_t i = 0; i < tracks_.size(); ++i) {
+      if (!track_matched[i] && ++tracks_[i].missed_detections >
+                                   options_.max_missed_detections()) {
+        continue;
+      }
+      tracks.push_back(std::move(tracks_[i]));
+    }
+    for (size_t j = 0; j < detections.size(); ++j) {
+      if (detection_matched[j] ||
+          !detections[j].location_data().has_relative_bounding_box()) {
+        continue;
+      }
+      Track& track = tracks.emplace_back();
+      track.id = next_id_++;
+      track.detection = detections[j];
+      track.filters = {
+          CoordinateFilter(boxes[j].x_center, measurement_variance_),
+          CoordinateFilter(boxes[j].y_center, measurement_variance_),
+          CoordinateFilter(boxes[j].width, measurement_variance_),
+          CoordinateFilter(boxes[j].height, measurement_variance_)};
+    }
+    tracks_ = std::move(tracks);
+  }
+
+  IouKalmanTrackerCalculatorOptions options_;
+  float measurement_variance_;
+  float process_variance_;
+  std::vector<Track> tracks_;
+  int64_t next_id_ = 0;
+  Timestamp last_timestamp_ = Timestamp::Unset();
+};
+
+REGISTER_CALCULATOR(IouKalmanTrackerCalculator);
+
+}  // namespace magritte
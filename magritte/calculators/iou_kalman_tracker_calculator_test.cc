@@ -0,0 +1,194 @@
+//
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+#include <cstdint>
+#include <vector>
+
+#include "magritte/calculators/box_velocity.h"
+#include "magritte/calculators/iou_kalman_tracker_calculator.pb.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/calculator_runner.h"
+#include "mediapipe/framework/formats/detection.pb.h"
+#include "mediapipe/framework/formats/location_data.pb.h"
+#include "mediapipe/framework/port/gmock.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/parse_text_proto.h"
+#include "mediapipe/framework/port/status_matchers.h"
+
+namespace magritte {
+namespace {
+
+using ::mediapipe::CalculatorRunner;
+using ::mediapipe::Detection;
+using ::mediapipe::MakePacket;
+using ::mediapipe::Timestamp;
+using Detections = std::vector<Detection>;
+
+constexpr char kNodeConfig[] = R"pb(
+  calculator: "IouKalmanTrackerCalculator"
+  input_stream: "VIDEO:input_video"
+  input_stream: "DETECTIONS:detections"
+  output_stream: "DETECTIONS:tracked_detections"
+  options {
+    [magritte.IouKalmanTrackerCalculatorOptions.ext] {
+      min_iou: 0.3
+      max_missed_detections: 1
+    }
+  }
+)pb";
+
+// Returns a square face detection of the given center and size, with a
+// keypoint at its center.
+Detection MakeFace(float x_center, float y_center, float size) {
+  Detection detection;
+  auto* location_data = detection.mutable_location_data();
+  auto* box = location_data->mutable_relative_bounding_box();
+  box->set_xmin(x_center - size / 2);
+  box->set_ymin(y_center - size / 2);
+  box->set_width(size);
+  box->set_height(size);
+  auto* keypoint = location_data->add_relative_keypoints();
+  keypoint->set_x(x_center);
+  keypoint->set_y(y_center);
+  return detection;
+}
+
+void AddFrame(int64_t timestamp, CalculatorRunner* runner) {
+  runner->MutableInputs()->Tag("VIDEO").packets.push_back(
+      MakePacket<int>(0).At(Timestamp(timestamp)));
+}
+
+void AddDetections(int64_t timestamp, const Detections& detections,
+                   CalculatorRunner* runner) {
+  runner->MutableInputs()->Tag("DETECTIONS").packets.push_back(
+      MakePacket<Detections>(detections).At(Timestamp(timestamp)));
+}
+
+std::vector<std::vector<int64_t>> OutputIds(const CalculatorRunner& runner) {
+  std::vector<std::vector<int64_t>> output_ids;
+  for (const auto& packet : runner.Outputs().Tag("DETECTIONS").packets) {
+    std::vector<int64_t> ids;
+    for (const Detection& detection : packet.Get<Detections>()) {
+      ids.push_back(detection.detection_id());
+    }
+    output_ids.push_back(ids);
+  }
+  return output_ids;
+}
+
+TEST(IouKalmanTrackerCalculatorTest, PredictsBoxesAtConstantVelocity) {
+  CalculatorRunner runner(
+      mediapipe::ParseTextProtoOrDie<mediapipe::CalculatorGraphConfig::Node>(
+          kNodeConfig));
+  // The face moves right by 0.05 every 100 ms, and is only detected on the
+  // first two frames.
+  AddFrame(0, &runner);
+  AddDetections(0, {MakeFace(0.3f, 0.5f, 0.2f)}, &runner);
+  AddFrame(100000, &runner);
+  AddDetections(100000, {MakeFace(0.35f, 0.5f, 0.2f)}, &runner);
+  AddFrame(200000, &runner);
+
+  MP_ASSERT_OK(runner.Run());
+  const auto& packets = runner.Outputs().Tag("DETECTIONS").packets;
+  ASSERT_EQ(packets.size(), 3);
+  EXPECT_THAT(OutputIds(runner),
+              testing::ElementsAre(testing::ElementsAre(0),
+                                   testing::ElementsAre(0),
+                                   testing::ElementsAre(0)));
+  const Detection& predicted = packets[2].Get<Detections>()[0];
+  const auto& box = predicted.location_data().relative_bounding_box();
+  EXPECT_NEAR(box.xmin() + box.width() / 2, 0.4f, 0.005f);
+  EXPECT_NEAR(box.ymin() + box.height() / 2, 0.5f, 0.005f);
+  EXPECT_NEAR(box.width(), 0.2f, 0.005f);
+  EXPECT_NEAR(box.height(), 0.2f, 0.005f);
+  const auto& keypoint = predicted.location_data().relative_keypoints(0);
+  EXPECT_NEAR(keypoint.x(), 0.4f, 0.005f);
+  EXPECT_NEAR(keypoint.y(), 0.5f, 0.005f);
+}
+
+TEST(IouKalmanTrackerCalculatorTest, OutputsFilterVelocities) {
+  CalculatorRunner runner(
+      mediapipe::ParseTextProtoOrDie<mediapipe::CalculatorGraphConfig::Node>(
+          R"pb(
+            calculator: "IouKalmanTrackerCalculator"
+            input_stream: "VIDEO:input_video"
+            input_stream: "DETECTIONS:detections"
+            output_stream: "DETECTIONS:tracked_detections"
+            output_stream: "VELOCITIES:velocities"
+          )pb"));
+  // The face moves right by 0.05 every 100 ms.
+  AddFrame(0, &runner);
+  AddDetections(0, {MakeFace(0.3f, 0.5f, 0.2f)}, &runner);
+  AddFrame(100000, &runner);
+  AddDetections(100000, {MakeFace(0.35f, 0.5f, 0.2f)}, &runner);
+  AddFrame(200000, &runner);
+  AddDetections(200000, {MakeFace(0.4f, 0.5f, 0.2f)}, &runner);
+
+  MP_ASSERT_OK(runner.Run());
+  const auto& packets = runner.Outputs().Tag("VELOCITIES").packets;
+  ASSERT_EQ(packets.size(), 3);
+  EXPECT_EQ(packets[2].Timestamp(), Timestamp(200000));
+  ASSERT_EQ(packets[2].Get<BoxVelocities>().size(), 1);
+  const BoxVelocity& velocity = packets[2].Get<BoxVelocities>()[0];
+  EXPECT_EQ(velocity.detection_id, 0);
+  // 0.5 per second to the right.
+  EXPECT_NEAR(velocity.xmin, 0.5f, 0.02f);
+  EXPECT_NEAR(velocity.ymin, 0.0f, 0.02f);
+  EXPECT_NEAR(velocity.width, 0.0f, 0.02f);
+  EXPECT_NEAR(velocity.height, 0.0f, 0.02f);
+}
+
+TEST(IouKalmanTrackerCalculatorTest, StartsAndDropsTracks) {
+  CalculatorRunner runner(
+      mediapipe::ParseTextProtoOrDie<mediapipe::CalculatorGraphConfig::Node>(
+          kNodeConfig));
+  AddFrame(0, &runner);
+  AddDetections(0, {MakeFace(0.2f, 0.5f, 0.2f), MakeFace(0.7f, 0.5f, 0.2f)},
+                &runner);
+  // The second face is missed once, and kept.
+  AddFrame(1, &runner);
+  AddDetections(1, {MakeFace(0.2f, 0.5f, 0.2f)}, &runner);
+  // A frame without detections doesn't count as a miss.
+  AddFrame(2, &runner);
+  // The second face is missed twice, and dropped, and a third face appears.
+  AddFrame(3, &runner);
+  AddDetections(3, {MakeFace(0.2f, 0.5f, 0.2f), MakeFace(0.5f, 0.2f, 0.1f)},
+                &runner);
+
+  MP_ASSERT_OK(runner.Run());
+  EXPECT_THAT(OutputIds(runner),
+              testing::ElementsAre(testing::ElementsAre(0, 1),
+                                   testing::ElementsAre(0, 1),
+                                   testing::ElementsAre(0, 1),
+                                   testing::ElementsAre(0, 2)));
+}
+
+TEST(IouKalmanTrackerCalculatorTest, OnlyOutputsAtVideoTimestamps) {
+  CalculatorRunner runner(
+      mediapipe::ParseTextProtoOrDie<mediapipe::CalculatorGraphConfig::Node>(
+          kNodeConfig));
+  AddDetections(0, {MakeFace(0.5f, 0.5f, 0.2f)}, &runner);
+  AddFrame(1, &runner);
+
+  MP_ASSERT_OK(runner.Run());
+  const auto& packets = runner.Outputs().Tag("DETECTIONS").packets;
+  ASSERT_EQ(packets.size(), 1);
+  EXPECT_EQ(packets[0].Timestamp(), Timestamp(1));
+  EXPECT_THAT(OutputIds(runner),
+              testing::ElementsAre(testing::ElementsAre(0)));
+}
+
+}  // namespace
+}  // namespace magritte
@@ -25,6 +25,7 @@
 #include "mediapipe/framework/formats/image_frame_opencv.h"
 #include "mediapipe/util/color.pb.h"
 #include "absl/memory/memory.h"
+#include "magritte/calculators/image_frame_pool_service.h"
 #include "magritte/calculators/new_canvas_calculator.pb.h"
 #include  <opencv2/core.hpp>
 
@@ -63,6 +64,7 @@ absl::Status NewCanvasCalculator::GetContract(CalculatorContract* cc) {
     RET_CHECK(cc->Outputs().HasTag(kImageFrameTag))
         << "Input and output format must be identical";
     cc->Outputs().Tag(kImageFrameTag).Set<ImageFrame>();
+    UseImageFramePoolService(cc);
   }
 
 #if !defined(MEDIAPIPE_DISABLE_GPU)
@@ -81,6 +83,10 @@ absl::Status NewCanvasCalculator::GetContract(CalculatorContract* cc) {
 }
 
 absl::Status NewCanvasCalculator::Open(CalculatorContext* cc) {
+  if (cc->Options<NewCanvasCalculatorOptions>().canvas_mode() ==
+      NewCanvasCalculatorOptions::POOLED) {
+    pool_ = GetImageFramePool(cc);
+  }
 #if !defined(MEDIAPIPE_DISABLE_GPU)
   return helper_.Open(cc);
 #endif  //  !MEDIAPIPE_DISABLE_GPU
@@ -109,13 +115,39 @@ absl::Status NewCanvasCalculator::ProcessCpu(CalculatorContext* cc) {
   const auto& frame = cc->Inputs().Tag(kImageFrameTag).Get<ImageFrame>();
   std::pair<int, int> size =
       GetSizeFromOptions(options, frame.Width(), frame.Height());
-  auto output_frame =
-      std::make_unique<ImageFrame>(frame.Format(), size.first, size.second);
+
+  if (options.canvas_mode() == NewCanvasCalculatorOptions::CONSTANT &&
+      !canvas_packet_.IsEmpty()) {
+    const auto& canvas = canvas_packet_.Get<ImageFrame>();
+    if (canvas.Format() == frame.Format() && canvas.Width() == size.first &&
+        canvas.Height() == size.second) {
+      cc->Outputs()
+          .Tag(kImageFrameTag)
+          .AddPacket(canvas_packet_.At(cc->InputTimestamp()));
+      return absl::OkStatus();
+    }
+  }
+
+  std::unique_ptr<ImageFrame> output_frame;
+  if (options.canvas_mode() == NewCanvasCalculatorOptions::POOLED) {
+    output_frame = pool_->GetFrame(frame.Format(), size.first, size.second);
+  } else {
+    output_frame =
+        std::make_unique<ImageFrame>(frame.Format(), size.first, size.second);
+  }
 
   cv::Mat src = MatView(output_frame.get());
   const mediapipe::Color color = options.color();
   src.setTo(cv::Scalar(color.r(), color.g(), color.b()));
 
+  if (options.canvas_mode() == NewCanvasCalculatorOptions::CONSTANT) {
+    canvas_packet_ = mediapipe::Adopt(output_frame.release());
+    cc->Outputs()
+        .Tag(kImageFrameTag)
+        .AddPacket(canvas_packet_.At(cc->InputTimestamp()));
+    return absl::OkStatus();
+  }
+
   cc->Outputs()
       .Tag(kImageFrameTag)
       .Add(output_frame.release(), cc->InputTimestamp());
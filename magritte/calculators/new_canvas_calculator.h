@@ -24,6 +24,7 @@
 #include "mediapipe/framework/calculator_framework.h"
 #include "mediapipe/framework/formats/image_frame.h"
 #include "mediapipe/util/color.pb.h"
+#include "magritte/calculators/image_frame_pool.h"
 #include "magritte/calculators/new_canvas_calculator.pb.h"
 
 #if !defined(MEDIAPIPE_DISABLE_GPU)
@@ -51,6 +52,9 @@ using ::mediapipe::CalculatorContract;
 // Options:
 // - color defining the new canvas color.
 // - scaling information (see proto file for details).
+// - canvas_mode: on CPU, whether to output a new canvas for every frame, the
+//   same immutable canvas as long as the input size doesn't change, or a
+//   canvas recycled from a pool (see proto file for details).
 //
 // Example config:
 // node {
@@ -83,6 +87,12 @@ class NewCanvasCalculator : public CalculatorBase {
 #if !defined(MEDIAPIPE_DISABLE_GPU)
   ::mediapipe::GlCalculatorHelper helper_;
 #endif  //  !MEDIAPIPE_DISABLE_GPU
+  // The canvas output in CONSTANT mode, until the input format or size changes.
+  mediapipe::Packet canvas_packet_;
+  // The pool of canvases in POOLED mode, shared with the other calculators if
+  // the graph provides kImageFramePoolService.
+  std::shared_ptr<ImageFramePool> pool_;
+
   absl::Status ProcessCpu(CalculatorContext* cc);
   absl::Status ProcessGpu(CalculatorContext* cc);
 };
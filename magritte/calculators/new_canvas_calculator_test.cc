@@ -16,16 +16,108 @@
 
 #include "magritte/calculators/new_canvas_calculator.h"
 
+#include <memory>
+#include <string>
 #include <utility>
+#include <vector>
 
+#include  <opencv2/core.hpp>
+#include "absl/strings/substitute.h"
 #include "magritte/calculators/new_canvas_calculator.pb.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/calculator_runner.h"
+#include "mediapipe/framework/formats/image_frame.h"
+#include "mediapipe/framework/formats/image_frame_opencv.h"
 #include "mediapipe/framework/port/gmock.h"
 #include "mediapipe/framework/port/gtest.h"
 #include "mediapipe/framework/port/parse_text_proto.h"
+#include "mediapipe/framework/port/status_matchers.h"
 
 namespace magritte {
 namespace {
 
+using ::mediapipe::CalculatorRunner;
+using ::mediapipe::ImageFormat;
+using ::mediapipe::ImageFrame;
+using ::mediapipe::Packet;
+using ::mediapipe::Timestamp;
+using ::mediapipe::formats::MatView;
+
+constexpr char kImageFrameTag[] = "IMAGE";
+
+// Node config with the canvas mode as a substitution parameter.
+constexpr char kNodeConfigTemplate[] = R"pb(
+  calculator: "NewCanvasCalculator"
+  input_stream: "IMAGE:input_video"
+  output_stream: "IMAGE:canvas"
+  options {
+    [magritte.NewCanvasCalculatorOptions.ext] {
+      color { r: 10 g: 20 b: 30 }
+      canvas_mode: $0
+    }
+  }
+)pb";
+
+// Runs the calculator in the given canvas mode on frames of the given sizes,
+// and returns the canvases.
+std::vector<Packet> RunWithCanvasMode(
+    const std::string& canvas_mode,
+    const std::vector<std::pair<int, int>>& sizes) {
+  CalculatorRunner runner(
+      mediapipe::ParseTextProtoOrDie<mediapipe::CalculatorGraphConfig::Node>(
+          absl::Substitute(kNodeConfigTemplate, canvas_mode)));
+  const int num_sizes = static_cast<int>(sizes.size());
+  for (int t = 0; t < num_sizes; ++t) {
+    runner.MutableInputs()
+        ->Tag(kImageFrameTag)
+        .packets.push_back(
+            mediapipe::MakePacket<ImageFrame>(ImageFormat::SRGB,
+                                              sizes[t].first, sizes[t].second)
+                .At(Timestamp(t)));
+  }
+  MP_EXPECT_OK(runner.Run());
+  return runner.Outputs().Tag(kImageFrameTag).packets;
+}
+
+// Expects the canvas to have the given size and the color of RunWithCanvasMode.
+void ExpectCanvas(const Packet& packet, int width, int height) {
+  const auto& canvas = packet.Get<ImageFrame>();
+  EXPECT_EQ(canvas.Width(), width);
+  EXPECT_EQ(canvas.Height(), height);
+  cv::Mat difference;
+  cv::absdiff(MatView(&canvas), cv::Scalar(10, 20, 30), difference);
+  EXPECT_EQ(cv::countNonZero(difference.reshape(1)), 0);
+}
+
+TEST(NewCanvasCalculatorCanvasModeTest, NewModeAllocatesEveryCanvas) {
+  const std::vector<Packet> canvases =
+      RunWithCanvasMode("NEW", {{64, 48}, {64, 48}});
+  ASSERT_EQ(canvases.size(), 2);
+  ExpectCanvas(canvases[0], 64, 48);
+  ExpectCanvas(canvases[1], 64, 48);
+  EXPECT_NE(&canvases[0].Get<ImageFrame>(), &canvases[1].Get<ImageFrame>());
+}
+
+TEST(NewCanvasCalculatorCanvasModeTest, ConstantModeReusesCanvasUntilResize) {
+  const std::vector<Packet> canvases =
+      RunWithCanvasMode("CONSTANT", {{64, 48}, {64, 48}, {32, 16}});
+  ASSERT_EQ(canvases.size(), 3);
+  ExpectCanvas(canvases[0], 64, 48);
+  ExpectCanvas(canvases[1], 64, 48);
+  ExpectCanvas(canvases[2], 32, 16);
+  EXPECT_EQ(&canvases[0].Get<ImageFrame>(), &canvases[1].Get<ImageFrame>());
+  EXPECT_EQ(canvases[1].Timestamp(), Timestamp(1));
+}
+
+TEST(NewCanvasCalculatorCanvasModeTest, PooledModeFillsEveryCanvas) {
+  const std::vector<Packet> canvases =
+      RunWithCanvasMode("POOLED", {{64, 48}, {64, 48}, {32, 16}});
+  ASSERT_EQ(canvases.size(), 3);
+  ExpectCanvas(canvases[0], 64, 48);
+  ExpectCanvas(canvases[1], 64, 48);
+  ExpectCanvas(canvases[2], 32, 16);
+}
+
 struct OptionsToSizeTestCase {
   const std::string test_name;
   const NewCanvasCalculatorOptions options;
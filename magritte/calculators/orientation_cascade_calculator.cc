@@ -0,0 +1,176 @@
+//
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+#include <memory>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "magritte/calculators/orientation_cascade_calculator.pb.h"
+#include "magritte/calculators/rotation_roi_calculator.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/formats/detection.pb.h"
+#include "mediapipe/framework/formats/rect.pb.h"
+#include "mediapipe/framework/port/ret_check.h"
+
+namespace magritte {
+namespace {
+using ::mediapipe::CalculatorBase;
+using ::mediapipe::CalculatorContext;
+using ::mediapipe::CalculatorContract;
+using ::mediapipe::Detection;
+using ::mediapipe::NormalizedRect;
+using Detections = std::vector<Detection>;
+
+constexpr char kTickTag[] = "TICK";
+constexpr char kDetectionsTag[] = "DETECTIONS";
+constexpr char kRotationDegreesTag[] = "ROTATION_DEGREES";
+constexpr char kRotationHintTag[] = "ROTATION_HINT";
+constexpr char kRegionOfInterestTag[] = "ROI";
+
+// Number of orientations searched besides the primary one.
+constexpr int kNumOtherOrientations = 3;
+
+// Suffix of the counter of frames in which all orientations were searched,
+// after the node name.
+constexpr char kFullSweepsCounterSuffix[] = "/FullSweeps";
+}  // namespace
+
+// A calculator that decides, in a 360° face detection graph, whether the
+// orientations other than the primary one need to be searched for the current
+// frame.
+//
+// Detection first runs on a ROI in the primary orientation, usually the
+// dominant orientation of the stream (see DominantOrientationCalculator). The
+// other three orientations are then only searched when nothing was found in
+// the primary orientation, or periodically to find faces appearing in another
+// orientation. For upright streams with faces, this runs one detection pass per
+// frame instead of four most of the time. When the orientation of a frame is
+// known beforehand, e.g. from the device orientation or EXIF data, it is given
+// as a ROTATION_HINT and the other orientations are not searched at all.
+//
+// Inputs:
+// - TICK: A packet of any type for every frame, e.g. the input image.
+// - DETECTIONS: The faces found in the primary orientation, as
+//   std::vector<Detection>. A missing packet means that none were found.
+// - ROTATION_DEGREES (optional): The clockwise rotation of the primary ROI in
+//   degrees, as an int multiple of 90. Defaults to 0.
+// - ROTATION_HINT (optional): The known clockwise rotation of the frame content
+//   in degrees, as an int multiple of 90. For the frames that have one, no ROI
+//   is output and the primary ROI is expected to be in the hinted orientation.
+//
+// Outputs:
+// - ROI:0, ROI:1, ROI:2: ROIs covering the whole image as NormalizedRect,
+//   rotated by 90°, 180° and 270° more than the primary ROI. They are only
+//   output for the frames in which the other orientations must be searched.
+//
+// Options:
+// - refresh_interval: The other orientations are searched at least once every
+//   refresh_interval frames. Default is 30.
+//
+// Example config:
+// node {
+//   calculator: "OrientationCascadeCalculator"
+//   input_stream: "TICK:input_video"
+//   input_stream: "DETECTIONS:primary_detections"
+//   input_stream: "ROTATION_DEGREES:primary_rotation"
+//   output_stream: "ROI:0:roi1"
+//   output_stream: "ROI:1:roi2"
+//   output_stream: "ROI:2:roi3"
+//   options: {
+//     [magritte.OrientationCascadeCalculatorOptions.ext] {
+//       refresh_interval: 30
+//     }
+//   }
+// }
+class OrientationCascadeCalculator : public CalculatorBase {
+ public:
+  OrientationCascadeCalculator() = default;
+  ~OrientationCascadeCalculator() override = default;
+
+  static absl::Status GetContract(CalculatorContract* cc) {
+    RET_CHECK(cc->Inputs().HasTag(kTickTag))
+        << "Missing input " << kTickTag << " tag.";
+    cc->Inputs().Tag(kTickTag).SetAny();
+    RET_CHECK(cc->Inputs().HasTag(kDetectionsTag))
+        << "Missing input " << kDetectionsTag << " tag.";
+    cc->Inputs().Tag(kDetectionsTag).Set<Detections>();
+    if (cc->Inputs().HasTag(kRotationDegreesTag)) {
+      cc->Inputs().Tag(kRotationDegreesTag).Set<int>();
+    }
+    if (cc->Inputs().HasTag(kRotationHintTag)) {
+      cc->Inputs().Tag(kRotationHintTag).Set<int>();
+    }
+
+    RET_CHECK_EQ(cc->Outputs().NumEntries(kRegionOfInterestTag),
+                 kNumOtherOrientations)
+        << "Calculator must have " << kNumOtherOrientations << " ROI outputs.";
+    for (int i = 0; i < kNumOtherOrientations; ++i) {
+      cc->Outputs().Get(kRegionOfInterestTag, i).Set<NormalizedRect>();
+    }
+
+    // No input side packets.
+    return absl::OkStatus();
+  }
+
+  absl::Status Open(CalculatorContext* cc) override {
+    cc->SetOffset(mediapipe::TimestampDiff(0));
+    refresh_interval_ =
+        cc->Options<OrientationCascadeCalculatorOptions>().refresh_interval();
+    RET_CHECK_GE(refresh_interval_, 1) << "refresh_interval must be positive.";
+    // The first frame searches all orientations.
+    frames_since_sweep_ = refresh_interval_ - 1;
+    return absl::OkStatus();
+  }
+
+  absl::Status Process(CalculatorContext* cc) override {
+    if (cc->Inputs().HasTag(kRotationHintTag) &&
+        !cc->Inputs().Tag(kRotationHintTag).IsEmpty()) {
+      return absl::OkStatus();
+    }
+    const auto& detections = cc->Inputs().Tag(kDetectionsTag);
+    const bool found_faces =
+        !detections.IsEmpty() && !detections.Get<Detections>().empty();
+    ++frames_since_sweep_;
+    if (found_faces && frames_since_sweep_ < refresh_interval_) {
+      return absl::OkStatus();
+    }
+    frames_since_sweep_ = 0;
+
+    int primary_rotation = 0;
+    if (cc->Inputs().HasTag(kRotationDegreesTag) &&
+        !cc->Inputs().Tag(kRotationDegreesTag).IsEmpty()) {
+      primary_rotation = cc->Inputs().Tag(kRotationDegreesTag).Get<int>();
+    }
+    for (int i = 0; i < kNumOtherOrientations; ++i) {
+      cc->Outputs()
+          .Get(kRegionOfInterestTag, i)
+          .Add(new NormalizedRect(RotationRoiCalculator::MakeRotatedRoi(
+                   primary_rotation + 90 * (i + 1))),
+               cc->InputTimestamp());
+    }
+    cc->GetCounter(absl::StrCat(cc->NodeName(), kFullSweepsCounterSuffix))
+        ->Increment();
+    return absl::OkStatus();
+  }
+
+ private:
+  int refresh_interval_ = 1;
+  // Number of frames since all orientations were last searched.
+  int frames_since_sweep_ = 0;
+};
+
+REGISTER_CALCULATOR(OrientationCascadeCalculator);
+
+}  // namespace magritte
@@ -0,0 +1,152 @@
+//
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+#include <cstdint>
+#include <vector>
+
+#include "magritte/calculators/orientation_cascade_calculator.pb.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/calculator_runner.h"
+#include "mediapipe/framework/formats/detection.pb.h"
+#include "mediapipe/framework/formats/rect.pb.h"
+#include "mediapipe/framework/port/gmock.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/parse_text_proto.h"
+#include "mediapipe/framework/port/status_matchers.h"
+
+namespace magritte {
+namespace {
+
+using ::mediapipe::CalculatorRunner;
+using ::mediapipe::Detection;
+using ::mediapipe::MakePacket;
+using ::mediapipe::NormalizedRect;
+using ::mediapipe::Timestamp;
+using Detections = std::vector<Detection>;
+
+constexpr char kNodeConfig[] = R"pb(
+  calculator: "OrientationCascadeCalculator"
+  input_stream: "TICK:tick"
+  input_stream: "DETECTIONS:detections"
+  input_stream: "ROTATION_DEGREES:rotation"
+  output_stream: "ROI:0:roi1"
+  output_stream: "ROI:1:roi2"
+  output_stream: "ROI:2:roi3"
+  options {
+    [magritte.OrientationCascadeCalculatorOptions.ext] { refresh_interval: 3 }
+  }
+)pb";
+
+// Adds a frame with the given number of faces found in the primary
+// orientation. Without faces, no detections packet is added.
+void AddFrame(int timestamp, int num_faces, CalculatorRunner* runner) {
+  runner->MutableInputs()->Tag("TICK").packets.push_back(
+      MakePacket<int>(0).At(Timestamp(timestamp)));
+  if (num_faces > 0) {
+    runner->MutableInputs()->Tag("DETECTIONS").packets.push_back(
+        MakePacket<Detections>(num_faces).At(Timestamp(timestamp)));
+  }
+}
+
+std::vector<int64_t> OutputTimestamps(const CalculatorRunner& runner,
+                                      int index) {
+  std::vector<int64_t> timestamps;
+  for (const auto& packet : runner.Outputs().Get("ROI", index).packets) {
+    timestamps.push_back(packet.Timestamp().Value());
+  }
+  return timestamps;
+}
+
+TEST(OrientationCascadeCalculatorTest, SearchesOtherOrientationsWhenNeeded) {
+  CalculatorRunner runner(
+      mediapipe::ParseTextProtoOrDie<mediapipe::CalculatorGraphConfig::Node>(
+          kNodeConfig));
+  // Frame 0 is always searched fully, frame 2 finds no face, and frame 5 is a
+  // periodic refresh.
+  AddFrame(0, 1, &runner);
+  AddFrame(1, 1, &runner);
+  AddFrame(2, 0, &runner);
+  AddFrame(3, 2, &runner);
+  AddFrame(4, 1, &runner);
+  AddFrame(5, 1, &runner);
+  AddFrame(6, 1, &runner);
+
+  MP_ASSERT_OK(runner.Run());
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_THAT(OutputTimestamps(runner, i), testing::ElementsAre(0, 2, 5));
+  }
+  EXPECT_EQ(runner.GetCounter("OrientationCascadeCalculator/FullSweeps")->Get(),
+            3);
+}
+
+TEST(OrientationCascadeCalculatorTest, RotatesRoisFromPrimaryOrientation) {
+  CalculatorRunner runner(
+      mediapipe::ParseTextProtoOrDie<mediapipe::CalculatorGraphConfig::Node>(
+          kNodeConfig));
+  AddFrame(0, 0, &runner);
+  runner.MutableInputs()->Tag("ROTATION_DEGREES").packets.push_back(
+      MakePacket<int>(180).At(Timestamp(0)));
+
+  MP_ASSERT_OK(runner.Run());
+  const float expected_rotations[] = {3 * M_PI / 2, 0.0, M_PI / 2};
+  for (int i = 0; i < 3; ++i) {
+    const auto& packets = runner.Outputs().Get("ROI", i).packets;
+    ASSERT_EQ(packets.size(), 1);
+    EXPECT_FLOAT_EQ(packets[0].Get<NormalizedRect>().rotation(),
+                    expected_rotations[i]);
+  }
+}
+
+TEST(OrientationCascadeCalculatorTest, RefreshIntervalOfOneSearchesAlways) {
+  auto node =
+      mediapipe::ParseTextProtoOrDie<mediapipe::CalculatorGraphConfig::Node>(
+          kNodeConfig);
+  node.mutable_options()
+      ->MutableExtension(OrientationCascadeCalculatorOptions::ext)
+      ->set_refresh_interval(1);
+  CalculatorRunner runner(node);
+  for (int t = 0; t < 4; ++t) {
+    AddFrame(t, 1, &runner);
+  }
+
+  MP_ASSERT_OK(runner.Run());
+  EXPECT_THAT(OutputTimestamps(runner, 0), testing::ElementsAre(0, 1, 2, 3));
+}
+
+TEST(OrientationCascadeCalculatorTest, SkipsFramesWithRotationHint) {
+  auto node =
+      mediapipe::ParseTextProtoOrDie<mediapipe::CalculatorGraphConfig::Node>(
+          kNodeConfig);
+  node.add_input_stream("ROTATION_HINT:hint");
+  node.mutable_options()
+      ->MutableExtension(OrientationCascadeCalculatorOptions::ext)
+      ->set_refresh_interval(1);
+  CalculatorRunner runner(node);
+  for (int t = 0; t < 4; ++t) {
+    AddFrame(t, 0, &runner);
+  }
+  for (int t : {1, 2}) {
+    runner.MutableInputs()->Tag("ROTATION_HINT").packets.push_back(
+        MakePacket<int>(90).At(Timestamp(t)));
+  }
+
+  MP_ASSERT_OK(runner.Run());
+  EXPECT_THAT(OutputTimestamps(runner, 0), testing::ElementsAre(0, 3));
+  EXPECT_EQ(runner.GetCounter("OrientationCascadeCalculator/FullSweeps")->Get(),
+            2);
+}
+
+}  // namespace
+}  // namespace magritte
@@ -0,0 +1,208 @@
+//
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Benchmarks SimpleBlurCalculatorCpu and SpriteCalculatorCpu for an increasing
+// number of faces in a 1080p frame, on one and on several threads, and
+// SimpleBlurCalculatorCpu for crowds of overlapping faces with and without
+// crowd mode.
+//
+// Usage:
+//   bazel run -c opt //magritte/calculators:parallel_redaction_benchmark
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/strings/substitute.h"
+#include "benchmark/benchmark.h"
+#include "magritte/calculators/sprite_list.h"
+#include "magritte/calculators/sprite_pose.pb.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/calculator_runner.h"
+#include "mediapipe/framework/formats/detection.pb.h"
+#include "mediapipe/framework/formats/image_frame.h"
+#include "mediapipe/framework/formats/image_frame_opencv.h"
+#include "mediapipe/framework/formats/location_data.pb.h"
+#include "mediapipe/framework/port/parse_text_proto.h"
+#include  <opencv2/core.hpp>
+
+namespace magritte {
+namespace {
+
+using ::mediapipe::CalculatorGraphConfig;
+using ::mediapipe::CalculatorRunner;
+using ::mediapipe::Detection;
+using ::mediapipe::ImageFormat;
+using ::mediapipe::ImageFrame;
+using ::mediapipe::LocationData;
+using ::mediapipe::Timestamp;
+using ::mediapipe::formats::MatView;
+
+constexpr int kFrameWidth = 1920;
+constexpr int kFrameHeight = 1080;
+// Faces are laid out on a grid, so that neighboring faces overlap once their
+// blur footprint or sprite is larger than the grid cell.
+constexpr int kFaceSize = 96;
+constexpr int kCellSize = 120;
+// In crowds, each face overlaps its neighbors by half.
+constexpr int kCrowdCellSize = kFaceSize / 2;
+
+constexpr char kSimpleBlurNode[] = R"pb(
+  calculator: "SimpleBlurCalculatorCpu"
+  input_stream: "FRAMES:input_video"
+  input_stream: "DETECTIONS:detections"
+  output_stream: "FRAMES:output_video"
+  options {
+    [magritte.SimpleBlurCalculatorOptions.ext] {
+      blur_type: GAUSSIAN_BLUR
+      num_threads: $0
+      crowd_mode: $1
+    }
+  }
+)pb";
+
+constexpr char kSpriteNode[] = R"pb(
+  calculator: "SpriteCalculatorCpu"
+  input_stream: "IMAGE:input_video"
+  input_stream: "SPRITES:sprites"
+  output_stream: "IMAGE:output_video"
+  options {
+    [magritte.SpriteCalculatorOptions.ext] { num_threads: $0 }
+  }
+)pb";
+
+cv::Rect FaceRect(int index, int cell_size = kCellSize) {
+  const int faces_per_row = (kFrameWidth - kFaceSize) / cell_size + 1;
+  return cv::Rect((index % faces_per_row) * cell_size,
+                  (index / faces_per_row) * cell_size, kFaceSize, kFaceSize);
+}
+
+mediapipe::Packet MakeDetectionsPacket(int num_faces, int cell_size) {
+  std::vector<Detection> detections(num_faces);
+  for (int i = 0; i < num_faces; ++i) {
+    const cv::Rect rect = FaceRect(i, cell_size);
+    LocationData* location_data = detections[i].mutable_location_data();
+    location_data->set_format(LocationData::BOUNDING_BOX);
+    location_data->mutable_bounding_box()->set_xmin(rect.x);
+    location_data->mutable_bounding_box()->set_ymin(rect.y);
+    location_data->mutable_bounding_box()->set_width(rect.width);
+    location_data->mutable_bounding_box()->set_height(rect.height);
+  }
+  return mediapipe::MakePacket<std::vector<Detection>>(detections).At(
+      Timestamp(0));
+}
+
+std::unique_ptr<ImageFrame> MakeFrame(ImageFormat::Format format, int width,
+                                      int height) {
+  auto frame = std::make_unique<ImageFrame>(format, width, height);
+  cv::Mat mat = MatView(frame.get());
+  cv::randu(mat, cv::Scalar::all(0), cv::Scalar::all(255));
+  return frame;
+}
+
+// Runs the calculator on a new frame in each iteration, together with the
+// given faces.
+void RunCalculator(benchmark::State& state, const std::string& node_config,
+                   const std::string& frame_tag, const std::string& faces_tag,
+                   const mediapipe::Packet& faces_packet) {
+  const auto node =
+      mediapipe::ParseTextProtoOrDie<CalculatorGraphConfig::Node>(node_config);
+
+  for (auto _ : state) {
+    state.PauseTiming();
+    CalculatorRunner runner(node);
+    runner.MutableInputs()->Tag(faces_tag).packets.push_back(faces_packet);
+    runner.MutableInputs()->Tag(frame_tag).packets.push_back(
+        mediapipe::Adopt(
+            MakeFrame(ImageFormat::SRGB, kFrameWidth, kFrameHeight).release())
+            .At(Timestamp(0)));
+    state.ResumeTiming();
+
+    if (!runner.Run().ok()) {
+      state.SkipWithError("Failed to run the calculator.");
+      break;
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+void BM_SimpleBlurCalculatorCpu(benchmark::State& state) {
+  const int num_faces = state.range(0);
+  const int num_threads = state.range(1);
+  RunCalculator(state,
+                absl::Substitute(kSimpleBlurNode, num_threads,
+                                 /*crowd_mode=*/false),
+                "FRAMES", "DETECTIONS",
+                MakeDetectionsPacket(num_faces, kCellSize));
+}
+
+void BM_SimpleBlurCalculatorCpuCrowd(benchmark::State& state) {
+  const int num_faces = state.range(0);
+  const bool crowd_mode = state.range(1);
+  RunCalculator(state,
+                absl::Substitute(kSimpleBlurNode, /*num_threads=*/1,
+                                 crowd_mode),
+                "FRAMES", "DETECTIONS",
+                MakeDetectionsPacket(num_faces, kCrowdCellSize));
+}
+
+void BM_SpriteCalculatorCpu(benchmark::State& state) {
+  const int num_faces = state.range(0);
+  const int num_threads = state.range(1);
+  const mediapipe::Packet sticker =
+      mediapipe::Adopt(
+          MakeFrame(ImageFormat::SRGBA, kFaceSize, kFaceSize).release())
+          .At(Timestamp(0));
+  SpriteList sprites;
+  for (int i = 0; i < num_faces; ++i) {
+    const cv::Rect rect = FaceRect(i);
+    SpritePose pose;
+    pose.set_position_x((rect.x + 0.5f * rect.width) / kFrameWidth);
+    pose.set_position_y((rect.y + 0.5f * rect.height) / kFrameHeight);
+    pose.set_rotation_radians(0.1f * i);
+    sprites.push_back(SpriteListElement(sticker, pose));
+  }
+  RunCalculator(state, absl::Substitute(kSpriteNode, num_threads), "IMAGE",
+                "SPRITES",
+                mediapipe::MakePacket<SpriteList>(sprites).At(Timestamp(0)));
+}
+
+// Face counts from 1 to 100, each on 1 and 4 threads.
+void FaceCountsAndThreads(benchmark::internal::Benchmark* benchmark) {
+  for (const int num_faces : {1, 10, 30, 60, 100}) {
+    for (const int num_threads : {1, 4}) {
+      benchmark->Args({num_faces, num_threads});
+    }
+  }
+  benchmark->ArgNames({"faces", "threads"})->UseRealTime();
+}
+
+// Crowds of 100 to 600 faces, with and without crowd mode.
+void CrowdSizesAndModes(benchmark::internal::Benchmark* benchmark) {
+  for (const int num_faces : {100, 300, 600}) {
+    for (const int crowd_mode : {0, 1}) {
+      benchmark->Args({num_faces, crowd_mode});
+    }
+  }
+  benchmark->ArgNames({"faces", "crowd_mode"})->UseRealTime();
+}
+
+BENCHMARK(BM_SimpleBlurCalculatorCpu)->Apply(FaceCountsAndThreads);
+BENCHMARK(BM_SimpleBlurCalculatorCpuCrowd)->Apply(CrowdSizesAndModes);
+BENCHMARK(BM_SpriteCalculatorCpu)->Apply(FaceCountsAndThreads);
+
+}  // namespace
+}  // namespace magritte
+
+BENCHMARK_MAIN();
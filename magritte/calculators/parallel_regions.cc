@@ -0,0 +1,97 @@
+//
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+#include "magritte/calculators/parallel_regions.h"
+
+#include <algorithm>
+#include <functional>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/synchronization/blocking_counter.h"
+#include "mediapipe/framework/port/status.h"
+#include "mediapipe/framework/port/threadpool.h"
+#include  <opencv2/core.hpp>
+
+namespace magritte {
+
+std::vector<std::vector<int>> GroupIntoNonOverlappingWaves(
+    const std::vector<cv::Rect>& regions) {
+  std::vector<int> wave_of_region(regions.size(), 0);
+  std::vector<std::vector<int>> waves;
+  const int num_regions = static_cast<int>(regions.size());
+  for (int i = 0; i < num_regions; ++i) {
+    int wave = 0;
+    for (int j = 0; j < i; ++j) {
+      if ((regions[i] & regions[j]).area() > 0) {
+        wave = std::max(wave, wave_of_region[j] + 1);
+      }
+    }
+    wave_of_region[i] = wave;
+    if (wave == static_cast<int>(waves.size())) {
+      waves.emplace_back();
+    }
+    waves[wave].push_back(i);
+  }
+  return waves;
+}
+
+absl::Status ParallelFor(int n, mediapipe::ThreadPool* thread_pool,
+                         const std::function<absl::Status(int)>& process) {
+  if (thread_pool == nullptr || n <= 1) {
+    for (int i = 0; i < n; ++i) {
+      MP_RETURN_IF_ERROR(process(i));
+    }
+    return absl::OkStatus();
+  }
+
+  std::vector<absl::Status> statuses(n);
+  // The calling thread makes the last call itself instead of idling while it
+  // waits for the others.
+  absl::BlockingCounter remaining(n - 1);
+  for (int i = 0; i + 1 < n; ++i) {
+    thread_pool->Schedule([&process, &statuses, &remaining, i] {
+      statuses[i] = process(i);
+      remaining.DecrementCount();
+    });
+  }
+  statuses[n - 1] = process(n - 1);
+  remaining.Wait();
+
+  for (const absl::Status& status : statuses) {
+    MP_RETURN_IF_ERROR(status);
+  }
+  return absl::OkStatus();
+}
+
+absl::Status ProcessRegionsInParallel(
+    const std::vector<cv::Rect>& regions, mediapipe::ThreadPool* thread_pool,
+    const std::function<absl::Status(int)>& process) {
+  const int num_regions = static_cast<int>(regions.size());
+  if (thread_pool == nullptr || num_regions <= 1) {
+    for (int i = 0; i < num_regions; ++i) {
+      MP_RETURN_IF_ERROR(process(i));
+    }
+    return absl::OkStatus();
+  }
+
+  for (const std::vector<int>& wave : GroupIntoNonOverlappingWaves(regions)) {
+    MP_RETURN_IF_ERROR(ParallelFor(wave.size(), thread_pool,
+                                   [&](int k) { return process(wave[k]); }));
+  }
+  return absl::OkStatus();
+}
+
+}  // namespace magritte
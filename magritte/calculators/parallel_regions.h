@@ -0,0 +1,63 @@
+//
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+#ifndef MAGRITTE_CALCULATORS_PARALLEL_REGIONS_H_
+#define MAGRITTE_CALCULATORS_PARALLEL_REGIONS_H_
+
+#include <functional>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "mediapipe/framework/port/threadpool.h"
+#include  <opencv2/core.hpp>
+
+namespace magritte {
+
+// Groups the indices of the given regions into waves, such that no two regions
+// of the same wave overlap and each region comes in a later wave than all
+// earlier regions that it overlaps. Empty regions overlap nothing.
+//
+// Processing the waves one after another, and the regions of each wave in any
+// order, therefore gives the same result as processing all regions in order.
+std::vector<std::vector<int>> GroupIntoNonOverlappingWaves(
+    const std::vector<cv::Rect>& regions);
+
+// Calls `process` with each index from 0 to `n` - 1, all in parallel on the
+// thread pool, and waits until all calls have returned. The calling thread
+// makes one of the calls itself.
+//
+// If the thread pool is nullptr, the calls are made in order on the calling
+// thread, stopping at the first error. Otherwise, all calls are made and the
+// error of the failing call with the lowest index is returned.
+absl::Status ParallelFor(int n, mediapipe::ThreadPool* thread_pool,
+                         const std::function<absl::Status(int)>& process);
+
+// Calls `process` with the index of each of the given regions. Regions that
+// don't overlap are processed in parallel on the thread pool; overlapping
+// regions are processed in the order of their indices. `regions` must contain
+// every pixel that `process` reads or writes for the corresponding index. Use
+// ParallelFor instead for independent calls that don't touch a shared image.
+// Empty regions overlap nothing, so they are processed in the first wave.
+//
+// If the thread pool is nullptr, all regions are processed in order on the
+// calling thread. Stops after the first wave with a failing region and returns
+// its error.
+absl::Status ProcessRegionsInParallel(
+    const std::vector<cv::Rect>& regions, mediapipe::ThreadPool* thread_pool,
+    const std::function<absl::Status(int)>& process);
+
+}  // namespace magritte
+
+#endif  // MAGRITTE_CALCULATORS_PARALLEL_REGIONS_H_
@@ -0,0 +1,133 @@
+//
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+#include "magritte/calculators/parallel_regions.h"
+
+#include <atomic>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "mediapipe/framework/port/gmock.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/status_matchers.h"
+#include "mediapipe/framework/port/threadpool.h"
+#include  <opencv2/core.hpp>
+
+namespace magritte {
+namespace {
+
+using ::testing::ElementsAre;
+using ::testing::IsEmpty;
+
+TEST(GroupIntoNonOverlappingWavesTest, NoRegions) {
+  EXPECT_THAT(GroupIntoNonOverlappingWaves({}), IsEmpty());
+}
+
+TEST(GroupIntoNonOverlappingWavesTest, DisjointRegionsShareAWave) {
+  EXPECT_THAT(GroupIntoNonOverlappingWaves({cv::Rect(0, 0, 10, 10),
+                                            cv::Rect(10, 0, 10, 10),
+                                            cv::Rect(0, 10, 10, 10)}),
+              ElementsAre(ElementsAre(0, 1, 2)));
+}
+
+TEST(GroupIntoNonOverlappingWavesTest, OverlappingRegionsKeepTheirOrder) {
+  // Region 1 overlaps region 0, and region 2 overlaps region 1 but not 0.
+  // Region 3 overlaps nothing and can be processed right away.
+  EXPECT_THAT(GroupIntoNonOverlappingWaves(
+                  {cv::Rect(0, 0, 10, 10), cv::Rect(5, 0, 10, 10),
+                   cv::Rect(12, 0, 10, 10), cv::Rect(100, 100, 5, 5)}),
+              ElementsAre(ElementsAre(0, 3), ElementsAre(1), ElementsAre(2)));
+}
+
+TEST(GroupIntoNonOverlappingWavesTest, EmptyRegionsOverlapNothing) {
+  EXPECT_THAT(GroupIntoNonOverlappingWaves(
+                  {cv::Rect(0, 0, 10, 10), cv::Rect(), cv::Rect(5, 5, 0, 0)}),
+              ElementsAre(ElementsAre(0, 1, 2)));
+}
+
+TEST(ParallelForTest, CallsEachIndexOnce) {
+  mediapipe::ThreadPool thread_pool(4);
+  thread_pool.StartWorkers();
+  std::vector<std::atomic<int>> num_calls(20);
+
+  MP_ASSERT_OK(ParallelFor(num_calls.size(), &thread_pool, [&](int i) {
+    ++num_calls[i];
+    return absl::OkStatus();
+  }));
+
+  for (const std::atomic<int>& n : num_calls) {
+    EXPECT_EQ(n, 1);
+  }
+}
+
+TEST(ParallelForTest, ReturnsErrorWithLowestIndex) {
+  mediapipe::ThreadPool thread_pool(4);
+  thread_pool.StartWorkers();
+  const absl::Status status = ParallelFor(5, &thread_pool, [](int i) {
+    if (i == 1) return absl::InternalError("first");
+    if (i == 3) return absl::UnknownError("second");
+    return absl::OkStatus();
+  });
+
+  EXPECT_EQ(status.code(), absl::StatusCode::kInternal);
+}
+
+TEST(ProcessRegionsInParallelTest, SameResultAsSequential) {
+  // Each region adds its index + 1 to its pixels and then multiplies them by
+  // two, so the result depends on the order overlapping regions are processed.
+  std::vector<cv::Rect> regions;
+  for (int i = 0; i < 50; ++i) {
+    regions.push_back(cv::Rect((i * 37) % 90, (i * 53) % 90, 10, 10));
+  }
+  auto process = [&regions](cv::Mat* mat, int i) {
+    cv::Mat roi = (*mat)(regions[i]);
+    roi += i + 1;
+    roi *= 2;
+    return absl::OkStatus();
+  };
+
+  cv::Mat expected(100, 100, CV_32SC1, cv::Scalar(0));
+  MP_ASSERT_OK(ProcessRegionsInParallel(
+      regions, /*thread_pool=*/nullptr,
+      [&](int i) { return process(&expected, i); }));
+
+  mediapipe::ThreadPool thread_pool(4);
+  thread_pool.StartWorkers();
+  cv::Mat actual(100, 100, CV_32SC1, cv::Scalar(0));
+  MP_ASSERT_OK(ProcessRegionsInParallel(
+      regions, &thread_pool, [&](int i) { return process(&actual, i); }));
+
+  EXPECT_EQ(cv::countNonZero(actual != expected), 0);
+}
+
+TEST(ProcessRegionsInParallelTest, ReturnsError) {
+  mediapipe::ThreadPool thread_pool(4);
+  thread_pool.StartWorkers();
+  std::atomic<int> num_processed = 0;
+  const absl::Status status = ProcessRegionsInParallel(
+      {cv::Rect(0, 0, 10, 10), cv::Rect(20, 0, 10, 10),
+       cv::Rect(0, 0, 10, 10)},
+      &thread_pool, [&num_processed](int i) {
+        ++num_processed;
+        return i == 1 ? absl::InternalError("failed") : absl::OkStatus();
+      });
+
+  EXPECT_EQ(status.code(), absl::StatusCode::kInternal);
+  // The second wave is not processed after the first one failed.
+  EXPECT_EQ(num_processed, 2);
+}
+
+}  // namespace
+}  // namespace magritte
@@ -21,28 +21,42 @@
 #include "mediapipe/framework/calculator_framework.h"
 #include "mediapipe/framework/formats/image_frame.h"
 #include "mediapipe/framework/formats/image_frame_opencv.h"
+#include "mediapipe/framework/formats/yuv_image.h"
+#include "magritte/calculators/image_frame_pool.h"
+#include "magritte/calculators/image_frame_pool_service.h"
+#include "magritte/calculators/image_frame_util.h"
 #include "magritte/calculators/pixelization_calculator.pb.h"
+#include "magritte/calculators/yuv_image_util.h"
+#include "mediapipe/framework/port/status.h"
 #include  <opencv2/core.hpp>
 #include  <opencv2/imgproc.hpp>
 
 namespace magritte {
 
 constexpr char kFramesTag[] = "FRAMES";
+constexpr char kYuvFramesTag[] = "YUV_FRAMES";
 
 using ::mediapipe::CalculatorBase;
 using ::mediapipe::CalculatorContext;
 using ::mediapipe::CalculatorContract;
 using ::mediapipe::ImageFrame;
+using ::mediapipe::YUVImage;
 using ::mediapipe::formats::MatView;
 // A calculator that applies pixelization to the whole input image. The total
 // number of pixels that should have the same color after pixelization is given
 // as a parameter. The ignore_mask parameter is ignored.
 //
+// YUVImages are pixelized plane by plane, without conversion. The subsampled
+// chroma planes are divided into as many cells as the luma plane, so that the
+// cells of all planes cover the same pixels.
+//
 // Inputs:
-// - FRAMES: An ImageFrame stream, containing the input images.
+// - FRAMES or YUV_FRAMES: An ImageFrame or YUVImage stream, containing the
+//   input images.
 //
 // Outputs:
-// - FRAMES: An ImageFrame stream, containing the pixelized images.
+// - FRAMES or YUV_FRAMES: An ImageFrame or YUVImage stream, matching the input,
+//   containing the pixelized images.
 //
 // Example config:
 // node {
@@ -63,8 +77,18 @@ class PixelizationCalculatorCpu : public CalculatorBase {
 
   static absl::Status GetContract(CalculatorContract* cc) {
     const auto& options = cc->Options<PixelizationCalculatorOptions>();
-    cc->Inputs().Tag(kFramesTag).Set<ImageFrame>();
-    cc->Outputs().Tag(kFramesTag).Set<ImageFrame>();
+    RET_CHECK(cc->Inputs().HasTag(kFramesTag) ^
+              cc->Inputs().HasTag(kYuvFramesTag))
+        << "Exactly one of " << kFramesTag << " or " << kYuvFramesTag
+        << " input tags must be set.";
+    if (cc->Inputs().HasTag(kFramesTag)) {
+      cc->Inputs().Tag(kFramesTag).Set<ImageFrame>();
+      cc->Outputs().Tag(kFramesTag).Set<ImageFrame>();
+    } else {
+      cc->Inputs().Tag(kYuvFramesTag).Set<YUVImage>();
+      cc->Outputs().Tag(kYuvFramesTag).Set<YUVImage>();
+    }
+    UseImageFramePoolService(cc);
     // No input side packets.
     // Check if Median filter options are set correctly
     RET_CHECK(!options.median_filter_enabled() ||
@@ -74,6 +98,7 @@ class PixelizationCalculatorCpu : public CalculatorBase {
   }
 
   absl::Status Open(CalculatorContext* cc) override {
+    pool_ = GetImageFramePool(cc);
     return absl::OkStatus();
   }
 
@@ -103,6 +128,9 @@ class PixelizationCalculatorCpu : public CalculatorBase {
   }
 
   absl::Status Process(CalculatorContext* cc) override {
+    if (cc->Inputs().HasTag(kYuvFramesTag)) {
+      return ProcessYuv(cc);
+    }
     const auto& options = cc->Options<PixelizationCalculatorOptions>();
 
     if (cc->Inputs().Tag(kFramesTag).Value().IsEmpty()) {
@@ -110,28 +138,63 @@ class PixelizationCalculatorCpu : public CalculatorBase {
       return absl::OkStatus();
     }
 
-    const auto& frame = cc->Inputs().Tag(kFramesTag).Get<ImageFrame>();
+    // Pixelization is applied in place. The input frame is only copied if
+    // other calculators might want to access it still.
+    ASSIGN_OR_RETURN(std::unique_ptr<ImageFrame> output_frame,
+                     ConsumeOrCopyImageFrame(cc, cc->Inputs().Tag(kFramesTag),
+                                             pool_.get()));
 
-    // We need to copy the original frame because other calculators might want
-    // to access it still.
-    std::unique_ptr<ImageFrame> output_frame(
-        new ImageFrame(frame.Format(), frame.Width(), frame.Height()));
-    output_frame->CopyFrom(frame, ImageFrame::kDefaultAlignmentBoundary);
-
-    const int width = frame.Width();
-    const int height = frame.Height();
+    const int width = output_frame->Width();
+    const int height = output_frame->Height();
     // Subdivide the screen into x by y regions.
     std::pair<int, int> scaled_down_size =
         getScaledDownSize(width, height, options);
-    int x = scaled_down_size.first;
-    int y = scaled_down_size.second;
+    Pixelize(options, scaled_down_size.first, scaled_down_size.second,
+             MatView(output_frame.get()));
+
+    cc->Outputs().Tag(kFramesTag).Add(output_frame.release(),
+                                    cc->InputTimestamp());
+    return absl::OkStatus();
+  }
+
+ private:
+  absl::Status ProcessYuv(CalculatorContext* cc) {
+    const auto& options = cc->Options<PixelizationCalculatorOptions>();
+
+    if (cc->Inputs().Tag(kYuvFramesTag).Value().IsEmpty()) {
+      LOG(WARNING) << "No YUV image at " << cc->InputTimestamp();
+      return absl::OkStatus();
+    }
+
+    // As for ImageFrames, pixelization is applied in place.
+    ASSIGN_OR_RETURN(
+        std::unique_ptr<YUVImage> output_image,
+        ConsumeOrCopyYuvImage(cc, cc->Inputs().Tag(kYuvFramesTag)));
+    ASSIGN_OR_RETURN(const YuvPlanes planes, GetYuvPlanes(*output_image));
+    std::pair<int, int> scaled_down_size = getScaledDownSize(
+        output_image->width(), output_image->height(), options);
+    for (const cv::Mat& plane : planes) {
+      Pixelize(options, scaled_down_size.first, scaled_down_size.second,
+               plane);
+    }
+
+    cc->Outputs().Tag(kYuvFramesTag).Add(output_image.release(),
+                                         cc->InputTimestamp());
+    return absl::OkStatus();
+  }
+
+  // Pixelizes the given image, or plane of an image, in place by subdividing
+  // it into x by y regions.
+  static void Pixelize(const PixelizationCalculatorOptions& options, int x,
+                       int y, cv::Mat src) {
+    const int width = src.cols;
+    const int height = src.rows;
     // Apply resizing to pixelize the image.
-    cv::Mat src = MatView(output_frame.get());
     cv::Mat dest(cv::Size(x, y), src.type());
     cv::resize(src, dest, cv::Size(x, y), 1, 1, cv::INTER_NEAREST);
     // Apply Median Filter
     if (options.median_filter_enabled()) {
-      cv::medianBlur(dest, dest, options.median_filter_ksize());
+      MedianBlur(options.median_filter_ksize(), &dest);
     }
     switch (options.blend_method()) {
       case PixelizationCalculatorOptions::DEFAULT:
@@ -145,11 +208,26 @@ class PixelizationCalculatorCpu : public CalculatorBase {
         cv::resize(dest, src, cv::Size(width, height), 1, 1, cv::INTER_CUBIC);
         break;
     }
+  }
 
-    cc->Outputs().Tag(kFramesTag).Add(output_frame.release(),
-                                    cc->InputTimestamp());
-    return absl::OkStatus();
+  // Applies a median filter. OpenCV doesn't support two-channel matrices, as
+  // the interleaved chroma planes of NV12 images, so those are filtered
+  // channel by channel.
+  static void MedianBlur(int ksize, cv::Mat* mat) {
+    if (mat->channels() != 2) {
+      cv::medianBlur(*mat, *mat, ksize);
+      return;
+    }
+    std::vector<cv::Mat> channels;
+    cv::split(*mat, channels);
+    for (cv::Mat& channel : channels) {
+      cv::medianBlur(channel, channel, ksize);
+    }
+    cv::merge(channels, *mat);
   }
+
+  // Provides the buffers of copied input frames.
+  std::shared_ptr<ImageFramePool> pool_;
 };
 
 REGISTER_CALCULATOR(PixelizationCalculatorCpu);
@@ -0,0 +1,344 @@
+//
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "magritte/calculators/rects_to_mask_calculator.pb.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/formats/image_frame.h"
+#include "mediapipe/framework/formats/image_frame_opencv.h"
+#include "mediapipe/framework/formats/rect.pb.h"
+#include "mediapipe/framework/formats/yuv_image.h"
+#include "mediapipe/framework/port/ret_check.h"
+#include "mediapipe/framework/port/status.h"
+#include  <opencv2/core.hpp>
+#include  <opencv2/imgproc.hpp>
+
+#if !defined(MEDIAPIPE_DISABLE_GPU)
+#include "mediapipe/gpu/gl_calculator_helper.h"
+#endif  //  !MEDIAPIPE_DISABLE_GPU
+
+namespace magritte {
+namespace {
+using ::mediapipe::CalculatorBase;
+using ::mediapipe::CalculatorContext;
+using ::mediapipe::CalculatorContract;
+using ::mediapipe::ImageFormat;
+using ::mediapipe::ImageFrame;
+using ::mediapipe::NormalizedRect;
+using ::mediapipe::YUVImage;
+using ::mediapipe::formats::MatView;
+#if !defined(MEDIAPIPE_DISABLE_GPU)
+using ::mediapipe::GlTexture;
+using ::mediapipe::GpuBuffer;
+#endif  //  !MEDIAPIPE_DISABLE_GPU
+
+constexpr char kImageTag[] = "IMAGE";
+constexpr char kImageGpuTag[] = "IMAGE_GPU";
+constexpr char kYuvImageTag[] = "YUV_IMAGE";
+constexpr char kNormRectsTag[] = "NORM_RECTS";
+constexpr char kMaskTag[] = "MASK";
+constexpr char kMaskGpuTag[] = "MASK_GPU";
+
+// Suffix of the counter of masks reused from the previous frame, after the
+// node name.
+constexpr char kCachedMasksCounterSuffix[] = "/CachedMasks";
+
+bool IsClose(const NormalizedRect& a, const NormalizedRect& b,
+             float tolerance) {
+  return std::abs(a.x_center() - b.x_center()) <= tolerance &&
+         std::abs(a.y_center() - b.y_center()) <= tolerance &&
+         std::abs(a.width() - b.width()) <= tolerance &&
+         std::abs(a.height() - b.height()) <= tolerance &&
+         std::abs(a.rotation() - b.rotation()) <= tolerance;
+}
+
+cv::RotatedRect ToRotatedRect(const NormalizedRect& rect, const cv::Mat& mask) {
+  return cv::RotatedRect(
+      cv::Point2f(rect.x_center() * mask.cols, rect.y_center() * mask.rows),
+      cv::Size2f(rect.width() * mask.cols, rect.height() * mask.rows),
+      rect.rotation() * 180.0f / M_PI);
+}
+
+// Returns the pixels that the oval of the rect may cover, with a margin for
+// rounding.
+cv::Rect OvalBounds(const NormalizedRect& rect, const cv::Mat& mask) {
+  cv::Rect bounds = ToRotatedRect(rect, mask).boundingRect();
+  bounds -= cv::Point(1, 1);
+  bounds += cv::Size(2, 2);
+  return bounds & cv::Rect(0, 0, mask.cols, mask.rows);
+}
+
+void DrawOval(const NormalizedRect& rect, cv::Mat& mask) {
+  cv::ellipse(mask, ToRotatedRect(rect, mask), cv::Scalar::all(255),
+              cv::FILLED);
+}
+}  // namespace
+
+// A calculator that draws a mask with a white oval inscribed in each rect, on a
+// black background, e.g. the rects of FaceDetectionToNormalizedRectSubgraph.
+//
+// The mask is cached across frames: when every rect is within the tolerance of
+// a rect of the cached mask, the cached mask packet is output again without
+// drawing anything. Otherwise, only the regions of the ovals that were added or
+// removed are cleared and redrawn, on a copy of the cached mask. The rects that
+// did not change keep their cached oval, so that a slow drift is eventually
+// redrawn once it exceeds the tolerance.
+//
+// On GPU, the mask is drawn on CPU and only uploaded when it changes.
+//
+// Inputs:
+// - IMAGE or IMAGE_GPU: An ImageFrame or GpuBuffer stream, giving the size of
+//   the mask. On CPU, the mask has the same format, which must be SRGB, SRGBA
+//   or GRAY8. On GPU, it is SRGBA.
+// - YUV_IMAGE: A YUVImage stream, instead of IMAGE, only giving the size of the
+//   mask, which is GRAY8 on CPU.
+// - NORM_RECTS: The rects as a std::vector<NormalizedRect>. Empty rects are
+//   ignored.
+//
+// Outputs:
+// - MASK or MASK_GPU: An ImageFrame or GpuBuffer stream, containing the mask.
+//
+// Options:
+// - tolerance: The largest difference of the center, size and rotation (in
+//   radians) of a rect, normalized by the image size, for its oval not to be
+//   redrawn. Default is 0.002.
+// - scale_factor: The scale of the mask relative to the input image. Default is
+//   1.
+//
+// Example config:
+// node {
+//   calculator: "RectsToMaskCalculator"
+//   input_stream: "IMAGE:input_video"
+//   input_stream: "NORM_RECTS:rects"
+//   output_stream: "MASK:mask"
+//   options: {
+//     [magritte.RectsToMaskCalculatorOptions.ext] {
+//       tolerance: 0.002
+//     }
+//   }
+// }
+class RectsToMaskCalculator : public CalculatorBase {
+ public:
+  RectsToMaskCalculator() = default;
+  ~RectsToMaskCalculator() override = default;
+
+  static absl::Status GetContract(CalculatorContract* cc) {
+    RET_CHECK_EQ(cc->Inputs().HasTag(kImageTag) +
+                     cc->Inputs().HasTag(kImageGpuTag) +
+                     cc->Inputs().HasTag(kYuvImageTag),
+                 1)
+        << "Calculator can have one and only one image input.";
+    RET_CHECK(cc->Inputs().HasTag(kNormRectsTag))
+        << "Missing input " << kNormRectsTag << " tag.";
+    cc->Inputs().Tag(kNormRectsTag).Set<std::vector<NormalizedRect>>();
+    if (cc->Inputs().HasTag(kImageTag)) {
+      cc->Inputs().Tag(kImageTag).Set<ImageFrame>();
+      RET_CHECK(cc->Outputs().HasTag(kMaskTag))
+          << "Missing output " << kMaskTag << " tag.";
+      cc->Outputs().Tag(kMaskTag).Set<ImageFrame>();
+    }
+    if (cc->Inputs().HasTag(kYuvImageTag)) {
+      cc->Inputs().Tag(kYuvImageTag).Set<YUVImage>();
+      RET_CHECK(cc->Outputs().HasTag(kMaskTag))
+          << "Missing output " << kMaskTag << " tag.";
+      cc->Outputs().Tag(kMaskTag).Set<ImageFrame>();
+    }
+#if !defined(MEDIAPIPE_DISABLE_GPU)
+    if (cc->Inputs().HasTag(kImageGpuTag)) {
+      cc->Inputs().Tag(kImageGpuTag).Set<GpuBuffer>();
+      RET_CHECK(cc->Outputs().HasTag(kMaskGpuTag))
+          << "Missing output " << kMaskGpuTag << " tag.";
+      cc->Outputs().Tag(kMaskGpuTag).Set<GpuBuffer>();
+    }
+    MP_RETURN_IF_ERROR(mediapipe::GlCalculatorHelper::UpdateContract(cc));
+#endif  //  !MEDIAPIPE_DISABLE_GPU
+    // No input side packets.
+    return absl::OkStatus();
+  }
+
+  absl::Status Open(CalculatorContext* cc) override {
+    cc->SetOffset(mediapipe::TimestampDiff(0));
+    const auto& options = cc->Options<RectsToMaskCalculatorOptions>();
+    RET_CHECK_GE(options.tolerance(), 0.0f)
+        << "tolerance must be non-negative.";
+    RET_CHECK_GT(options.scale_factor(), 0.0f)
+        << "scale_factor must be positive.";
+    tolerance_ = options.tolerance();
+    scale_factor_ = options.scale_factor();
+    use_gpu_ = cc->Inputs().HasTag(kImageGpuTag);
+#if !defined(MEDIAPIPE_DISABLE_GPU)
+    if (use_gpu_) {
+      return helper_.Open(cc);
+    }
+#endif  //  !MEDIAPIPE_DISABLE_GPU
+    return absl::OkStatus();
+  }
+
+  absl::Status Process(CalculatorContext* cc) override {
+    int width = 0;
+    int height = 0;
+    ImageFormat::Format format = ImageFormat::SRGBA;
+    if (use_gpu_) {
+#if !defined(MEDIAPIPE_DISABLE_GPU)
+      const auto& input = cc->Inputs().Tag(kImageGpuTag).Get<GpuBuffer>();
+      width = input.width();
+      height = input.height();
+#endif  //  !MEDIAPIPE_DISABLE_GPU
+    } else if (cc->Inputs().HasTag(kYuvImageTag)) {
+      const auto& input = cc->Inputs().Tag(kYuvImageTag).Get<YUVImage>();
+      width = input.width();
+      height = input.height();
+      format = ImageFormat::GRAY8;
+    } else {
+      const auto& input = cc->Inputs().Tag(kImageTag).Get<ImageFrame>();
+      width = input.Width();
+      height = input.Height();
+      format = input.Format();
+      RET_CHECK(format == ImageFormat::SRGB || format == ImageFormat::SRGBA ||
+                format == ImageFormat::GRAY8)
+          << "Unsupported image format: " << format;
+    }
+    width = std::max(1, static_cast<int>(width * scale_factor_));
+    height = std::max(1, static_cast<int>(height * scale_factor_));
+
+    std::vector<NormalizedRect> rects;
+    if (!cc->Inputs().Tag(kNormRectsTag).IsEmpty()) {
+      for (const auto& rect :
+           cc->Inputs().Tag(kNormRectsTag).Get<std::vector<NormalizedRect>>()) {
+        if (rect.width() > 0.0f && rect.height() > 0.0f) {
+          rects.push_back(rect);
+        }
+      }
+    }
+
+    bool cached = false;
+    if (!mask_packet_.IsEmpty()) {
+      const auto& cached_mask = mask_packet_.Get<ImageFrame>();
+      cached = cached_mask.Format() == format &&
+               cached_mask.Width() == width && cached_mask.Height() == height;
+    }
+
+    std::vector<NormalizedRect> next_rects;
+    std::vector<NormalizedRect> changed_rects;
+    if (cached) {
+      // Matches each rect with a cached oval, which is kept as is.
+      const int num_drawn_rects = static_cast<int>(drawn_rects_.size());
+      std::vector<bool> matched(num_drawn_rects, false);
+      for (const auto& rect : rects) {
+        int match = -1;
+        for (int i = 0; i < num_drawn_rects; ++i) {
+          if (!matched[i] && IsClose(rect, drawn_rects_[i], tolerance_)) {
+            match = i;
+            break;
+          }
+        }
+        if (match >= 0) {
+          matched[match] = true;
+          next_rects.push_back(drawn_rects_[match]);
+        } else {
+          changed_rects.push_back(rect);
+          next_rects.push_back(rect);
+        }
+      }
+      for (int i = 0; i < num_drawn_rects; ++i) {
+        if (!matched[i]) {
+          changed_rects.push_back(drawn_rects_[i]);
+        }
+      }
+      if (changed_rects.empty()) {
+        cc->Outputs()
+            .Tag(use_gpu_ ? kMaskGpuTag : kMaskTag)
+            .AddPacket(output_packet_.At(cc->InputTimestamp()));
+        cc->GetCounter(absl::StrCat(cc->NodeName(), kCachedMasksCounterSuffix))
+            ->Increment();
+        return absl::OkStatus();
+      }
+    }
+
+    // The mask is only allocated once it has to be redrawn.
+    auto mask = std::make_unique<ImageFrame>(format, width, height);
+    cv::Mat mask_mat = MatView(mask.get());
+    const cv::Scalar background(0, 0, 0, 255);
+    if (cached) {
+      // The cached mask may still be used downstream, so it is copied.
+      MatView(&mask_packet_.Get<ImageFrame>()).copyTo(mask_mat);
+      std::vector<cv::Rect> dirty_regions;
+      for (const auto& rect : changed_rects) {
+        dirty_regions.push_back(OvalBounds(rect, mask_mat));
+        mask_mat(dirty_regions.back()).setTo(background);
+      }
+      // Redraws all the ovals that overlap a cleared region.
+      for (const auto& rect : next_rects) {
+        const cv::Rect bounds = OvalBounds(rect, mask_mat);
+        for (const auto& region : dirty_regions) {
+          if ((bounds & region).area() > 0) {
+            DrawOval(rect, mask_mat);
+            break;
+          }
+        }
+      }
+      drawn_rects_ = std::move(next_rects);
+    } else {
+      mask_mat.setTo(background);
+      for (const auto& rect : rects) {
+        DrawOval(rect, mask_mat);
+      }
+      drawn_rects_ = std::move(rects);
+    }
+
+    mask_packet_ = mediapipe::Adopt(mask.release()).At(cc->InputTimestamp());
+    if (!use_gpu_) {
+      output_packet_ = mask_packet_;
+      cc->Outputs().Tag(kMaskTag).AddPacket(output_packet_);
+      return absl::OkStatus();
+    }
+#if !defined(MEDIAPIPE_DISABLE_GPU)
+    return helper_.RunInGlContext([this, &cc]() -> absl::Status {
+      GlTexture texture =
+          helper_.CreateSourceTexture(mask_packet_.Get<ImageFrame>());
+      output_packet_ = mediapipe::Adopt(texture.GetFrame<GpuBuffer>().release())
+                           .At(cc->InputTimestamp());
+      glFlush();
+      texture.Release();
+      cc->Outputs().Tag(kMaskGpuTag).AddPacket(output_packet_);
+      return absl::OkStatus();
+    });
+#endif  //  !MEDIAPIPE_DISABLE_GPU
+    return absl::OkStatus();
+  }
+
+ private:
+  float tolerance_ = 0.0f;
+  float scale_factor_ = 1.0f;
+  bool use_gpu_ = false;
+#if !defined(MEDIAPIPE_DISABLE_GPU)
+  mediapipe::GlCalculatorHelper helper_;
+#endif  //  !MEDIAPIPE_DISABLE_GPU
+  // The cached mask as an ImageFrame, and the rects of its ovals.
+  mediapipe::Packet mask_packet_;
+  std::vector<NormalizedRect> drawn_rects_;
+  // The last output packet, an ImageFrame or GpuBuffer.
+  mediapipe::Packet output_packet_;
+};
+
+REGISTER_CALCULATOR(RectsToMaskCalculator);
+
+}  // namespace magritte
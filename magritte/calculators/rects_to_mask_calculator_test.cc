@@ -0,0 +1,187 @@
+//
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+#include <memory>
+#include <vector>
+
+#include  <opencv2/core.hpp>
+#include "magritte/calculators/rects_to_mask_calculator.pb.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/calculator_runner.h"
+#include "mediapipe/framework/formats/image_frame.h"
+#include "mediapipe/framework/formats/image_frame_opencv.h"
+#include "mediapipe/framework/formats/rect.pb.h"
+#include "mediapipe/framework/formats/yuv_image.h"
+#include "mediapipe/framework/port/gmock.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/parse_text_proto.h"
+#include "mediapipe/framework/port/status_matchers.h"
+#include "magritte/calculators/yuv_image_util.h"
+#include "libyuv/video_common.h"
+
+namespace magritte {
+namespace {
+
+using ::mediapipe::CalculatorRunner;
+using ::mediapipe::ImageFormat;
+using ::mediapipe::ImageFrame;
+using ::mediapipe::NormalizedRect;
+using ::mediapipe::Packet;
+using ::mediapipe::Timestamp;
+using ::mediapipe::YUVImage;
+using ::mediapipe::formats::MatView;
+
+constexpr char kNodeConfig[] = R"pb(
+  calculator: "RectsToMaskCalculator"
+  input_stream: "IMAGE:input_video"
+  input_stream: "NORM_RECTS:rects"
+  output_stream: "MASK:mask"
+  options {
+    [magritte.RectsToMaskCalculatorOptions.ext] { tolerance: 0.01 }
+  }
+)pb";
+
+NormalizedRect MakeRect(float x_center, float y_center, float size,
+                        float rotation) {
+  NormalizedRect rect;
+  rect.set_x_center(x_center);
+  rect.set_y_center(y_center);
+  rect.set_width(size);
+  rect.set_height(size);
+  rect.set_rotation(rotation);
+  return rect;
+}
+
+void AddFrame(const std::vector<NormalizedRect>& rects, int timestamp,
+              CalculatorRunner& runner) {
+  runner.MutableInputs()->Tag("IMAGE").packets.push_back(
+      mediapipe::Adopt(new ImageFrame(ImageFormat::SRGB, 320, 240))
+          .At(Timestamp(timestamp)));
+  runner.MutableInputs()->Tag("NORM_RECTS").packets.push_back(
+      mediapipe::MakePacket<std::vector<NormalizedRect>>(rects).At(
+          Timestamp(timestamp)));
+}
+
+// Returns the mask of the given rects, drawn from scratch.
+cv::Mat DrawMask(const std::vector<NormalizedRect>& rects) {
+  CalculatorRunner runner(
+      mediapipe::ParseTextProtoOrDie<mediapipe::CalculatorGraphConfig::Node>(
+          kNodeConfig));
+  AddFrame(rects, 0, runner);
+  EXPECT_TRUE(runner.Run().ok());
+  return MatView(&runner.Outputs().Tag("MASK").packets[0].Get<ImageFrame>())
+      .clone();
+}
+
+TEST(RectsToMaskCalculatorTest, ReusesMaskOfUnchangedRects) {
+  CalculatorRunner runner(
+      mediapipe::ParseTextProtoOrDie<mediapipe::CalculatorGraphConfig::Node>(
+          kNodeConfig));
+  const std::vector<NormalizedRect> rects = {MakeRect(0.3f, 0.5f, 0.2f, 0.0f),
+                                             MakeRect(0.7f, 0.5f, 0.2f, 0.5f)};
+  AddFrame(rects, 0, runner);
+  // Within the tolerance.
+  AddFrame({MakeRect(0.305f, 0.5f, 0.2f, 0.0f),
+            MakeRect(0.7f, 0.495f, 0.2f, 0.5f)},
+           1, runner);
+
+  MP_ASSERT_OK(runner.Run());
+  const auto& packets = runner.Outputs().Tag("MASK").packets;
+  ASSERT_EQ(packets.size(), 2);
+  EXPECT_EQ(&packets[0].Get<ImageFrame>(), &packets[1].Get<ImageFrame>());
+  EXPECT_EQ(packets[1].Timestamp(), Timestamp(1));
+  EXPECT_EQ(runner.GetCounter("RectsToMaskCalculator/CachedMasks")->Get(), 1);
+
+  const cv::Mat mask = MatView(&packets[0].Get<ImageFrame>());
+  EXPECT_EQ(cv::norm(mask, DrawMask(rects), cv::NORM_INF), 0.0);
+  EXPECT_EQ(mask.at<cv::Vec3b>(120, 96), cv::Vec3b(255, 255, 255));
+  EXPECT_EQ(mask.at<cv::Vec3b>(120, 160), cv::Vec3b(0, 0, 0));
+}
+
+TEST(RectsToMaskCalculatorTest, RedrawsChangedRects) {
+  CalculatorRunner runner(
+      mediapipe::ParseTextProtoOrDie<mediapipe::CalculatorGraphConfig::Node>(
+          kNodeConfig));
+  // Overlapping ovals, so that redrawing one must preserve the others.
+  AddFrame({MakeRect(0.3f, 0.5f, 0.3f, 0.0f), MakeRect(0.45f, 0.5f, 0.3f, 0.5f),
+            MakeRect(0.7f, 0.3f, 0.2f, 0.0f)},
+           0, runner);
+  // The second rect moves, the third one disappears and a fourth appears.
+  const std::vector<NormalizedRect> moved = {MakeRect(0.3f, 0.5f, 0.3f, 0.0f),
+                                             MakeRect(0.5f, 0.6f, 0.3f, 1.0f),
+                                             MakeRect(0.8f, 0.7f, 0.2f, 0.0f)};
+  AddFrame(moved, 1, runner);
+  AddFrame({}, 2, runner);
+
+  MP_ASSERT_OK(runner.Run());
+  const auto& packets = runner.Outputs().Tag("MASK").packets;
+  ASSERT_EQ(packets.size(), 3);
+  EXPECT_EQ(cv::norm(MatView(&packets[1].Get<ImageFrame>()), DrawMask(moved),
+                     cv::NORM_INF),
+            0.0);
+  EXPECT_EQ(cv::countNonZero(
+                MatView(&packets[2].Get<ImageFrame>()).reshape(1)),
+            0);
+  EXPECT_EQ(runner.GetCounter("RectsToMaskCalculator/CachedMasks")->Get(), 0);
+}
+
+TEST(RectsToMaskCalculatorTest, ScalesMask) {
+  auto node =
+      mediapipe::ParseTextProtoOrDie<mediapipe::CalculatorGraphConfig::Node>(
+          kNodeConfig);
+  node.mutable_options()
+      ->MutableExtension(RectsToMaskCalculatorOptions::ext)
+      ->set_scale_factor(0.5f);
+  CalculatorRunner runner(node);
+  AddFrame({MakeRect(0.5f, 0.5f, 0.2f, 0.0f)}, 0, runner);
+
+  MP_ASSERT_OK(runner.Run());
+  const auto& mask =
+      runner.Outputs().Tag("MASK").packets[0].Get<ImageFrame>();
+  EXPECT_EQ(mask.Width(), 160);
+  EXPECT_EQ(mask.Height(), 120);
+  EXPECT_EQ(MatView(&mask).at<cv::Vec3b>(60, 80), cv::Vec3b(255, 255, 255));
+}
+
+TEST(RectsToMaskCalculatorTest, TakesSizeOfYuvImages) {
+  CalculatorRunner runner(
+      mediapipe::ParseTextProtoOrDie<mediapipe::CalculatorGraphConfig::Node>(
+          R"pb(
+            calculator: "RectsToMaskCalculator"
+            input_stream: "YUV_IMAGE:input_video"
+            input_stream: "NORM_RECTS:rects"
+            output_stream: "MASK:mask"
+          )pb"));
+  ASSERT_OK_AND_ASSIGN(std::unique_ptr<YUVImage> image,
+                       MakeYuvImage(libyuv::FOURCC_I420, 320, 240));
+  runner.MutableInputs()->Tag("YUV_IMAGE").packets.push_back(
+      mediapipe::Adopt(image.release()).At(Timestamp(0)));
+  runner.MutableInputs()->Tag("NORM_RECTS").packets.push_back(
+      mediapipe::MakePacket<std::vector<NormalizedRect>>(
+          std::vector<NormalizedRect>{MakeRect(0.5f, 0.5f, 0.2f, 0.0f)})
+          .At(Timestamp(0)));
+
+  MP_ASSERT_OK(runner.Run());
+  const auto& mask =
+      runner.Outputs().Tag("MASK").packets[0].Get<ImageFrame>();
+  EXPECT_EQ(mask.Format(), ImageFormat::GRAY8);
+  EXPECT_EQ(mask.Width(), 320);
+  EXPECT_EQ(mask.Height(), 240);
+  EXPECT_EQ(MatView(&mask).at<uint8_t>(120, 160), 255);
+  EXPECT_EQ(MatView(&mask).at<uint8_t>(0, 0), 0);
+}
+
+}  // namespace
+}  // namespace magritte
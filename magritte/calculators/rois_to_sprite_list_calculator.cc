@@ -22,8 +22,10 @@
 #include "mediapipe/framework/formats/image_frame.h"
 #include "mediapipe/framework/formats/image_frame_opencv.h"
 #include "absl/memory/memory.h"
+#include "magritte/calculators/channel_order_service.h"
 #include "magritte/calculators/rois_to_sprite_list_calculator.pb.h"
 #include "magritte/calculators/sprite_list.h"
+#include "magritte/calculators/sprite_mipmap.h"
 #include "mediapipe/framework/formats/rect.pb.h"
 #include  <opencv2/imgproc.hpp>
 
@@ -74,6 +76,7 @@ absl::Status RoisToSpriteListCalculator::GetContract(CalculatorContract* cc) {
 
   if (cc->InputSidePackets().HasTag(kStickerImageCpuTag)) {
     cc->InputSidePackets().Tag(kStickerImageCpuTag).Set<ImageFrame>();
+    UseChannelOrderService(cc);
   }
 
 #if !defined(MEDIAPIPE_DISABLE_GPU)
@@ -105,14 +108,24 @@ absl::Status RoisToSpriteListCalculator::OpenCpu(CalculatorContext* cc) {
   sticker_packet_ = cc->InputSidePackets().Tag(kStickerImageCpuTag);
   cv::Mat sticker_mat = MatView(&(sticker_packet_.Get<ImageFrame>()));
   bool sticker_has_alpha = sticker_mat.channels() == 4;
+  // In graphs of BGR frames, the sticker is converted to BGR too.
+  const bool bgr = GetChannelOrder(cc) == ChannelOrder::kBgr;
 
   if (!sticker_has_alpha) {
     // Prevent black rectangle around the sticker if it is 3-channel.
     sticker_packet_ = MakePacket<ImageFrame>(
         ImageFormat::SRGBA, sticker_mat.cols, sticker_mat.rows);
     cv::Mat sticker_rgba = MatView(&(sticker_packet_.Get<ImageFrame>()));
-    cv::cvtColor(sticker_mat, sticker_rgba, cv::COLOR_RGB2RGBA);
+    cv::cvtColor(sticker_mat, sticker_rgba,
+                 bgr ? cv::COLOR_RGB2BGRA : cv::COLOR_RGB2RGBA);
   } else {
+    if (bgr) {
+      sticker_packet_ = MakePacket<ImageFrame>(
+          ImageFormat::SRGBA, sticker_mat.cols, sticker_mat.rows);
+      cv::Mat sticker_bgra = MatView(&(sticker_packet_.Get<ImageFrame>()));
+      cv::cvtColor(sticker_mat, sticker_bgra, cv::COLOR_RGBA2BGRA);
+      sticker_mat = sticker_bgra;
+    }
     const RoisToSpriteListCalculatorOptions& options =
         cc->Options<RoisToSpriteListCalculatorOptions>();
     if (!options.sticker_is_premultiplied()) {
@@ -120,6 +133,11 @@ absl::Status RoisToSpriteListCalculator::OpenCpu(CalculatorContext* cc) {
     }
   }
 
+  // Downscaled versions of the premultiplied sticker, built once so that
+  // drawing it much smaller than its size is cheap and doesn't alias.
+  mipmap_packet_ = MakePacket<SpriteMipmap>(
+      BuildSpriteMipmap(MatView(&(sticker_packet_.Get<ImageFrame>()))));
+
   return absl::OkStatus();
 }
 
@@ -188,6 +206,7 @@ absl::Status RoisToSpriteListCalculator::Process(CalculatorContext* cc) {
     pose.set_rotation_radians(roi.rotation());
     pose.set_scale(sticker_zoom_ * FindFitZoom(bg_size, sticker_size, roi));
     SpriteListElement element(sticker_packet_, pose);
+    element.mipmap_packet = mipmap_packet_;
     sprite_list->push_back(element);
   }
 
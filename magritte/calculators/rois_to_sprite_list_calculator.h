@@ -35,7 +35,9 @@ namespace magritte {
 // rotation. The sticker is then zoomed so to cover the entire ROI while
 // preserving aspect ratio. An extra default zoom given by the STICKER_ZOOM may
 // be applied to ensure that, e.g. stickers with transaparency indeed redact
-// the ROI.
+// the ROI. In CPU pipelines, the sprites also carry a mipmap of the sticker,
+// built once in Open, and the sticker is converted to BGR in graphs whose
+// kChannelOrderService is kBgr.
 //
 // Inputs:
 // - SIZE: The backgroud image size as a std::pair<int, int>.
@@ -89,6 +91,8 @@ class RoisToSpriteListCalculator : public mediapipe::CalculatorBase {
  private:
   float sticker_zoom_;
   mediapipe::Packet sticker_packet_;
+  // The SpriteMipmap of the sticker, in CPU pipelines only.
+  mediapipe::Packet mipmap_packet_;
 #if !defined(MEDIAPIPE_DISABLE_GPU)
   mediapipe::GlCalculatorHelper helper_;
   GLuint premultiply_program_;
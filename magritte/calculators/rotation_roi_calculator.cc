@@ -30,16 +30,20 @@ using ::mediapipe::CalculatorContract;
 using ::mediapipe::NormalizedRect;
 
 constexpr char kRegionOfInterestTag[] = "ROI";
+constexpr char kRotationDegreesTag[] = "ROTATION_DEGREES";
 }  // namespace
 
 absl::Status RotationRoiCalculator::GetContract(CalculatorContract* cc) {
   RET_CHECK(cc != nullptr) << "CalculatorContract is nullptr";
-  RET_CHECK(cc->Inputs().NumEntries() == 1)
-      << "Calculator must have one input (of any type).";
+  RET_CHECK(cc->Inputs().NumEntries("") == 1)
+      << "Calculator must have one untagged input (of any type).";
   RET_CHECK(cc->Outputs().HasTag(kRegionOfInterestTag))
         << "Calculator must have an output ROI.";
 
-  cc->Inputs().Get(cc->Inputs().BeginId()).SetAny();
+  cc->Inputs().Get("", 0).SetAny();
+  if (cc->Inputs().HasTag(kRotationDegreesTag)) {
+    cc->Inputs().Tag(kRotationDegreesTag).Set<int>();
+  }
   cc->Outputs().Tag(kRegionOfInterestTag).Set<NormalizedRect>();
 
   // No input side packets.
@@ -51,6 +55,19 @@ absl::Status RotationRoiCalculator::Open(CalculatorContext* cc) {
 }
 
 absl::Status RotationRoiCalculator::Process(CalculatorContext* cc) {
+  auto& output = cc->Outputs().Tag(kRegionOfInterestTag);
+  if (cc->Inputs().HasTag(kRotationDegreesTag) &&
+      !cc->Inputs().Tag(kRotationDegreesTag).IsEmpty()) {
+    const int rotation_degrees =
+        cc->Inputs().Tag(kRotationDegreesTag).Get<int>();
+    RET_CHECK_EQ(rotation_degrees % 90, 0)
+        << "Rotation must be a multiple of 90 degrees, got "
+        << rotation_degrees;
+    output.Add(new NormalizedRect(MakeRotatedRoi(rotation_degrees)),
+               cc->InputTimestamp());
+    return absl::OkStatus();
+  }
+
   const RotationCalculatorOptions& options =
       cc->Options<RotationCalculatorOptions>();
   RotationMode::Mode rotation_mode = options.rotation_mode();
@@ -68,35 +85,40 @@ absl::Status RotationRoiCalculator::Process(CalculatorContext* cc) {
     }
   }
 
-  // NormalizedRect::rotation is clockwise in radians.
-  float rotation_radians = 0.0;
+  int rotation_degrees = 0;
   switch (rotation_mode) {
     case RotationMode::ROTATION_90:
-      rotation_radians = M_PI / 2;
+      rotation_degrees = 90;
       break;
     case RotationMode::ROTATION_180:
-      rotation_radians = M_PI;
+      rotation_degrees = 180;
       break;
     case RotationMode::ROTATION_270:
-      rotation_radians = 3 * M_PI / 2;
+      rotation_degrees = 270;
       break;
     default:
       break;
   }
 
-  auto rect = std::make_unique<NormalizedRect>();
-  rect->set_x_center(0.5);
-  rect->set_y_center(0.5);
-  rect->set_height(1.0);
-  rect->set_width(1.0);
-  rect->set_rotation(rotation_radians);
-
-  auto& output = cc->Outputs().Tag(kRegionOfInterestTag);
-  output.Add(rect.release(), cc->InputTimestamp());
+  output.Add(new NormalizedRect(MakeRotatedRoi(rotation_degrees)),
+             cc->InputTimestamp());
 
   return absl::OkStatus();
 }
 
+// static
+NormalizedRect RotationRoiCalculator::MakeRotatedRoi(int rotation_degrees) {
+  // NormalizedRect::rotation is clockwise in radians.
+  const int quarter_turns = ((rotation_degrees / 90) % 4 + 4) % 4;
+  NormalizedRect rect;
+  rect.set_x_center(0.5);
+  rect.set_y_center(0.5);
+  rect.set_height(1.0);
+  rect.set_width(1.0);
+  rect.set_rotation(quarter_turns * M_PI / 2);
+  return rect;
+}
+
 REGISTER_CALCULATOR(RotationRoiCalculator);
 
 }  // namespace magritte
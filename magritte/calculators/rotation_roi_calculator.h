@@ -17,6 +17,7 @@
 #define MAGRITTE_CALCULATORS_ROTATION_ROI_CALCULATOR_H
 
 #include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/formats/rect.pb.h"
 
 namespace magritte {
 
@@ -25,6 +26,9 @@ namespace magritte {
 //
 // Inputs:
 // - (No tag required): A packet of any type, containing the timestamp.
+// - ROTATION_DEGREES (optional): The clockwise rotation of the ROI in degrees,
+//   as an int multiple of 90. When a packet is present, it overrides the
+//   rotation options, e.g. to follow the dominant orientation of a stream.
 //
 // Outputs:
 // - ROI: a NormalizedRect stream, containing the rotated region of interest.
@@ -53,6 +57,10 @@ class RotationRoiCalculator : public mediapipe::CalculatorBase {
   static absl::Status GetContract(mediapipe::CalculatorContract* cc);
   absl::Status Open(mediapipe::CalculatorContext* cc) override;
   absl::Status Process(mediapipe::CalculatorContext* cc) override;
+
+  // Returns a ROI covering the whole image, rotated clockwise by the given
+  // multiple of 90 degrees.
+  static mediapipe::NormalizedRect MakeRotatedRoi(int rotation_degrees);
 };
 
 }  // namespace magritte
@@ -28,6 +28,7 @@ namespace magritte {
 namespace {
 
 constexpr char kRegionOfInterestTag[] = "ROI";
+constexpr char kRotationDegreesTag[] = "ROTATION_DEGREES";
 
 struct RotationRoiTestCase {
   const std::string test_name;
@@ -122,5 +123,53 @@ INSTANTIATE_TEST_SUITE_P(
     }
 );
 
+TEST(RotationRoiCalculatorTest, RotationDegreesOverridesOptions) {
+  mediapipe::CalculatorRunner runner(
+      mediapipe::ParseTextProtoOrDie<mediapipe::CalculatorGraphConfig::Node>(
+          R"pb(
+            calculator: "RotationRoiCalculator"
+            input_stream: "input_stream"
+            input_stream: "ROTATION_DEGREES:rotation_degrees"
+            output_stream: "ROI:roi"
+            options {
+              [magritte.RotationCalculatorOptions.ext] {
+                rotation_mode: ROTATION_90
+                clockwise: true
+              }
+            }
+          )pb"));
+  // The first frame has no rotation, so the options apply.
+  runner.MutableInputs()->Get("", 0).packets.push_back(
+      mediapipe::MakePacket<int>(0).At(mediapipe::Timestamp(0)));
+  runner.MutableInputs()->Get("", 0).packets.push_back(
+      mediapipe::MakePacket<int>(0).At(mediapipe::Timestamp(1)));
+  runner.MutableInputs()->Get("", 0).packets.push_back(
+      mediapipe::MakePacket<int>(0).At(mediapipe::Timestamp(2)));
+  runner.MutableInputs()->Tag(kRotationDegreesTag).packets.push_back(
+      mediapipe::MakePacket<int>(180).At(mediapipe::Timestamp(1)));
+  runner.MutableInputs()->Tag(kRotationDegreesTag).packets.push_back(
+      mediapipe::MakePacket<int>(-90).At(mediapipe::Timestamp(2)));
+
+  MP_ASSERT_OK(runner.Run());
+  const std::vector<mediapipe::Packet>& output =
+      runner.Outputs().Tag(kRegionOfInterestTag).packets;
+  ASSERT_EQ(output.size(), 3);
+  EXPECT_FLOAT_EQ(output[0].Get<mediapipe::NormalizedRect>().rotation(),
+                  M_PI / 2);
+  EXPECT_FLOAT_EQ(output[1].Get<mediapipe::NormalizedRect>().rotation(), M_PI);
+  EXPECT_FLOAT_EQ(output[2].Get<mediapipe::NormalizedRect>().rotation(),
+                  3 * M_PI / 2);
+}
+
+TEST(RotationRoiCalculatorTest, MakeRotatedRoiCoversWholeImage) {
+  const mediapipe::NormalizedRect roi =
+      RotationRoiCalculator::MakeRotatedRoi(450);
+  EXPECT_FLOAT_EQ(roi.x_center(), 0.5);
+  EXPECT_FLOAT_EQ(roi.y_center(), 0.5);
+  EXPECT_FLOAT_EQ(roi.width(), 1.0);
+  EXPECT_FLOAT_EQ(roi.height(), 1.0);
+  EXPECT_FLOAT_EQ(roi.rotation(), M_PI / 2);
+}
+
 }  // namespace
 }  // namespace magritte
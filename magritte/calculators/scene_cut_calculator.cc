@@ -0,0 +1,157 @@
+//
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+#include <array>
+#include <cstdint>
+#include <cstdlib>
+
+#include "absl/strings/str_cat.h"
+#include "magritte/calculators/image_frame_util.h"
+#include "magritte/calculators/scene_cut_calculator.pb.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/formats/image_frame.h"
+#include "mediapipe/framework/port/ret_check.h"
+#include "mediapipe/framework/port/status.h"
+#include  <opencv2/core.hpp>
+#include  <opencv2/imgproc.hpp>
+
+namespace magritte {
+namespace {
+using ::mediapipe::CalculatorBase;
+using ::mediapipe::CalculatorContext;
+using ::mediapipe::CalculatorContract;
+using ::mediapipe::ImageFrame;
+
+constexpr char kImageTag[] = "IMAGE";
+constexpr char kSceneCutTag[] = "SCENE_CUT";
+
+// Suffix of the counter of scene cuts, after the node name.
+constexpr char kSceneCutsCounterSuffix[] = "/SceneCuts";
+
+// The size of the thumbnails whose histograms are compared. Their pixels are
+// sampled from the frame, so the cost doesn't depend on its size.
+constexpr int kThumbnailSize = 64;
+// The number of histogram bins, and the shift from a pixel value to its bin.
+constexpr int kNumBins = 32;
+constexpr int kBinShift = 3;
+
+using Histogram = std::array<int, kNumBins>;
+
+Histogram LumaHistogram(const cv::Mat& thumbnail) {
+  Histogram histogram = {};
+  for (int y = 0; y < thumbnail.rows; ++y) {
+    const uint8_t* row = thumbnail.ptr<uint8_t>(y);
+    for (int x = 0; x < thumbnail.cols; ++x) {
+      ++histogram[row[x] >> kBinShift];
+    }
+  }
+  return histogram;
+}
+}  // namespace
+
+// A calculator that detects scene cuts in a video stream, e.g. to run face
+// detection on the first frame of a new shot, and to drop the tracks of the
+// previous shot, instead of redacting stale boxes until the next sampled
+// frame.
+//
+// A frame is a scene cut when its luma histogram differs enough from the
+// previous frame's one. The histograms are computed on a 64x64 thumbnail
+// sampled from the frame, so the detection is cheap and its cost independent of
+// the frame size. Unlike frame differences, histograms are robust to camera and
+// face motion within a shot.
+//
+// Inputs:
+// - IMAGE: The ImageFrame stream, in SRGB, SRGBA or GRAY8.
+//
+// Outputs:
+// - SCENE_CUT: A true boolean packet for the frames that start a new scene.
+//   There is no packet for the other frames, nor for the first frame.
+//
+// Options:
+// - threshold: The histogram distance, from 0 to 1, above which a frame is a
+//   scene cut. Default is 0.5.
+//
+// Example config:
+// node {
+//   calculator: "SceneCutCalculator"
+//   input_stream: "IMAGE:input_video"
+//   output_stream: "SCENE_CUT:scene_cut"
+//   options: {
+//     [magritte.SceneCutCalculatorOptions.ext] {
+//       threshold: 0.5
+//     }
+//   }
+// }
+class SceneCutCalculator : public CalculatorBase {
+ public:
+  SceneCutCalculator() = default;
+  ~SceneCutCalculator() override = default;
+
+  static absl::Status GetContract(CalculatorContract* cc) {
+    RET_CHECK(cc->Inputs().HasTag(kImageTag))
+        << "Missing input " << kImageTag << " tag.";
+    cc->Inputs().Tag(kImageTag).Set<ImageFrame>();
+    RET_CHECK(cc->Outputs().HasTag(kSceneCutTag))
+        << "Missing output " << kSceneCutTag << " tag.";
+    cc->Outputs().Tag(kSceneCutTag).Set<bool>();
+    // No input side packets.
+    return absl::OkStatus();
+  }
+
+  absl::Status Open(CalculatorContext* cc) override {
+    cc->SetOffset(mediapipe::TimestampDiff(0));
+    threshold_ = cc->Options<SceneCutCalculatorOptions>().threshold();
+    RET_CHECK(threshold_ > 0.0f && threshold_ <= 1.0f)
+        << "threshold must be in (0, 1].";
+    return absl::OkStatus();
+  }
+
+  absl::Status Process(CalculatorContext* cc) override {
+    ASSIGN_OR_RETURN(
+        const cv::Mat thumbnail,
+        GrayThumbnail(cc->Inputs().Tag(kImageTag).Get<ImageFrame>(),
+                      kThumbnailSize, cv::INTER_NEAREST));
+    const Histogram histogram = LumaHistogram(thumbnail);
+    if (has_previous_) {
+      int difference = 0;
+      for (int i = 0; i < kNumBins; ++i) {
+        difference += std::abs(histogram[i] - previous_histogram_[i]);
+      }
+      // Each pixel that changes bins counts twice in the difference.
+      const float distance = difference / (2.0f * thumbnail.total());
+      if (distance > threshold_) {
+        cc->Outputs()
+            .Tag(kSceneCutTag)
+            .AddPacket(mediapipe::MakePacket<bool>(true).At(
+                cc->InputTimestamp()));
+        cc->GetCounter(absl::StrCat(cc->NodeName(), kSceneCutsCounterSuffix))
+            ->Increment();
+      }
+    }
+    previous_histogram_ = histogram;
+    has_previous_ = true;
+    return absl::OkStatus();
+  }
+
+ private:
+  float threshold_ = 0.0f;
+  // The histogram of the previous frame, if any.
+  Histogram previous_histogram_;
+  bool has_previous_ = false;
+};
+
+REGISTER_CALCULATOR(SceneCutCalculator);
+
+}  // namespace magritte
@@ -0,0 +1,106 @@
+//
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include  <opencv2/core.hpp>
+#include "magritte/calculators/scene_cut_calculator.pb.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/calculator_runner.h"
+#include "mediapipe/framework/formats/image_frame.h"
+#include "mediapipe/framework/formats/image_frame_opencv.h"
+#include "mediapipe/framework/port/gmock.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/parse_text_proto.h"
+#include "mediapipe/framework/port/status_matchers.h"
+
+namespace magritte {
+namespace {
+
+using ::mediapipe::CalculatorRunner;
+using ::mediapipe::ImageFormat;
+using ::mediapipe::ImageFrame;
+using ::mediapipe::Packet;
+using ::mediapipe::Timestamp;
+using ::mediapipe::formats::MatView;
+
+constexpr char kNodeConfig[] = R"pb(
+  calculator: "SceneCutCalculator"
+  input_stream: "IMAGE:input_video"
+  output_stream: "SCENE_CUT:scene_cut"
+  options {
+    [magritte.SceneCutCalculatorOptions.ext] { threshold: 0.5 }
+  }
+)pb";
+
+// Returns a frame whose left half has the given gray level and right half the
+// other given gray level.
+Packet MakeFrame(int left_level, int right_level, int timestamp) {
+  auto frame = std::make_unique<ImageFrame>(
+      ImageFormat::SRGB, 320, 240, ImageFrame::kDefaultAlignmentBoundary);
+  cv::Mat mat = MatView(frame.get());
+  mat.colRange(0, 160).setTo(cv::Scalar(left_level, left_level, left_level));
+  mat.colRange(160, 320).setTo(
+      cv::Scalar(right_level, right_level, right_level));
+  return mediapipe::Adopt(frame.release()).At(Timestamp(timestamp));
+}
+
+std::vector<int64_t> CutTimestamps(const CalculatorRunner& runner) {
+  std::vector<int64_t> timestamps;
+  for (const auto& packet : runner.Outputs().Tag("SCENE_CUT").packets) {
+    EXPECT_TRUE(packet.Get<bool>());
+    timestamps.push_back(packet.Timestamp().Value());
+  }
+  return timestamps;
+}
+
+TEST(SceneCutCalculatorTest, DetectsHistogramChanges) {
+  CalculatorRunner runner(
+      mediapipe::ParseTextProtoOrDie<mediapipe::CalculatorGraphConfig::Node>(
+          kNodeConfig));
+  auto& packets = runner.MutableInputs()->Tag("IMAGE").packets;
+  packets.push_back(MakeFrame(20, 200, 0));
+  packets.push_back(MakeFrame(20, 200, 1));
+  // Swapping the halves is motion, not a cut: the histogram is unchanged.
+  packets.push_back(MakeFrame(200, 20, 2));
+  // Half of the pixels change bins, which is not above the threshold.
+  packets.push_back(MakeFrame(200, 100, 3));
+  // All pixels change bins.
+  packets.push_back(MakeFrame(60, 140, 4));
+  packets.push_back(MakeFrame(60, 140, 5));
+
+  MP_ASSERT_OK(runner.Run());
+  EXPECT_THAT(CutTimestamps(runner), testing::ElementsAre(4));
+  EXPECT_EQ(runner.GetCounter("SceneCutCalculator/SceneCuts")->Get(), 1);
+}
+
+TEST(SceneCutCalculatorTest, FailsWithInvalidThreshold) {
+  auto node =
+      mediapipe::ParseTextProtoOrDie<mediapipe::CalculatorGraphConfig::Node>(
+          kNodeConfig);
+  node.mutable_options()
+      ->MutableExtension(SceneCutCalculatorOptions::ext)
+      ->set_threshold(0.0f);
+  CalculatorRunner runner(node);
+  runner.MutableInputs()->Tag("IMAGE").packets.push_back(
+      MakeFrame(20, 200, 0));
+
+  EXPECT_FALSE(runner.Run().ok());
+}
+
+}  // namespace
+}  // namespace magritte
@@ -23,8 +23,18 @@
 #include "mediapipe/framework/formats/image_frame.h"
 #include "mediapipe/framework/formats/image_frame_opencv.h"
 #include "mediapipe/framework/formats/location_data.pb.h"
+#include "mediapipe/framework/formats/yuv_image.h"
+#include "magritte/calculators/disjoint_tiles.h"
+#include "magritte/calculators/fast_blur.h"
+#include "magritte/calculators/image_frame_pool.h"
+#include "magritte/calculators/image_frame_pool_service.h"
+#include "magritte/calculators/image_frame_util.h"
+#include "magritte/calculators/parallel_regions.h"
 #include "magritte/calculators/simple_blur_calculator.pb.h"
+#include "magritte/calculators/yuv_image_util.h"
 #include "mediapipe/framework/formats/location.h"
+#include "mediapipe/framework/port/status.h"
+#include "mediapipe/framework/port/threadpool.h"
 #include  <opencv2/imgproc.hpp>
 
 namespace magritte {
@@ -35,25 +45,40 @@ using ::mediapipe::CalculatorContract;
 using ::mediapipe::Detection;
 using ::mediapipe::ImageFrame;
 using ::mediapipe::Location;
+using ::mediapipe::YUVImage;
 using ::mediapipe::formats::MatView;
 namespace {
 
 constexpr char kDetectionsTag[] = "DETECTIONS";
 constexpr char kFramesTag[] = "FRAMES";
+constexpr char kYuvFramesTag[] = "YUV_FRAMES";
+
+// Size of the grid cells used to find overlapping detections in crowd mode.
+constexpr int kCrowdGridCellSize = 64;
 
 typedef std::vector<Detection> Detections;
 }  // namespace
 
 // A calculator that applies box blurring or Gaussian blurring on an image. The
-// type of blurring is configured via the calculator options.
+// type of blurring is configured via the calculator options, as well as the
+// algorithm: for large faces, the RUNNING_SUM and PYRAMID algorithms are much
+// faster than filtering with the full kernel. Detections whose blurred regions
+// don't overlap can be blurred in parallel on num_threads threads; the result
+// does not depend on the number of threads. For crowds, crowd_mode merges
+// overlapping detections so that each pixel is blurred at most once.
+//
+// YUVImages are blurred plane by plane, without conversion. In the subsampled
+// chroma planes, the regions and the blur sizes are halved.
 //
 // Inputs:
-// - FRAMES: An ImageFrame stream, containing an input image.
+// - FRAMES or YUV_FRAMES: An ImageFrame or YUVImage stream, containing an input
+//   image.
 // - DETECTIONS: A vector of detections, containing the detections to be blurred
 //   onto the image from the first stream.  The type is vector<Detection>.
 //
 // Outputs:
-// - FRAMES: An ImageFrame stream, containing the blurred images.
+// - FRAMES or YUV_FRAMES: An ImageFrame or YUVImage stream, matching the input,
+//   containing the blurred images.
 //
 // Example config:
 // node {
@@ -64,6 +89,7 @@ typedef std::vector<Detection> Detections;
 //   options: {
 //     [magritte.SimpleBlurCalculatorOptions.ext] {
 //       blur_type: GAUSSIAN_BLUR
+//       blur_algorithm: RUNNING_SUM
 //     }
 //   }
 // }
@@ -73,41 +99,76 @@ class SimpleBlurCalculatorCpu : public CalculatorBase {
   ~SimpleBlurCalculatorCpu() override = default;
 
   static absl::Status GetContract(CalculatorContract* cc) {
-    cc->Inputs().Tag(kFramesTag).Set<ImageFrame>();
+    RET_CHECK(cc->Inputs().HasTag(kFramesTag) ^
+              cc->Inputs().HasTag(kYuvFramesTag))
+        << "Exactly one of " << kFramesTag << " or " << kYuvFramesTag
+        << " input tags must be set.";
+    if (cc->Inputs().HasTag(kFramesTag)) {
+      cc->Inputs().Tag(kFramesTag).Set<ImageFrame>();
+      cc->Outputs().Tag(kFramesTag).Set<ImageFrame>();
+    } else {
+      cc->Inputs().Tag(kYuvFramesTag).Set<YUVImage>();
+      cc->Outputs().Tag(kYuvFramesTag).Set<YUVImage>();
+    }
     cc->Inputs().Tag(kDetectionsTag).Set<Detections>();
-    cc->Outputs().Tag(kFramesTag).Set<ImageFrame>();
+    UseImageFramePoolService(cc);
 
     // No input side packets.
     return absl::OkStatus();
   }
 
-  absl::Status Open(CalculatorContext* cc) override { return absl::OkStatus(); }
+  absl::Status Open(CalculatorContext* cc) override {
+    const auto& options = cc->Options<SimpleBlurCalculatorOptions>();
+    RET_CHECK_GE(options.num_threads(), 1) << "num_threads must be positive.";
+    if (options.num_threads() > 1) {
+      thread_pool_ = std::make_unique<mediapipe::ThreadPool>(
+          "simple_blur", options.num_threads());
+      thread_pool_->StartWorkers();
+    }
+    pool_ = GetImageFramePool(cc);
+    return absl::OkStatus();
+  }
 
   absl::Status Process(CalculatorContext* cc) override {
     const auto& options = cc->Options<SimpleBlurCalculatorOptions>();
+    const bool yuv = cc->Inputs().HasTag(kYuvFramesTag);
+    const char* frames_tag = yuv ? kYuvFramesTag : kFramesTag;
 
-    if (cc->Inputs().Tag(kFramesTag).Value().IsEmpty()) {
+    if (cc->Inputs().Tag(frames_tag).Value().IsEmpty()) {
       LOG(WARNING) << "No image frame at " << cc->InputTimestamp();
       return absl::OkStatus();
     }
     if (cc->Inputs().Tag(kDetectionsTag).Value().IsEmpty()) {
       LOG(INFO) << "Empty detections at " << cc->InputTimestamp();
       cc->Outputs()
-          .Tag(kFramesTag)
-          .AddPacket(cc->Inputs().Tag(kFramesTag).Value());
+          .Tag(frames_tag)
+          .AddPacket(cc->Inputs().Tag(frames_tag).Value());
       return absl::OkStatus();
     }
 
-    const auto& frame = cc->Inputs().Tag(kFramesTag).Get<ImageFrame>();
-    Detections detections = cc->Inputs().Tag(kDetectionsTag).Get<Detections>();
+    const Detections& detections =
+        cc->Inputs().Tag(kDetectionsTag).Get<Detections>();
 
-    std::unique_ptr<ImageFrame> output_frame(
-        new ImageFrame(frame.Format(), frame.Width(), frame.Height()));
-
-    cv::Mat src = MatView(&frame);
+    // The detections are blurred in place. The input frame is only copied if
+    // other calculators might want to access it still.
+    std::unique_ptr<ImageFrame> output_frame;
+    std::unique_ptr<YUVImage> output_image;
+    cv::Size size;
+    if (yuv) {
+      ASSIGN_OR_RETURN(output_image,
+                       ConsumeOrCopyYuvImage(cc, cc->Inputs().Tag(frames_tag)));
+      size = cv::Size(output_image->width(), output_image->height());
+    } else {
+      ASSIGN_OR_RETURN(output_frame,
+                       ConsumeOrCopyImageFrame(
+                           cc, cc->Inputs().Tag(frames_tag), pool_.get()));
+      size = cv::Size(output_frame->Width(), output_frame->Height());
+    }
 
-    const int width = frame.Width();
-    const int height = frame.Height();
+    const int width = size.width;
+    const int height = size.height;
+    std::vector<cv::Rect> rects;
+    std::vector<int> blur_sizes;
     for (const Detection& detection : detections) {
       auto box = Location(detection.location_data())
                      .ConvertToBBox<BoundingBox>(width, height);
@@ -130,30 +191,152 @@ class SimpleBlurCalculatorCpu : public CalculatorBase {
         blur_size++;
       }
 
-      cv::Mat submatrix = src(cv::Range(ymin, ymax), cv::Range(xmin, xmax));
+      rects.push_back(cv::Rect(xmin, ymin, xmax - xmin, ymax - ymin));
+      blur_sizes.push_back(blur_size);
+    }
+
+    if (!yuv) {
+      cv::Mat src = MatView(output_frame.get());
+      MP_RETURN_IF_ERROR(BlurRects(options, rects, blur_sizes, &src));
+      cc->Outputs()
+          .Tag(kFramesTag)
+          .Add(output_frame.release(), cc->InputTimestamp());
+      return absl::OkStatus();
+    }
+
+    ASSIGN_OR_RETURN(YuvPlanes planes, GetYuvPlanes(*output_image));
+    for (cv::Mat& plane : planes) {
+      const int factor = width / plane.cols;
+      std::vector<cv::Rect> plane_rects;
+      std::vector<int> plane_blur_sizes;
+      for (size_t i = 0; i < rects.size(); ++i) {
+        plane_rects.push_back(PlaneRect(rects[i], size, plane));
+        // The blur size stays odd once scaled to the plane.
+        plane_blur_sizes.push_back(blur_sizes[i] / factor / 2 * 2 + 1);
+      }
+      MP_RETURN_IF_ERROR(
+          BlurRects(options, plane_rects, plane_blur_sizes, &plane));
+    }
+    cc->Outputs()
+        .Tag(kYuvFramesTag)
+        .Add(output_image.release(), cc->InputTimestamp());
+    return absl::OkStatus();
+  }
+
+ private:
+  // Blurs the given rects of the frame, or plane of a frame, in place.
+  absl::Status BlurRects(const SimpleBlurCalculatorOptions& options,
+                         const std::vector<cv::Rect>& rects,
+                         const std::vector<int>& blur_sizes, cv::Mat* src) {
+    if (options.crowd_mode()) {
+      return BlurDisjointTiles(options, rects, blur_sizes, src);
+    }
+    // Blurring reads pixels up to half a kernel outside of the detection, so
+    // detections are only blurred in parallel if these footprints don't
+    // overlap.
+    std::vector<cv::Rect> footprints;
+    for (size_t i = 0; i < rects.size(); ++i) {
+      const cv::Rect& rect = rects[i];
+      const int radius = blur_sizes[i] / 2;
+      footprints.push_back(
+          cv::Rect(rect.x - radius, rect.y - radius, rect.width + 2 * radius,
+                   rect.height + 2 * radius) &
+          cv::Rect(0, 0, src->cols, src->rows));
+    }
+    return ProcessRegionsInParallel(
+        footprints, thread_pool_.get(), [&](int i) {
+          cv::Mat submatrix = (*src)(rects[i]);
+          Blur(options, blur_sizes[i], &submatrix);
+          return absl::OkStatus();
+        });
+  }
 
-      switch (options.blur_type()) {
-        case SimpleBlurCalculatorOptions::BOX_BLUR: {
-          // using a faster blur for manual testing
-          cv::blur(submatrix, submatrix, cv::Size(blur_size, blur_size),
-                   cv::Point(-(blur_size / 2), -(blur_size / 2)));
-          break;
+  static void Blur(const SimpleBlurCalculatorOptions& options, int blur_size,
+                   cv::Mat* submatrix) {
+    switch (options.blur_algorithm()) {
+      case SimpleBlurCalculatorOptions::DIRECT:
+        BlurDirect(options.blur_type(), blur_size, submatrix);
+        break;
+      case SimpleBlurCalculatorOptions::RUNNING_SUM:
+        if (options.blur_type() == SimpleBlurCalculatorOptions::BOX_BLUR) {
+          RunningSumBoxBlur(blur_size, submatrix);
+        } else {
+          RunningSumGaussianBlur(blur_size, submatrix);
         }
-        case SimpleBlurCalculatorOptions::GAUSSIAN_BLUR: {
-          cv::GaussianBlur(submatrix, submatrix, cv::Size(blur_size, blur_size),
-                           0, 0);
-          break;
+        break;
+      case SimpleBlurCalculatorOptions::PYRAMID:
+        if (options.blur_type() == SimpleBlurCalculatorOptions::BOX_BLUR) {
+          PyramidBoxBlur(blur_size, submatrix);
+        } else {
+          PyramidGaussianBlur(blur_size, submatrix);
         }
-      }
+        break;
     }
+  }
 
-    output_frame->CopyFrom(frame, ImageFrame::kDefaultAlignmentBoundary);
+  // Blurs the union of the given rects, each pixel once with the largest blur
+  // size of the rects covering it.
+  absl::Status BlurDisjointTiles(const SimpleBlurCalculatorOptions& options,
+                                 const std::vector<cv::Rect>& rects,
+                                 const std::vector<int>& blur_sizes,
+                                 cv::Mat* frame) {
+    const std::vector<DisjointTile> tiles =
+        DecomposeIntoDisjointTiles(rects, blur_sizes, kCrowdGridCellSize);
+    // Tiles of the same group with the same blur size are blurred once over
+    // their bounds, so that thin tiles don't each pay for a kernel-radius
+    // margin.
+    const std::vector<DisjointTileBatch> batches = BatchDisjointTiles(tiles);
 
-    cc->Outputs()
-        .Tag(kFramesTag)
-        .Add(output_frame.release(), cc->InputTimestamp());
+    // All batches are blurred from the unmodified frame before any tile is
+    // written back, so that tiles don't blur the result of neighboring tiles
+    // again. Batches only read the frame, so they can all be blurred in
+    // parallel.
+    const cv::Rect frame_rect(0, 0, frame->cols, frame->rows);
+    std::vector<cv::Rect> contexts(batches.size());
+    std::vector<cv::Mat> blurred_contexts(batches.size());
+    MP_RETURN_IF_ERROR(
+        ParallelFor(batches.size(), thread_pool_.get(), [&](int b) {
+          const cv::Rect& bounds = batches[b].bounds;
+          const int radius = batches[b].value / 2;
+          contexts[b] = cv::Rect(bounds.x - radius, bounds.y - radius,
+                                 bounds.width + 2 * radius,
+                                 bounds.height + 2 * radius) &
+                        frame_rect;
+          blurred_contexts[b] = (*frame)(contexts[b]).clone();
+          Blur(options, batches[b].value, &blurred_contexts[b]);
+          return absl::OkStatus();
+        }));
+
+    for (size_t b = 0; b < batches.size(); ++b) {
+      for (const int i : batches[b].tiles) {
+        const cv::Rect& rect = tiles[i].rect;
+        blurred_contexts[b](rect - contexts[b].tl()).copyTo((*frame)(rect));
+      }
+    }
     return absl::OkStatus();
   }
+
+  static void BlurDirect(SimpleBlurCalculatorOptions::BlurType blur_type,
+                         int blur_size, cv::Mat* submatrix) {
+    switch (blur_type) {
+      case SimpleBlurCalculatorOptions::BOX_BLUR: {
+        // using a faster blur for manual testing
+        cv::blur(*submatrix, *submatrix, cv::Size(blur_size, blur_size),
+                 cv::Point(-(blur_size / 2), -(blur_size / 2)));
+        break;
+      }
+      case SimpleBlurCalculatorOptions::GAUSSIAN_BLUR: {
+        cv::GaussianBlur(*submatrix, *submatrix,
+                         cv::Size(blur_size, blur_size), 0, 0);
+        break;
+      }
+    }
+  }
+
+  // Blurs non-overlapping detections in parallel if num_threads > 1.
+  std::unique_ptr<mediapipe::ThreadPool> thread_pool_;
+  // Provides the buffers of copied input frames.
+  std::shared_ptr<ImageFramePool> pool_;
 };
 
 REGISTER_CALCULATOR(SimpleBlurCalculatorCpu);
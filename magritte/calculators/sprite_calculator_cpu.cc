@@ -13,24 +13,71 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 //
+#include <cmath>
+#include <list>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
 #include "mediapipe/framework/calculator_framework.h"
 #include "mediapipe/framework/formats/image_frame_opencv.h"
+#include "mediapipe/framework/formats/yuv_image.h"
+#include "magritte/calculators/image_frame_pool.h"
+#include "magritte/calculators/image_frame_pool_service.h"
+#include "magritte/calculators/image_frame_util.h"
+#include "magritte/calculators/parallel_regions.h"
+#include "magritte/calculators/sprite_calculator.pb.h"
 #include "magritte/calculators/sprite_list.h"
+#include "magritte/calculators/sprite_mipmap.h"
 #include "magritte/calculators/sprite_pose.pb.h"
+#include "magritte/calculators/warp_compose.h"
+#include "magritte/calculators/yuv_image_util.h"
 #include "mediapipe/framework/formats/image_frame.h"
+#include "mediapipe/framework/port/status.h"
+#include "mediapipe/framework/port/threadpool.h"
 #include  <opencv2/imgproc.hpp>
 
 namespace magritte {
 namespace {
 // Input/output stream tags.
 constexpr char kImageFrameTag[] = "IMAGE";
+constexpr char kYuvImageTag[] = "YUV_IMAGE";
 constexpr char kSpritesTag[] = "SPRITES";
 
+// Suffixes of the counters of the warped sprite cache, after the node name.
+constexpr char kCacheHitsCounterSuffix[] = "/SpriteCacheHits";
+constexpr char kCacheMissesCounterSuffix[] = "/SpriteCacheMisses";
+
 using ::mediapipe::CalculatorBase;
 using ::mediapipe::CalculatorContext;
 using ::mediapipe::CalculatorContract;
 using ::mediapipe::formats::MatView;
 using ::mediapipe::ImageFrame;
+using ::mediapipe::YUVImage;
+
+// Identifies a warped sprite in the cache: the sprite image, the type of the
+// target image, and the quantized scale and rotation.
+struct WarpedSpriteKey {
+  const ImageFrame* image = nullptr;
+  int target_type = 0;
+  int scale_step = 0;
+  int rotation_step = 0;
+
+  bool operator==(const WarpedSpriteKey& other) const {
+    return image == other.image && target_type == other.target_type &&
+           scale_step == other.scale_step &&
+           rotation_step == other.rotation_step;
+  }
+
+  template <typename H>
+  friend H AbslHashValue(H h, const WarpedSpriteKey& key) {
+    return H::combine(std::move(h), key.image, key.target_type, key.scale_step,
+                      key.rotation_step);
+  }
+};
 }  // namespace
 
 // Stamps the given textures onto the background image after transforming by the
@@ -39,14 +86,28 @@ using ::mediapipe::ImageFrame;
 // Inputs:
 // - IMAGE: The input ImageFrame video frame to be overlaid with the sprites.
 //   If it has transparency, it is assumed to be premultiplied.
+// - YUV_IMAGE: The input YUVImage video frame, instead of IMAGE. Each sprite is
+//   drawn onto an RGB copy of the chroma-aligned region it covers, which is
+//   then converted back into the planes, so that the rest of the frame is never
+//   converted.
 // - SPRITES: A vector of pairs of sprite images as ImageFrames and vertex
 //   transformations as SpritePoses to be stamped onto the input video
 //   (see sprite_list.h). The ImageFrame must have a premultiplied alpha
-//   channel.
+//   channel. If the sprites have a mipmap, it is used to draw sprites that
+//   are scaled down by half or more.
 //
 // Outputs:
-// - IMAGE: The output image with the sprites addded. If the input background
-//   image has transparency, then the output will be premultiplied.
+// - IMAGE or YUV_IMAGE: The output image, matching the input, with the sprites
+//   addded. If the input background image has transparency, then the output
+//   will be premultiplied.
+//
+// Sprites that don't overlap can be drawn in parallel, see
+// SpriteCalculatorOptions. Overlapping sprites are always drawn in the order of
+// the sprite list.
+//
+// Warped sprites can be cached across frames, with their scale and rotation
+// quantized, see SpriteCalculatorOptions. The cache maintains the
+// "<node name>/SpriteCacheHits" and "<node name>/SpriteCacheMisses" counters.
 //
 class SpriteCalculatorCpu : public CalculatorBase {
  public:
@@ -58,16 +119,88 @@ class SpriteCalculatorCpu : public CalculatorBase {
   absl::Status Process(CalculatorContext* cc) override;
 
  protected:
-  // Draws the provided sprite at the position and orientation specified into
-  // the target image.
+  // Where a sprite is drawn in the target image.
+  struct SpritePlacement {
+    // The size of the whole sprite after warping.
+    cv::Size warped_size;
+    // The affine transform from sprite coordinates to warped sprite
+    // coordinates.
+    cv::Mat transform;
+    // The region of the warped sprite that is inside of the target image.
+    cv::Rect warped_roi;
+    // The region of the target image covered by the sprite, clipped to the
+    // target image. Empty if the sprite is entirely outside of it.
+    cv::Rect target_roi;
+  };
+
+  // A warped sprite, prepared to be drawn onto targets of a given type.
+  struct ComposableSprite {
+    // The premultiplied color, with as many channels as the target.
+    cv::Mat color;
+    // 255 minus the alpha, with as many channels as the target.
+    cv::Mat inverse_alpha;
+  };
+
+  // Computes where a sprite of the given size is drawn in a target image of the
+  // given size, at the position and orientation specified.
+  static SpritePlacement PlaceSprite(const cv::Size& sprite_size,
+                                     const SpritePose& orientation,
+                                     const cv::Size& target_size);
+
+  // Draws the provided sprite at the given placement into the target image,
+  // warping and composing it in a single pass.
   absl::Status RenderSingleSprite(const cv::Mat& sprite,
-                                  const SpritePose& orientation,
+                                  const SpritePlacement& placement,
                                   cv::Mat* target);
 
-  // Draws src atop dst using normal alpha blending. src and dst must have the
-  // same width and height, but may have different numbers of channels.
-  // NOTE: src is assumed to have a premultiplied alpha channel.
-  absl::Status ComposeNormal(const cv::Mat& src, cv::Mat& dst);
+  // Converts src, which must have a premultiplied alpha channel, for drawing
+  // onto targets of the given type with ComposePrepared.
+  static absl::StatusOr<ComposableSprite> PrepareForComposition(
+      const cv::Mat& src, int dst_type);
+
+  // Draws the given region of src atop dst, which must have the size of the
+  // region, using normal alpha blending.
+  static void ComposePrepared(const ComposableSprite& src,
+                              const cv::Rect& src_roi, cv::Mat& dst);
+
+ private:
+  // A cached warped sprite.
+  struct CachedSprite {
+    // Keeps the sprite image alive, so that its address keeps identifying it.
+    mediapipe::Packet image_packet;
+    ComposableSprite sprite;
+  };
+  using CacheEntry =
+      std::pair<WarpedSpriteKey, std::shared_ptr<const CachedSprite>>;
+
+  // Rounds the scale and rotation of the pose to the quantization steps of the
+  // cache, and stores the step indices in the key. Returns false if the pose
+  // cannot be cached.
+  bool QuantizePose(SpritePose* pose, WarpedSpriteKey* key) const;
+
+  // Returns the cached sprite with the given key and marks it as most recently
+  // used, or nullptr.
+  std::shared_ptr<const CachedSprite> LookUpCachedSprite(
+      const WarpedSpriteKey& key);
+
+  // Adds a sprite to the cache, evicting the least recently used sprites
+  // beyond the cache size.
+  void InsertCachedSprite(const WarpedSpriteKey& key,
+                          std::shared_ptr<const CachedSprite> sprite);
+
+  // Draws non-overlapping sprites in parallel if num_threads > 1.
+  std::unique_ptr<mediapipe::ThreadPool> thread_pool_;
+
+  // Provides the buffers of copied input frames.
+  std::shared_ptr<ImageFramePool> pool_;
+
+  // Warped sprites, most recently used first, and their index by key.
+  int cache_size_ = 0;
+  double scale_quantization_ = 0.0;
+  double rotation_quantization_radians_ = 0.0;
+  std::list<CacheEntry> cache_;
+  absl::flat_hash_map<WarpedSpriteKey, std::list<CacheEntry>::iterator>
+      cache_index_;
 };
 
 REGISTER_CALCULATOR(SpriteCalculatorCpu);
@@ -75,63 +208,102 @@ REGISTER_CALCULATOR(SpriteCalculatorCpu);
 // static
 absl::Status SpriteCalculatorCpu::GetContract(CalculatorContract* cc) {
   RET_CHECK(cc != nullptr) << "CalculatorContract is nullptr";
-  RET_CHECK(cc->Inputs().HasTag(kImageFrameTag))
-      << "Missing input " << kImageFrameTag << " tag.";
-  cc->Inputs().Tag(kImageFrameTag).Set<ImageFrame>();
+  RET_CHECK(cc->Inputs().HasTag(kImageFrameTag) ^
+            cc->Inputs().HasTag(kYuvImageTag))
+      << "Exactly one of " << kImageFrameTag << " or " << kYuvImageTag
+      << " input tags must be set.";
+  const char* image_tag =
+      cc->Inputs().HasTag(kYuvImageTag) ? kYuvImageTag : kImageFrameTag;
+  if (cc->Inputs().HasTag(kImageFrameTag)) {
+    cc->Inputs().Tag(kImageFrameTag).Set<ImageFrame>();
+  } else {
+    cc->Inputs().Tag(kYuvImageTag).Set<YUVImage>();
+  }
 
   RET_CHECK(cc->Inputs().HasTag(kSpritesTag))
       << "Missing input " << kSpritesTag << " tag.";
   cc->Inputs().Tag(kSpritesTag).Set<SpriteList>();
 
-  RET_CHECK(cc->Outputs().HasTag(kImageFrameTag))
-      << "Missing output " << kImageFrameTag << " tag.";
-  cc->Outputs().Tag(kImageFrameTag).Set<ImageFrame>();
+  RET_CHECK(cc->Outputs().HasTag(image_tag))
+      << "Missing output " << image_tag << " tag.";
+  if (cc->Inputs().HasTag(kImageFrameTag)) {
+    cc->Outputs().Tag(kImageFrameTag).Set<ImageFrame>();
+  } else {
+    cc->Outputs().Tag(kYuvImageTag).Set<YUVImage>();
+  }
+  UseImageFramePoolService(cc);
 
   return absl::OkStatus();
 }
 
 absl::Status SpriteCalculatorCpu::Open(CalculatorContext* cc) {
+  pool_ = GetImageFramePool(cc);
+
+  const auto& options = cc->Options<SpriteCalculatorOptions>();
+  RET_CHECK_GE(options.num_threads(), 1) << "num_threads must be positive.";
+  if (options.num_threads() > 1) {
+    thread_pool_ = std::make_unique<mediapipe::ThreadPool>(
+        "sprite", options.num_threads());
+    thread_pool_->StartWorkers();
+  }
+
+  RET_CHECK_GE(options.cache_size(), 0) << "cache_size must not be negative.";
+  cache_size_ = options.cache_size();
+  if (cache_size_ > 0) {
+    RET_CHECK_GT(options.scale_quantization(), 0.0f)
+        << "scale_quantization must be positive.";
+    RET_CHECK_GT(options.rotation_quantization_degrees(), 0.0f)
+        << "rotation_quantization_degrees must be positive.";
+  }
+  scale_quantization_ = options.scale_quantization();
+  rotation_quantization_radians_ =
+      options.rotation_quantization_degrees() * M_PI / 180.0;
   return absl::OkStatus();
 }
 
-absl::Status SpriteCalculatorCpu::ComposeNormal(const cv::Mat& src,
-                                                cv::Mat& dst) {
-  RET_CHECK_EQ(src.rows, dst.rows)
-      << "src rows: " << src.rows << " does not equal dst rows: " << dst.rows;
-  RET_CHECK_EQ(src.cols, dst.cols)
-      << "src cols: " << src.cols << " does not equal dst cols: " << dst.cols;
+// static
+absl::StatusOr<SpriteCalculatorCpu::ComposableSprite>
+SpriteCalculatorCpu::PrepareForComposition(const cv::Mat& src, int dst_type) {
   RET_CHECK_EQ(src.type(), CV_8UC4) << "src should have an alpha channel.";
-  RET_CHECK(dst.type() == CV_8UC3 || dst.type() == CV_8UC4)
+  RET_CHECK(dst_type == CV_8UC3 || dst_type == CV_8UC4)
       << "dst should be an RGB or RGBA Mat.";
 
   // Create a Mat with as many copies of the src alpha as the channels in dst.
-  cv::Mat alpha_copies(src.rows, src.cols, dst.type());
+  cv::Mat alpha_copies(src.rows, src.cols, dst_type);
   static int from_to[] = {3, 0, 3, 1, 3, 2, 3, 3};
   cv::mixChannels(&src, /*nsrcs=*/1, &alpha_copies, /*ndsts=*/1, from_to,
-                  /*npairs=*/dst.channels());
+                  /*npairs=*/CV_MAT_CN(dst_type));
+
+  ComposableSprite composable;
+  composable.inverse_alpha = cv::Scalar::all(255) - alpha_copies;
 
   // Make sure we have a copy of src with a number of channels matching dst.
-  cv::Mat src_matching_channels;
-  if (dst.type() == CV_8UC3) {
-    cv::cvtColor(src, src_matching_channels, cv::COLOR_RGBA2RGB);
-  } else if (dst.type() == CV_8UC4) {
-    src_matching_channels = src;
+  if (dst_type == CV_8UC3) {
+    cv::cvtColor(src, composable.color, cv::COLOR_RGBA2RGB);
+  } else if (dst_type == CV_8UC4) {
+    composable.color = src;
   }
+  return composable;
+}
 
-  cv::multiply(cv::Scalar::all(255) - alpha_copies, dst, dst, 1 / 255.0);
-  cv::add(dst, src_matching_channels, dst);
-
-  return absl::OkStatus();
+// static
+void SpriteCalculatorCpu::ComposePrepared(const ComposableSprite& src,
+                                          const cv::Rect& src_roi,
+                                          cv::Mat& dst) {
+  cv::multiply(src.inverse_alpha(src_roi), dst, dst, 1 / 255.0);
+  cv::add(dst, src.color(src_roi), dst);
 }
 
-absl::Status SpriteCalculatorCpu::RenderSingleSprite(
-    const cv::Mat& sprite, const SpritePose& orientation, cv::Mat* target) {
-  const int sprite_width = sprite.cols;
-  const int sprite_height = sprite.rows;
+// static
+SpriteCalculatorCpu::SpritePlacement SpriteCalculatorCpu::PlaceSprite(
+    const cv::Size& sprite_size, const SpritePose& orientation,
+    const cv::Size& target_size) {
+  const int sprite_width = sprite_size.width;
+  const int sprite_height = sprite_size.height;
   const float rotation_in_degrees_counterclockwise =
       - orientation.rotation_radians() * 180.0f / M_PI;
-  const float center_x = orientation.position_x() * target->cols;
-  const float center_y = orientation.position_y() * target->rows;
+  const float center_x = orientation.position_x() * target_size.width;
+  const float center_y = orientation.position_y() * target_size.height;
   const float scale = orientation.scale();
 
   const cv::RotatedRect rotated_sprite_bounds(
@@ -140,7 +312,8 @@ absl::Status SpriteCalculatorCpu::RenderSingleSprite(
       rotation_in_degrees_counterclockwise);
 
   cv::Rect target_roi_rect = rotated_sprite_bounds.boundingRect();
-  cv::Size warped_sprite_size(target_roi_rect.width, target_roi_rect.height);
+  const cv::Size warped_sprite_size(target_roi_rect.width,
+                                    target_roi_rect.height);
 
   cv::Mat transform_mat = cv::getRotationMatrix2D(
       cv::Point2f(0.5f * (sprite_width - 1), 0.5f * (sprite_height - 1)),
@@ -155,74 +328,236 @@ absl::Status SpriteCalculatorCpu::RenderSingleSprite(
   // Translate the rotated rect to put it where the sprite is going to be drawn.
   target_roi_rect.x = std::round(-target_roi_rect.width * 0.5f + center_x);
   target_roi_rect.y = std::round(-target_roi_rect.height * 0.5f + center_y);
-
-  // Figure out how much (if any) of the sprite is supposed to be rendered
-  // outside the bounds of the target image.
-  const int needed_left_margin = std::max(-target_roi_rect.tl().x, 0);
-  const int needed_right_margin =
-      std::max(target_roi_rect.br().x - target->cols, 0);
-  const int needed_top_margin = std::max(-target_roi_rect.tl().y, 0);
-  const int needed_bottom_margin =
-      std::max(target_roi_rect.br().y - target->rows, 0);
+  const cv::Point sprite_origin = target_roi_rect.tl();
 
   // Adjust the position of the target ROI to be the intersection of the
   // computed target ROI and the whole target image.
-  target_roi_rect.x += needed_left_margin;
-  target_roi_rect.width -= needed_left_margin + needed_right_margin;
-  target_roi_rect.y += needed_top_margin;
-  target_roi_rect.height -= needed_top_margin + needed_bottom_margin;
+  target_roi_rect &= cv::Rect(0, 0, target_size.width, target_size.height);
+
+  // The part of the warped sprite that shows up in the target ROI.
+  cv::Rect warped_roi_rect(target_roi_rect.tl() - sprite_origin,
+                           target_roi_rect.size());
 
-  // If the intersection is empty, there is nothing to draw.
-  if (target_roi_rect.width <= 0 || target_roi_rect.height <= 0) {
+  return {warped_sprite_size, transform_mat, warped_roi_rect, target_roi_rect};
+}
+
+absl::Status SpriteCalculatorCpu::RenderSingleSprite(
+    const cv::Mat& sprite, const SpritePlacement& placement, cv::Mat* target) {
+  // If the sprite is entirely outside of the target, there is nothing to draw.
+  if (placement.target_roi.empty()) {
     return absl::OkStatus();
   }
 
-  cv::Mat target_roi = (*target)(target_roi_rect);
-
-  // Trim the warped sprite rect to match the dimensions of the target ROI.
-  cv::Rect warped_sprite_rect(0, 0, warped_sprite_size.width,
-                              warped_sprite_size.height);
-  warped_sprite_rect.x += needed_left_margin;
-  warped_sprite_rect.width -= needed_left_margin + needed_right_margin;
-  warped_sprite_rect.y += needed_top_margin;
-  warped_sprite_rect.height -= needed_top_margin + needed_bottom_margin;
+  RET_CHECK_EQ(sprite.type(), CV_8UC4)
+      << "sprite should have an alpha channel.";
+  RET_CHECK(target->type() == CV_8UC3 || target->type() == CV_8UC4)
+      << "target should be an RGB or RGBA Mat.";
+  cv::Mat target_roi = (*target)(placement.target_roi);
 
   // Translate the transform so that we can evaluate only the pixels that show
   // up in the target ROI.
-  transform_mat.at<double>(0, 2) -= warped_sprite_rect.x;
-  transform_mat.at<double>(1, 2) -= warped_sprite_rect.y;
-
-  // Perform the actual warp.
-  cv::Mat warped_sprite(warped_sprite_rect.height, warped_sprite_rect.width,
-                        sprite.type());
-  cv::warpAffine(sprite, warped_sprite, transform_mat, warped_sprite.size());
+  cv::Mat transform_mat = placement.transform.clone();
+  transform_mat.at<double>(0, 2) -= placement.warped_roi.x;
+  transform_mat.at<double>(1, 2) -= placement.warped_roi.y;
 
-  MP_RETURN_IF_ERROR(ComposeNormal(warped_sprite, target_roi));
+  // Warp and compose in a single pass, without a temporary warped sprite.
+  WarpAndComposeNormal(sprite, transform_mat, &target_roi);
   return absl::OkStatus();
 }
 
-absl::Status SpriteCalculatorCpu::Process(CalculatorContext* cc) {
-  const ImageFrame& input_frame =
-      cc->Inputs().Tag(kImageFrameTag).Get<ImageFrame>();
-  std::unique_ptr<ImageFrame> output_frame(new ImageFrame(
-      input_frame.Format(), input_frame.Width(), input_frame.Height()));
+bool SpriteCalculatorCpu::QuantizePose(SpritePose* pose,
+                                       WarpedSpriteKey* key) const {
+  if (pose->scale() <= 0.0f) {
+    return false;
+  }
+  // Scales are quantized logarithmically, so that the relative error is the
+  // same for small and large sprites.
+  const double log_scale_step = std::log1p(scale_quantization_);
+  key->scale_step =
+      static_cast<int>(std::lround(std::log(pose->scale()) / log_scale_step));
+  pose->set_scale(std::exp(key->scale_step * log_scale_step));
+
+  const int steps_per_turn = std::max<int>(
+      1, std::lround(2 * M_PI / rotation_quantization_radians_));
+  const double rotation_step = 2 * M_PI / steps_per_turn;
+  key->rotation_step =
+      static_cast<int>(std::lround(pose->rotation_radians() / rotation_step) %
+                       steps_per_turn);
+  if (key->rotation_step < 0) {
+    key->rotation_step += steps_per_turn;
+  }
+  pose->set_rotation_radians(key->rotation_step * rotation_step);
+  return true;
+}
 
-  cv::Mat output_mat = MatView(output_frame.get());
-  MatView(&input_frame).copyTo(output_mat);
+std::shared_ptr<const SpriteCalculatorCpu::CachedSprite>
+SpriteCalculatorCpu::LookUpCachedSprite(const WarpedSpriteKey& key) {
+  auto it = cache_index_.find(key);
+  if (it == cache_index_.end()) {
+    return nullptr;
+  }
+  cache_.splice(cache_.begin(), cache_, it->second);
+  return it->second->second;
+}
 
-  // Render all the sprites.
+void SpriteCalculatorCpu::InsertCachedSprite(
+    const WarpedSpriteKey& key, std::shared_ptr<const CachedSprite> sprite) {
+  cache_.emplace_front(key, std::move(sprite));
+  cache_index_[key] = cache_.begin();
+  while (static_cast<int>(cache_.size()) > cache_size_) {
+    cache_index_.erase(cache_.back().first);
+    cache_.pop_back();
+  }
+}
+
+absl::Status SpriteCalculatorCpu::Process(CalculatorContext* cc) {
+  // The sprites are drawn in place. The input frame is only copied if other
+  // calculators might want to access it still.
+  const bool yuv = cc->Inputs().HasTag(kYuvImageTag);
+  std::unique_ptr<ImageFrame> output_frame;
+  std::unique_ptr<YUVImage> output_image;
+  cv::Mat output_mat;
+  YuvPlanes output_planes;
+  if (yuv) {
+    ASSIGN_OR_RETURN(output_image,
+                     ConsumeOrCopyYuvImage(cc, cc->Inputs().Tag(kYuvImageTag)));
+    ASSIGN_OR_RETURN(output_planes, GetYuvPlanes(*output_image));
+  } else {
+    ASSIGN_OR_RETURN(output_frame,
+                     ConsumeOrCopyImageFrame(
+                         cc, cc->Inputs().Tag(kImageFrameTag), pool_.get()));
+    output_mat = MatView(output_frame.get());
+  }
+  // YUV frames are drawn onto through RGB copies of regions.
+  const cv::Size target_size =
+      yuv ? output_planes[0].size() : output_mat.size();
+  const int target_type = yuv ? CV_8UC3 : output_mat.type();
+
+  // Place all the sprites first, so that the ones that don't overlap can be
+  // rendered in parallel, and look them up in the cache.
   const auto& all_sprites = cc->Inputs().Tag(kSpritesTag).Get<SpriteList>();
-  for (const auto& sprite : all_sprites) {
+  const int num_sprites = all_sprites.size();
+  std::vector<cv::Mat> sources;
+  std::vector<SpritePlacement> placements;
+  std::vector<cv::Rect> target_rois;
+  std::vector<std::shared_ptr<const CachedSprite>> cached_sprites(num_sprites);
+  // Sprites missing from the cache, by key, and the first sprite to use them.
+  absl::flat_hash_map<WarpedSpriteKey, int> missed_keys;
+  std::vector<WarpedSpriteKey> keys(num_sprites);
+  std::vector<int> missed_sprites;
+  sources.reserve(num_sprites);
+  placements.reserve(num_sprites);
+  target_rois.reserve(num_sprites);
+  int num_hits = 0;
+  for (int i = 0; i < num_sprites; ++i) {
+    const SpriteListElement& sprite = all_sprites[i];
     MP_RETURN_IF_ERROR(sprite.image_packet.ValidateAsType<ImageFrame>());
     const auto& sprite_frame = sprite.image_packet.Get<ImageFrame>();
-    const auto& pose = sprite.pose;
-    MP_RETURN_IF_ERROR(
-        RenderSingleSprite(MatView(&sprite_frame), pose, &output_mat));
+    const SpriteMipmap* mipmap = nullptr;
+    if (!sprite.mipmap_packet.IsEmpty()) {
+      MP_RETURN_IF_ERROR(sprite.mipmap_packet.ValidateAsType<SpriteMipmap>());
+      mipmap = &sprite.mipmap_packet.Get<SpriteMipmap>();
+    }
+
+    SpritePose pose = sprite.pose;
+    const bool cacheable = cache_size_ > 0 && QuantizePose(&pose, &keys[i]);
+    float scale = pose.scale();
+    sources.push_back(
+        SelectSpriteMipmapLevel(MatView(&sprite_frame), mipmap, &scale));
+    pose.set_scale(scale);
+    placements.push_back(PlaceSprite(sources.back().size(), pose, target_size));
+    // In YUV frames, sprites cover whole chroma samples, so the regions of
+    // sprites that share none can be drawn in parallel.
+    target_rois.push_back(
+        yuv ? ChromaAlignedRect(placements.back().target_roi, target_size)
+            : placements.back().target_roi);
+
+    if (!cacheable || placements.back().target_roi.empty()) {
+      continue;
+    }
+    keys[i].image = &sprite_frame;
+    keys[i].target_type = target_type;
+    cached_sprites[i] = LookUpCachedSprite(keys[i]);
+    if (cached_sprites[i] != nullptr || missed_keys.contains(keys[i])) {
+      ++num_hits;
+    } else {
+      missed_keys[keys[i]] = missed_sprites.size();
+      missed_sprites.push_back(i);
+    }
+  }
+
+  if (cache_size_ > 0) {
+    cc->GetCounter(absl::StrCat(cc->NodeName(), kCacheHitsCounterSuffix))
+        ->IncrementBy(num_hits);
+    cc->GetCounter(absl::StrCat(cc->NodeName(), kCacheMissesCounterSuffix))
+        ->IncrementBy(missed_sprites.size());
+  }
+
+  // Warp the whole sprites missing from the cache, all in parallel.
+  std::vector<std::shared_ptr<const CachedSprite>> warped_sprites(
+      missed_sprites.size());
+  MP_RETURN_IF_ERROR(ParallelFor(
+      missed_sprites.size(), thread_pool_.get(), [&](int m) -> absl::Status {
+        const int i = missed_sprites[m];
+        cv::Mat warped_sprite;
+        cv::warpAffine(sources[i], warped_sprite, placements[i].transform,
+                       placements[i].warped_size);
+        ASSIGN_OR_RETURN(
+            ComposableSprite composable,
+            PrepareForComposition(warped_sprite, target_type));
+        warped_sprites[m] = std::make_shared<const CachedSprite>(
+            CachedSprite{all_sprites[i].image_packet, std::move(composable)});
+        return absl::OkStatus();
+      }));
+  for (size_t m = 0; m < missed_sprites.size(); ++m) {
+    InsertCachedSprite(keys[missed_sprites[m]], warped_sprites[m]);
+  }
+  for (int i = 0; i < num_sprites; ++i) {
+    if (cached_sprites[i] == nullptr && missed_keys.contains(keys[i]) &&
+        keys[i].image != nullptr) {
+      cached_sprites[i] = warped_sprites[missed_keys[keys[i]]];
+    }
+  }
+
+  // Render all the sprites.
+  const auto render_sprite = [&](int i, const SpritePlacement& placement,
+                                 cv::Mat* target) -> absl::Status {
+    if (cached_sprites[i] == nullptr) {
+      return RenderSingleSprite(sources[i], placement, target);
+    }
+    cv::Mat target_roi = (*target)(placement.target_roi);
+    ComposePrepared(cached_sprites[i]->sprite, placement.warped_roi,
+                    target_roi);
+    return absl::OkStatus();
+  };
+  if (!yuv) {
+    MP_RETURN_IF_ERROR(ProcessRegionsInParallel(
+        target_rois, thread_pool_.get(),
+        [&](int i) { return render_sprite(i, placements[i], &output_mat); }));
+    cc->Outputs()
+        .Tag(kImageFrameTag)
+        .Add(output_frame.release(), cc->InputTimestamp());
+    return absl::OkStatus();
   }
 
+  MP_RETURN_IF_ERROR(ProcessRegionsInParallel(
+      target_rois, thread_pool_.get(), [&](int i) -> absl::Status {
+        const cv::Rect& region = target_rois[i];
+        if (region.empty()) {
+          return absl::OkStatus();
+        }
+        const YuvPlanes region_planes = CropYuvPlanes(output_planes, region);
+        cv::Mat region_rgb(region.size(), CV_8UC3);
+        YuvPlanesToRgb(region_planes, region_rgb);
+        SpritePlacement placement = placements[i];
+        placement.target_roi -= region.tl();
+        MP_RETURN_IF_ERROR(render_sprite(i, placement, &region_rgb));
+        RgbToYuvPlanes(region_rgb, region_planes);
+        return absl::OkStatus();
+      }));
   cc->Outputs()
-      .Tag(kImageFrameTag)
-      .Add(output_frame.release(), cc->InputTimestamp());
+      .Tag(kYuvImageTag)
+      .Add(output_image.release(), cc->InputTimestamp());
   return absl::OkStatus();
 }
 }  // namespace magritte
@@ -13,23 +13,29 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 //
+#include <cstdint>
 #include <memory>
+#include <string>
 #include <vector>
 
 #include "mediapipe/framework/formats/image_frame_opencv.h"
 #include  <opencv2/imgcodecs.hpp>
 #include  <opencv2/imgproc.hpp>
 #include "absl/memory/memory.h"
+#include "magritte/calculators/sprite_calculator.pb.h"
 #include "magritte/calculators/sprite_list.h"
 #include "magritte/calculators/sprite_pose.pb.h"
+#include "magritte/calculators/yuv_image_util.h"
 #include "mediapipe/framework/calculator_framework.h"
 #include "mediapipe/framework/calculator_runner.h"
 #include "mediapipe/framework/formats/image_frame.h"
+#include "mediapipe/framework/formats/yuv_image.h"
 #include "mediapipe/framework/port/gmock.h"
 #include "mediapipe/framework/port/gtest.h"
 #include "mediapipe/framework/port/parse_text_proto.h"
 #include "mediapipe/framework/port/status_matchers.h"
 #include "mediapipe/framework/tool/test_util.h"
+#include "libyuv/video_common.h"
 
 namespace magritte {
 namespace {
@@ -40,10 +46,12 @@ using ::mediapipe::ImageFormat;
 using ::mediapipe::ImageFrame;
 using ::mediapipe::Packet;
 using ::mediapipe::Timestamp;
+using ::mediapipe::YUVImage;
 using ::mediapipe::formats::MatView;
 
 constexpr char kImageFrameTag[] = "IMAGE";
 constexpr char kSpritesTag[] = "SPRITES";
+constexpr char kYuvImageTag[] = "YUV_IMAGE";
 
 constexpr char kSpriteBackgroundPath[] =
     "magritte/test_data/sprite_background.png";
@@ -59,6 +67,32 @@ constexpr char kCalculatorGraphProto[] = R"pb(
   output_stream: "IMAGE:composited_result"
 )pb";
 
+constexpr char kParallelCalculatorGraphProto[] = R"pb(
+  calculator: "SpriteCalculatorCpu"
+  input_stream: "IMAGE:background_video"
+  input_stream: "SPRITES:sprites"
+  output_stream: "IMAGE:composited_result"
+  options {
+    [magritte.SpriteCalculatorOptions.ext] { num_threads: 4 }
+  }
+)pb";
+
+// Quantization steps that keep the scale of 2 and the 90 degree rotations of
+// the four sprite pattern exact.
+constexpr char kCachedCalculatorGraphProto[] = R"pb(
+  calculator: "SpriteCalculatorCpu"
+  input_stream: "IMAGE:background_video"
+  input_stream: "SPRITES:sprites"
+  output_stream: "IMAGE:composited_result"
+  options {
+    [magritte.SpriteCalculatorOptions.ext] {
+      cache_size: 8
+      scale_quantization: 1.0
+      rotation_quantization_degrees: 90.0
+    }
+  }
+)pb";
+
 std::unique_ptr<ImageFrame> LoadRgbaPng(std::string filename) {
   cv::Mat mat = cv::imread(filename, cv::IMREAD_UNCHANGED);
   cv::cvtColor(mat, mat, cv::COLOR_BGRA2RGBA);
@@ -70,9 +104,10 @@ std::unique_ptr<ImageFrame> LoadRgbaPng(std::string filename) {
 
 // Sets up the input and output streams, runs the calculator on them, and
 // returns a Packet containing the corresponding ImageFrame.
-Packet RunCalculatorWithInput(std::unique_ptr<ImageFrame> background,
-                              std::unique_ptr<ImageFrame> sprite,
-                              const std::vector<SpritePose>& poses) {
+Packet RunCalculatorWithInput(
+    std::unique_ptr<ImageFrame> background, std::unique_ptr<ImageFrame> sprite,
+    const std::vector<SpritePose>& poses,
+    const std::string& node_config = kCalculatorGraphProto) {
   Packet background_packet =
       mediapipe::Adopt(background.release()).At(Timestamp(0));
   Packet sprite_frame_packet =
@@ -87,7 +122,7 @@ Packet RunCalculatorWithInput(std::unique_ptr<ImageFrame> background,
 
   CalculatorGraphConfig::Node config_node =
       mediapipe::ParseTextProtoOrDie<mediapipe::CalculatorGraphConfig::Node>(
-          kCalculatorGraphProto);
+          node_config);
 
   CalculatorRunner runner(config_node);
   runner.MutableInputs()
@@ -106,16 +141,9 @@ Packet RunCalculatorWithInput(std::unique_ptr<ImageFrame> background,
   return output[0];
 }
 
-// Tests stamping a pattern of sprites with alpha over a background with scaling
-// and 90 degree rotations and compares it to a golden result.
-TEST(SpriteCpuCalculatorTest, FourSpriteStamp) {
-  std::unique_ptr<ImageFrame> background_frame =
-      LoadRgbaPng(kSpriteBackgroundPath);
-  std::unique_ptr<ImageFrame> sprite_frame =
-      LoadRgbaPng(kSpritePremultipliedPath);
-  std::unique_ptr<ImageFrame> expected_result_frame =
-      LoadRgbaPng(kSpriteCompositedPath);
-
+// Returns the poses of a pattern of four sprites with scaling and 90 degree
+// rotations, matching kSpriteCompositedPath.
+std::vector<SpritePose> FourSpritePoses() {
   std::vector<SpritePose> poses;
   SpritePose pose;
   pose.set_scale(2.0f);
@@ -138,9 +166,22 @@ TEST(SpriteCpuCalculatorTest, FourSpriteStamp) {
   pose.set_position_y(0.75f);
   pose.set_rotation_radians(M_PI / 2);
   poses.push_back(pose);
+  return poses;
+}
 
-  Packet result_packet = RunCalculatorWithInput(std::move(background_frame),
-                                                std::move(sprite_frame), poses);
+// Tests stamping a pattern of sprites with alpha over a background with scaling
+// and 90 degree rotations and compares it to a golden result.
+TEST(SpriteCpuCalculatorTest, FourSpriteStamp) {
+  std::unique_ptr<ImageFrame> background_frame =
+      LoadRgbaPng(kSpriteBackgroundPath);
+  std::unique_ptr<ImageFrame> sprite_frame =
+      LoadRgbaPng(kSpritePremultipliedPath);
+  std::unique_ptr<ImageFrame> expected_result_frame =
+      LoadRgbaPng(kSpriteCompositedPath);
+
+  Packet result_packet =
+      RunCalculatorWithInput(std::move(background_frame),
+                             std::move(sprite_frame), FourSpritePoses());
   auto& result_frame = result_packet.Get<ImageFrame>();
 
   std::string comparison_error;
@@ -150,6 +191,85 @@ TEST(SpriteCpuCalculatorTest, FourSpriteStamp) {
       << comparison_error;
 }
 
+// Tests that drawing sprites in parallel gives the same result as drawing them
+// sequentially, including for sprites that overlap.
+TEST(SpriteCpuCalculatorTest, FourSpriteStampInParallel) {
+  std::unique_ptr<ImageFrame> background_frame =
+      LoadRgbaPng(kSpriteBackgroundPath);
+  std::unique_ptr<ImageFrame> sprite_frame =
+      LoadRgbaPng(kSpritePremultipliedPath);
+
+  std::vector<SpritePose> poses = FourSpritePoses();
+  // Draw every sprite twice, so that each one overlaps its own copy.
+  const std::vector<SpritePose> first = poses;
+  poses.insert(poses.end(), first.begin(), first.end());
+
+  Packet result_packet = RunCalculatorWithInput(
+      std::move(background_frame), std::move(sprite_frame), poses,
+      kParallelCalculatorGraphProto);
+  auto& result_frame = result_packet.Get<ImageFrame>();
+
+  Packet sequential_packet = RunCalculatorWithInput(
+      LoadRgbaPng(kSpriteBackgroundPath), LoadRgbaPng(kSpritePremultipliedPath),
+      poses);
+
+  std::string comparison_error;
+  EXPECT_TRUE(mediapipe::CompareImageFrames(
+      result_frame, sequential_packet.Get<ImageFrame>(),
+      /*max_color_diff=*/0.0, /*max_alpha_diff=*/0.0, /*max_avg_diff=*/0.0,
+      &comparison_error))
+      << comparison_error;
+}
+
+// Tests that sprites warped for the first frame are reused for the next frames,
+// and still match the golden result.
+TEST(SpriteCpuCalculatorTest, FourSpriteStampCachedAcrossFrames) {
+  const Packet sprite_frame_packet =
+      mediapipe::Adopt(LoadRgbaPng(kSpritePremultipliedPath).release());
+  std::unique_ptr<ImageFrame> expected_result_frame =
+      LoadRgbaPng(kSpriteCompositedPath);
+
+  CalculatorRunner runner(
+      mediapipe::ParseTextProtoOrDie<mediapipe::CalculatorGraphConfig::Node>(
+          kCachedCalculatorGraphProto));
+  constexpr int kNumFrames = 3;
+  for (int t = 0; t < kNumFrames; ++t) {
+    auto sprite_list = std::make_unique<SpriteList>();
+    for (const auto& pose : FourSpritePoses()) {
+      sprite_list->push_back(SpriteListElement(sprite_frame_packet, pose));
+    }
+    runner.MutableInputs()
+        ->Tag(kImageFrameTag)
+        .packets.push_back(
+            mediapipe::Adopt(LoadRgbaPng(kSpriteBackgroundPath).release())
+                .At(Timestamp(t)));
+    runner.MutableInputs()
+        ->Tag(kSpritesTag)
+        .packets.push_back(
+            mediapipe::Adopt(sprite_list.release()).At(Timestamp(t)));
+  }
+
+  MP_ASSERT_OK(runner.Run());
+  const std::vector<Packet>& output =
+      runner.Outputs().Tag(kImageFrameTag).packets;
+  ASSERT_EQ(output.size(), kNumFrames);
+
+  // The four sprites have different rotations, so they are warped once each.
+  EXPECT_EQ(runner.GetCounter("SpriteCalculatorCpu/SpriteCacheMisses")->Get(),
+            4);
+  EXPECT_EQ(runner.GetCounter("SpriteCalculatorCpu/SpriteCacheHits")->Get(),
+            4 * (kNumFrames - 1));
+
+  for (const Packet& packet : output) {
+    std::string comparison_error;
+    EXPECT_TRUE(mediapipe::CompareImageFrames(
+        packet.Get<ImageFrame>(), *expected_result_frame,
+        /*max_color_diff=*/0.0, /*max_alpha_diff=*/0.0, /*max_avg_diff=*/0.0,
+        &comparison_error))
+        << comparison_error;
+  }
+}
+
 // Tests stamping one big sprite to cover the background. This is testing that
 // off screen pixels don't break anything.
 TEST(SpriteCpuCalculatorTest, OneReallyBigStamp) {
@@ -186,5 +306,120 @@ TEST(SpriteCpuCalculatorTest, OneReallyBigStamp) {
       << comparison_error;
 }
 
+// Tests that a background frame that is still referenced elsewhere is copied
+// instead of being drawn on in place.
+TEST(SpriteCpuCalculatorTest, SharedBackgroundIsCopied) {
+  std::unique_ptr<ImageFrame> background_frame =
+      LoadRgbaPng(kSpriteBackgroundPath);
+  std::unique_ptr<ImageFrame> expected_background_frame =
+      LoadRgbaPng(kSpriteBackgroundPath);
+  std::unique_ptr<ImageFrame> sprite_frame =
+      LoadRgbaPng(kSpritePremultipliedPath);
+
+  SpritePose pose;
+  pose.set_scale(2.0f);
+  pose.set_position_x(0.5f);
+  pose.set_position_y(0.5f);
+  auto sprite_list = std::make_unique<SpriteList>();
+  sprite_list->push_back(SpriteListElement(
+      mediapipe::Adopt(sprite_frame.release()).At(Timestamp(0)), pose));
+
+  // The runner keeps a reference to its input packets, so the calculator
+  // cannot take over the background frame.
+  const Packet background_packet =
+      mediapipe::Adopt(background_frame.release()).At(Timestamp(0));
+  CalculatorRunner runner(
+      mediapipe::ParseTextProtoOrDie<mediapipe::CalculatorGraphConfig::Node>(
+          kCalculatorGraphProto));
+  runner.MutableInputs()
+      ->Tag(kImageFrameTag)
+      .packets.push_back(background_packet);
+  runner.MutableInputs()
+      ->Tag(kSpritesTag)
+      .packets.push_back(
+          mediapipe::Adopt(sprite_list.release()).At(Timestamp(0)));
+
+  MP_ASSERT_OK(runner.Run());
+  ASSERT_EQ(runner.Outputs().Tag(kImageFrameTag).packets.size(), 1);
+
+  EXPECT_EQ(runner.GetCounter("SpriteCalculatorCpu/FramesCopied")->Get(), 1);
+  EXPECT_EQ(runner.GetCounter("SpriteCalculatorCpu/FramesConsumed")->Get(), 0);
+
+  std::string comparison_error;
+  EXPECT_TRUE(mediapipe::CompareImageFrames(
+      background_packet.Get<ImageFrame>(), *expected_background_frame,
+      /*max_color_diff=*/0.0, /*max_alpha_diff=*/0.0, /*max_avg_diff=*/0.0,
+      &comparison_error))
+      << comparison_error;
+}
+
+class SpriteCpuCalculatorYuvTest : public testing::TestWithParam<uint32_t> {};
+
+// Tests stamping an opaque sprite onto a YUV image, which must only change the
+// region covered by the sprite.
+TEST_P(SpriteCpuCalculatorYuvTest, StampsOnlyTheSpriteRegion) {
+  const cv::Scalar gray(128, 128, 128);
+  const cv::Scalar red(200, 40, 40);
+  ASSERT_OK_AND_ASSIGN(std::unique_ptr<YUVImage> background,
+                       MakeYuvImage(GetParam(), 64, 64));
+  ASSERT_OK_AND_ASSIGN(const YuvPlanes background_planes,
+                       GetYuvPlanes(*background));
+  RgbToYuvPlanes(cv::Mat(64, 64, CV_8UC3, gray), background_planes);
+  const cv::Mat background_luma = background_planes[0].clone();
+
+  auto sprite_frame = std::make_unique<ImageFrame>(ImageFormat::SRGBA,
+                                                   /*width=*/8, /*height=*/8);
+  MatView(sprite_frame.get()).setTo(cv::Scalar(red[0], red[1], red[2], 255));
+  SpritePose pose;
+  pose.set_scale(2.0f);
+  pose.set_position_x(0.5f);
+  pose.set_position_y(0.5f);
+  auto sprite_list = std::make_unique<SpriteList>();
+  sprite_list->push_back(SpriteListElement(
+      mediapipe::Adopt(sprite_frame.release()).At(Timestamp(0)), pose));
+
+  CalculatorRunner runner(
+      mediapipe::ParseTextProtoOrDie<mediapipe::CalculatorGraphConfig::Node>(
+          R"pb(
+            calculator: "SpriteCalculatorCpu"
+            input_stream: "YUV_IMAGE:background_video"
+            input_stream: "SPRITES:sprites"
+            output_stream: "YUV_IMAGE:composited_result"
+          )pb"));
+  runner.MutableInputs()
+      ->Tag(kYuvImageTag)
+      .packets.push_back(
+          mediapipe::Adopt(background.release()).At(Timestamp(0)));
+  runner.MutableInputs()
+      ->Tag(kSpritesTag)
+      .packets.push_back(
+          mediapipe::Adopt(sprite_list.release()).At(Timestamp(0)));
+
+  MP_ASSERT_OK(runner.Run());
+  const std::vector<Packet>& output =
+      runner.Outputs().Tag(kYuvImageTag).packets;
+  ASSERT_EQ(output.size(), 1);
+  ASSERT_OK_AND_ASSIGN(const YuvPlanes planes,
+                       GetYuvPlanes(output[0].Get<YUVImage>()));
+  cv::Mat result(64, 64, CV_8UC3);
+  YuvPlanesToRgb(planes, result);
+
+  // The sprite covers the 16x16 pixels around the center.
+  const cv::Rect inside(28, 28, 8, 8);
+  EXPECT_LE(cv::norm(result(inside), cv::Mat(inside.size(), CV_8UC3, red),
+                     cv::NORM_INF),
+            3.0);
+  // The top of the frame is never converted to RGB.
+  const cv::Rect outside(0, 0, 64, 16);
+  EXPECT_EQ(cv::norm(planes[0](outside), background_luma(outside),
+                     cv::NORM_INF),
+            0.0);
+}
+
+INSTANTIATE_TEST_SUITE_P(SpriteCpuCalculatorYuvTests,
+                         SpriteCpuCalculatorYuvTest,
+                         testing::Values(libyuv::FOURCC_I420,
+                                         libyuv::FOURCC_NV12));
+
 }  // namespace
 }  // namespace magritte
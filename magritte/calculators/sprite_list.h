@@ -28,7 +28,8 @@ namespace magritte {
 // background.
 struct SpriteListElement {
   SpriteListElement() {}
-  SpriteListElement(const mediapipe::Packet& image_packet, const SpritePose& pose)
+  SpriteListElement(const mediapipe::Packet& image_packet,
+                    const SpritePose& pose)
       : image_packet(image_packet), pose(pose) {}
 
   // This packet contains the image used to render the sprite. In CPU pipelines,
@@ -36,6 +37,9 @@ struct SpriteListElement {
   // GpuBuffer. The image is assumed to have a premultiplied alpha channel.
   mediapipe::Packet image_packet;
   SpritePose pose;
+  // Optional, CPU pipelines only: a packet containing the SpriteMipmap of the
+  // image (see sprite_mipmap.h), used to draw sprites that are scaled down.
+  mediapipe::Packet mipmap_packet;
 };
 
 typedef std::vector<SpriteListElement> SpriteList;
@@ -0,0 +1,57 @@
+//
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+#include "magritte/calculators/sprite_mipmap.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include  <opencv2/core.hpp>
+#include  <opencv2/imgproc.hpp>
+
+namespace magritte {
+
+SpriteMipmap BuildSpriteMipmap(const cv::Mat& sprite) {
+  SpriteMipmap mipmap;
+  cv::Mat previous = sprite;
+  while (previous.cols / 2 >= kMinSpriteMipmapSize &&
+         previous.rows / 2 >= kMinSpriteMipmapSize) {
+    cv::Mat level;
+    cv::resize(previous, level, cv::Size(previous.cols / 2, previous.rows / 2),
+               0, 0, cv::INTER_AREA);
+    mipmap.levels.push_back(level);
+    previous = level;
+  }
+  return mipmap;
+}
+
+const cv::Mat& SelectSpriteMipmapLevel(const cv::Mat& sprite,
+                                       const SpriteMipmap* mipmap,
+                                       float* scale) {
+  if (mipmap == nullptr || mipmap->levels.empty() || *scale > 0.5f ||
+      *scale <= 0.0f) {
+    return sprite;
+  }
+  // The smallest level that is still scaled down when drawn, by less than half,
+  // which bilinear interpolation handles without aliasing.
+  const int level = std::min<int>(
+      static_cast<int>(std::floor(std::log2(1.0f / *scale))) - 1,
+      mipmap->levels.size() - 1);
+  const cv::Mat& level_image = mipmap->levels[level];
+  *scale *= static_cast<float>(sprite.cols) / level_image.cols;
+  return level_image;
+}
+
+}  // namespace magritte
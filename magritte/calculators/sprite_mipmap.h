@@ -0,0 +1,50 @@
+//
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+#ifndef MAGRITTE_CALCULATORS_SPRITE_MIPMAP_H_
+#define MAGRITTE_CALCULATORS_SPRITE_MIPMAP_H_
+
+#include <vector>
+
+#include  <opencv2/core.hpp>
+
+namespace magritte {
+
+// Downscaled versions of a sprite image, so that drawing a sprite much smaller
+// than its image neither has to filter the full image nor aliases.
+struct SpriteMipmap {
+  // Level i has half the width and height of level i - 1, where level -1 is
+  // the sprite image itself, which is not included. Levels are computed with
+  // area averaging, and stop before either dimension gets below
+  // kMinSpriteMipmapSize.
+  std::vector<cv::Mat> levels;
+};
+
+constexpr int kMinSpriteMipmapSize = 4;
+
+// Builds the mipmap of a sprite image. Since levels are averaged, the image
+// should have a premultiplied alpha channel.
+SpriteMipmap BuildSpriteMipmap(const cv::Mat& sprite);
+
+// Returns the mipmap level to draw a sprite of the given size with the given
+// scale, and updates the scale relative to that level. Returns the sprite
+// itself if it is not scaled down by at least half, or if there is no mipmap.
+const cv::Mat& SelectSpriteMipmapLevel(const cv::Mat& sprite,
+                                       const SpriteMipmap* mipmap,
+                                       float* scale);
+
+}  // namespace magritte
+
+#endif  // MAGRITTE_CALCULATORS_SPRITE_MIPMAP_H_
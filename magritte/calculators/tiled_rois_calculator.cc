@@ -0,0 +1,139 @@
+//
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+#include <vector>
+
+#include "magritte/calculators/tiled_rois_calculator.pb.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/formats/rect.pb.h"
+#include "mediapipe/framework/port/ret_check.h"
+
+namespace magritte {
+namespace {
+using ::mediapipe::CalculatorBase;
+using ::mediapipe::CalculatorContext;
+using ::mediapipe::CalculatorContract;
+using ::mediapipe::NormalizedRect;
+
+constexpr char kTickTag[] = "TICK";
+constexpr char kRegionOfInterestTag[] = "ROI";
+
+// Returns the size of a tile, relative to the image size, such that num_tiles
+// tiles overlapping by the given fraction of their size cover the image.
+float TileSize(int num_tiles, float overlap) {
+  return 1.0f / (num_tiles - (num_tiles - 1) * overlap);
+}
+}  // namespace
+
+// A calculator that cuts the image into a grid of overlapping tiles, output as
+// ROIs, e.g. to detect faces that are too small to be found once the whole
+// high-resolution image is scaled down to the input of a detection model.
+//
+// The tiles have the same size and cover the whole image. Each tile overlaps
+// with the next one in its row and in its column by the given fraction of its
+// size, so that faces smaller than the overlap are entirely inside a tile.
+// Detections in the ROIs, e.g. by FaceDetectionFullRangeByRoiSubgraphCpu, are
+// in the coordinates of the whole image, and meant to be merged with a
+// non-max suppression.
+//
+// Inputs:
+// - TICK: A packet of any type for every frame, e.g. the input image.
+//
+// Outputs:
+// - ROI:0, ..., ROI:<rows * cols - 1>: The tiles as NormalizedRect, row by
+//   row.
+//
+// Options:
+// - rows, cols: The size of the grid. Default is 3x3.
+// - overlap: The fraction of a tile's size that overlaps with the next tile.
+//   Default is 0.2.
+//
+// Example config:
+// node {
+//   calculator: "TiledRoisCalculator"
+//   input_stream: "TICK:input_video"
+//   output_stream: "ROI:0:tile0"
+//   output_stream: "ROI:1:tile1"
+//   output_stream: "ROI:2:tile2"
+//   output_stream: "ROI:3:tile3"
+//   options: {
+//     [magritte.TiledRoisCalculatorOptions.ext] {
+//       rows: 2
+//       cols: 2
+//       overlap: 0.2
+//     }
+//   }
+// }
+class TiledRoisCalculator : public CalculatorBase {
+ public:
+  TiledRoisCalculator() = default;
+  ~TiledRoisCalculator() override = default;
+
+  static absl::Status GetContract(CalculatorContract* cc) {
+    const auto& options = cc->Options<TiledRoisCalculatorOptions>();
+    RET_CHECK(options.rows() >= 1 && options.cols() >= 1)
+        << "The grid must have at least one row and one column.";
+    RET_CHECK(options.overlap() >= 0.0f && options.overlap() < 1.0f)
+        << "overlap must be in [0, 1).";
+    RET_CHECK(cc->Inputs().HasTag(kTickTag))
+        << "Missing input " << kTickTag << " tag.";
+    cc->Inputs().Tag(kTickTag).SetAny();
+    RET_CHECK_EQ(cc->Outputs().NumEntries(kRegionOfInterestTag),
+                 options.rows() * options.cols())
+        << "Calculator must have one ROI output per tile.";
+    for (int i = 0; i < cc->Outputs().NumEntries(kRegionOfInterestTag); ++i) {
+      cc->Outputs().Get(kRegionOfInterestTag, i).Set<NormalizedRect>();
+    }
+    // No input side packets.
+    return absl::OkStatus();
+  }
+
+  absl::Status Open(CalculatorContext* cc) override {
+    cc->SetOffset(mediapipe::TimestampDiff(0));
+    const auto& options = cc->Options<TiledRoisCalculatorOptions>();
+    const float width = TileSize(options.cols(), options.overlap());
+    const float height = TileSize(options.rows(), options.overlap());
+    for (int row = 0; row < options.rows(); ++row) {
+      for (int col = 0; col < options.cols(); ++col) {
+        NormalizedRect tile;
+        tile.set_x_center(width * (0.5f + col * (1.0f - options.overlap())));
+        tile.set_y_center(height * (0.5f + row * (1.0f - options.overlap())));
+        tile.set_width(width);
+        tile.set_height(height);
+        tiles_.push_back(tile);
+      }
+    }
+    return absl::OkStatus();
+  }
+
+  absl::Status Process(CalculatorContext* cc) override {
+    const int num_tiles = static_cast<int>(tiles_.size());
+    for (int i = 0; i < num_tiles; ++i) {
+      cc->Outputs()
+          .Get(kRegionOfInterestTag, i)
+          .AddPacket(mediapipe::MakePacket<NormalizedRect>(tiles_[i]).At(
+              cc->InputTimestamp()));
+    }
+    return absl::OkStatus();
+  }
+
+ private:
+  // The tiles, row by row.
+  std::vector<NormalizedRect> tiles_;
+};
+
+REGISTER_CALCULATOR(TiledRoisCalculator);
+
+}  // namespace magritte
@@ -0,0 +1,87 @@
+//
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+#include "magritte/calculators/tiled_rois_calculator.pb.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/calculator_runner.h"
+#include "mediapipe/framework/formats/rect.pb.h"
+#include "mediapipe/framework/port/gmock.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/parse_text_proto.h"
+#include "mediapipe/framework/port/status_matchers.h"
+
+namespace magritte {
+namespace {
+
+using ::mediapipe::CalculatorRunner;
+using ::mediapipe::MakePacket;
+using ::mediapipe::NormalizedRect;
+using ::mediapipe::Timestamp;
+
+constexpr char kNodeConfig[] = R"pb(
+  calculator: "TiledRoisCalculator"
+  input_stream: "TICK:tick"
+  output_stream: "ROI:0:tile0"
+  output_stream: "ROI:1:tile1"
+  output_stream: "ROI:2:tile2"
+  output_stream: "ROI:3:tile3"
+  options {
+    [magritte.TiledRoisCalculatorOptions.ext] {
+      rows: 2
+      cols: 2
+      overlap: 0.2
+    }
+  }
+)pb";
+
+TEST(TiledRoisCalculatorTest, CoversImageWithOverlappingTiles) {
+  CalculatorRunner runner(
+      mediapipe::ParseTextProtoOrDie<mediapipe::CalculatorGraphConfig::Node>(
+          kNodeConfig));
+  runner.MutableInputs()->Tag("TICK").packets.push_back(
+      MakePacket<int>(0).At(Timestamp(0)));
+
+  MP_ASSERT_OK(runner.Run());
+  // Tiles of size 1 / 1.8 start at 0 and end at 1.
+  const float size = 1.0f / 1.8f;
+  const float centers[] = {size / 2, 1.0f - size / 2};
+  for (int i = 0; i < 4; ++i) {
+    const auto& packets = runner.Outputs().Get("ROI", i).packets;
+    ASSERT_EQ(packets.size(), 1);
+    const auto& tile = packets[0].Get<NormalizedRect>();
+    EXPECT_NEAR(tile.x_center(), centers[i % 2], 1e-6);
+    EXPECT_NEAR(tile.y_center(), centers[i / 2], 1e-6);
+    EXPECT_NEAR(tile.width(), size, 1e-6);
+    EXPECT_NEAR(tile.height(), size, 1e-6);
+    EXPECT_EQ(tile.rotation(), 0.0f);
+  }
+}
+
+TEST(TiledRoisCalculatorTest, RequiresOneOutputPerTile) {
+  auto node =
+      mediapipe::ParseTextProtoOrDie<mediapipe::CalculatorGraphConfig::Node>(
+          kNodeConfig);
+  node.mutable_options()
+      ->MutableExtension(TiledRoisCalculatorOptions::ext)
+      ->set_rows(3);
+  CalculatorRunner runner(node);
+  runner.MutableInputs()->Tag("TICK").packets.push_back(
+      MakePacket<int>(0).At(Timestamp(0)));
+
+  EXPECT_FALSE(runner.Run().ok());
+}
+
+}  // namespace
+}  // namespace magritte
@@ -0,0 +1,136 @@
+//
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_set.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/formats/detection.pb.h"
+#include "mediapipe/framework/port/ret_check.h"
+
+namespace magritte {
+namespace {
+using ::mediapipe::CalculatorBase;
+using ::mediapipe::CalculatorContext;
+using ::mediapipe::CalculatorContract;
+using ::mediapipe::Detection;
+using Detections = std::vector<Detection>;
+
+constexpr char kDetectionsTag[] = "DETECTIONS";
+constexpr char kResetTag[] = "RESET";
+}  // namespace
+
+// A calculator that drops the tracked detections whose tracks started before
+// the last reset, e.g. a scene cut, as if the tracker had been reset.
+//
+// The MediaPipe tracker can't be reset, and keeps tracking the boxes of the
+// previous shot after a scene cut until it loses them. This calculator drops
+// those tracks from its output, and only keeps the tracks started from the
+// detections after the cut. Since the tracker gives each track a unique ID, in
+// detection_id, the dropped tracks are those already tracked in the last frame
+// before the cut.
+//
+// Inputs:
+// - DETECTIONS: The tracked detections, as std::vector<Detection>.
+// - RESET: A packet of any type for the frames that reset the tracks, e.g. the
+//   SCENE_CUT output of a SceneCutCalculator.
+//
+// Outputs:
+// - DETECTIONS: The tracked detections whose tracks started since the last
+//   reset.
+//
+// Example config:
+// node {
+//   calculator: "TrackResetCalculator"
+//   input_stream: "DETECTIONS:raw_tracked_detections"
+//   input_stream: "RESET:scene_cut"
+//   output_stream: "DETECTIONS:tracked_detections"
+// }
+class TrackResetCalculator : public CalculatorBase {
+ public:
+  TrackResetCalculator() = default;
+  ~TrackResetCalculator() override = default;
+
+  static absl::Status GetContract(CalculatorContract* cc) {
+    RET_CHECK(cc->Inputs().HasTag(kDetectionsTag))
+        << "Missing input " << kDetectionsTag << " tag.";
+    cc->Inputs().Tag(kDetectionsTag).Set<Detections>();
+    RET_CHECK(cc->Inputs().HasTag(kResetTag))
+        << "Missing input " << kResetTag << " tag.";
+    cc->Inputs().Tag(kResetTag).SetAny();
+    RET_CHECK(cc->Outputs().HasTag(kDetectionsTag))
+        << "Missing output " << kDetectionsTag << " tag.";
+    cc->Outputs().Tag(kDetectionsTag).Set<Detections>();
+    // No input side packets.
+    return absl::OkStatus();
+  }
+
+  absl::Status Open(CalculatorContext* cc) override {
+    cc->SetOffset(mediapipe::TimestampDiff(0));
+    return absl::OkStatus();
+  }
+
+  absl::Status Process(CalculatorContext* cc) override {
+    if (!cc->Inputs().Tag(kResetTag).IsEmpty()) {
+      stale_ids_.insert(previous_ids_.begin(), previous_ids_.end());
+    }
+    if (cc->Inputs().Tag(kDetectionsTag).IsEmpty()) {
+      return absl::OkStatus();
+    }
+
+    const auto& detections = cc->Inputs().Tag(kDetectionsTag).Get<Detections>();
+    if (stale_ids_.empty()) {
+      cc->Outputs()
+          .Tag(kDetectionsTag)
+          .AddPacket(cc->Inputs().Tag(kDetectionsTag).Value());
+    } else {
+      auto output = std::make_unique<Detections>();
+      for (const Detection& detection : detections) {
+        if (!stale_ids_.contains(detection.detection_id())) {
+          output->push_back(detection);
+        }
+      }
+      cc->Outputs()
+          .Tag(kDetectionsTag)
+          .Add(output.release(), cc->InputTimestamp());
+    }
+
+    // Tracks that ended never come back, so only the current IDs are kept.
+    absl::flat_hash_set<int64_t> current_ids;
+    absl::flat_hash_set<int64_t> still_stale_ids;
+    for (const Detection& detection : detections) {
+      current_ids.insert(detection.detection_id());
+      if (stale_ids_.contains(detection.detection_id())) {
+        still_stale_ids.insert(detection.detection_id());
+      }
+    }
+    previous_ids_ = std::move(current_ids);
+    stale_ids_ = std::move(still_stale_ids);
+    return absl::OkStatus();
+  }
+
+ private:
+  // The IDs of the tracks in the last frame with tracked detections.
+  absl::flat_hash_set<int64_t> previous_ids_;
+  // The IDs of the tracks started before the last reset, still tracked.
+  absl::flat_hash_set<int64_t> stale_ids_;
+};
+
+REGISTER_CALCULATOR(TrackResetCalculator);
+
+}  // namespace magritte
@@ -0,0 +1,108 @@
+//
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+#include <cstdint>
+#include <vector>
+
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/calculator_runner.h"
+#include "mediapipe/framework/formats/detection.pb.h"
+#include "mediapipe/framework/port/gmock.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/parse_text_proto.h"
+#include "mediapipe/framework/port/status_matchers.h"
+
+namespace magritte {
+namespace {
+
+using ::mediapipe::CalculatorRunner;
+using ::mediapipe::Detection;
+using ::mediapipe::MakePacket;
+using ::mediapipe::Timestamp;
+using Detections = std::vector<Detection>;
+
+constexpr char kNodeConfig[] = R"pb(
+  calculator: "TrackResetCalculator"
+  input_stream: "DETECTIONS:raw_tracked_detections"
+  input_stream: "RESET:scene_cut"
+  output_stream: "DETECTIONS:tracked_detections"
+)pb";
+
+// Adds the tracked detections with the given track IDs.
+void AddTracks(int timestamp, const std::vector<int64_t>& ids,
+               CalculatorRunner* runner) {
+  Detections detections;
+  for (int64_t id : ids) {
+    detections.emplace_back().set_detection_id(id);
+  }
+  runner->MutableInputs()->Tag("DETECTIONS").packets.push_back(
+      MakePacket<Detections>(detections).At(Timestamp(timestamp)));
+}
+
+void AddReset(int timestamp, CalculatorRunner* runner) {
+  runner->MutableInputs()->Tag("RESET").packets.push_back(
+      MakePacket<bool>(true).At(Timestamp(timestamp)));
+}
+
+std::vector<std::vector<int64_t>> OutputIds(const CalculatorRunner& runner) {
+  std::vector<std::vector<int64_t>> output_ids;
+  for (const auto& packet : runner.Outputs().Tag("DETECTIONS").packets) {
+    std::vector<int64_t> ids;
+    for (const Detection& detection : packet.Get<Detections>()) {
+      ids.push_back(detection.detection_id());
+    }
+    output_ids.push_back(ids);
+  }
+  return output_ids;
+}
+
+TEST(TrackResetCalculatorTest, DropsTracksStartedBeforeReset) {
+  CalculatorRunner runner(
+      mediapipe::ParseTextProtoOrDie<mediapipe::CalculatorGraphConfig::Node>(
+          kNodeConfig));
+  AddTracks(0, {1, 2}, &runner);
+  AddTracks(1, {1, 2, 3}, &runner);
+  // Track 4 starts from a detection on the reset frame.
+  AddReset(2, &runner);
+  AddTracks(2, {1, 2, 3, 4}, &runner);
+  AddTracks(3, {2, 4, 5}, &runner);
+  // Tracks 4 and 5 become stale at a reset on a frame without tracks, and
+  // track 2 is still stale.
+  AddReset(4, &runner);
+  AddTracks(5, {2, 4, 5, 6}, &runner);
+
+  MP_ASSERT_OK(runner.Run());
+  EXPECT_THAT(OutputIds(runner),
+              testing::ElementsAre(
+                  testing::ElementsAre(1, 2), testing::ElementsAre(1, 2, 3),
+                  testing::ElementsAre(4), testing::ElementsAre(4, 5),
+                  testing::ElementsAre(6)));
+}
+
+TEST(TrackResetCalculatorTest, ForwardsTracksWithoutReset) {
+  CalculatorRunner runner(
+      mediapipe::ParseTextProtoOrDie<mediapipe::CalculatorGraphConfig::Node>(
+          kNodeConfig));
+  AddTracks(0, {1}, &runner);
+  AddTracks(1, {1, 2}, &runner);
+
+  MP_ASSERT_OK(runner.Run());
+  EXPECT_THAT(OutputIds(runner),
+              testing::ElementsAre(testing::ElementsAre(1),
+                                   testing::ElementsAre(1, 2)));
+}
+
+}  // namespace
+}  // namespace magritte
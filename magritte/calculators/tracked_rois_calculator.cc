@@ -0,0 +1,187 @@
+//
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "magritte/calculators/tracked_rois_calculator.pb.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/formats/detection.pb.h"
+#include "mediapipe/framework/formats/location_data.pb.h"
+#include "mediapipe/framework/formats/rect.pb.h"
+#include "mediapipe/framework/port/ret_check.h"
+
+namespace magritte {
+namespace {
+using ::mediapipe::CalculatorBase;
+using ::mediapipe::CalculatorContext;
+using ::mediapipe::CalculatorContract;
+using ::mediapipe::Detection;
+using ::mediapipe::NormalizedRect;
+using Detections = std::vector<Detection>;
+
+constexpr char kTickTag[] = "TICK";
+constexpr char kTrackedDetectionsTag[] = "TRACKED_DETECTIONS";
+constexpr char kSceneCutTag[] = "SCENE_CUT";
+constexpr char kRegionOfInterestTag[] = "ROI";
+constexpr char kFullFrameRegionOfInterestTag[] = "FULL_FRAME_ROI";
+
+// Suffix of the counter of frames in which the whole image is scanned, after
+// the node name.
+constexpr char kFullFrameScansCounterSuffix[] = "/FullFrameScans";
+}  // namespace
+
+// A calculator that drives face detection from the faces already tracked, so
+// that its steady-state cost scales with the number of faces rather than with
+// the image size.
+//
+// Each tracked face is enlarged into a crop, output as a ROI, in which a
+// detection subgraph by ROI, e.g. FaceDetectionShortRangeByRoiCpu, finds it
+// again. The whole image is only scanned, to pick up new faces, on a slower
+// schedule: periodically, when there are more tracked faces than crop
+// outputs, and on scene cuts, where the tracked faces are stale. The ROIs are
+// only output when needed, since the detection subgraphs by ROI skip the
+// frames without ROI.
+//
+// The tracked detections are typically those of the previous detection frame,
+// looped back with a PreviousLoopbackCalculator from a tracker downstream.
+//
+// Inputs:
+// - TICK: A packet of any type for every frame, e.g. the input image.
+// - TRACKED_DETECTIONS: The faces currently tracked, as std::vector<Detection>
+//   with relative bounding boxes. A missing packet means that none are tracked.
+// - SCENE_CUT (optional): A packet of any type for the frames that start a new
+//   scene, e.g. from a SceneCutCalculator. It may also have packets for frames
+//   without TICK, which are ignored.
+//
+// Outputs:
+// - ROI:0, ..., ROI:<n - 1>: The crops around the tracked faces, as
+//   NormalizedRect. Only the first ones are output when fewer faces are
+//   tracked, and none in the frames in which the whole image is scanned.
+// - FULL_FRAME_ROI: A NormalizedRect covering the whole image, only output for
+//   the frames in which the whole image must be scanned.
+//
+// Options:
+// - scale: The factor by which tracked faces are enlarged into crops. Default
+//   is 2.
+// - full_frame_interval: The whole image is scanned at least once every
+//   full_frame_interval frames. Default is 5.
+//
+// Example config:
+// node {
+//   calculator: "TrackedRoisCalculator"
+//   input_stream: "TICK:input_video"
+//   input_stream: "TRACKED_DETECTIONS:prev_tracked_detections"
+//   output_stream: "ROI:0:face_roi0"
+//   output_stream: "ROI:1:face_roi1"
+//   output_stream: "FULL_FRAME_ROI:full_frame_roi"
+//   options: {
+//     [magritte.TrackedRoisCalculatorOptions.ext] {
+//       scale: 2
+//       full_frame_interval: 5
+//     }
+//   }
+// }
+class TrackedRoisCalculator : public CalculatorBase {
+ public:
+  TrackedRoisCalculator() = default;
+  ~TrackedRoisCalculator() override = default;
+
+  static absl::Status GetContract(CalculatorContract* cc) {
+    RET_CHECK(cc->Inputs().HasTag(kTickTag))
+        << "Missing input " << kTickTag << " tag.";
+    cc->Inputs().Tag(kTickTag).SetAny();
+    RET_CHECK(cc->Inputs().HasTag(kTrackedDetectionsTag))
+        << "Missing input " << kTrackedDetectionsTag << " tag.";
+    cc->Inputs().Tag(kTrackedDetectionsTag).Set<Detections>();
+    if (cc->Inputs().HasTag(kSceneCutTag)) {
+      cc->Inputs().Tag(kSceneCutTag).SetAny();
+    }
+
+    RET_CHECK(cc->Outputs().HasTag(kFullFrameRegionOfInterestTag))
+        << "Missing output " << kFullFrameRegionOfInterestTag << " tag.";
+    cc->Outputs().Tag(kFullFrameRegionOfInterestTag).Set<NormalizedRect>();
+    for (int i = 0; i < cc->Outputs().NumEntries(kRegionOfInterestTag); ++i) {
+      cc->Outputs().Get(kRegionOfInterestTag, i).Set<NormalizedRect>();
+    }
+
+    // No input side packets.
+    return absl::OkStatus();
+  }
+
+  absl::Status Open(CalculatorContext* cc) override {
+    cc->SetOffset(mediapipe::TimestampDiff(0));
+    options_ = cc->Options<TrackedRoisCalculatorOptions>();
+    RET_CHECK_GT(options_.scale(), 0.0f) << "scale must be positive.";
+    RET_CHECK_GE(options_.full_frame_interval(), 1)
+        << "full_frame_interval must be positive.";
+    // The first frame scans the whole image.
+    frames_since_scan_ = options_.full_frame_interval() - 1;
+    return absl::OkStatus();
+  }
+
+  absl::Status Process(CalculatorContext* cc) override {
+    if (cc->Inputs().Tag(kTickTag).IsEmpty()) {
+      return absl::OkStatus();
+    }
+    ++frames_since_scan_;
+    const bool scene_cut = cc->Inputs().HasTag(kSceneCutTag) &&
+                           !cc->Inputs().Tag(kSceneCutTag).IsEmpty();
+    const auto& tracked = cc->Inputs().Tag(kTrackedDetectionsTag);
+    const Detections no_detections;
+    const Detections& faces =
+        tracked.IsEmpty() ? no_detections : tracked.Get<Detections>();
+    const int num_faces = static_cast<int>(faces.size());
+    const int num_crops = cc->Outputs().NumEntries(kRegionOfInterestTag);
+
+    if (scene_cut || frames_since_scan_ >= options_.full_frame_interval() ||
+        num_faces > num_crops) {
+      frames_since_scan_ = 0;
+      NormalizedRect* roi = new NormalizedRect();
+      roi->set_x_center(0.5f);
+      roi->set_y_center(0.5f);
+      roi->set_width(1.0f);
+      roi->set_height(1.0f);
+      cc->Outputs()
+          .Tag(kFullFrameRegionOfInterestTag)
+          .Add(roi, cc->InputTimestamp());
+      cc->GetCounter(absl::StrCat(cc->NodeName(), kFullFrameScansCounterSuffix))
+          ->Increment();
+      return absl::OkStatus();
+    }
+
+    for (int i = 0; i < num_faces; ++i) {
+      const auto& box = faces[i].location_data().relative_bounding_box();
+      NormalizedRect* roi = new NormalizedRect();
+      roi->set_x_center(box.xmin() + box.width() / 2);
+      roi->set_y_center(box.ymin() + box.height() / 2);
+      roi->set_width(box.width() * options_.scale());
+      roi->set_height(box.height() * options_.scale());
+      cc->Outputs()
+          .Get(kRegionOfInterestTag, i)
+          .Add(roi, cc->InputTimestamp());
+    }
+    return absl::OkStatus();
+  }
+
+ private:
+  TrackedRoisCalculatorOptions options_;
+  // Number of frames since the whole image was last scanned.
+  int frames_since_scan_ = 0;
+};
+
+REGISTER_CALCULATOR(TrackedRoisCalculator);
+
+}  // namespace magritte
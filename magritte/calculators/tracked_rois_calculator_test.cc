@@ -0,0 +1,181 @@
+//
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+#include <cstdint>
+#include <vector>
+
+#include "magritte/calculators/tracked_rois_calculator.pb.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/calculator_runner.h"
+#include "mediapipe/framework/formats/detection.pb.h"
+#include "mediapipe/framework/formats/location_data.pb.h"
+#include "mediapipe/framework/formats/rect.pb.h"
+#include "mediapipe/framework/port/gmock.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/parse_text_proto.h"
+#include "mediapipe/framework/port/status_matchers.h"
+
+namespace magritte {
+namespace {
+
+using ::mediapipe::CalculatorRunner;
+using ::mediapipe::Detection;
+using ::mediapipe::MakePacket;
+using ::mediapipe::NormalizedRect;
+using ::mediapipe::Timestamp;
+using Detections = std::vector<Detection>;
+
+constexpr char kNodeConfig[] = R"pb(
+  calculator: "TrackedRoisCalculator"
+  input_stream: "TICK:tick"
+  input_stream: "TRACKED_DETECTIONS:tracked_detections"
+  output_stream: "ROI:0:roi0"
+  output_stream: "ROI:1:roi1"
+  output_stream: "FULL_FRAME_ROI:full_frame_roi"
+  options {
+    [magritte.TrackedRoisCalculatorOptions.ext] {
+      scale: 2
+      full_frame_interval: 3
+    }
+  }
+)pb";
+
+Detection MakeFace(float xmin, float ymin, float size) {
+  Detection detection;
+  auto* box =
+      detection.mutable_location_data()->mutable_relative_bounding_box();
+  box->set_xmin(xmin);
+  box->set_ymin(ymin);
+  box->set_width(size);
+  box->set_height(size);
+  return detection;
+}
+
+// Adds a frame with the given tracked faces, or without tracked detections
+// packet if there are none.
+void AddFrame(int timestamp, const Detections& faces,
+              CalculatorRunner* runner) {
+  runner->MutableInputs()->Tag("TICK").packets.push_back(
+      MakePacket<int>(0).At(Timestamp(timestamp)));
+  if (!faces.empty()) {
+    runner->MutableInputs()
+        ->Tag("TRACKED_DETECTIONS")
+        .packets.push_back(MakePacket<Detections>(faces).At(
+            Timestamp(timestamp)));
+  }
+}
+
+std::vector<int64_t> OutputTimestamps(
+    const std::vector<mediapipe::Packet>& packets) {
+  std::vector<int64_t> timestamps;
+  for (const auto& packet : packets) {
+    timestamps.push_back(packet.Timestamp().Value());
+  }
+  return timestamps;
+}
+
+TEST(TrackedRoisCalculatorTest, CropsTrackedFacesBetweenFullFrameScans) {
+  CalculatorRunner runner(
+      mediapipe::ParseTextProtoOrDie<mediapipe::CalculatorGraphConfig::Node>(
+          kNodeConfig));
+  const Detections faces = {MakeFace(0.1f, 0.2f, 0.1f),
+                            MakeFace(0.6f, 0.5f, 0.2f)};
+  for (int t = 0; t < 5; ++t) {
+    AddFrame(t, faces, &runner);
+  }
+
+  MP_ASSERT_OK(runner.Run());
+  EXPECT_THAT(OutputTimestamps(runner.Outputs().Tag("FULL_FRAME_ROI").packets),
+              testing::ElementsAre(0, 3));
+  EXPECT_THAT(OutputTimestamps(runner.Outputs().Get("ROI", 0).packets),
+              testing::ElementsAre(1, 2, 4));
+  EXPECT_THAT(OutputTimestamps(runner.Outputs().Get("ROI", 1).packets),
+              testing::ElementsAre(1, 2, 4));
+  EXPECT_EQ(runner.GetCounter("TrackedRoisCalculator/FullFrameScans")->Get(),
+            2);
+
+  const NormalizedRect& full_frame = runner.Outputs()
+                                         .Tag("FULL_FRAME_ROI")
+                                         .packets[0]
+                                         .Get<NormalizedRect>();
+  EXPECT_FLOAT_EQ(full_frame.x_center(), 0.5f);
+  EXPECT_FLOAT_EQ(full_frame.y_center(), 0.5f);
+  EXPECT_FLOAT_EQ(full_frame.width(), 1.0f);
+  EXPECT_FLOAT_EQ(full_frame.height(), 1.0f);
+
+  const NormalizedRect& crop =
+      runner.Outputs().Get("ROI", 1).packets[0].Get<NormalizedRect>();
+  EXPECT_FLOAT_EQ(crop.x_center(), 0.7f);
+  EXPECT_FLOAT_EQ(crop.y_center(), 0.6f);
+  EXPECT_FLOAT_EQ(crop.width(), 0.4f);
+  EXPECT_FLOAT_EQ(crop.height(), 0.4f);
+  EXPECT_FLOAT_EQ(crop.rotation(), 0.0f);
+}
+
+TEST(TrackedRoisCalculatorTest, OnlyCropsTrackedFaces) {
+  CalculatorRunner runner(
+      mediapipe::ParseTextProtoOrDie<mediapipe::CalculatorGraphConfig::Node>(
+          kNodeConfig));
+  AddFrame(0, {}, &runner);
+  AddFrame(1, {MakeFace(0.1f, 0.2f, 0.1f)}, &runner);
+  AddFrame(2, {}, &runner);
+
+  MP_ASSERT_OK(runner.Run());
+  EXPECT_THAT(OutputTimestamps(runner.Outputs().Tag("FULL_FRAME_ROI").packets),
+              testing::ElementsAre(0));
+  EXPECT_THAT(OutputTimestamps(runner.Outputs().Get("ROI", 0).packets),
+              testing::ElementsAre(1));
+  EXPECT_TRUE(runner.Outputs().Get("ROI", 1).packets.empty());
+}
+
+TEST(TrackedRoisCalculatorTest, ScansFullFrameWithMoreFacesThanCrops) {
+  CalculatorRunner runner(
+      mediapipe::ParseTextProtoOrDie<mediapipe::CalculatorGraphConfig::Node>(
+          kNodeConfig));
+  const Detections faces = {MakeFace(0.1f, 0.1f, 0.1f),
+                            MakeFace(0.4f, 0.4f, 0.1f),
+                            MakeFace(0.7f, 0.7f, 0.1f)};
+  for (int t = 0; t < 3; ++t) {
+    AddFrame(t, faces, &runner);
+  }
+
+  MP_ASSERT_OK(runner.Run());
+  EXPECT_THAT(OutputTimestamps(runner.Outputs().Tag("FULL_FRAME_ROI").packets),
+              testing::ElementsAre(0, 1, 2));
+  EXPECT_TRUE(runner.Outputs().Get("ROI", 0).packets.empty());
+}
+
+TEST(TrackedRoisCalculatorTest, ScansFullFrameOnSceneCuts) {
+  auto node =
+      mediapipe::ParseTextProtoOrDie<mediapipe::CalculatorGraphConfig::Node>(
+          kNodeConfig);
+  node.add_input_stream("SCENE_CUT:scene_cut");
+  CalculatorRunner runner(node);
+  const Detections faces = {MakeFace(0.1f, 0.2f, 0.1f)};
+  for (int t = 0; t < 3; ++t) {
+    AddFrame(t, faces, &runner);
+  }
+  runner.MutableInputs()->Tag("SCENE_CUT").packets.push_back(
+      MakePacket<bool>(true).At(Timestamp(1)));
+
+  MP_ASSERT_OK(runner.Run());
+  EXPECT_THAT(OutputTimestamps(runner.Outputs().Tag("FULL_FRAME_ROI").packets),
+              testing::ElementsAre(0, 1));
+  EXPECT_THAT(OutputTimestamps(runner.Outputs().Get("ROI", 0).packets),
+              testing::ElementsAre(2));
+}
+
+}  // namespace
+}  // namespace magritte
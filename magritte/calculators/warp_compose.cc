@@ -0,0 +1,154 @@
+//
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+#include "magritte/calculators/warp_compose.h"
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include  <opencv2/core.hpp>
+
+namespace magritte {
+namespace {
+
+// cv::warpAffine computes source coordinates in fixed point with
+// kCoordinateBits fractional bits, then rounds them to kInterpolationBits
+// fractional bits to index its table of bilinear weights.
+constexpr int kCoordinateBits = 10;
+constexpr int kInterpolationBits = 5;
+constexpr int kInterpolationSteps = 1 << kInterpolationBits;
+// The bilinear weights are products of two interpolation steps.
+constexpr int kWeightBits = 2 * kInterpolationBits;
+
+// A fully transparent pixel, sampled outside of the sprite.
+constexpr uint8_t kTransparentPixel[4] = {0, 0, 0, 0};
+
+// Rounds like cvRound does.
+int RoundToInt(double value) { return static_cast<int>(std::lrint(value)); }
+
+// Composes a premultiplied color channel atop a target channel, given 255 minus
+// the alpha of the color. Rounds the scaled target channel to nearest, which
+// never ties for 8-bit values, and saturates like cv::multiply and cv::add do.
+inline uint8_t ComposeChannel(int color, int inverse_alpha, int target) {
+  const int composed = (inverse_alpha * target + 127) / 255 + color;
+  return static_cast<uint8_t>(composed > 255 ? 255 : composed);
+}
+
+template <int kTargetChannels>
+void WarpAndComposeNormalImpl(const cv::Mat& sprite, const double inverse[6],
+                              cv::Mat* target) {
+  const double coordinate_scale = 1 << kCoordinateBits;
+  const int round_delta =
+      (1 << kCoordinateBits) / kInterpolationSteps / 2;
+
+  // The contribution of the target column to the source coordinates.
+  std::vector<int> column_x(target->cols);
+  std::vector<int> column_y(target->cols);
+  for (int x = 0; x < target->cols; ++x) {
+    column_x[x] = RoundToInt(inverse[0] * x * coordinate_scale);
+    column_y[x] = RoundToInt(inverse[3] * x * coordinate_scale);
+  }
+
+  // Returns the sprite pixel at the given position, or a transparent pixel
+  // outside of the sprite.
+  auto sprite_pixel = [&sprite](int x, int y) -> const uint8_t* {
+    if (x < 0 || y < 0 || x >= sprite.cols || y >= sprite.rows) {
+      return kTransparentPixel;
+    }
+    return sprite.ptr<uint8_t>(y) + 4 * x;
+  };
+
+  for (int y = 0; y < target->rows; ++y) {
+    const int row_x =
+        RoundToInt((inverse[1] * y + inverse[2]) * coordinate_scale) +
+        round_delta;
+    const int row_y =
+        RoundToInt((inverse[4] * y + inverse[5]) * coordinate_scale) +
+        round_delta;
+    uint8_t* out = target->ptr<uint8_t>(y);
+    for (int x = 0; x < target->cols; ++x, out += kTargetChannels) {
+      const int source_x =
+          (row_x + column_x[x]) >> (kCoordinateBits - kInterpolationBits);
+      const int source_y =
+          (row_y + column_y[x]) >> (kCoordinateBits - kInterpolationBits);
+      const int left = source_x >> kInterpolationBits;
+      const int top = source_y >> kInterpolationBits;
+      if (left >= sprite.cols || left + 1 < 0 || top >= sprite.rows ||
+          top + 1 < 0) {
+        continue;
+      }
+
+      const int fraction_x = source_x & (kInterpolationSteps - 1);
+      const int fraction_y = source_y & (kInterpolationSteps - 1);
+      const int weight_top_left = (kInterpolationSteps - fraction_y) *
+                                  (kInterpolationSteps - fraction_x);
+      const int weight_top_right =
+          (kInterpolationSteps - fraction_y) * fraction_x;
+      const int weight_bottom_left =
+          fraction_y * (kInterpolationSteps - fraction_x);
+      const int weight_bottom_right = fraction_y * fraction_x;
+      const uint8_t* top_left = sprite_pixel(left, top);
+      const uint8_t* top_right = sprite_pixel(left + 1, top);
+      const uint8_t* bottom_left = sprite_pixel(left, top + 1);
+      const uint8_t* bottom_right = sprite_pixel(left + 1, top + 1);
+
+      int sample[4];
+      for (int c = 0; c < 4; ++c) {
+        sample[c] = (top_left[c] * weight_top_left +
+                     top_right[c] * weight_top_right +
+                     bottom_left[c] * weight_bottom_left +
+                     bottom_right[c] * weight_bottom_right +
+                     (1 << (kWeightBits - 1))) >>
+                    kWeightBits;
+      }
+      const int inverse_alpha = 255 - sample[3];
+      for (int c = 0; c < kTargetChannels; ++c) {
+        out[c] = ComposeChannel(sample[c], inverse_alpha, out[c]);
+      }
+    }
+  }
+}
+
+}  // namespace
+
+void WarpAndComposeNormal(const cv::Mat& sprite, const cv::Mat& transform,
+                          cv::Mat* target) {
+  // Invert the transform the same way cv::warpAffine does.
+  double inverse[6];
+  for (int i = 0; i < 6; ++i) {
+    inverse[i] = transform.at<double>(i / 3, i % 3);
+  }
+  double determinant = inverse[0] * inverse[4] - inverse[1] * inverse[3];
+  determinant = determinant != 0 ? 1.0 / determinant : 0.0;
+  const double a11 = inverse[4] * determinant;
+  const double a22 = inverse[0] * determinant;
+  inverse[0] = a11;
+  inverse[1] *= -determinant;
+  inverse[3] *= -determinant;
+  inverse[4] = a22;
+  const double b1 = -inverse[0] * inverse[2] - inverse[1] * inverse[5];
+  const double b2 = -inverse[3] * inverse[2] - inverse[4] * inverse[5];
+  inverse[2] = b1;
+  inverse[5] = b2;
+
+  if (target->channels() == 4) {
+    WarpAndComposeNormalImpl<4>(sprite, inverse, target);
+  } else {
+    WarpAndComposeNormalImpl<3>(sprite, inverse, target);
+  }
+}
+
+}  // namespace magritte
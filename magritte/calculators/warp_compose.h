@@ -0,0 +1,43 @@
+//
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+#ifndef MAGRITTE_CALCULATORS_WARP_COMPOSE_H_
+#define MAGRITTE_CALCULATORS_WARP_COMPOSE_H_
+
+#include  <opencv2/core.hpp>
+
+namespace magritte {
+
+// Draws a sprite atop a target image in a single pass: for each target pixel,
+// the sprite is sampled bilinearly through the inverse of the given affine
+// transform and composed with normal alpha blending directly into the target.
+// Pixels that map outside of the sprite are left untouched.
+//
+// The sprite must be a CV_8UC4 matrix with a premultiplied alpha channel, the
+// target a CV_8UC3 or CV_8UC4 matrix, and the transform a 2x3 CV_64F matrix
+// from sprite to target coordinates. If the target has an alpha channel, it is
+// composed as well, so that the result stays premultiplied.
+//
+// The result is the same as cv::warpAffine with bilinear interpolation and a
+// transparent constant border into a temporary image, followed by composing
+// the temporary image atop the target, as the fixed-point arithmetic of both
+// steps is reproduced exactly. It avoids the temporary image and the
+// intermediate passes over it, though.
+void WarpAndComposeNormal(const cv::Mat& sprite, const cv::Mat& transform,
+                          cv::Mat* target);
+
+}  // namespace magritte
+
+#endif  // MAGRITTE_CALCULATORS_WARP_COMPOSE_H_
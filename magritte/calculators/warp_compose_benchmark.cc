@@ -0,0 +1,87 @@
+//
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Benchmarks drawing one rotated sticker onto an RGB frame, with separate warp
+// and composition passes as SpriteCalculatorCpu used to, and with the fused
+// WarpAndComposeNormal kernel.
+//
+// Usage:
+//   bazel run -c opt //magritte/calculators:warp_compose_benchmark
+#include "benchmark/benchmark.h"
+#include  <opencv2/core.hpp>
+#include  <opencv2/imgproc.hpp>
+#include "magritte/calculators/warp_compose.h"
+
+namespace magritte {
+namespace {
+
+constexpr int kStickerSize = 512;
+constexpr double kRotationDegrees = 30.0;
+
+// Draws a premultiplied sticker rotated by kRotationDegrees and scaled to the
+// size state.range(0) atop an RGB frame of the bounding box of the result.
+template <typename DrawFn>
+void DrawSticker(benchmark::State& state, DrawFn draw) {
+  const int size = state.range(0);
+  cv::Mat sticker(kStickerSize, kStickerSize, CV_8UC4);
+  cv::randu(sticker, cv::Scalar(0, 0, 0, 255), cv::Scalar(256, 256, 256, 256));
+
+  const cv::Point2f center(0.5f * (kStickerSize - 1),
+                           0.5f * (kStickerSize - 1));
+  const double scale = static_cast<double>(size) / kStickerSize;
+  const cv::Rect bounds =
+      cv::RotatedRect(center, cv::Size2f(size, size), kRotationDegrees)
+          .boundingRect();
+  cv::Mat transform = cv::getRotationMatrix2D(center, kRotationDegrees, scale);
+  transform.at<double>(0, 2) -= bounds.x;
+  transform.at<double>(1, 2) -= bounds.y;
+
+  cv::Mat target(bounds.height, bounds.width, CV_8UC3);
+  cv::randu(target, cv::Scalar::all(0), cv::Scalar::all(256));
+
+  for (auto _ : state) {
+    draw(sticker, transform, &target);
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * target.total());
+}
+
+void BM_SeparatePasses(benchmark::State& state) {
+  DrawSticker(state, [](const cv::Mat& sprite, const cv::Mat& transform,
+                        cv::Mat* target) {
+    cv::Mat warped(target->rows, target->cols, sprite.type());
+    cv::warpAffine(sprite, warped, transform, warped.size());
+    cv::Mat alpha_copies(warped.rows, warped.cols, target->type());
+    static int from_to[] = {3, 0, 3, 1, 3, 2};
+    cv::mixChannels(&warped, 1, &alpha_copies, 1, from_to, 3);
+    cv::Mat warped_rgb;
+    cv::cvtColor(warped, warped_rgb, cv::COLOR_RGBA2RGB);
+    cv::multiply(cv::Scalar::all(255) - alpha_copies, *target, *target,
+                 1 / 255.0);
+    cv::add(*target, warped_rgb, *target);
+  });
+}
+
+void BM_Fused(benchmark::State& state) {
+  DrawSticker(state, WarpAndComposeNormal);
+}
+
+BENCHMARK(BM_SeparatePasses)->RangeMultiplier(2)->Range(32, 1024);
+BENCHMARK(BM_Fused)->RangeMultiplier(2)->Range(32, 1024);
+
+}  // namespace
+}  // namespace magritte
+
+BENCHMARK_MAIN();
@@ -0,0 +1,153 @@
+//
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+#include "magritte/calculators/warp_compose.h"
+
+#include <cmath>
+#include <string>
+
+#include  <opencv2/core.hpp>
+#include  <opencv2/imgcodecs.hpp>
+#include  <opencv2/imgproc.hpp>
+#include "mediapipe/framework/port/gtest.h"
+
+namespace magritte {
+namespace {
+
+constexpr char kSpriteBackgroundPath[] =
+    "magritte/test_data/sprite_background.png";
+constexpr char kSpriteCompositedPath[] =
+    "magritte/test_data/sprite_composited.png";
+constexpr char kSpritePremultipliedPath[] =
+    "magritte/test_data/sprite_premultiplied.png";
+
+// Loads a PNG as an RGBA matrix, with opaque alpha if the PNG has none.
+cv::Mat LoadRgbaPng(const std::string& filename) {
+  cv::Mat mat = cv::imread(filename, cv::IMREAD_UNCHANGED);
+  cv::cvtColor(mat, mat, cv::COLOR_BGRA2RGBA);
+  return mat;
+}
+
+// Draws the sprite scaled and rotated counterclockwise around its center, and
+// centered at the given position of the target, the way SpriteCalculatorCpu
+// places sprites. The sprite must be fully inside of the target.
+void DrawSprite(const cv::Mat& sprite, const cv::Point2f& position,
+                float rotation_degrees, float scale, cv::Mat* target) {
+  const cv::Point2f sprite_center(0.5f * (sprite.cols - 1),
+                                  0.5f * (sprite.rows - 1));
+  const cv::Rect bounds =
+      cv::RotatedRect(sprite_center,
+                      cv::Size2f(scale * sprite.cols, scale * sprite.rows),
+                      rotation_degrees)
+          .boundingRect();
+  cv::Mat transform =
+      cv::getRotationMatrix2D(sprite_center, rotation_degrees, scale);
+  transform.at<double>(0, 2) -= bounds.x;
+  transform.at<double>(1, 2) -= bounds.y;
+
+  const cv::Rect roi(std::round(position.x - bounds.width * 0.5f),
+                     std::round(position.y - bounds.height * 0.5f),
+                     bounds.width, bounds.height);
+  cv::Mat target_roi = (*target)(roi);
+  WarpAndComposeNormal(sprite, transform, &target_roi);
+}
+
+// Draws the pattern of four sprites of sprite_calculator_cpu_test.cc.
+void DrawFourSpritePattern(const cv::Mat& sprite, cv::Mat* target) {
+  const float width = target->cols;
+  const float height = target->rows;
+  DrawSprite(sprite, {0.25f * width, 0.25f * height}, 0.0f, 2.0f, target);
+  DrawSprite(sprite, {0.75f * width, 0.25f * height}, 270.0f, 2.0f, target);
+  DrawSprite(sprite, {0.75f * width, 0.75f * height}, 180.0f, 2.0f, target);
+  DrawSprite(sprite, {0.25f * width, 0.75f * height}, 90.0f, 2.0f, target);
+}
+
+// Returns the largest difference between two matrices of the same type.
+double MaxDifference(const cv::Mat& a, const cv::Mat& b) {
+  return cv::norm(a, b, cv::NORM_INF);
+}
+
+TEST(WarpAndComposeNormalTest, MatchesGoldenOnRgbaTarget) {
+  const cv::Mat sprite = LoadRgbaPng(kSpritePremultipliedPath);
+  cv::Mat target = LoadRgbaPng(kSpriteBackgroundPath);
+  const cv::Mat expected = LoadRgbaPng(kSpriteCompositedPath);
+
+  DrawFourSpritePattern(sprite, &target);
+
+  EXPECT_EQ(MaxDifference(target, expected), 0.0);
+}
+
+TEST(WarpAndComposeNormalTest, MatchesGoldenOnRgbTarget) {
+  const cv::Mat sprite = LoadRgbaPng(kSpritePremultipliedPath);
+  cv::Mat target;
+  cv::cvtColor(LoadRgbaPng(kSpriteBackgroundPath), target,
+               cv::COLOR_RGBA2RGB);
+  cv::Mat expected;
+  cv::cvtColor(LoadRgbaPng(kSpriteCompositedPath), expected,
+               cv::COLOR_RGBA2RGB);
+
+  DrawFourSpritePattern(sprite, &target);
+
+  EXPECT_EQ(MaxDifference(target, expected), 0.0);
+}
+
+// Tests that an opaque sprite translated by whole pixels is copied as is, and
+// that the pixels around it are untouched.
+TEST(WarpAndComposeNormalTest, CopiesOpaqueSpriteTranslatedByWholePixels) {
+  cv::Mat sprite(/*rows=*/8, /*cols=*/6, CV_8UC4);
+  cv::randu(sprite, cv::Scalar(0, 0, 0, 255), cv::Scalar(256, 256, 256, 256));
+  cv::Mat target(/*rows=*/20, /*cols=*/20, CV_8UC4, cv::Scalar(1, 2, 3, 4));
+  const cv::Mat background = target.clone();
+  const cv::Mat transform =
+      (cv::Mat_<double>(2, 3) << 1.0, 0.0, 5.0, 0.0, 1.0, 7.0);
+
+  WarpAndComposeNormal(sprite, transform, &target);
+
+  const cv::Rect sprite_rect(5, 7, sprite.cols, sprite.rows);
+  EXPECT_EQ(MaxDifference(target(sprite_rect), sprite), 0.0);
+  target(sprite_rect).setTo(cv::Scalar(1, 2, 3, 4));
+  EXPECT_EQ(MaxDifference(target, background), 0.0);
+}
+
+// Tests that a half transparent sprite is composed atop the target, including
+// its alpha channel.
+TEST(WarpAndComposeNormalTest, ComposesPremultipliedAlpha) {
+  const cv::Mat sprite(/*rows=*/4, /*cols=*/4, CV_8UC4,
+                       cv::Scalar(100, 50, 0, 128));
+  cv::Mat target(/*rows=*/4, /*cols=*/4, CV_8UC4,
+                 cv::Scalar(200, 200, 200, 200));
+  const cv::Mat identity = cv::Mat::eye(2, 3, CV_64F);
+
+  WarpAndComposeNormal(sprite, identity, &target);
+
+  // 127 / 255 of the target, plus the sprite.
+  EXPECT_EQ(target.at<cv::Vec4b>(1, 1), cv::Vec4b(200, 150, 100, 228));
+}
+
+// Tests that pixels that map outside of the sprite are untouched.
+TEST(WarpAndComposeNormalTest, LeavesTargetOutsideOfSpriteUntouched) {
+  const cv::Mat sprite(/*rows=*/4, /*cols=*/4, CV_8UC4, cv::Scalar::all(255));
+  cv::Mat target(/*rows=*/16, /*cols=*/16, CV_8UC3, cv::Scalar(10, 20, 30));
+  const cv::Mat background = target.clone();
+  const cv::Mat transform =
+      (cv::Mat_<double>(2, 3) << 1.0, 0.0, -10.0, 0.0, 1.0, 40.0);
+
+  WarpAndComposeNormal(sprite, transform, &target);
+
+  EXPECT_EQ(MaxDifference(target, background), 0.0);
+}
+
+}  // namespace
+}  // namespace magritte
@@ -0,0 +1,83 @@
+//
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+#include <memory>
+#include <utility>
+
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/formats/yuv_image.h"
+
+namespace magritte {
+namespace {
+using ::mediapipe::CalculatorBase;
+using ::mediapipe::CalculatorContext;
+using ::mediapipe::CalculatorContract;
+using ::mediapipe::YUVImage;
+constexpr char kYuvImageTag[] = "YUV_IMAGE";
+constexpr char kSizeTag[] = "SIZE";
+}  // namespace
+
+// A calculator that outputs the size of YUVImages, like MediaPipe's
+// ImagePropertiesCalculator does for ImageFrames, e.g. for the subgraphs that
+// place redactions relative to the image size.
+//
+// Inputs:
+// - YUV_IMAGE: A YUVImage stream.
+//
+// Outputs:
+// - SIZE: The size of the images as a std::pair<int, int> of the width and the
+//   height.
+//
+// Example config:
+// node {
+//   calculator: "YuvImagePropertiesCalculator"
+//   input_stream: "YUV_IMAGE:input_video"
+//   output_stream: "SIZE:image_size"
+// }
+class YuvImagePropertiesCalculator : public CalculatorBase {
+ public:
+  YuvImagePropertiesCalculator() = default;
+  ~YuvImagePropertiesCalculator() override = default;
+
+  static absl::Status GetContract(CalculatorContract* cc) {
+    cc->Inputs().Tag(kYuvImageTag).Set<YUVImage>();
+    cc->Outputs().Tag(kSizeTag).Set<std::pair<int, int>>();
+
+    // No input side packets.
+    return absl::OkStatus();
+  }
+
+  absl::Status Open(CalculatorContext* cc) override {
+    cc->SetOffset(mediapipe::TimestampDiff(0));
+    return absl::OkStatus();
+  }
+
+  absl::Status Process(CalculatorContext* cc) override {
+    if (cc->Inputs().Tag(kYuvImageTag).IsEmpty()) {
+      return absl::OkStatus();
+    }
+    const auto& image = cc->Inputs().Tag(kYuvImageTag).Get<YUVImage>();
+    cc->Outputs()
+        .Tag(kSizeTag)
+        .AddPacket(mediapipe::MakePacket<std::pair<int, int>>(image.width(),
+                                                               image.height())
+                       .At(cc->InputTimestamp()));
+    return absl::OkStatus();
+  }
+};
+
+REGISTER_CALCULATOR(YuvImagePropertiesCalculator);
+
+}  // namespace magritte
@@ -0,0 +1,58 @@
+//
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/calculator_runner.h"
+#include "mediapipe/framework/formats/yuv_image.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/parse_text_proto.h"
+#include "mediapipe/framework/port/status_matchers.h"
+#include "magritte/calculators/yuv_image_util.h"
+#include "libyuv/video_common.h"
+
+namespace magritte {
+namespace {
+
+using ::mediapipe::CalculatorRunner;
+using ::mediapipe::Packet;
+using ::mediapipe::Timestamp;
+using ::mediapipe::YUVImage;
+
+TEST(YuvImagePropertiesCalculatorTest, OutputsSize) {
+  CalculatorRunner runner(
+      mediapipe::ParseTextProtoOrDie<mediapipe::CalculatorGraphConfig::Node>(
+          R"pb(
+            calculator: "YuvImagePropertiesCalculator"
+            input_stream: "YUV_IMAGE:input_video"
+            output_stream: "SIZE:image_size"
+          )pb"));
+  ASSERT_OK_AND_ASSIGN(std::unique_ptr<YUVImage> image,
+                       MakeYuvImage(libyuv::FOURCC_NV12, 320, 240));
+  runner.MutableInputs()->Tag("YUV_IMAGE").packets.push_back(
+      mediapipe::Adopt(image.release()).At(Timestamp(7)));
+
+  MP_ASSERT_OK(runner.Run());
+  const std::vector<Packet>& output = runner.Outputs().Tag("SIZE").packets;
+  ASSERT_EQ(output.size(), 1);
+  EXPECT_EQ(output[0].Timestamp(), Timestamp(7));
+  EXPECT_EQ(output[0].Get<std::pair<int, int>>(), std::make_pair(320, 240));
+}
+
+}  // namespace
+}  // namespace magritte
@@ -0,0 +1,212 @@
+//
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+#include "magritte/calculators/yuv_image_util.h"
+
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/formats/yuv_image.h"
+#include "mediapipe/framework/port/ret_check.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "magritte/calculators/image_frame_util.h"
+#include "libyuv/video_common.h"
+#include  <opencv2/core.hpp>
+#include  <opencv2/imgproc.hpp>
+
+namespace magritte {
+namespace {
+
+using ::mediapipe::CalculatorContext;
+using ::mediapipe::YUVImage;
+
+// Copies src into dst, resizing it with area averaging if the sizes differ.
+void ResizeInto(const cv::Mat& src, cv::Mat dst) {
+  if (src.size() == dst.size()) {
+    src.copyTo(dst);
+  } else {
+    cv::resize(src, dst, dst.size(), 0, 0, cv::INTER_AREA);
+  }
+}
+
+}  // namespace
+
+absl::StatusOr<std::unique_ptr<YUVImage>> MakeYuvImage(uint32_t fourcc,
+                                                       int width, int height) {
+  RET_CHECK(width > 0 && height > 0 && width % 2 == 0 && height % 2 == 0)
+      << "YUV images must have a positive even width and height.";
+  const int chroma_width = width / 2;
+  const int chroma_height = height / 2;
+  const int luma_size = width * height;
+  const int chroma_size = chroma_width * chroma_height;
+  uint8_t* buffer = new uint8_t[luma_size + 2 * chroma_size];
+  auto image = std::make_unique<YUVImage>();
+  switch (fourcc) {
+    case libyuv::FOURCC_I420:
+      image->Initialize(libyuv::FOURCC_I420, [buffer] { delete[] buffer; },
+                        buffer, width, buffer + luma_size, chroma_width,
+                        buffer + luma_size + chroma_size, chroma_width, width,
+                        height);
+      break;
+    case libyuv::FOURCC_NV12:
+      image->Initialize(libyuv::FOURCC_NV12, [buffer] { delete[] buffer; },
+                        buffer, width, buffer + luma_size, width, nullptr, 0,
+                        width, height);
+      break;
+    default:
+      delete[] buffer;
+      return absl::InvalidArgumentError(
+          absl::StrCat("Unsupported YUV fourcc: ", fourcc));
+  }
+  return image;
+}
+
+absl::StatusOr<YuvPlanes> GetYuvPlanes(const YUVImage& image) {
+  RET_CHECK_EQ(image.bit_depth(), 8) << "Only 8-bit YUV images are supported.";
+  const int width = image.width();
+  const int height = image.height();
+  RET_CHECK(width % 2 == 0 && height % 2 == 0)
+      << "YUV images must have an even width and height.";
+  const auto data = [&image](int index) {
+    return const_cast<uint8_t*>(image.data(index));
+  };
+  const cv::Size chroma_size(width / 2, height / 2);
+  YuvPlanes planes;
+  planes.emplace_back(height, width, CV_8UC1, data(0), image.stride(0));
+  switch (image.fourcc()) {
+    case libyuv::FOURCC_I420:
+      planes.emplace_back(chroma_size, CV_8UC1, data(1), image.stride(1));
+      planes.emplace_back(chroma_size, CV_8UC1, data(2), image.stride(2));
+      return planes;
+    case libyuv::FOURCC_NV12:
+      planes.emplace_back(chroma_size, CV_8UC2, data(1), image.stride(1));
+      return planes;
+    default:
+      return absl::InvalidArgumentError(
+          absl::StrCat("Unsupported YUV fourcc: ", image.fourcc()));
+  }
+}
+
+absl::StatusOr<std::unique_ptr<YUVImage>> ConsumeOrCopyYuvImage(
+    CalculatorContext* cc, mediapipe::InputStream& input) {
+  RET_CHECK(cc != nullptr) << "CalculatorContext is nullptr";
+  RET_CHECK(!input.IsEmpty()) << "No YUV image at " << cc->InputTimestamp();
+
+  // Consume() only succeeds if the packet holds the last reference to the
+  // image, and leaves the packet untouched otherwise.
+  mediapipe::Packet& packet = input.Value();
+  absl::StatusOr<std::unique_ptr<YUVImage>> consumed =
+      packet.Consume<YUVImage>();
+  if (consumed.ok()) {
+    cc->GetCounter(absl::StrCat(cc->NodeName(), kFramesConsumedCounterSuffix))
+        ->Increment();
+    return std::move(consumed).value();
+  }
+
+  const YUVImage& image = packet.Get<YUVImage>();
+  ASSIGN_OR_RETURN(const YuvPlanes planes, GetYuvPlanes(image));
+  ASSIGN_OR_RETURN(std::unique_ptr<YUVImage> copy,
+                   MakeYuvImage(image.fourcc(), image.width(), image.height()));
+  copy->set_matrix_coefficients(image.matrix_coefficients());
+  copy->set_full_range(image.full_range());
+  ASSIGN_OR_RETURN(const YuvPlanes copy_planes, GetYuvPlanes(*copy));
+  for (size_t i = 0; i < planes.size(); ++i) {
+    cv::Mat copy_plane = copy_planes[i];
+    planes[i].copyTo(copy_plane);
+  }
+  cc->GetCounter(absl::StrCat(cc->NodeName(), kFramesCopiedCounterSuffix))
+      ->Increment();
+  return copy;
+}
+
+cv::Rect PlaneRect(const cv::Rect& image_rect, const cv::Size& image_size,
+                   const cv::Mat& plane) {
+  const int factor_x = image_size.width / plane.cols;
+  const int factor_y = image_size.height / plane.rows;
+  const int x0 = image_rect.x / factor_x;
+  const int y0 = image_rect.y / factor_y;
+  const int x1 = (image_rect.br().x + factor_x - 1) / factor_x;
+  const int y1 = (image_rect.br().y + factor_y - 1) / factor_y;
+  return cv::Rect(x0, y0, x1 - x0, y1 - y0);
+}
+
+cv::Rect ChromaAlignedRect(const cv::Rect& rect, const cv::Size& image_size) {
+  const cv::Rect clipped =
+      rect & cv::Rect(0, 0, image_size.width, image_size.height);
+  if (clipped.empty()) return cv::Rect();
+  const int x0 = clipped.x - clipped.x % 2;
+  const int y0 = clipped.y - clipped.y % 2;
+  const int x1 = clipped.br().x + clipped.br().x % 2;
+  const int y1 = clipped.br().y + clipped.br().y % 2;
+  return cv::Rect(x0, y0, x1 - x0, y1 - y0);
+}
+
+YuvPlanes CropYuvPlanes(const YuvPlanes& planes, const cv::Rect& rect) {
+  YuvPlanes cropped;
+  for (const cv::Mat& plane : planes) {
+    cropped.push_back(plane(PlaneRect(rect, planes[0].size(), plane)));
+  }
+  return cropped;
+}
+
+void YuvPlanesToRgb(const YuvPlanes& planes, cv::Mat rgb) {
+  const cv::Size size = rgb.size();
+  // OpenCV converts 4:2:0 images from a single matrix, with the luma rows
+  // followed by the U plane and then the V plane.
+  cv::Mat i420(size.height * 3 / 2, size.width, CV_8UC1);
+  ResizeInto(planes[0], i420.rowRange(0, size.height));
+  const cv::Size chroma_size(size.width / 2, size.height / 2);
+  uint8_t* chroma_data = i420.ptr(size.height);
+  cv::Mat u(chroma_size, CV_8UC1, chroma_data);
+  cv::Mat v(chroma_size, CV_8UC1, chroma_data + chroma_size.area());
+  if (planes.size() == 3) {
+    ResizeInto(planes[1], u);
+    ResizeInto(planes[2], v);
+  } else {
+    cv::Mat uv(chroma_size, CV_8UC2);
+    ResizeInto(planes[1], uv);
+    cv::Mat u_and_v[] = {u, v};
+    const int from_to[] = {0, 0, 1, 1};
+    cv::mixChannels(&uv, 1, u_and_v, 2, from_to, 2);
+  }
+  cv::cvtColor(i420, rgb, cv::COLOR_YUV2RGB_I420);
+}
+
+void RgbToYuvPlanes(const cv::Mat& rgb, const YuvPlanes& planes) {
+  cv::Mat i420;
+  cv::cvtColor(rgb, i420, cv::COLOR_RGB2YUV_I420);
+  cv::Mat luma = planes[0];
+  i420.rowRange(0, rgb.rows).copyTo(luma);
+  const cv::Size chroma_size(rgb.cols / 2, rgb.rows / 2);
+  uint8_t* chroma_data = i420.ptr(rgb.rows);
+  cv::Mat u(chroma_size, CV_8UC1, chroma_data);
+  cv::Mat v(chroma_size, CV_8UC1, chroma_data + chroma_size.area());
+  if (planes.size() == 3) {
+    cv::Mat u_plane = planes[1];
+    cv::Mat v_plane = planes[2];
+    u.copyTo(u_plane);
+    v.copyTo(v_plane);
+  } else {
+    cv::Mat uv = planes[1];
+    const cv::Mat u_and_v[] = {u, v};
+    const int from_to[] = {0, 0, 1, 1};
+    cv::mixChannels(u_and_v, 2, &uv, 1, from_to, 2);
+  }
+}
+
+}  // namespace magritte
@@ -0,0 +1,92 @@
+//
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+#ifndef MAGRITTE_CALCULATORS_YUV_IMAGE_UTIL_H_
+#define MAGRITTE_CALCULATORS_YUV_IMAGE_UTIL_H_
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/formats/yuv_image.h"
+#include "absl/status/statusor.h"
+#include  <opencv2/core.hpp>
+
+namespace magritte {
+
+// Utilities for the YUV processing path of the CPU calculators, which works on
+// 8-bit 4:2:0 YUVImages as decoded by video decoders, without converting whole
+// frames to RGB and back.
+//
+// Two layouts are supported: I420, with separate U and V planes, and NV12, with
+// a single plane of interleaved U and V. As chroma is subsampled by 2 in both
+// directions, the width and height of the images must be even.
+//
+// Conversions to and from RGB use the BT.601 limited range coefficients of
+// OpenCV. They are only meant for small regions, e.g. the input of detection
+// models or the area covered by a sticker.
+
+// The planes of a YUVImage as OpenCV matrices viewing its data: first the luma
+// plane, then the chroma planes, which are half as wide and high. I420 images
+// have two single-channel chroma planes, U then V, and NV12 images a single
+// two-channel one.
+using YuvPlanes = std::vector<cv::Mat>;
+
+// Returns an I420 or NV12 YUVImage of the given size, with uninitialized
+// contents. The width and height must be even.
+absl::StatusOr<std::unique_ptr<mediapipe::YUVImage>> MakeYuvImage(
+    uint32_t fourcc, int width, int height);
+
+// Returns the planes of the given image, which can be modified through them
+// even if the image is const, like mediapipe::formats::MatView does for
+// ImageFrames. Returns an error if the image isn't an 8-bit I420 or NV12 image
+// with even dimensions.
+absl::StatusOr<YuvPlanes> GetYuvPlanes(const mediapipe::YUVImage& image);
+
+// Returns a writable YUVImage holding the contents of the current packet of
+// the given input stream, like ConsumeOrCopyImageFrame. The image is taken
+// over if the packet holds its last reference, and copied otherwise. Increments
+// the "<node name>/FramesConsumed" or "<node name>/FramesCopied" counter of the
+// calculator accordingly.
+absl::StatusOr<std::unique_ptr<mediapipe::YUVImage>> ConsumeOrCopyYuvImage(
+    mediapipe::CalculatorContext* cc, mediapipe::InputStream& input);
+
+// Returns the region of the given plane covered by a region of the image, of
+// the given size. Chroma regions are rounded outwards, so that they cover all
+// the pixels of the image region.
+cv::Rect PlaneRect(const cv::Rect& image_rect, const cv::Size& image_size,
+                   const cv::Mat& plane);
+
+// Returns the given region rounded outwards to even coordinates, so that it is
+// aligned with the chroma samples, and clipped to an image of the given size.
+cv::Rect ChromaAlignedRect(const cv::Rect& rect, const cv::Size& image_size);
+
+// Returns views of the given chroma-aligned region of all the planes.
+YuvPlanes CropYuvPlanes(const YuvPlanes& planes, const cv::Rect& rect);
+
+// Converts the image with the given planes into the given SRGB matrix, whose
+// width and height must be even. The planes are resized to the size of the
+// matrix with area averaging before they are converted, so that only the output
+// pixels are converted.
+void YuvPlanesToRgb(const YuvPlanes& planes, cv::Mat rgb);
+
+// Converts the given SRGB matrix, with the size of the luma plane, into the
+// given planes.
+void RgbToYuvPlanes(const cv::Mat& rgb, const YuvPlanes& planes);
+
+}  // namespace magritte
+
+#endif  // MAGRITTE_CALCULATORS_YUV_IMAGE_UTIL_H_
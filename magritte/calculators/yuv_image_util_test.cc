@@ -0,0 +1,130 @@
+//
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+#include "magritte/calculators/yuv_image_util.h"
+
+#include <cstdint>
+#include <memory>
+
+#include "mediapipe/framework/formats/yuv_image.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/status_matchers.h"
+#include "libyuv/video_common.h"
+#include  <opencv2/core.hpp>
+
+namespace magritte {
+namespace {
+
+using ::mediapipe::YUVImage;
+
+// Maximum difference after converting to YUV and back, in intensity levels.
+constexpr double kMaxRoundTripDifference = 3.0;
+
+class YuvImageUtilTest : public testing::TestWithParam<uint32_t> {};
+
+TEST_P(YuvImageUtilTest, GetsPlanes) {
+  ASSERT_OK_AND_ASSIGN(std::unique_ptr<YUVImage> image,
+                       MakeYuvImage(GetParam(), 64, 48));
+  ASSERT_OK_AND_ASSIGN(const YuvPlanes planes, GetYuvPlanes(*image));
+
+  EXPECT_EQ(planes[0].size(), cv::Size(64, 48));
+  EXPECT_EQ(planes[0].type(), CV_8UC1);
+  if (GetParam() == libyuv::FOURCC_I420) {
+    ASSERT_EQ(planes.size(), 3);
+    EXPECT_EQ(planes[1].size(), cv::Size(32, 24));
+    EXPECT_EQ(planes[1].type(), CV_8UC1);
+    EXPECT_EQ(planes[2].size(), cv::Size(32, 24));
+  } else {
+    ASSERT_EQ(planes.size(), 2);
+    EXPECT_EQ(planes[1].size(), cv::Size(32, 24));
+    EXPECT_EQ(planes[1].type(), CV_8UC2);
+  }
+}
+
+TEST_P(YuvImageUtilTest, RejectsOddSizes) {
+  EXPECT_FALSE(MakeYuvImage(GetParam(), 63, 48).ok());
+}
+
+TEST_P(YuvImageUtilTest, ConvertsToRgbAndBack) {
+  ASSERT_OK_AND_ASSIGN(std::unique_ptr<YUVImage> image,
+                       MakeYuvImage(GetParam(), 64, 48));
+  ASSERT_OK_AND_ASSIGN(const YuvPlanes planes, GetYuvPlanes(*image));
+  const cv::Mat rgb(48, 64, CV_8UC3, cv::Scalar(200, 120, 40));
+
+  RgbToYuvPlanes(rgb, planes);
+
+  cv::Mat converted(rgb.size(), CV_8UC3);
+  YuvPlanesToRgb(planes, converted);
+  EXPECT_LE(cv::norm(converted, rgb, cv::NORM_INF), kMaxRoundTripDifference);
+}
+
+TEST_P(YuvImageUtilTest, ConvertsToSmallerRgb) {
+  ASSERT_OK_AND_ASSIGN(std::unique_ptr<YUVImage> image,
+                       MakeYuvImage(GetParam(), 64, 48));
+  ASSERT_OK_AND_ASSIGN(const YuvPlanes planes, GetYuvPlanes(*image));
+  const cv::Mat rgb(48, 64, CV_8UC3, cv::Scalar(30, 90, 220));
+  RgbToYuvPlanes(rgb, planes);
+
+  cv::Mat small(/*rows=*/12, /*cols=*/16, CV_8UC3);
+  YuvPlanesToRgb(planes, small);
+
+  EXPECT_LE(cv::norm(small, rgb(cv::Rect(0, 0, 16, 12)), cv::NORM_INF),
+            kMaxRoundTripDifference);
+}
+
+TEST_P(YuvImageUtilTest, ConvertsRegions) {
+  ASSERT_OK_AND_ASSIGN(std::unique_ptr<YUVImage> image,
+                       MakeYuvImage(GetParam(), 64, 48));
+  ASSERT_OK_AND_ASSIGN(const YuvPlanes planes, GetYuvPlanes(*image));
+  const cv::Mat black(48, 64, CV_8UC3, cv::Scalar::all(0));
+  RgbToYuvPlanes(black, planes);
+  const cv::Rect region(10, 6, 20, 16);
+  const cv::Mat white(region.size(), CV_8UC3, cv::Scalar::all(255));
+
+  RgbToYuvPlanes(white, CropYuvPlanes(planes, region));
+
+  cv::Mat expected = black.clone();
+  expected(region).setTo(cv::Scalar::all(255));
+  cv::Mat converted(expected.size(), CV_8UC3);
+  YuvPlanesToRgb(planes, converted);
+  EXPECT_LE(cv::norm(converted, expected, cv::NORM_INF),
+            kMaxRoundTripDifference);
+}
+
+INSTANTIATE_TEST_SUITE_P(YuvImageUtilTests, YuvImageUtilTest,
+                         testing::Values(libyuv::FOURCC_I420,
+                                         libyuv::FOURCC_NV12));
+
+TEST(YuvImageUtilTest, AlignsRectsWithChroma) {
+  EXPECT_EQ(ChromaAlignedRect(cv::Rect(3, 5, 4, 4), cv::Size(64, 48)),
+            cv::Rect(2, 4, 6, 6));
+  EXPECT_EQ(ChromaAlignedRect(cv::Rect(-3, 40, 10, 20), cv::Size(64, 48)),
+            cv::Rect(0, 40, 8, 8));
+  EXPECT_TRUE(
+      ChromaAlignedRect(cv::Rect(70, 0, 10, 10), cv::Size(64, 48)).empty());
+}
+
+TEST(YuvImageUtilTest, ScalesRectsToPlanes) {
+  const cv::Mat luma(48, 64, CV_8UC1);
+  const cv::Mat chroma(24, 32, CV_8UC2);
+
+  EXPECT_EQ(PlaneRect(cv::Rect(3, 5, 4, 4), luma.size(), luma),
+            cv::Rect(3, 5, 4, 4));
+  EXPECT_EQ(PlaneRect(cv::Rect(3, 5, 4, 4), luma.size(), chroma),
+            cv::Rect(1, 2, 3, 3));
+}
+
+}  // namespace
+}  // namespace magritte
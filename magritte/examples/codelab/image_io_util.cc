@@ -15,7 +15,12 @@
 //
 #include "magritte/examples/codelab/image_io_util.h"
 
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <iterator>
 #include <memory>
+#include <string>
 
 #include "mediapipe/framework/calculator_framework.h"
 #include "mediapipe/framework/formats/image_format.pb.h"
@@ -25,11 +30,102 @@
 #include  <opencv2/imgproc.hpp>
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "mediapipe/framework/port/status.h"
 
 namespace magritte {
+namespace {
+
+// The TIFF tag of the EXIF orientation, and its SHORT type.
+constexpr uint32_t kOrientationTag = 0x0112;
+constexpr uint32_t kShortType = 3;
+
+// Returns the clockwise rotation in degrees of the image content relative to
+// upright for an EXIF orientation. Mirroring is ignored, as it does not change
+// the orientation of faces.
+int ExifOrientationToRotationDegrees(uint32_t orientation) {
+  switch (orientation) {
+    case 3:
+    case 4:
+      return 180;
+    case 5:
+    case 6:
+      return 270;
+    case 7:
+    case 8:
+      return 90;
+    default:
+      return 0;
+  }
+}
+
+// Returns the orientation in the first IFD of the given TIFF data, the format
+// of the EXIF payload, or 1 (upright) if there is none.
+uint32_t ReadTiffOrientation(absl::string_view tiff) {
+  if (tiff.size() < 8) return 1;
+  const bool big_endian = tiff.substr(0, 2) == "MM";
+  if (!big_endian && tiff.substr(0, 2) != "II") return 1;
+  const auto read = [tiff, big_endian](size_t offset, int num_bytes) {
+    uint32_t value = 0;
+    for (int i = 0; i < num_bytes; ++i) {
+      const int byte = big_endian ? i : num_bytes - 1 - i;
+      value = (value << 8) | static_cast<uint8_t>(tiff[offset + byte]);
+    }
+    return value;
+  };
+  const size_t ifd_offset = read(4, 4);
+  if (ifd_offset + 2 > tiff.size()) return 1;
+  const uint32_t num_entries = read(ifd_offset, 2);
+  for (uint32_t i = 0; i < num_entries; ++i) {
+    // Entries are 12 bytes: tag, type, count and value.
+    const size_t entry = ifd_offset + 2 + 12 * i;
+    if (entry + 12 > tiff.size()) break;
+    if (read(entry, 2) == kOrientationTag && read(entry + 2, 2) == kShortType) {
+      return read(entry + 8, 2);
+    }
+  }
+  return 1;
+}
+
+// Returns the clockwise rotation in degrees of the content of a JPEG file
+// relative to upright, from its EXIF orientation. Returns 0 for files without
+// one, including all non-JPEG files.
+int ReadExifRotationDegrees(const std::string& file_path) {
+  std::ifstream file(file_path, std::ios::binary);
+  const std::string data((std::istreambuf_iterator<char>(file)),
+                         std::istreambuf_iterator<char>());
+  const auto byte = [&data](size_t offset) -> uint32_t {
+    return static_cast<uint8_t>(data[offset]);
+  };
+  if (data.size() < 4 || byte(0) != 0xFF || byte(1) != 0xD8) return 0;
+  // Walks the JPEG segments, each starting with a 0xFF marker byte and its
+  // type, followed by a big-endian length that includes the length itself.
+  size_t offset = 2;
+  while (offset + 4 <= data.size() && byte(offset) == 0xFF) {
+    const uint32_t marker = byte(offset + 1);
+    const size_t length = (byte(offset + 2) << 8) | byte(offset + 3);
+    // The metadata segments all come before the start of scan.
+    if (marker == 0xDA || marker == 0xD9 || length < 2) return 0;
+    const size_t payload = offset + 4;
+    const size_t end = std::min(offset + 2 + length, data.size());
+    // The EXIF data is in the APP1 segment, after an "Exif\0\0" header.
+    constexpr absl::string_view kExifHeader("Exif\0\0", 6);
+    if (marker == 0xE1 && end >= payload + kExifHeader.size() &&
+        absl::string_view(data).substr(payload, kExifHeader.size()) ==
+            kExifHeader) {
+      const size_t tiff = payload + kExifHeader.size();
+      return ExifOrientationToRotationDegrees(ReadTiffOrientation(
+          absl::string_view(data).substr(tiff, end - tiff)));
+    }
+    offset += 2 + length;
+  }
+  return 0;
+}
+
+}  // namespace
 
 absl::StatusOr<std::unique_ptr<mediapipe::ImageFrame>> LoadFromFile(
-    const std::string& file_path) {
+    const std::string& file_path, ChannelOrder channel_order) {
   cv::Mat mat = cv::imread(file_path, cv::IMREAD_UNCHANGED);
   if (mat.empty()) {
     return absl::InternalError("Could not read image");
@@ -37,6 +133,12 @@ absl::StatusOr<std::unique_ptr<mediapipe::ImageFrame>> LoadFromFile(
   if (mat.type() != CV_8UC3) {
     return absl::UnimplementedError("Expected image in CV_8UC3 format");
   }
+  if (channel_order == ChannelOrder::kBgr) {
+    // The ImageFrame adopts the pixels of the Mat, which it keeps alive.
+    return std::make_unique<mediapipe::ImageFrame>(
+        mediapipe::ImageFormat::SRGB, mat.cols, mat.rows, mat.step, mat.data,
+        [mat](uint8_t*) {});
+  }
   std::unique_ptr<mediapipe::ImageFrame> image_frame =
       std::make_unique<mediapipe::ImageFrame>(
           mediapipe::ImageFormat::SRGB, mat.size().width, mat.size().height);
@@ -46,15 +148,29 @@ absl::StatusOr<std::unique_ptr<mediapipe::ImageFrame>> LoadFromFile(
   return image_frame;
 }
 
+absl::StatusOr<std::unique_ptr<mediapipe::ImageFrame>> LoadFromFile(
+    const std::string& file_path, int* rotation_degrees,
+    ChannelOrder channel_order) {
+  ASSIGN_OR_RETURN(std::unique_ptr<mediapipe::ImageFrame> image_frame,
+                   LoadFromFile(file_path, channel_order));
+  *rotation_degrees = ReadExifRotationDegrees(file_path);
+  return image_frame;
+}
+
 absl::Status SaveToFile(const std::string& file_path,
-                        const mediapipe::ImageFrame& image_frame) {
+                        const mediapipe::ImageFrame& image_frame,
+                        ChannelOrder channel_order) {
   if (image_frame.Format() != mediapipe::ImageFormat::SRGB) {
     return absl::UnimplementedError("Expected ImageFrame in SRGB format");
   }
-  // OpenCV can only write color images in BGR format, so we need to convert.
   cv::Mat output_mat;
-  cv::cvtColor(mediapipe::formats::MatView(&image_frame), output_mat,
-               cv::COLOR_RGB2BGR);
+  if (channel_order == ChannelOrder::kBgr) {
+    output_mat = mediapipe::formats::MatView(&image_frame);
+  } else {
+    // OpenCV can only write color images in BGR format, so we need to convert.
+    cv::cvtColor(mediapipe::formats::MatView(&image_frame), output_mat,
+                 cv::COLOR_RGB2BGR);
+  }
   if (!cv::imwrite(file_path, output_mat)) {
     return absl::InternalError("Could not write image");
   }
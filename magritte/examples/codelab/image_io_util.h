@@ -17,10 +17,12 @@
 #define MAGRITTE_EXAMPLES_CODELAB_IMAGE_IO_UTIL_H_
 
 #include <memory>
+#include <string>
 
 #include "mediapipe/framework/formats/image_frame.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "magritte/calculators/channel_order_service.h"
 
 namespace magritte {
 
@@ -31,8 +33,22 @@ namespace magritte {
 // This function uses OpenCV to read image files. It therefore supports the same
 // file formats as OpenCV. See
 // https://docs.opencv.org/4.6.0/d4/da8/group__imgcodecs.html#ga288b8b3da0892bd651fce07b3bbd3a56.
+//
+// With ChannelOrder::kBgr, the returned SRGB ImageFrame holds the BGR buffer
+// decoded by OpenCV as is, without a conversion or a copy. Such frames are to
+// be given to a Deidentifier created with the same channel order.
+absl::StatusOr<std::unique_ptr<mediapipe::ImageFrame>> LoadFromFile(
+    const std::string& file_path,
+    ChannelOrder channel_order = ChannelOrder::kRgb);
+
+// Same as above, and also returns in rotation_degrees the clockwise rotation
+// of the content of the image relative to upright, read from the EXIF
+// orientation of JPEG files. It is 0 for images without EXIF orientation. The
+// image itself is returned as stored, without applying the EXIF orientation,
+// and the rotation can be given as a hint to the Deidentify API.
 absl::StatusOr<std::unique_ptr<mediapipe::ImageFrame>> LoadFromFile(
-    const std::string& file_path);
+    const std::string& file_path, int* rotation_degrees,
+    ChannelOrder channel_order = ChannelOrder::kRgb);
 
 // Saves a given ImageFrame into a file.
 //
@@ -41,8 +57,12 @@ absl::StatusOr<std::unique_ptr<mediapipe::ImageFrame>> LoadFromFile(
 // This function uses OpenCV to write image files. It therefore supports the
 // same file formats as OpenCV. See
 // https://docs.opencv.org/4.6.0/d4/da8/group__imgcodecs.html#ga288b8b3da0892bd651fce07b3bbd3a56.
+//
+// With ChannelOrder::kBgr, the ImageFrame is taken to hold BGR data, and is
+// written without a conversion.
 absl::Status SaveToFile(const std::string& file_path,
-                        const mediapipe::ImageFrame& image_frame);
+                        const mediapipe::ImageFrame& image_frame,
+                        ChannelOrder channel_order = ChannelOrder::kRgb);
 
 }  // namespace magritte
 
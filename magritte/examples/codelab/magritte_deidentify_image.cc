@@ -28,12 +28,14 @@
 #include "mediapipe/framework/calculator.pb.h"
 #include "mediapipe/framework/port/status.h"
 
-// Name of the Magritte graph that will be used for processing.
-constexpr char kGraphName[] = "FacePixelizationOfflineCpu";
-
 ABSL_FLAG(std::string, input_file, "", "input file path");
 ABSL_FLAG(std::string, output_file, "", "output file path");
 ABSL_FLAG(bool, async, false, "Deidentify asynchronously");
+ABSL_FLAG(std::string, graph_name, "FacePixelizationOfflineCpu",
+          "Name of the Magritte graph that will be used for processing. Graphs "
+          "with a rotation_degrees input stream, e.g. "
+          "FaceBlurWithTrackingOfflineCpu, only detect faces in the "
+          "orientation given by the EXIF data of the image.");
 
 // Uses the synchronous Magritte API to deidentify an image file and save the
 // result to an output file.
@@ -42,14 +44,16 @@ absl::Status RunSync(const std::string& graph_name,
                      const std::string& output_file) {
   ASSIGN_OR_RETURN(mediapipe::CalculatorGraphConfig graph_config,
                    magritte::MagritteGraphByName(graph_name));
+  int rotation_degrees = 0;
   ASSIGN_OR_RETURN(std::unique_ptr<mediapipe::ImageFrame> image,
-                   magritte::LoadFromFile(input_file));
+                   magritte::LoadFromFile(input_file, &rotation_degrees));
   ASSIGN_OR_RETURN(
       std::unique_ptr<magritte::DeidentifierSync<mediapipe::ImageFrame>>
           deidentifier,
       magritte::CreateCpuDeidentifierSync(graph_config));
   ASSIGN_OR_RETURN(std::unique_ptr<mediapipe::ImageFrame> result,
-                   deidentifier->Deidentify(std::move(image)));
+                   deidentifier->Deidentify(std::move(image), 0,
+                                            rotation_degrees));
   MP_RETURN_IF_ERROR(deidentifier->Close());
   return magritte::SaveToFile(output_file, *result);
 }
@@ -61,8 +65,9 @@ absl::Status RunAsync(const std::string& graph_name,
                       const std::string& output_file) {
   ASSIGN_OR_RETURN(mediapipe::CalculatorGraphConfig graph_config,
                    magritte::MagritteGraphByName(graph_name));
+  int rotation_degrees = 0;
   ASSIGN_OR_RETURN(std::unique_ptr<mediapipe::ImageFrame> image,
-                   magritte::LoadFromFile(input_file));
+                   magritte::LoadFromFile(input_file, &rotation_degrees));
   ASSIGN_OR_RETURN(
       std::unique_ptr<magritte::DeidentifierAsync<mediapipe::ImageFrame>>
           deidentifier,
@@ -70,7 +75,8 @@ absl::Status RunAsync(const std::string& graph_name,
           graph_config, [&output_file](const mediapipe::ImageFrame& image) {
             return magritte::SaveToFile(output_file, image);
           }));
-  MP_RETURN_IF_ERROR(deidentifier->Deidentify(std::move(image), 0));
+  MP_RETURN_IF_ERROR(
+      deidentifier->Deidentify(std::move(image), 0, rotation_degrees));
   return deidentifier->Close();
 }
 
@@ -80,11 +86,12 @@ int main(int argc, char** argv) {
 
   std::string input_file = absl::GetFlag(FLAGS_input_file);
   std::string output_file = absl::GetFlag(FLAGS_output_file);
+  std::string graph_name = absl::GetFlag(FLAGS_graph_name);
   absl::Status status;
   if (absl::GetFlag(FLAGS_async)) {
-    status = RunAsync(kGraphName, input_file, output_file);
+    status = RunAsync(graph_name, input_file, output_file);
   } else {
-    status = RunSync(kGraphName, input_file, output_file);
+    status = RunSync(graph_name, input_file, output_file);
   }
   LOG(INFO) << status;
   return status.raw_code();
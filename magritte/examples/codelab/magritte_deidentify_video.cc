@@ -22,7 +22,6 @@
 #include "mediapipe/framework/formats/image_frame.h"
 #include "mediapipe/framework/formats/image_frame_opencv.h"
 #include  <opencv2/highgui.hpp>
-#include  <opencv2/imgproc.hpp>
 #include  <opencv2/video.hpp>
 #include "absl/flags/flag.h"
 #include "absl/status/status.h"
@@ -30,6 +29,7 @@
 #include "absl/strings/str_cat.h"
 #include "magritte/api/magritte_api.h"
 #include "magritte/api/magritte_api_factory.h"
+#include "magritte/calculators/channel_order_service.h"
 #include "mediapipe/framework/calculator.pb.h"
 #include "mediapipe/framework/port/status.h"
 
@@ -60,21 +60,26 @@ absl::Status Run(const std::string& graph_name, const std::string& input_file,
   ASSIGN_OR_RETURN(
       std::unique_ptr<magritte::DeidentifierSync<mediapipe::ImageFrame>>
           deidentifier,
-      magritte::CreateCpuDeidentifierSync(graph_config));
+      magritte::CreateCpuDeidentifierSync(graph_config,
+                                          magritte::ChannelOrder::kBgr));
 
-  // Read, process and write frames from the video until reaching the end.
+  // Read, process and write frames from the video until reaching the end. The
+  // Deidentifier takes frames in the BGR order of OpenCV, as the graph detects
+  // faces through ImagePyramidCalculator, so no conversion is needed in either
+  // direction.
   cv::VideoWriter writer;
-  cv::Mat frame_raw;
   int frame_number = 0;
-  for (capture >> frame_raw; !frame_raw.empty(); capture >> frame_raw) {
+  while (true) {
+    // A new Mat for each frame, as the previous ones may still be in use by
+    // the graph.
+    cv::Mat frame_raw;
+    if (!capture.read(frame_raw) || frame_raw.empty()) break;
     ++frame_number;
 
-    // Convert raw frame into an ImageFrame with the right format.
+    // Wrap the raw frame into an ImageFrame, which keeps the Mat alive.
     auto input_frame = std::make_unique<mediapipe::ImageFrame>(
         mediapipe::ImageFormat::SRGB, frame_raw.cols, frame_raw.rows,
-        mediapipe::ImageFrame::kDefaultAlignmentBoundary);
-    cv::cvtColor(frame_raw, mediapipe::formats::MatView(input_frame.get()),
-                 cv::COLOR_BGR2RGB);
+        frame_raw.step, frame_raw.data, [frame_raw](uint8_t*) {});
 
     // Send the ImageFrame to the Deidentifier.
     ASSIGN_OR_RETURN(
@@ -82,10 +87,8 @@ absl::Status Run(const std::string& graph_name, const std::string& input_file,
         deidentifier->Deidentify(std::move(input_frame),
                                  frame_number * frame_duration_us));
 
-    // Convert the result back to the format required for writing.
-    cv::Mat deidentified_mat;
-    cv::cvtColor(mediapipe::formats::MatView(deidentified_frame.get()),
-                 deidentified_mat, cv::COLOR_RGB2BGR);
+    const cv::Mat deidentified_mat =
+        mediapipe::formats::MatView(deidentified_frame.get());
 
     // Write the output frame.
     if (!writer.isOpened()) {
@@ -0,0 +1,184 @@
+//
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Compares the recall and throughput of face detection on sparse keyframes
+// followed by bidirectional tracking, as in
+// FaceBlurWithBidirectionalTrackingOfflineCpu, with face detection on every
+// frame.
+//
+// The detections on every frame are the reference: the recall is the fraction
+// of them that are also found, with an intersection over union of at least
+// --min_iou, by detection on every frame followed by forward tracking, as in
+// FaceBlurWithTrackingOfflineCpu, and by detection on 1 in N keyframes followed
+// by bidirectional tracking, for several N and for the adaptive keyframe rate.
+// The precision is the fraction of the detections of a run that match a
+// reference detection.
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "magritte/examples/desktop/detection_eval_util.h"
+#include "mediapipe/framework/calculator.pb.h"
+#include "mediapipe/framework/port/parse_text_proto.h"
+#include  <opencv2/core.hpp>
+#include "absl/flags/flag.h"
+#include "absl/flags/parse.h"
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/substitute.h"
+#include "absl/time/time.h"
+#include "mediapipe/framework/port/logging.h"
+#include "mediapipe/framework/port/ret_check.h"
+#include "mediapipe/framework/port/status.h"
+
+constexpr char kDetectionGraphType[] =
+    "FaceDetection360ShortAndFullRangeByRoiSubgraphCpu";
+// The keyframe intervals, in frames.
+constexpr int kKeyframeIntervals[] = {5, 10, 15};
+
+ABSL_FLAG(std::string, input_video, "", "Full path of a video file.");
+ABSL_FLAG(int, max_frames, 300,
+          "Maximum number of frames of the input video to use.");
+ABSL_FLAG(double, frame_rate, 30.0, "Frame rate of the input video.");
+ABSL_FLAG(double, min_iou, 0.5,
+          "Minimum intersection over union for a reference detection to be "
+          "found.");
+
+namespace {
+
+using ::magritte::CountDetections;
+using ::magritte::CountFound;
+using ::magritte::DetectionGraphConfig;
+using ::magritte::DetectionRunResult;
+using ::magritte::DetectionsByFrame;
+using ::magritte::LoadFrames;
+using ::magritte::RunDetectionGraph;
+
+// Returns the nodes of FaceBlurWithBidirectionalTrackingOfflineCpu up to the
+// tracking, with keyframes sampled at the given range of rates, and the
+// streams expected by RunDetectionGraph.
+mediapipe::CalculatorGraphConfig BidirectionalTrackingGraphConfig(
+    double min_frame_rate, double max_frame_rate) {
+  return mediapipe::ParseTextProtoOrDie<mediapipe::CalculatorGraphConfig>(
+      absl::Substitute(R"pb(
+                         input_stream: "input_video"
+                         output_stream: "detections"
+                         node {
+                           calculator: "SceneCutCalculator"
+                           input_stream: "IMAGE:input_video"
+                           output_stream: "SCENE_CUT:scene_cut"
+                         }
+                         node {
+                           calculator: "AdaptiveSamplerCalculator"
+                           input_stream: "IMAGE:input_video"
+                           input_stream: "SCENE_CUT:scene_cut"
+                           output_stream: "SAMPLED_IMAGE:keyframe_video"
+                           options: {
+                             [magritte.AdaptiveSamplerCalculatorOptions.ext] {
+                               min_frame_rate: $1
+                               max_frame_rate: $2
+                             }
+                           }
+                         }
+                         node {
+                           calculator: "$0"
+                           input_stream: "IMAGE:keyframe_video"
+                           output_stream: "DETECTIONS:keyframe_detections"
+                         }
+                         node {
+                           calculator: "BidirectionalTrackingSubgraphCpu"
+                           input_stream: "IMAGE:input_video"
+                           input_stream: "DETECTIONS:keyframe_detections"
+                           output_stream: "DETECTIONS:detections"
+                         }
+                       )pb",
+                       kDetectionGraphType, min_frame_rate, max_frame_rate));
+}
+
+void PrintRow(const std::string& name, const DetectionsByFrame& reference,
+              const DetectionRunResult& run, int num_frames) {
+  const float min_iou = absl::GetFlag(FLAGS_min_iou);
+  const int num_reference = CountDetections(reference);
+  const int num_detections = CountDetections(run.detections);
+  std::printf(
+      "%22s %10.3f %10.3f %10.1f\n", name.c_str(),
+      num_reference > 0
+          ? 1.0 * CountFound(reference, run.detections, min_iou) /
+                num_reference
+          : 1.0,
+      num_detections > 0
+          ? 1.0 * CountFound(run.detections, reference, min_iou) /
+                num_detections
+          : 1.0,
+      num_frames / absl::ToDoubleSeconds(run.duration));
+}
+
+absl::Status RunEvaluation() {
+  ASSIGN_OR_RETURN(std::vector<cv::Mat> frames,
+                   LoadFrames(absl::GetFlag(FLAGS_input_video),
+                              absl::GetFlag(FLAGS_max_frames)));
+  RET_CHECK(!frames.empty()) << "The input video has no frames.";
+  const double frame_rate = absl::GetFlag(FLAGS_frame_rate);
+
+  ASSIGN_OR_RETURN(
+      DetectionRunResult reference,
+      RunDetectionGraph(DetectionGraphConfig(kDetectionGraphType), frames,
+                        frame_rate));
+  std::printf("Reference detections: %d\n",
+              CountDetections(reference.detections));
+  std::printf("%22s %10s %10s %10s\n", "detection", "recall", "precision",
+              "fps");
+  PrintRow("every frame", reference.detections, reference, frames.size());
+
+  ASSIGN_OR_RETURN(
+      DetectionRunResult tracked,
+      RunDetectionGraph(DetectionGraphConfig(kDetectionGraphType,
+                                             /*with_tracking=*/true),
+                        frames, frame_rate));
+  PrintRow("every frame, tracked", reference.detections, tracked,
+           frames.size());
+
+  for (const int interval : kKeyframeIntervals) {
+    // Half a frame less than the interval, for the rounded timestamps.
+    const double keyframe_rate = frame_rate / (interval - 0.5);
+    ASSIGN_OR_RETURN(
+        DetectionRunResult bidirectional,
+        RunDetectionGraph(
+            BidirectionalTrackingGraphConfig(keyframe_rate, keyframe_rate),
+            frames, frame_rate));
+    PrintRow(absl::StrCat("1 in ", interval, " frames"), reference.detections,
+             bidirectional, frames.size());
+  }
+  ASSIGN_OR_RETURN(
+      DetectionRunResult adaptive,
+      RunDetectionGraph(BidirectionalTrackingGraphConfig(3, 10), frames,
+                        frame_rate));
+  PrintRow("3 to 10 fps", reference.detections, adaptive, frames.size());
+  return absl::OkStatus();
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  google::InitGoogleLogging(argv[0]);
+  absl::ParseCommandLine(argc, argv);
+  absl::Status status = RunEvaluation();
+  if (!status.ok()) {
+    LOG(ERROR) << "Failed to run the evaluation: " << status.message();
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
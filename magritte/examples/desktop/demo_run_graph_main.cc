@@ -14,9 +14,11 @@
 // limitations under the License.
 //
 // An example of sending video frames into a Magritte graph.
+#include <cstdint>
 #include <cstdlib>
 #include <map>
 #include <memory>
+#include <string>
 
 #include "mediapipe/framework/calculator_framework.h"
 #include "mediapipe/framework/formats/image_frame.h"
@@ -27,6 +29,7 @@
 #include "absl/flags/flag.h"
 #include "absl/flags/parse.h"
 #include "absl/status/status.h"
+#include "magritte/calculators/channel_order_service.h"
 #include "mediapipe/framework/port/status.h"
 #include "mediapipe/framework/subgraph.h"
 
@@ -53,6 +56,12 @@ ABSL_FLAG(float, sticker_zoom, 1.0,
           "The default extra zoom applied to the sticker. "
           "Only used in the sticker redaction graphs. "
           "If not provided, the default is 1.0.");
+ABSL_FLAG(bool, bgr_frames, false,
+          "Whether to give the frames to the graph in the BGR order of "
+          "OpenCV, without converting them. Only for the graphs whose "
+          "detection models get their frames through ImagePyramidCalculator "
+          "and that draw no annotations, e.g. FacePixelizationOfflineCpu. "
+          "If not provided, the frames are converted to RGB.");
 
 absl::Status RunMediaPipeGraph() {
   std::string calculator_graph_config_contents;
@@ -75,6 +84,15 @@ absl::Status RunMediaPipeGraph() {
   LOG(INFO) << "Initialize the graph.";
   mediapipe::CalculatorGraph graph;
   MP_RETURN_IF_ERROR(graph.Initialize(config, input_side_packets));
+  // Frames are only given in the BGR order of OpenCV to the graphs that
+  // support it, see --bgr_frames.
+  const bool bgr_frames = absl::GetFlag(FLAGS_bgr_frames);
+  if (bgr_frames) {
+    MP_RETURN_IF_ERROR(graph.SetServiceObject(
+        magritte::kChannelOrderService,
+        std::make_shared<magritte::ChannelOrder>(
+            magritte::ChannelOrder::kBgr)));
+  }
 
   LOG(INFO) << "Initialize the camera or load the video.";
   cv::VideoCapture capture;
@@ -111,6 +129,13 @@ absl::Status RunMediaPipeGraph() {
   ASSIGN_OR_RETURN(mediapipe::OutputStreamPoller poller,
                    graph.AddOutputStreamPoller(kOutputStream));
   MP_RETURN_IF_ERROR(graph.StartRun({}));
+  // Only the video is fed, so optional input streams, e.g. rotation hints, are
+  // closed for the graph not to wait for them.
+  for (const std::string& input_stream : config.input_stream()) {
+    if (input_stream != kInputStream) {
+      MP_RETURN_IF_ERROR(graph.CloseInputStream(input_stream));
+    }
+  }
 
   LOG(INFO) << "Start grabbing and processing frames.";
   bool grab_frames = true;
@@ -120,17 +145,19 @@ absl::Status RunMediaPipeGraph() {
     capture >> camera_frame_raw;
     if (camera_frame_raw.empty()) break;  // End of video.
     cv::Mat camera_frame;
-    cv::cvtColor(camera_frame_raw, camera_frame, cv::COLOR_BGR2RGB);
+    if (bgr_frames) {
+      camera_frame = camera_frame_raw;
+    } else {
+      cv::cvtColor(camera_frame_raw, camera_frame, cv::COLOR_BGR2RGB);
+    }
     if (!load_video) {
       cv::flip(camera_frame, camera_frame, /*flipcode=HORIZONTAL*/ 1);
     }
 
-    // Wrap Mat into an ImageFrame.
+    // Wrap Mat into an ImageFrame, which keeps it alive, without a copy.
     auto input_frame = std::make_unique<mediapipe::ImageFrame>(
         mediapipe::ImageFormat::SRGB, camera_frame.cols, camera_frame.rows,
-        mediapipe::ImageFrame::kDefaultAlignmentBoundary);
-    cv::Mat input_frame_mat = mediapipe::formats::MatView(input_frame.get());
-    camera_frame.copyTo(input_frame_mat);
+        camera_frame.step, camera_frame.data, [camera_frame](uint8_t*) {});
 
     // Send image packet into the graph.
     size_t frame_timestamp_us =
@@ -144,9 +171,15 @@ absl::Status RunMediaPipeGraph() {
     if (!poller.Next(&packet)) break;
     auto& output_frame = packet.Get<mediapipe::ImageFrame>();
 
-    // Convert back to opencv for display or saving.
-    cv::Mat output_frame_mat = mediapipe::formats::MatView(&output_frame);
-    cv::cvtColor(output_frame_mat, output_frame_mat, cv::COLOR_RGB2BGR);
+    // Convert back to opencv for display or saving, or only wrap it if it is
+    // already in BGR order.
+    cv::Mat output_frame_mat;
+    if (bgr_frames) {
+      output_frame_mat = mediapipe::formats::MatView(&output_frame);
+    } else {
+      cv::cvtColor(mediapipe::formats::MatView(&output_frame),
+                   output_frame_mat, cv::COLOR_RGB2BGR);
+    }
     if (save_video) {
       if (!writer.isOpened()) {
         LOG(INFO) << "Prepare video writer.";
@@ -0,0 +1,184 @@
+//
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+#include "magritte/examples/desktop/detection_eval_util.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/formats/image_frame.h"
+#include "mediapipe/framework/formats/image_frame_opencv.h"
+#include "mediapipe/framework/formats/location_data.pb.h"
+#include "mediapipe/framework/port/parse_text_proto.h"
+#include  <opencv2/imgproc.hpp>
+#include  <opencv2/video.hpp>
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/substitute.h"
+#include "absl/time/clock.h"
+#include "mediapipe/framework/port/status.h"
+
+namespace magritte {
+namespace {
+
+constexpr char kInputStream[] = "input_video";
+constexpr char kOutputStream[] = "detections";
+
+}  // namespace
+
+absl::StatusOr<std::vector<cv::Mat>> LoadFrames(const std::string& path,
+                                                int max_frames) {
+  cv::VideoCapture capture(path);
+  if (!capture.isOpened()) {
+    return absl::NotFoundError(absl::StrCat("Cannot open video file ", path));
+  }
+  std::vector<cv::Mat> frames;
+  while (static_cast<int>(frames.size()) < max_frames) {
+    cv::Mat frame;
+    capture >> frame;
+    if (frame.empty()) break;
+    cv::cvtColor(frame, frame, cv::COLOR_BGR2RGB);
+    frames.push_back(frame);
+  }
+  return frames;
+}
+
+mediapipe::CalculatorGraphConfig DetectionGraphConfig(
+    const std::string& graph_type, bool with_tracking) {
+  if (!with_tracking) {
+    return mediapipe::ParseTextProtoOrDie<mediapipe::CalculatorGraphConfig>(
+        absl::Substitute(R"pb(
+                           input_stream: "$1"
+                           output_stream: "$2"
+                           node {
+                             calculator: "$0"
+                             input_stream: "IMAGE:$1"
+                             output_stream: "DETECTIONS:$2"
+                           }
+                         )pb",
+                         graph_type, kInputStream, kOutputStream));
+  }
+  return mediapipe::ParseTextProtoOrDie<mediapipe::CalculatorGraphConfig>(
+      absl::Substitute(R"pb(
+                         input_stream: "$1"
+                         output_stream: "$2"
+                         node {
+                           calculator: "$0"
+                           input_stream: "IMAGE:$1"
+                           output_stream: "DETECTIONS:raw_detections"
+                         }
+                         node {
+                           calculator: "TrackingSubgraphCpu"
+                           input_stream: "IMAGE:$1"
+                           input_stream: "DETECTIONS:raw_detections"
+                           output_stream: "DETECTIONS:$2"
+                         }
+                       )pb",
+                       graph_type, kInputStream, kOutputStream));
+}
+
+absl::StatusOr<DetectionRunResult> RunDetectionGraph(
+    const mediapipe::CalculatorGraphConfig& graph_config,
+    const std::vector<cv::Mat>& frames, double frame_rate) {
+  mediapipe::CalculatorGraph graph;
+  MP_RETURN_IF_ERROR(graph.Initialize(graph_config));
+
+  // The frame indices by timestamp.
+  const int num_frames = static_cast<int>(frames.size());
+  absl::flat_hash_map<int64_t, int> frame_indices;
+  for (int i = 0; i < num_frames; ++i) {
+    frame_indices[std::llround(i * 1e6 / frame_rate)] = i;
+  }
+
+  DetectionRunResult result;
+  MP_RETURN_IF_ERROR(graph.ObserveOutputStream(
+      kOutputStream,
+      [&result, &frame_indices](const mediapipe::Packet& packet) {
+        result.detections[frame_indices.at(packet.Timestamp().Value())] =
+            packet.Get<std::vector<mediapipe::Detection>>();
+        return absl::OkStatus();
+      }));
+
+  // Frames are copied into ImageFrames before timing.
+  std::vector<mediapipe::Packet> packets;
+  for (int i = 0; i < num_frames; ++i) {
+    auto input_frame = std::make_unique<mediapipe::ImageFrame>(
+        mediapipe::ImageFormat::SRGB, frames[i].cols, frames[i].rows,
+        mediapipe::ImageFrame::kDefaultAlignmentBoundary);
+    frames[i].copyTo(mediapipe::formats::MatView(input_frame.get()));
+    packets.push_back(
+        mediapipe::Adopt(input_frame.release())
+            .At(mediapipe::Timestamp(std::llround(i * 1e6 / frame_rate))));
+  }
+
+  const absl::Time start = absl::Now();
+  MP_RETURN_IF_ERROR(graph.StartRun({}));
+  for (mediapipe::Packet& packet : packets) {
+    MP_RETURN_IF_ERROR(
+        graph.AddPacketToInputStream(kInputStream, std::move(packet)));
+  }
+  MP_RETURN_IF_ERROR(graph.CloseInputStream(kInputStream));
+  MP_RETURN_IF_ERROR(graph.WaitUntilDone());
+  result.duration = absl::Now() - start;
+  return result;
+}
+
+float IntersectionOverUnion(const mediapipe::Detection& a,
+                            const mediapipe::Detection& b) {
+  const auto& box_a = a.location_data().relative_bounding_box();
+  const auto& box_b = b.location_data().relative_bounding_box();
+  const float width =
+      std::min(box_a.xmin() + box_a.width(), box_b.xmin() + box_b.width()) -
+      std::max(box_a.xmin(), box_b.xmin());
+  const float height =
+      std::min(box_a.ymin() + box_a.height(), box_b.ymin() + box_b.height()) -
+      std::max(box_a.ymin(), box_b.ymin());
+  if (width <= 0 || height <= 0) return 0.0f;
+  const float intersection = width * height;
+  return intersection / (box_a.width() * box_a.height() +
+                         box_b.width() * box_b.height() - intersection);
+}
+
+int CountFound(const DetectionsByFrame& reference,
+               const DetectionsByFrame& detections, float min_iou) {
+  int found = 0;
+  for (const auto& [frame, reference_detections] : reference) {
+    const auto it = detections.find(frame);
+    if (it == detections.end()) continue;
+    for (const mediapipe::Detection& expected : reference_detections) {
+      for (const mediapipe::Detection& actual : it->second) {
+        if (IntersectionOverUnion(expected, actual) >= min_iou) {
+          ++found;
+          break;
+        }
+      }
+    }
+  }
+  return found;
+}
+
+int CountDetections(const DetectionsByFrame& detections) {
+  int count = 0;
+  for (const auto& [frame, frame_detections] : detections) {
+    count += frame_detections.size();
+  }
+  return count;
+}
+
+}  // namespace magritte
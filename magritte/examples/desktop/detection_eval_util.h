@@ -0,0 +1,74 @@
+//
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+#ifndef MAGRITTE_EXAMPLES_DESKTOP_DETECTION_EVAL_UTIL_H_
+#define MAGRITTE_EXAMPLES_DESKTOP_DETECTION_EVAL_UTIL_H_
+
+// Utilities for the desktop tools that compare the recall and throughput of
+// face detection subgraphs.
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "mediapipe/framework/calculator.pb.h"
+#include "mediapipe/framework/formats/detection.pb.h"
+#include  <opencv2/core.hpp>
+#include "absl/status/statusor.h"
+#include "absl/time/time.h"
+
+namespace magritte {
+
+// Detections of a run, by frame index.
+using DetectionsByFrame = std::map<int, std::vector<mediapipe::Detection>>;
+
+struct DetectionRunResult {
+  DetectionsByFrame detections;
+  absl::Duration duration;
+};
+
+// Loads at most max_frames frames of a video file, in RGB.
+absl::StatusOr<std::vector<cv::Mat>> LoadFrames(const std::string& path,
+                                                int max_frames);
+
+// Returns a graph config running a detection subgraph of the given type, with
+// an IMAGE input and a DETECTIONS output, on the "input_video" stream. When
+// with_tracking is true, the detections are tracked by TrackingSubgraphCpu.
+mediapipe::CalculatorGraphConfig DetectionGraphConfig(
+    const std::string& graph_type, bool with_tracking = false);
+
+// Runs a graph made with DetectionGraphConfig on the frames, timestamped at the
+// given frame rate, and returns its detections and the time it took, excluding
+// graph initialization.
+absl::StatusOr<DetectionRunResult> RunDetectionGraph(
+    const mediapipe::CalculatorGraphConfig& graph_config,
+    const std::vector<cv::Mat>& frames, double frame_rate = 30.0);
+
+// Returns the intersection over union of the bounding boxes of two detections.
+float IntersectionOverUnion(const mediapipe::Detection& a,
+                            const mediapipe::Detection& b);
+
+// Returns the number of reference detections that have a match, with an
+// intersection over union of at least min_iou, among the detections of the
+// same frame.
+int CountFound(const DetectionsByFrame& reference,
+               const DetectionsByFrame& detections, float min_iou);
+
+// Returns the total number of detections of all frames.
+int CountDetections(const DetectionsByFrame& detections);
+
+}  // namespace magritte
+
+#endif  // MAGRITTE_EXAMPLES_DESKTOP_DETECTION_EVAL_UTIL_H_
@@ -0,0 +1,102 @@
+//
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Compares the recall and throughput of the scheduled short and full-range face
+// detection subgraph with the subgraph running both models on every frame.
+//
+// The frames of the input video are run through both subgraphs, first alone
+// and then followed by tracking, which carries the faces found by the
+// full-range model forward in the scheduled subgraph. The detections of the
+// subgraph running both models are the reference: the recall is the fraction
+// of them that the scheduled subgraph also finds, with an intersection over
+// union of at least --min_iou.
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "magritte/examples/desktop/detection_eval_util.h"
+#include  <opencv2/core.hpp>
+#include "absl/flags/flag.h"
+#include "absl/flags/parse.h"
+#include "absl/status/status.h"
+#include "absl/time/time.h"
+#include "mediapipe/framework/port/logging.h"
+#include "mediapipe/framework/port/ret_check.h"
+#include "mediapipe/framework/port/status.h"
+
+constexpr char kReferenceGraphType[] =
+    "FaceDetectionShortAndFullRangeSubgraphCpu";
+constexpr char kScheduledGraphType[] =
+    "FaceDetectionShortAndFullRangeScheduledSubgraphCpu";
+
+ABSL_FLAG(std::string, input_video, "", "Full path of a video file.");
+ABSL_FLAG(int, max_frames, 300,
+          "Maximum number of frames of the input video to use.");
+ABSL_FLAG(double, min_iou, 0.5,
+          "Minimum intersection over union for a reference detection to be "
+          "found by the scheduled subgraph.");
+
+namespace {
+
+using ::magritte::CountDetections;
+using ::magritte::CountFound;
+using ::magritte::DetectionGraphConfig;
+using ::magritte::DetectionRunResult;
+using ::magritte::LoadFrames;
+using ::magritte::RunDetectionGraph;
+
+absl::Status RunEvaluation() {
+  ASSIGN_OR_RETURN(std::vector<cv::Mat> frames,
+                   LoadFrames(absl::GetFlag(FLAGS_input_video),
+                              absl::GetFlag(FLAGS_max_frames)));
+  RET_CHECK(!frames.empty()) << "The input video has no frames.";
+
+  std::printf("%10s %10s %8s %14s %14s\n", "tracking", "reference", "recall",
+              "both fps", "scheduled fps");
+  for (const bool with_tracking : {false, true}) {
+    ASSIGN_OR_RETURN(
+        DetectionRunResult reference,
+        RunDetectionGraph(
+            DetectionGraphConfig(kReferenceGraphType, with_tracking), frames));
+    ASSIGN_OR_RETURN(
+        DetectionRunResult scheduled,
+        RunDetectionGraph(
+            DetectionGraphConfig(kScheduledGraphType, with_tracking), frames));
+    const int num_reference = CountDetections(reference.detections);
+    const int num_found = CountFound(reference.detections,
+                                     scheduled.detections,
+                                     absl::GetFlag(FLAGS_min_iou));
+    std::printf("%10s %10d %8.3f %14.1f %14.1f\n", with_tracking ? "yes" : "no",
+                num_reference,
+                num_reference > 0 ? 1.0 * num_found / num_reference : 1.0,
+                frames.size() / absl::ToDoubleSeconds(reference.duration),
+                frames.size() / absl::ToDoubleSeconds(scheduled.duration));
+  }
+  return absl::OkStatus();
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  google::InitGoogleLogging(argv[0]);
+  absl::ParseCommandLine(argc, argv);
+  absl::Status status = RunEvaluation();
+  if (!status.ok()) {
+    LOG(ERROR) << "Failed to run the evaluation: " << status.message();
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,130 @@
+//
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Compares the recall and throughput of the orientation cascade face detection
+// subgraph with the exhaustive 360° subgraph, on synthetic rotated faces.
+//
+// The frames of the input video, which should contain upright faces, are
+// rotated by 0°, 90°, 180° and 270°. Each rotated sequence is run through both
+// subgraphs, each in a new graph so that the cascade starts from the upright
+// orientation. The detections of the exhaustive subgraph are the reference:
+// the recall is the fraction of them that the cascade also finds, with an
+// intersection over union of at least --min_iou.
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "magritte/examples/desktop/detection_eval_util.h"
+#include  <opencv2/core.hpp>
+#include "absl/flags/flag.h"
+#include "absl/flags/parse.h"
+#include "absl/status/status.h"
+#include "absl/time/time.h"
+#include "mediapipe/framework/port/logging.h"
+#include "mediapipe/framework/port/ret_check.h"
+#include "mediapipe/framework/port/status.h"
+
+constexpr char kReferenceGraphType[] =
+    "FaceDetection360ShortAndFullRangeByRoiSubgraphCpu";
+constexpr char kCascadeGraphType[] =
+    "FaceDetection360ShortAndFullRangeCascadeSubgraphCpu";
+
+ABSL_FLAG(std::string, input_video, "",
+          "Full path of a video file with upright faces.");
+ABSL_FLAG(int, max_frames, 100,
+          "Maximum number of frames of the input video to use.");
+ABSL_FLAG(double, min_iou, 0.5,
+          "Minimum intersection over union for a reference detection to be "
+          "found by the cascade.");
+
+namespace {
+
+using ::magritte::CountDetections;
+using ::magritte::CountFound;
+using ::magritte::DetectionGraphConfig;
+using ::magritte::DetectionRunResult;
+using ::magritte::LoadFrames;
+using ::magritte::RunDetectionGraph;
+
+absl::Status RunEvaluation() {
+  ASSIGN_OR_RETURN(std::vector<cv::Mat> frames,
+                   LoadFrames(absl::GetFlag(FLAGS_input_video),
+                              absl::GetFlag(FLAGS_max_frames)));
+  RET_CHECK(!frames.empty()) << "The input video has no frames.";
+
+  // OpenCV rotation codes, with -1 for no rotation.
+  const std::pair<int, const char*> rotations[] = {
+      {-1, "0"},
+      {cv::ROTATE_90_CLOCKWISE, "90"},
+      {cv::ROTATE_180, "180"},
+      {cv::ROTATE_90_COUNTERCLOCKWISE, "270"},
+  };
+  std::printf("%8s %10s %8s %14s %14s\n", "rotation", "reference", "recall",
+              "exhaustive fps", "cascade fps");
+  int total_reference = 0;
+  int total_found = 0;
+  absl::Duration total_reference_duration;
+  absl::Duration total_cascade_duration;
+  for (const auto& [rotate_code, name] : rotations) {
+    std::vector<cv::Mat> rotated_frames;
+    for (const cv::Mat& frame : frames) {
+      cv::Mat rotated = frame;
+      if (rotate_code >= 0) cv::rotate(frame, rotated, rotate_code);
+      rotated_frames.push_back(rotated);
+    }
+
+    ASSIGN_OR_RETURN(
+        DetectionRunResult reference,
+        RunDetectionGraph(DetectionGraphConfig(kReferenceGraphType),
+                          rotated_frames));
+    ASSIGN_OR_RETURN(
+        DetectionRunResult cascade,
+        RunDetectionGraph(DetectionGraphConfig(kCascadeGraphType),
+                          rotated_frames));
+    const int num_reference = CountDetections(reference.detections);
+    const int num_found = CountFound(reference.detections, cascade.detections,
+                                     absl::GetFlag(FLAGS_min_iou));
+    std::printf("%8s %10d %8.3f %14.1f %14.1f\n", name, num_reference,
+                num_reference > 0 ? 1.0 * num_found / num_reference : 1.0,
+                frames.size() / absl::ToDoubleSeconds(reference.duration),
+                frames.size() / absl::ToDoubleSeconds(cascade.duration));
+    total_reference += num_reference;
+    total_found += num_found;
+    total_reference_duration += reference.duration;
+    total_cascade_duration += cascade.duration;
+  }
+  std::printf("%8s %10d %8.3f %14.1f %14.1f\n", "all", total_reference,
+              total_reference > 0 ? 1.0 * total_found / total_reference : 1.0,
+              4 * frames.size() /
+                  absl::ToDoubleSeconds(total_reference_duration),
+              4 * frames.size() /
+                  absl::ToDoubleSeconds(total_cascade_duration));
+  return absl::OkStatus();
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  google::InitGoogleLogging(argv[0]);
+  absl::ParseCommandLine(argc, argv);
+  absl::Status status = RunEvaluation();
+  if (!status.ok()) {
+    LOG(ERROR) << "Failed to run the evaluation: " << status.message();
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
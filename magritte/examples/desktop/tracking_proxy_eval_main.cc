@@ -0,0 +1,144 @@
+//
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Compares the accuracy and throughput of tracking on downscaled grayscale
+// proxy frames, as in ProxyTrackingSubgraphCpu, with tracking on the full
+// resolution frames, as in TrackingSubgraphCpu.
+//
+// The frames of the input video are run through face detection followed by
+// tracking, at full resolution and then on proxies of several sizes. The
+// tracked detections at full resolution are the reference: the agreement is
+// the fraction of them that tracking on the proxy also finds, with an
+// intersection over union of at least --min_iou. A run without tracking gives
+// the throughput of the detection alone.
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "magritte/examples/desktop/detection_eval_util.h"
+#include "mediapipe/framework/calculator.pb.h"
+#include "mediapipe/framework/port/parse_text_proto.h"
+#include  <opencv2/core.hpp>
+#include "absl/flags/flag.h"
+#include "absl/flags/parse.h"
+#include "absl/status/status.h"
+#include "absl/strings/substitute.h"
+#include "absl/time/time.h"
+#include "mediapipe/framework/port/logging.h"
+#include "mediapipe/framework/port/ret_check.h"
+#include "mediapipe/framework/port/status.h"
+
+constexpr char kDetectionGraphType[] =
+    "FaceDetectionShortAndFullRangeSubgraphCpu";
+// The maximum width and height of the proxies.
+constexpr int kProxySizes[] = {320, 480, 640, 960};
+
+ABSL_FLAG(std::string, input_video, "", "Full path of a video file.");
+ABSL_FLAG(int, max_frames, 300,
+          "Maximum number of frames of the input video to use.");
+ABSL_FLAG(double, min_iou, 0.5,
+          "Minimum intersection over union for a reference detection to be "
+          "found by tracking on the proxy.");
+
+namespace {
+
+using ::magritte::CountDetections;
+using ::magritte::CountFound;
+using ::magritte::DetectionGraphConfig;
+using ::magritte::DetectionRunResult;
+using ::magritte::LoadFrames;
+using ::magritte::RunDetectionGraph;
+
+// Returns the nodes of ProxyTrackingSubgraphCpu with the given proxy size,
+// after the detection, with the streams expected by RunDetectionGraph.
+mediapipe::CalculatorGraphConfig ProxyTrackingGraphConfig(int proxy_size) {
+  return mediapipe::ParseTextProtoOrDie<mediapipe::CalculatorGraphConfig>(
+      absl::Substitute(R"pb(
+                         input_stream: "input_video"
+                         output_stream: "detections"
+                         node {
+                           calculator: "$0"
+                           input_stream: "IMAGE:input_video"
+                           output_stream: "DETECTIONS:raw_detections"
+                         }
+                         node {
+                           calculator: "ImagePyramidCalculator"
+                           input_stream: "IMAGE:input_video"
+                           output_stream: "LEVEL:0:tracking_proxy"
+                           options: {
+                             [magritte.ImagePyramidCalculatorOptions.ext] {
+                               max_size: $1
+                               grayscale: true
+                             }
+                           }
+                         }
+                         node {
+                           calculator: "TrackingSubgraphCpu"
+                           input_stream: "IMAGE:tracking_proxy"
+                           input_stream: "DETECTIONS:raw_detections"
+                           output_stream: "DETECTIONS:detections"
+                         }
+                       )pb",
+                       kDetectionGraphType, proxy_size));
+}
+
+absl::Status RunEvaluation() {
+  ASSIGN_OR_RETURN(std::vector<cv::Mat> frames,
+                   LoadFrames(absl::GetFlag(FLAGS_input_video),
+                              absl::GetFlag(FLAGS_max_frames)));
+  RET_CHECK(!frames.empty()) << "The input video has no frames.";
+  std::printf("Input size: %dx%d\n", frames[0].cols, frames[0].rows);
+
+  ASSIGN_OR_RETURN(
+      DetectionRunResult detection,
+      RunDetectionGraph(DetectionGraphConfig(kDetectionGraphType), frames));
+  ASSIGN_OR_RETURN(
+      DetectionRunResult reference,
+      RunDetectionGraph(DetectionGraphConfig(kDetectionGraphType,
+                                             /*with_tracking=*/true),
+                        frames));
+  const int num_reference = CountDetections(reference.detections);
+  std::printf("%10s %10s %10s %10s\n", "tracking", "reference", "agreement",
+              "fps");
+  std::printf("%10s %10s %10s %10.1f\n", "none", "", "",
+              frames.size() / absl::ToDoubleSeconds(detection.duration));
+  std::printf("%10s %10d %10.3f %10.1f\n", "full", num_reference, 1.0,
+              frames.size() / absl::ToDoubleSeconds(reference.duration));
+  for (const int proxy_size : kProxySizes) {
+    ASSIGN_OR_RETURN(
+        DetectionRunResult proxy,
+        RunDetectionGraph(ProxyTrackingGraphConfig(proxy_size), frames));
+    const int num_found = CountFound(reference.detections, proxy.detections,
+                                     absl::GetFlag(FLAGS_min_iou));
+    std::printf("%10d %10d %10.3f %10.1f\n", proxy_size, num_reference,
+                num_reference > 0 ? 1.0 * num_found / num_reference : 1.0,
+                frames.size() / absl::ToDoubleSeconds(proxy.duration));
+  }
+  return absl::OkStatus();
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  google::InitGoogleLogging(argv[0]);
+  absl::ParseCommandLine(argc, argv);
+  absl::Status status = RunEvaluation();
+  if (!status.ok()) {
+    LOG(ERROR) << "Failed to run the evaluation: " << status.message();
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}